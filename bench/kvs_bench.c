@@ -0,0 +1,527 @@
+#include "kvs.h"
+#include "../src/ssdmmc_sim/ssdmmc_sim.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+// Нагрузочный тест хранилища в духе YCSB: фаза загрузки записывает records ключей, фаза выполнения
+// выполняет operations операций чтения, обновления, вставки и удаления в заданных долях.
+// Результат - объект JSON (пропускная способность, процентили задержек, операции устройства,
+// сборка мусора и усиление записи), пригодный для сравнения между коммитами.
+//
+//   kvs_bench [--workload=a|b|c|d] [--records=N] [--operations=N]
+//             [--read=P] [--update=P] [--insert=P] [--delete=P]
+//             [--distribution=uniform|zipfian|latest] [--zipf-theta=T]
+//             [--value-size=fixed:N|uniform:MIN:MAX|zipfian:MIN:MAX]
+//             [--storage=BYTES] [--layout=linear|hash] [--seed=N]
+//             [--path=FILE] [--output=FILE]
+
+#define BENCH_DEFAULT_RECORDS    500
+#define BENCH_DEFAULT_OPERATIONS 1000
+#define BENCH_DEFAULT_STORAGE    (1024 * 512)
+#define BENCH_DEFAULT_THETA      0.99
+#define BENCH_DEFAULT_PATH       "../data/kvs_bench.bin"
+#define BENCH_MAX_VALUE_SIZE     4096
+#define BENCH_LATENCY_BUFFER     8192
+
+// Распределение номеров ключей.
+typedef enum {
+    BENCH_DIST_UNIFORM = 0,          // Все ключи равновероятны
+    BENCH_DIST_ZIPFIAN,              // Закон Ципфа по перемешанным номерам: горячие ключи разбросаны по всему набору
+    BENCH_DIST_LATEST                // Закон Ципфа по давности вставки: чаще всего нужны последние вставленные ключи
+} bench_distribution;
+
+// Распределение размеров значений.
+typedef enum {
+    BENCH_SIZE_FIXED = 0,            // Всегда size_min
+    BENCH_SIZE_UNIFORM,              // Равномерно от size_min до size_max
+    BENCH_SIZE_ZIPFIAN               // По закону Ципфа: чаще всего size_min
+} bench_size_distribution;
+
+// Виды операций фазы выполнения.
+typedef enum {
+    BENCH_OP_READ = 0,
+    BENCH_OP_UPDATE,
+    BENCH_OP_INSERT,
+    BENCH_OP_DELETE,
+    BENCH_OP_COUNT
+} bench_op;
+
+static const char *bench_op_names[BENCH_OP_COUNT] = {"read", "update", "insert", "delete"};
+static const char *bench_distribution_names[] = {"uniform", "zipfian", "latest"};
+static const char *bench_size_names[] = {"fixed", "uniform", "zipfian"};
+
+// Параметры запуска.
+typedef struct {
+    const char *workload;            // Имя набора параметров (a, b, c, d или custom)
+    uint32_t records;                // Ключей в фазе загрузки
+    uint32_t operations;             // Операций в фазе выполнения
+    double   proportions[BENCH_OP_COUNT]; // Доли операций (сумма нормируется)
+    bench_distribution distribution;
+    double   zipf_theta;             // Показатель закона Ципфа
+    bench_size_distribution size_distribution;
+    uint32_t size_min;
+    uint32_t size_max;
+    size_t   storage;                // Размер области данных хранилища
+    kvs_metadata_layout layout;
+    uint64_t seed;
+    const char *path;                // Файл-эмулятор хранилища
+    const char *output;              // Файл результата (NULL - стандартный вывод)
+} bench_config;
+
+// Генератор ключей по закону Ципфа (Gray et al., "Quickly generating billion-record synthetic databases"),
+// как ZipfianGenerator в YCSB. Сумма zeta досчитывается при росте количества элементов.
+typedef struct {
+    uint64_t items;
+    double   theta;
+    double   alpha;
+    double   zeta2;
+    double   zeta_n;
+    double   eta;
+} bench_zipf;
+
+static uint64_t bench_rng_state;
+
+// xorshift64*: быстрый генератор, воспроизводимый по --seed.
+static uint64_t bench_rand(void)
+{
+    bench_rng_state ^= bench_rng_state >> 12;
+    bench_rng_state ^= bench_rng_state << 25;
+    bench_rng_state ^= bench_rng_state >> 27;
+    return bench_rng_state * 2685821657736338717ull;
+}
+
+// Возвращает случайное число из [0, 1).
+static double bench_rand_double(void)
+{
+    return (bench_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint64_t bench_fnv64(uint64_t value)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int i = 0; i < 8; i++) {
+        hash ^= value & 0xFF;
+        hash *= 1099511628211ull;
+        value >>= 8;
+    }
+    return hash;
+}
+
+static void bench_zipf_init(bench_zipf *zipf, uint64_t items, double theta)
+{
+    memset(zipf, 0, sizeof(*zipf));
+    zipf->theta = theta;
+    zipf->alpha = 1.0 / (1.0 - theta);
+    zipf->zeta2 = 1.0 + pow(0.5, theta);
+    zipf->zeta_n = 0;
+    zipf->items = 0;
+    for (uint64_t i = 1; i <= items; i++) {
+        zipf->zeta_n += 1.0 / pow((double)i, theta);
+    }
+    zipf->items = items;
+    zipf->eta = (1.0 - pow(2.0 / (double)items, 1.0 - theta)) / (1.0 - zipf->zeta2 / zipf->zeta_n);
+}
+
+// Возвращает номер из [0, items): 0 - самый частый. items может расти между вызовами.
+static uint64_t bench_zipf_next(bench_zipf *zipf, uint64_t items)
+{
+    if (items != zipf->items) {
+        for (uint64_t i = zipf->items + 1; i <= items; i++) {
+            zipf->zeta_n += 1.0 / pow((double)i, zipf->theta);
+        }
+        zipf->items = items;
+        zipf->eta = (1.0 - pow(2.0 / (double)items, 1.0 - zipf->theta)) / (1.0 - zipf->zeta2 / zipf->zeta_n);
+    }
+    double u = bench_rand_double();
+    double uz = u * zipf->zeta_n;
+    if (uz < 1.0) {
+        return 0;
+    }
+    if (uz < zipf->zeta2) {
+        return 1;
+    }
+    uint64_t value = (uint64_t)((double)items * pow(zipf->eta * u - zipf->eta + 1.0, zipf->alpha));
+    return value < items ? value : items - 1;
+}
+
+// Ключ по номеру: номер перемешивается, чтобы соседние номера не были соседними ключами (как в YCSB).
+// Возвращает длину ключа.
+static size_t bench_make_key(char *key, uint64_t number)
+{
+    memset(key, 0, KVS_KEY_SIZE);
+    snprintf(key, KVS_KEY_SIZE, "user%016llx", (unsigned long long)bench_fnv64(number));
+    return strlen(key);
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void bench_make_value(uint8_t *value, uint32_t size)
+{
+    uint64_t word = bench_rand();
+    for (uint32_t i = 0; i < size; i++) {
+        value[i] = (uint8_t)(((word >> ((i % 8) * 8)) + i) % 0xFF);
+    }
+}
+
+static uint32_t bench_value_size(const bench_config *config, bench_zipf *size_zipf)
+{
+    uint32_t span = config->size_max - config->size_min + 1;
+    switch (config->size_distribution) {
+        case BENCH_SIZE_UNIFORM:
+            return config->size_min + (uint32_t)(bench_rand() % span);
+        case BENCH_SIZE_ZIPFIAN:
+            return config->size_min + (uint32_t)bench_zipf_next(size_zipf, span);
+        default:
+            return config->size_min;
+    }
+}
+
+// Выбирает номер существующего ключа из [0, inserted).
+static uint64_t bench_next_key(const bench_config *config, bench_zipf *key_zipf, uint64_t inserted)
+{
+    switch (config->distribution) {
+        case BENCH_DIST_ZIPFIAN:
+            return bench_fnv64(bench_zipf_next(key_zipf, inserted)) % inserted;
+        case BENCH_DIST_LATEST:
+            return inserted - 1 - bench_zipf_next(key_zipf, inserted);
+        default:
+            return bench_rand() % inserted;
+    }
+}
+
+static double bench_now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Задает доли операций набора параметров YCSB. Возвращает false, если набор неизвестен.
+static bool bench_apply_workload(bench_config *config, const char *name)
+{
+    double read = 0, update = 0, insert = 0;
+    bench_distribution distribution = BENCH_DIST_ZIPFIAN;
+    if (strcmp(name, "a") == 0) {
+        read = 0.5; update = 0.5;
+    } else if (strcmp(name, "b") == 0) {
+        read = 0.95; update = 0.05;
+    } else if (strcmp(name, "c") == 0) {
+        read = 1.0;
+    } else if (strcmp(name, "d") == 0) {
+        read = 0.95; insert = 0.05; distribution = BENCH_DIST_LATEST;
+    } else {
+        return false;
+    }
+    config->workload = name;
+    config->proportions[BENCH_OP_READ]   = read;
+    config->proportions[BENCH_OP_UPDATE] = update;
+    config->proportions[BENCH_OP_INSERT] = insert;
+    config->proportions[BENCH_OP_DELETE] = 0;
+    config->distribution = distribution;
+    return true;
+}
+
+// Разбирает --value-size. Возвращает false при неверной записи.
+static bool bench_parse_size(bench_config *config, const char *text)
+{
+    unsigned min = 0, max = 0;
+    if (sscanf(text, "fixed:%u", &min) == 1) {
+        config->size_distribution = BENCH_SIZE_FIXED;
+        max = min;
+    } else if (sscanf(text, "uniform:%u:%u", &min, &max) == 2) {
+        config->size_distribution = BENCH_SIZE_UNIFORM;
+    } else if (sscanf(text, "zipfian:%u:%u", &min, &max) == 2) {
+        config->size_distribution = BENCH_SIZE_ZIPFIAN;
+    } else {
+        return false;
+    }
+    if (min == 0 || max < min || max > BENCH_MAX_VALUE_SIZE) {
+        return false;
+    }
+    config->size_min = min;
+    config->size_max = max;
+    return true;
+}
+
+// Разбирает аргументы командной строки. Возвращает false при неверном аргументе.
+static bool bench_parse_args(bench_config *config, int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        if (strncmp(arg, "--", 2) != 0 || !value) {
+            fprintf(stderr, "Неверный аргумент: %s\n", arg);
+            return false;
+        }
+        value++;
+        size_t name_len = (size_t)(value - 1 - (arg + 2));
+        const char *name = arg + 2;
+        bool ok = true;
+#define BENCH_ARG(text) (name_len == strlen(text) && strncmp(name, text, name_len) == 0)
+        if (BENCH_ARG("workload")) {
+            ok = bench_apply_workload(config, value);
+        } else if (BENCH_ARG("records")) {
+            config->records = (uint32_t)strtoul(value, NULL, 0);
+            ok = config->records > 0;
+        } else if (BENCH_ARG("operations")) {
+            config->operations = (uint32_t)strtoul(value, NULL, 0);
+        } else if (BENCH_ARG("read") || BENCH_ARG("update") || BENCH_ARG("insert") || BENCH_ARG("delete")) {
+            bench_op op = BENCH_ARG("read") ? BENCH_OP_READ : BENCH_ARG("update") ? BENCH_OP_UPDATE : BENCH_ARG("insert") ? BENCH_OP_INSERT : BENCH_OP_DELETE;
+            config->proportions[op] = strtod(value, NULL);
+            config->workload = "custom";
+            ok = config->proportions[op] >= 0;
+        } else if (BENCH_ARG("distribution")) {
+            ok = false;
+            for (int d = 0; d <= BENCH_DIST_LATEST; d++) {
+                if (strcmp(value, bench_distribution_names[d]) == 0) {
+                    config->distribution = (bench_distribution)d;
+                    ok = true;
+                }
+            }
+        } else if (BENCH_ARG("zipf-theta")) {
+            config->zipf_theta = strtod(value, NULL);
+            ok = config->zipf_theta > 0 && config->zipf_theta < 1;
+        } else if (BENCH_ARG("value-size")) {
+            ok = bench_parse_size(config, value);
+        } else if (BENCH_ARG("storage")) {
+            config->storage = strtoull(value, NULL, 0);
+        } else if (BENCH_ARG("layout")) {
+            ok = strcmp(value, "linear") == 0 || strcmp(value, "hash") == 0;
+            config->layout = strcmp(value, "hash") == 0 ? KVS_LAYOUT_HASH : KVS_LAYOUT_LINEAR;
+        } else if (BENCH_ARG("seed")) {
+            config->seed = strtoull(value, NULL, 0);
+        } else if (BENCH_ARG("path")) {
+            config->path = value;
+        } else if (BENCH_ARG("output")) {
+            config->output = value;
+        } else {
+            ok = false;
+        }
+#undef BENCH_ARG
+        if (!ok) {
+            fprintf(stderr, "Неверный аргумент: %s\n", arg);
+            return false;
+        }
+    }
+    double total = 0;
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        total += config->proportions[op];
+    }
+    if (total <= 0) {
+        fprintf(stderr, "Сумма долей операций должна быть больше нуля.\n");
+        return false;
+    }
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        config->proportions[op] /= total;
+    }
+    return true;
+}
+
+// Счетчики одной фазы.
+typedef struct {
+    uint64_t ops[BENCH_OP_COUNT];
+    uint64_t failed[BENCH_OP_COUNT];      // Завершились ошибкой (кроме "ключ не найден")
+    uint64_t not_found[BENCH_OP_COUNT];   // Ключ не найден: ключ удален раньше
+    double   seconds;
+} bench_phase;
+
+// Состояние устройства и хранилища в начале и в конце фазы выполнения.
+typedef struct {
+    kvs_stats stats;
+    kvs_write_stats write_stats;
+    uint64_t device_ns;
+} bench_snapshot;
+
+static void bench_take_snapshot(kvs_handle *handle, bench_snapshot *snapshot)
+{
+    kvs_get_stats_h(handle, &snapshot->stats);
+    kvs_get_write_stats_h(handle, &snapshot->write_stats);
+    kvs_get_device_time_h(handle, &snapshot->device_ns);
+}
+
+static void bench_count(bench_phase *phase, bench_op op, kvs_status status)
+{
+    phase->ops[op]++;
+    if (status == KVS_ERROR_KEY_NOT_FOUND) {
+        phase->not_found[op]++;
+    } else if (status != KVS_SUCCESS) {
+        phase->failed[op]++;
+    }
+}
+
+static void bench_print_phase(FILE *out, const char *name, const bench_phase *phase, bool last)
+{
+    uint64_t total = 0, failed = 0;
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        total += phase->ops[op];
+        failed += phase->failed[op];
+    }
+    fprintf(out, "  \"%s\": {\"operations\": %lu, \"failed\": %lu, \"seconds\": %.6f, \"ops_per_sec\": %.1f}%s\n", name,
+            (unsigned long)total, (unsigned long)failed, phase->seconds, phase->seconds > 0 ? total / phase->seconds : 0.0, last ? "" : ",");
+}
+
+// Печатает результат в JSON.
+static void bench_report(FILE *out, const bench_config *config, const bench_phase *load, const bench_phase *run,
+                         const bench_snapshot *before, const bench_snapshot *after)
+{
+    fprintf(out, "{\n");
+    fprintf(out, "  \"workload\": {\"name\": \"%s\", \"records\": %u, \"operations\": %u, ", config->workload, config->records, config->operations);
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        fprintf(out, "\"%s_proportion\": %.4f, ", bench_op_names[op], config->proportions[op]);
+    }
+    fprintf(out, "\"distribution\": \"%s\", \"zipf_theta\": %.4f, ", bench_distribution_names[config->distribution], config->zipf_theta);
+    fprintf(out, "\"value_size\": {\"distribution\": \"%s\", \"min\": %u, \"max\": %u}, ", bench_size_names[config->size_distribution], config->size_min, config->size_max);
+    fprintf(out, "\"storage_bytes\": %zu, \"layout\": \"%s\", \"seed\": %lu},\n", config->storage,
+            config->layout == KVS_LAYOUT_HASH ? "hash" : "linear", (unsigned long)config->seed);
+    bench_print_phase(out, "load", load, false);
+
+    // Задержки фазы выполнения: гистограммы хранилища сброшены после загрузки
+    static const kvs_latency_op latency_ops[BENCH_OP_COUNT] = {KVS_LATENCY_GET, KVS_LATENCY_UPDATE, KVS_LATENCY_PUT, KVS_LATENCY_DELETE};
+    bench_print_phase(out, "run", run, false);
+    fprintf(out, "  \"run_ops\": {");
+    for (int op = 0; op < BENCH_OP_COUNT; op++) {
+        const kvs_latency_summary *latency = &after->stats.latency[latency_ops[op]];
+        fprintf(out, "%s\"%s\": {\"count\": %lu, \"failed\": %lu, \"not_found\": %lu, \"mean_ns\": %lu, \"p50_ns\": %lu, \"p99_ns\": %lu, \"p999_ns\": %lu, \"max_ns\": %lu}",
+                op ? ", " : "", bench_op_names[op], (unsigned long)run->ops[op], (unsigned long)run->failed[op], (unsigned long)run->not_found[op],
+                (unsigned long)(latency->count ? latency->total_ns / latency->count : 0), (unsigned long)latency->p50_ns,
+                (unsigned long)latency->p99_ns, (unsigned long)latency->p999_ns, (unsigned long)latency->max_ns);
+    }
+    fprintf(out, "},\n");
+
+    // Операции устройства, сборка мусора и усиление записи за фазу выполнения
+    fprintf(out, "  \"device\": {\"words_read\": %lu, \"words_written\": %lu, \"pages_erased\": %lu, \"device_time_ns\": %lu},\n",
+            (unsigned long)(after->stats.device_words_read - before->stats.device_words_read),
+            (unsigned long)(after->stats.device_words_written - before->stats.device_words_written),
+            (unsigned long)(after->stats.device_pages_erased - before->stats.device_pages_erased),
+            (unsigned long)(after->device_ns - before->device_ns));
+    fprintf(out, "  \"gc\": {\"cycles\": %lu, \"bytes_moved\": %lu},\n",
+            (unsigned long)(after->stats.gc_cycles - before->stats.gc_cycles),
+            (unsigned long)(after->stats.gc_bytes_moved - before->stats.gc_bytes_moved));
+    static const char *path_names[KVS_WRITE_PATH_COUNT] = {"put", "delete", "gc", "wear_level", "persist"};
+    uint64_t host = 0, programmed = 0;
+    fprintf(out, "  \"write_amplification\": {\"paths\": {");
+    for (int path = 0; path < KVS_WRITE_PATH_COUNT; path++) {
+        uint64_t path_programmed = after->write_stats.paths[path].programmed_bytes - before->write_stats.paths[path].programmed_bytes;
+        host += after->write_stats.paths[path].host_bytes - before->write_stats.paths[path].host_bytes;
+        programmed += path_programmed;
+        fprintf(out, "%s\"%s\": %lu", path ? ", " : "", path_names[path], (unsigned long)path_programmed);
+    }
+    fprintf(out, "}, \"host_bytes\": %lu, \"programmed_bytes\": %lu, \"total\": %.4f}\n", (unsigned long)host, (unsigned long)programmed,
+            host ? (double)programmed / (double)host : 0.0);
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char **argv)
+{
+    // Шаг 1: Параметры по умолчанию - набор YCSB A
+    bench_config config = {0};
+    config.records    = BENCH_DEFAULT_RECORDS;
+    config.operations = BENCH_DEFAULT_OPERATIONS;
+    config.zipf_theta = BENCH_DEFAULT_THETA;
+    config.size_distribution = BENCH_SIZE_FIXED;
+    config.size_min   = 100;
+    config.size_max   = 100;
+    config.storage    = BENCH_DEFAULT_STORAGE;
+    config.layout     = KVS_LAYOUT_LINEAR;
+    config.seed       = 1;
+    config.path       = BENCH_DEFAULT_PATH;
+    bench_apply_workload(&config, "a");
+    if (!bench_parse_args(&config, argc, argv)) {
+        return 2;
+    }
+    bench_rng_state = config.seed ? config.seed : 1;
+
+    // Шаг 2: Открываем новое хранилище
+    kvs_options options = {config.storage, config.layout, false, false};
+    kvs_handle *handle = NULL;
+    if (strcmp(config.path, BENCH_DEFAULT_PATH) == 0) {
+        ssdmmc_sim_ensure_data_dir_exists();
+    }
+    remove(config.path);
+    if (kvs_open(config.path, &options, &handle) != KVS_SUCCESS) {
+        fprintf(stderr, "Не удалось создать хранилище %s.\n", config.path);
+        return 1;
+    }
+
+    // Шаг 3: Фаза загрузки
+    char key[KVS_KEY_SIZE];
+    uint8_t value[BENCH_MAX_VALUE_SIZE];
+    bench_zipf key_zipf, size_zipf;
+    bench_zipf_init(&key_zipf, config.records, config.zipf_theta);
+    bench_zipf_init(&size_zipf, config.size_max - config.size_min + 1, config.zipf_theta);
+    bench_phase load = {0}, run = {0};
+    double start = bench_now_seconds();
+    for (uint64_t i = 0; i < config.records; i++) {
+        uint32_t size = bench_value_size(&config, &size_zipf);
+        size_t key_len = bench_make_key(key, i);
+        bench_make_value(value, size);
+        bench_count(&load, BENCH_OP_INSERT, kvs_put_h(handle, key, key_len, value, size));
+    }
+    load.seconds = bench_now_seconds() - start;
+
+    // Шаг 4: Сбрасываем гистограммы задержек, чтобы процентили относились только к фазе выполнения
+    static char latency_text[BENCH_LATENCY_BUFFER];
+    size_t latency_len = sizeof(latency_text);
+    kvs_export_latency_h(handle, KVS_METRICS_JSON, true, latency_text, &latency_len);
+    bench_snapshot before, after;
+    bench_take_snapshot(handle, &before);
+
+    // Шаг 5: Фаза выполнения. Вставки получают новые номера ключей, остальные операции выбирают номер по распределению
+    uint64_t inserted = config.records;
+    bench_op last_op = BENCH_OP_READ;       // Выбирается, если доли из-за округления не дали в сумме 1
+    for (int o = 0; o < BENCH_OP_COUNT; o++) {
+        if (config.proportions[o] > 0) {
+            last_op = (bench_op)o;
+        }
+    }
+    start = bench_now_seconds();
+    for (uint32_t i = 0; i < config.operations; i++) {
+        double choice = bench_rand_double();
+        bench_op op = last_op;
+        for (int o = 0; o < BENCH_OP_COUNT; o++) {
+            if (config.proportions[o] > 0 && choice < config.proportions[o]) {
+                op = (bench_op)o;
+                break;
+            }
+            choice -= config.proportions[o];
+        }
+        uint32_t size = op == BENCH_OP_UPDATE || op == BENCH_OP_INSERT ? bench_value_size(&config, &size_zipf) : 0;
+        size_t key_len = bench_make_key(key, op == BENCH_OP_INSERT ? inserted++ : bench_next_key(&config, &key_zipf, inserted));
+        kvs_status status;
+        switch (op) {
+            case BENCH_OP_READ: {
+                size_t value_len = sizeof(value);
+                status = kvs_get_h(handle, key, key_len, value, &value_len);
+                break;
+            }
+            case BENCH_OP_UPDATE:
+                bench_make_value(value, size);
+                status = kvs_update_h(handle, key, key_len, value, size);
+                break;
+            case BENCH_OP_INSERT:
+                bench_make_value(value, size);
+                status = kvs_put_h(handle, key, key_len, value, size);
+                break;
+            default:
+                status = kvs_delete_h(handle, key, key_len);
+                break;
+        }
+        bench_count(&run, op, status);
+    }
+    run.seconds = bench_now_seconds() - start;
+    bench_take_snapshot(handle, &after);
+    kvs_close(handle);
+
+    // Шаг 6: Печатаем результат
+    FILE *out = config.output ? fopen(config.output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Не удалось создать файл %s.\n", config.output);
+        return 1;
+    }
+    bench_report(out, &config, &load, &run, &before, &after);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
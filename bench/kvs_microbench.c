@@ -0,0 +1,594 @@
+#include "kvs.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "../src/key_value_store/kvs_internal_io.h"
+#include "../src/key_value_store/kvs_metadata.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Микробенчмарки внутренних примитивов хранилища: crc32_calc, поиск свободного места для данных и
+// метаданных, выбор страницы-жертвы, пометка регионов в битовой карте, чтение, запись и очистка
+// регионов устройства, поиск и вставка в key_index.
+//
+// Примитивы работают над синтетическим состоянием нового хранилища: битовые карты данных и метаданных
+// заполнены на долю --fill сериями занятых слов (слотов), длина которых задается --fragmentation
+// (0 - серии до четырех страниц, 1 - по одному слову), а key_index содержит ключ для каждого занятого
+// слота метаданных. Доля --garbage серий данных считается мусором для kvs_find_victim_page.
+// Каждый примитив выполняется --rounds раз по --iterations операций; результат - объект JSON
+// с медианным и лучшим временем операции.
+//
+//   kvs_microbench [--fill=F] [--fragmentation=F] [--garbage=F] [--value-size=N]
+//                  [--iterations=N] [--rounds=N] [--storage=BYTES] [--layout=linear|hash]
+//                  [--seed=N] [--path=FILE] [--output=FILE]
+
+#define MICRO_DEFAULT_ITERATIONS 10000
+#define MICRO_DEFAULT_ROUNDS     5
+#define MICRO_DEFAULT_STORAGE    (1024 * 512)
+#define MICRO_DEFAULT_PATH       "../data/kvs_microbench.bin"
+#define MICRO_MAX_ROUNDS         64
+#define MICRO_RUN_PAGES          4      // Наибольшая длина серии (в страницах) при нулевой фрагментации
+#define MICRO_SCAN_DIVISOR       100    // Во столько раз меньше операций у примитивов, просматривающих всю карту
+
+// Параметры запуска.
+typedef struct {
+    double   fill;                   // Доля занятых слов данных и слотов метаданных
+    double   fragmentation;          // 0 - длинные серии занятых слов, 1 - одиночные слова
+    double   garbage;                // Доля серий данных, которые считаются мусором
+    uint32_t value_size;             // Размер региона для crc, поиска места, битовой карты и ввода-вывода
+    uint32_t iterations;             // Операций в одном повторе
+    uint32_t rounds;                 // Повторов каждого примитива
+    size_t   storage;                // Размер области данных хранилища
+    kvs_metadata_layout layout;
+    uint64_t seed;
+    const char *path;                // Файл-эмулятор хранилища
+    const char *output;              // Файл результата (NULL - стандартный вывод)
+} micro_config;
+
+// Синтетическое состояние и заранее подготовленные аргументы операций.
+typedef struct {
+    kvs_handle *handle;
+    uint32_t total_words;            // Слов в области данных
+    uint32_t total_slots;            // Слотов метаданных
+    uint8_t  *bitmap;                // Исходная битовая карта данных
+    uint8_t  *valid_bitmap;          // Битовая карта данных без мусора
+    uint8_t  *valid_metadata_bitmap; // Битовая карта метаданных без мусора
+    kvs_key_index_entry *index;      // Исходный key_index
+    uint32_t key_count;              // Ключей в исходном key_index
+    kvs_key_index_entry *new_entries; // Ключи, которых нет в индексе; первые insert_count из них получили свободные слоты
+    uint32_t new_count;              // Количество таких ключей (iterations)
+    uint32_t insert_count;           // Сколько из них можно вставить в key_index
+    uint32_t *offsets;               // Случайные смещения регионов в области данных
+    uint32_t *data_starts;           // Случайные начала карусели данных
+    uint32_t *slot_starts;           // Случайные начала карусели метаданных
+    uint32_t *hit_keys;              // Случайные позиции исходного key_index
+    uint8_t  *buffer;                // Буфер значения
+} micro_state;
+
+// Примитив: prepare восстанавливает состояние перед повтором (не измеряется), run выполняет count операций.
+typedef struct {
+    const char *name;
+    void (*prepare)(micro_state *state);
+    uint64_t (*run)(micro_state *state, const micro_config *config, uint32_t count);
+    uint32_t divisor;                // Операций в повторе: iterations / divisor
+    bool     has_bytes;              // Печатать ли пропускную способность по value_size
+} micro_case;
+
+static volatile uint64_t micro_sink; // Результаты примитивов, чтобы компилятор не выбросил вызовы
+static uint64_t micro_rng_state;
+
+// xorshift64*: быстрый генератор, воспроизводимый по --seed.
+static uint64_t micro_rand(void)
+{
+    micro_rng_state ^= micro_rng_state >> 12;
+    micro_rng_state ^= micro_rng_state << 25;
+    micro_rng_state ^= micro_rng_state >> 27;
+    return micro_rng_state * 2685821657736338717ull;
+}
+
+// Возвращает случайное число из [0, 1).
+static double micro_rand_double(void)
+{
+    return (micro_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint64_t micro_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void micro_make_key(kvs_key_index_entry *entry, uint64_t number)
+{
+    memset(entry, 0, sizeof(*entry));
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int i = 0; i < 8; i++) {
+        hash ^= (number >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ull;
+    }
+    snprintf((char *)entry->key, KVS_KEY_SIZE, "user%016llx", (unsigned long long)hash);
+    entry->key_len = (uint8_t)strlen((const char *)entry->key);
+}
+
+// Длина серии со средним mean: равномерно от 1 до 2 * mean - 1, а при mean < 1 - 1 с вероятностью mean.
+static uint32_t micro_run_length(double mean)
+{
+    if (mean < 1) {
+        return micro_rand_double() < mean ? 1 : 0;
+    }
+    return 1 + (uint32_t)(micro_rand_double() * (2 * mean - 1));
+}
+
+// Заполняет bitmap из bits битов чередующимися свободными и занятыми сериями так, чтобы занятой была
+// примерно доля fill. Средняя длина серии - от max_run при fragmentation 0 до 1 при fragmentation 1.
+static void micro_fill_bitmap(uint8_t *bitmap, uint32_t bits, double fill, double fragmentation, uint32_t max_run)
+{
+    memset(bitmap, 0, (bits + 7) / 8);
+    if (fill <= 0) {
+        return;
+    }
+    double mean      = 1 + (1 - fragmentation) * (max_run - 1);
+    double used_mean = fill >= 0.5 ? mean : mean * fill / (1 - fill);
+    double free_mean = fill >= 0.5 ? mean * (1 - fill) / fill : mean;
+    uint32_t bit = 0;
+    while (bit < bits) {
+        bit += micro_run_length(free_mean);
+        uint32_t used = micro_run_length(used_mean);
+        for (uint32_t i = 0; i < used && bit < bits; i++, bit++) {
+            bitmap[bit / 8] |= (uint8_t)(1 << (bit % 8));
+        }
+    }
+}
+
+// Копирует в valid занятые серии bitmap, кроме доли garbage серий, которые становятся мусором.
+static void micro_make_valid(uint8_t *valid, const uint8_t *bitmap, uint32_t bits, double garbage)
+{
+    memset(valid, 0, (bits + 7) / 8);
+    bool keep = false;
+    for (uint32_t bit = 0; bit < bits; bit++) {
+        if (!get_bit(bitmap, bit)) {
+            continue;
+        }
+        if (bit == 0 || !get_bit(bitmap, bit - 1)) {
+            keep = micro_rand_double() >= garbage;
+        }
+        if (keep) {
+            valid[bit / 8] |= (uint8_t)(1 << (bit % 8));
+        }
+    }
+}
+
+static uint32_t micro_count_bits(const uint8_t *bitmap, uint32_t bits)
+{
+    uint32_t count = 0;
+    for (uint32_t bit = 0; bit < bits; bit++) {
+        count += get_bit(bitmap, bit);
+    }
+    return count;
+}
+
+// Восстанавливает исходные битовые карты и key_index.
+static void micro_restore(micro_state *state)
+{
+    memcpy(device->bitmap, state->bitmap, device->superblock.bitmap_size_bytes);
+    memcpy(device->key_index, state->index, state->key_count * sizeof(kvs_key_index_entry));
+    device->key_count = state->key_count;
+    kvs_slot_map_rebuild();
+}
+
+// --- Примитивы ---
+
+static uint64_t micro_crc32(micro_state *state, const micro_config *config, uint32_t count)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        state->buffer[0] = (uint8_t)i;
+        sum += crc32_calc(state->buffer, config->value_size);
+    }
+    return sum;
+}
+
+static uint64_t micro_find_free_data(micro_state *state, const micro_config *config, uint32_t count)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        device->superblock.last_data_word_checked = state->data_starts[i];
+        sum += kvs_find_free_data_offset(config->value_size, KVS_DATA_COLD);
+    }
+    return sum;
+}
+
+static uint64_t micro_find_free_metadata(micro_state *state, const micro_config *config, uint32_t count)
+{
+    (void)config;
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const kvs_key_index_entry *entry = &state->new_entries[i % state->new_count];
+        device->superblock.last_metadata_slot_checked = state->slot_starts[i];
+        sum += kvs_find_free_metadata_offset(entry->key, entry->key_len);
+    }
+    return sum;
+}
+
+static uint64_t micro_victim_data(micro_state *state, const micro_config *config, uint32_t count)
+{
+    (void)config;
+    uint64_t sum = 0;
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += kvs_find_victim_page(CLEAN_DATA, state->valid_bitmap, device->superblock.bitmap_size_bytes, &live) + live;
+    }
+    return sum;
+}
+
+static uint64_t micro_victim_metadata(micro_state *state, const micro_config *config, uint32_t count)
+{
+    (void)config;
+    uint64_t sum = 0;
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += kvs_find_victim_page(CLEAN_METADATA, state->valid_metadata_bitmap, device->superblock.metadata_bitmap_size_bytes, &live) + live;
+    }
+    return sum;
+}
+
+static uint64_t micro_bitmap_set(micro_state *state, const micro_config *config, uint32_t count)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += bitmap_set_region(state->offsets[i], config->value_size);
+    }
+    return sum;
+}
+
+static uint64_t micro_bitmap_clear(micro_state *state, const micro_config *config, uint32_t count)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += bitmap_clear_region(state->offsets[i], config->value_size);
+    }
+    return sum;
+}
+
+static uint64_t micro_write_region(micro_state *state, const micro_config *config, uint32_t count)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += kvs_write_region(state->handle->sim, state->offsets[i], state->buffer, config->value_size);
+    }
+    return sum;
+}
+
+static uint64_t micro_read_region(micro_state *state, const micro_config *config, uint32_t count)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += kvs_read_region(state->handle->sim, state->offsets[i], state->buffer, config->value_size) + state->buffer[0];
+    }
+    return sum;
+}
+
+static uint64_t micro_clear_region(micro_state *state, const micro_config *config, uint32_t count)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += kvs_clear_region(state->handle->sim, state->offsets[i], config->value_size);
+    }
+    return sum;
+}
+
+static uint64_t micro_index_hit(micro_state *state, const micro_config *config, uint32_t count)
+{
+    (void)config;
+    uint64_t sum = 0;
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count && state->key_count > 0; i++) {
+        const kvs_key_index_entry *entry = &state->index[state->hit_keys[i]];
+        sum += kvs_key_index_find(entry->key, entry->key_len, &pos) + pos;
+    }
+    return sum;
+}
+
+static uint64_t micro_index_miss(micro_state *state, const micro_config *config, uint32_t count)
+{
+    (void)config;
+    uint64_t sum = 0;
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const kvs_key_index_entry *entry = &state->new_entries[i % state->new_count];
+        sum += kvs_key_index_find(entry->key, entry->key_len, &pos);
+    }
+    return sum;
+}
+
+// Вставляет новые ключи в свободные слоты; их не больше, чем свободных слотов (state->insert_count).
+static uint64_t micro_index_insert(micro_state *state, const micro_config *config, uint32_t count)
+{
+    (void)config;
+    uint64_t sum = 0;
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count && i < state->insert_count; i++) {
+        sum += kvs_key_index_insert(&state->new_entries[i], &pos) + pos;
+    }
+    return sum;
+}
+
+static const micro_case micro_cases[] = {
+    {"crc32_calc",                    NULL,          micro_crc32,              1,                  true},
+    {"kvs_find_free_data_offset",     NULL,          micro_find_free_data,     10,                 false},
+    {"kvs_find_free_metadata_offset", NULL,          micro_find_free_metadata, 1,                  false},
+    {"kvs_find_victim_page.data",     NULL,          micro_victim_data,        MICRO_SCAN_DIVISOR, false},
+    {"kvs_find_victim_page.metadata", NULL,          micro_victim_metadata,    MICRO_SCAN_DIVISOR, false},
+    {"bitmap_set_region",             micro_restore, micro_bitmap_set,         1,                  false},
+    {"bitmap_clear_region",           micro_restore, micro_bitmap_clear,       1,                  false},
+    {"kvs_clear_region",              NULL,          micro_clear_region,       10,                 true},
+    {"kvs_write_region",              NULL,          micro_write_region,       1,                  true},
+    {"kvs_read_region",               NULL,          micro_read_region,        1,                  true},
+    {"kvs_key_index_find.hit",        NULL,          micro_index_hit,          1,                  false},
+    {"kvs_key_index_find.miss",       NULL,          micro_index_miss,         1,                  false},
+    {"kvs_key_index_insert",          micro_restore, micro_index_insert,       1,                  false},
+};
+
+// Разбирает аргументы командной строки. Возвращает false при неверном аргументе.
+static bool micro_parse_args(micro_config *config, int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = strchr(arg, '=');
+        if (strncmp(arg, "--", 2) != 0 || !value) {
+            fprintf(stderr, "Неверный аргумент: %s\n", arg);
+            return false;
+        }
+        value++;
+        size_t name_len = (size_t)(value - 1 - (arg + 2));
+        const char *name = arg + 2;
+        bool ok = true;
+#define MICRO_ARG(text) (name_len == strlen(text) && strncmp(name, text, name_len) == 0)
+        if (MICRO_ARG("fill")) {
+            config->fill = strtod(value, NULL);
+            ok = config->fill >= 0 && config->fill <= 1;
+        } else if (MICRO_ARG("fragmentation")) {
+            config->fragmentation = strtod(value, NULL);
+            ok = config->fragmentation >= 0 && config->fragmentation <= 1;
+        } else if (MICRO_ARG("garbage")) {
+            config->garbage = strtod(value, NULL);
+            ok = config->garbage >= 0 && config->garbage <= 1;
+        } else if (MICRO_ARG("value-size")) {
+            config->value_size = (uint32_t)strtoul(value, NULL, 0);
+            ok = config->value_size > 0;
+        } else if (MICRO_ARG("iterations")) {
+            config->iterations = (uint32_t)strtoul(value, NULL, 0);
+            ok = config->iterations > 0;
+        } else if (MICRO_ARG("rounds")) {
+            config->rounds = (uint32_t)strtoul(value, NULL, 0);
+            ok = config->rounds > 0 && config->rounds <= MICRO_MAX_ROUNDS;
+        } else if (MICRO_ARG("storage")) {
+            config->storage = strtoull(value, NULL, 0);
+        } else if (MICRO_ARG("layout")) {
+            ok = strcmp(value, "linear") == 0 || strcmp(value, "hash") == 0;
+            config->layout = strcmp(value, "hash") == 0 ? KVS_LAYOUT_HASH : KVS_LAYOUT_LINEAR;
+        } else if (MICRO_ARG("seed")) {
+            config->seed = strtoull(value, NULL, 0);
+        } else if (MICRO_ARG("path")) {
+            config->path = value;
+        } else if (MICRO_ARG("output")) {
+            config->output = value;
+        } else {
+            ok = false;
+        }
+#undef MICRO_ARG
+        if (!ok) {
+            fprintf(stderr, "Неверный аргумент: %s\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Строит синтетическое состояние текущего устройства. Возвращает false, если не хватило памяти.
+static bool micro_build_state(micro_state *state, const micro_config *config)
+{
+    kvs_superblock *sb = &device->superblock;
+    state->total_words = sb->userdata_size_bytes / sb->word_size_bytes;
+    state->total_slots = sb->max_key_count;
+    uint32_t value_words = (config->value_size + sb->word_size_bytes - 1) / sb->word_size_bytes;
+    if (value_words >= state->total_words) {
+        fprintf(stderr, "Размер значения %u больше области данных.\n", config->value_size);
+        return false;
+    }
+
+    state->bitmap                = malloc(sb->bitmap_size_bytes);
+    state->valid_bitmap          = malloc(sb->bitmap_size_bytes);
+    state->valid_metadata_bitmap = malloc(sb->metadata_bitmap_size_bytes);
+    state->index                 = malloc((size_t)state->total_slots * sizeof(kvs_key_index_entry));
+    state->new_entries           = malloc((size_t)config->iterations * sizeof(kvs_key_index_entry));
+    state->offsets               = malloc((size_t)config->iterations * sizeof(uint32_t));
+    state->data_starts           = malloc((size_t)config->iterations * sizeof(uint32_t));
+    state->slot_starts           = malloc((size_t)config->iterations * sizeof(uint32_t));
+    state->hit_keys              = malloc((size_t)config->iterations * sizeof(uint32_t));
+    state->buffer                = malloc(config->value_size);
+    if (!state->bitmap || !state->valid_bitmap || !state->valid_metadata_bitmap || !state->index || !state->new_entries
+        || !state->offsets || !state->data_starts || !state->slot_starts || !state->hit_keys || !state->buffer) {
+        fprintf(stderr, "Не хватает памяти для синтетического состояния.\n");
+        return false;
+    }
+
+    // Шаг 1: Битовые карты данных и метаданных и их варианты без мусора
+    micro_fill_bitmap(device->bitmap, state->total_words, config->fill, config->fragmentation, MICRO_RUN_PAGES * sb->words_per_page);
+    micro_make_valid(state->valid_bitmap, device->bitmap, state->total_words, config->garbage);
+    memcpy(state->bitmap, device->bitmap, sb->bitmap_size_bytes);
+    micro_fill_bitmap(device->metadata_bitmap, state->total_slots, config->fill, config->fragmentation,
+                      MICRO_RUN_PAGES * (sb->page_size_bytes / sizeof(kvs_metadata)));
+    micro_make_valid(state->valid_metadata_bitmap, device->metadata_bitmap, state->total_slots, config->garbage);
+
+    // Шаг 2: key_index - по ключу на каждый занятый слот метаданных; новые ключи получают свободные слоты
+    uint64_t number = 0;
+    device->key_count = 0;
+    kvs_slot_map_rebuild();
+    for (uint32_t slot = 0; slot < state->total_slots; slot++) {
+        kvs_key_index_entry entry;
+        micro_make_key(&entry, number++);
+        entry.metadata_offset = sb->metadata_offset + slot * sizeof(kvs_metadata);
+        if (get_bit(device->metadata_bitmap, slot)) {
+            kvs_key_index_insert(&entry, NULL);
+        } else if (state->new_count < config->iterations) {
+            state->new_entries[state->new_count++] = entry;
+        }
+    }
+    // Ключам сверх свободных слотов слот не нужен: они используются только для промахов поиска
+    state->insert_count = state->new_count;
+    while (state->new_count < config->iterations) {
+        micro_make_key(&state->new_entries[state->new_count++], number++);
+    }
+    state->key_count = device->key_count;
+    memcpy(state->index, device->key_index, state->key_count * sizeof(kvs_key_index_entry));
+
+    // Шаг 3: Аргументы операций
+    for (uint32_t i = 0; i < config->iterations; i++) {
+        state->offsets[i]     = sb->data_offset + (uint32_t)(micro_rand() % (state->total_words - value_words)) * sb->word_size_bytes;
+        state->data_starts[i] = (uint32_t)(micro_rand() % state->total_words);
+        state->slot_starts[i] = (uint32_t)(micro_rand() % state->total_slots);
+        state->hit_keys[i]    = state->key_count ? (uint32_t)(micro_rand() % state->key_count) : 0;
+    }
+    for (uint32_t i = 0; i < config->value_size; i++) {
+        state->buffer[i] = (uint8_t)((micro_rand() + i) % 0xFF);
+    }
+    return true;
+}
+
+static void micro_free_state(micro_state *state)
+{
+    free(state->bitmap);
+    free(state->valid_bitmap);
+    free(state->valid_metadata_bitmap);
+    free(state->index);
+    free(state->new_entries);
+    free(state->offsets);
+    free(state->data_starts);
+    free(state->slot_starts);
+    free(state->hit_keys);
+    free(state->buffer);
+}
+
+static int micro_compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Выполняет примитив rounds раз и печатает его результат.
+static void micro_measure(FILE *out, micro_state *state, const micro_config *config, const micro_case *test, bool last)
+{
+    uint32_t count = config->iterations / test->divisor ? config->iterations / test->divisor : 1;
+    if (test->run == micro_index_insert && count > state->insert_count) {
+        count = state->insert_count;
+    }
+    double ns_per_op[MICRO_MAX_ROUNDS];
+    uint64_t device_ns = 0;
+    for (uint32_t r = 0; r < config->rounds; r++) {
+        if (test->prepare) {
+            test->prepare(state);
+        }
+        uint64_t clock_before = ssdmmc_sim_get_clock_ns(state->handle->sim);
+        uint64_t start = micro_now_ns();
+        micro_sink += test->run(state, config, count);
+        uint64_t elapsed = micro_now_ns() - start;
+        device_ns += ssdmmc_sim_get_clock_ns(state->handle->sim) - clock_before;
+        ns_per_op[r] = count ? (double)elapsed / count : 0;
+    }
+    qsort(ns_per_op, config->rounds, sizeof(double), micro_compare_double);
+
+    double median = ns_per_op[config->rounds / 2];
+    fprintf(out, "    \"%s\": {\"ops\": %u, \"ns_per_op\": %.1f, \"best_ns_per_op\": %.1f, \"device_ns_per_op\": %.1f",
+            test->name, count, median, ns_per_op[0], count ? (double)device_ns / config->rounds / count : 0.0);
+    if (test->has_bytes) {
+        fprintf(out, ", \"bytes_per_op\": %u, \"mb_per_sec\": %.1f", config->value_size, median > 0 ? config->value_size * 1e3 / median : 0.0);
+    }
+    fprintf(out, "}%s\n", last ? "" : ",");
+}
+
+int main(int argc, char **argv)
+{
+    // Шаг 1: Параметры по умолчанию
+    micro_config config = {0};
+    config.fill          = 0.5;
+    config.fragmentation = 0.5;
+    config.garbage       = 0.25;
+    config.value_size    = 100;
+    config.iterations    = MICRO_DEFAULT_ITERATIONS;
+    config.rounds        = MICRO_DEFAULT_ROUNDS;
+    config.storage       = MICRO_DEFAULT_STORAGE;
+    config.layout        = KVS_LAYOUT_LINEAR;
+    config.seed          = 1;
+    config.path          = MICRO_DEFAULT_PATH;
+    if (!micro_parse_args(&config, argc, argv)) {
+        return 2;
+    }
+    micro_rng_state = config.seed ? config.seed : 1;
+
+    // Шаг 2: Открываем новое хранилище и делаем его текущим устройством: примитивы работают с ним напрямую
+    kvs_options options = {config.storage, config.layout, false, false};
+    kvs_handle *handle = NULL;
+    if (strcmp(config.path, MICRO_DEFAULT_PATH) == 0) {
+        ssdmmc_sim_ensure_data_dir_exists();
+    }
+    remove(config.path);
+    if (kvs_open(config.path, &options, &handle) != KVS_SUCCESS) {
+        fprintf(stderr, "Не удалось создать хранилище %s.\n", config.path);
+        return 1;
+    }
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_superblock saved_superblock = device->superblock;
+
+    // Шаг 3: Синтетическое состояние
+    micro_state state = {0};
+    state.handle = handle;
+    if (!micro_build_state(&state, &config)) {
+        micro_free_state(&state);
+        kvs_bind_device(previous);
+        kvs_close(handle);
+        return 1;
+    }
+
+    // Шаг 4: Измеряем примитивы и печатаем результат
+    FILE *out = config.output ? fopen(config.output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Не удалось создать файл %s.\n", config.output);
+        micro_free_state(&state);
+        kvs_bind_device(previous);
+        kvs_close(handle);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"fill\": %.4f, \"fragmentation\": %.4f, \"garbage\": %.4f, \"value_size\": %u, \"iterations\": %u, "
+                 "\"rounds\": %u, \"storage_bytes\": %zu, \"layout\": \"%s\", \"seed\": %lu},\n",
+            config.fill, config.fragmentation, config.garbage, config.value_size, config.iterations, config.rounds, config.storage,
+            config.layout == KVS_LAYOUT_HASH ? "hash" : "linear", (unsigned long)config.seed);
+    uint32_t used_words  = micro_count_bits(state.bitmap, state.total_words);
+    uint32_t valid_words = micro_count_bits(state.valid_bitmap, state.total_words);
+    fprintf(out, "  \"state\": {\"data_words\": %u, \"data_fill\": %.4f, \"data_garbage\": %.4f, \"metadata_slots\": %u, \"keys\": %u, \"insert_keys\": %u},\n",
+            state.total_words, (double)used_words / state.total_words, used_words ? 1.0 - (double)valid_words / used_words : 0.0,
+            state.total_slots, state.key_count, state.insert_count);
+    fprintf(out, "  \"primitives\": {\n");
+    size_t case_count = sizeof(micro_cases) / sizeof(micro_cases[0]);
+    for (size_t i = 0; i < case_count; i++) {
+        micro_measure(out, &state, &config, &micro_cases[i], i + 1 == case_count);
+    }
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    // Шаг 5: Возвращаем пустое состояние нового хранилища, чтобы закрытие сохранило согласованные служебные данные
+    memset(device->bitmap, 0, device->superblock.bitmap_size_bytes);
+    memset(device->metadata_bitmap, 0, device->superblock.metadata_bitmap_size_bytes);
+    device->key_count = 0;
+    kvs_slot_map_rebuild();
+    device->superblock = saved_superblock;
+    micro_free_state(&state);
+    kvs_bind_device(previous);
+    kvs_close(handle);
+    return 0;
+}
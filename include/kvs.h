@@ -18,29 +18,48 @@ typedef enum {
     KVS_ERROR_UNKNOWN = -9              // Неизвестная/неспецифическая ошибка
 } kvs_status;
 
-#define KVS_KEY_SIZE 128             // Размер ключа
+// Наибольшая длина ключа в байтах. Задается при сборке (например, -DKVS_KEY_SIZE=32).
+// Слот метаданных хранит только первые KVS_SLOT_KEY_SIZE байт ключа, остальные байты длинного ключа
+// лежат в области данных рядом со значением, поэтому размер слота от KVS_KEY_SIZE не зависит.
+// Ключ - это последовательность байт длиной от 1 до KVS_KEY_SIZE. Все функции принимают длину ключа
+// key_len и читают ровно key_len байт: ключи "a" и "a\0" различны.
+#ifndef KVS_KEY_SIZE
+#define KVS_KEY_SIZE 128
+#endif
+#if KVS_KEY_SIZE < 1 || KVS_KEY_SIZE > 255
+#error "KVS_KEY_SIZE должен быть в диапазоне 1..255"
+#endif
+
+// Раскладка слотов метаданных на устройстве. Выбирается при создании хранилища и сохраняется в суперблоке.
+typedef enum {
+    KVS_LAYOUT_LINEAR = 0,           // Слоты выделяются по кругу, ключ ищется по key_index в ОЗУ
+    KVS_LAYOUT_HASH   = 1            // Слот определяется хешем ключа, поиск читает с устройства одну корзину слотов
+} kvs_metadata_layout;
 
 
 // Проверяет существование ключа в хранилище.
-// key - указатель на ключ.
+// key     - указатель на ключ.
+// key_len - размер ключа (1..KVS_KEY_SIZE).
 // Возвращает 1 если ключ существует, 0 если не найден, или отрицательное значение (код ошибки).
-int kvs_exists(const void *key);
+int kvs_exists(const void *key, size_t key_len);
 
 // Удаляет запись по ключу.
-// key - ключ для удаления.
+// key     - ключ для удаления.
+// key_len - размер ключа (1..KVS_KEY_SIZE).
 // Возвращает KVS_SUCCESS при успешном удалении, KVS_ERROR_KEY_NOT_FOUND если ключ не найден, или другой код ошибки.
-kvs_status kvs_delete(const void *key);
+kvs_status kvs_delete(const void *key, size_t key_len);
 
 // Получает значение по ключу.
 // key       - ключ для поиска.
+// key_len   - размер ключа (1..KVS_KEY_SIZE).
 // value     - буфер для сохранения значения.
 // value_len - на входе содержит размер буфера value, на выходе — фактический размер значения.
 // Возвращает KVS_SUCCESS при успехе, KVS_ERROR_BUFFER_TOO_SMALL если буфер слишком мал, или другой код ошибки.
-kvs_status kvs_get(const void *key, void *value, size_t *value_len);
+kvs_status kvs_get(const void *key, size_t key_len, void *value, size_t *value_len);
 
 // Сохраняет или обновляет значение по ключу.
 // key       - ключ.
-// key_len   - размер ключа.
+// key_len   - размер ключа (1..KVS_KEY_SIZE), читаются только key_len байт.
 // value     - указатель на данные значения.
 // value_len - размер значения.
 // Возвращает KVS_SUCCESS при успехе, KVS_ERROR_NO_SPACE если нет места, или другой код ошибки.
@@ -48,18 +67,538 @@ kvs_status kvs_put(const void *key, size_t key_len, const void *value, size_t va
 
 // Обновляет значение для существующего ключа.
 // key       - ключ, значение которого нужно обновить.
+// key_len   - размер ключа (1..KVS_KEY_SIZE).
 // value     - указатель на новые данные.
 // value_len - размер новых данных.
 // Возвращает KVS_SUCCESS при успехе или код ошибки.
-kvs_status kvs_update(const void *key, const void *value, size_t value_len);
+kvs_status kvs_update(const void *key, size_t key_len, const void *value, size_t value_len);
+
+// Возвращает разброс износа страниц пользовательских данных.
+// spread       - разность максимального и минимального счетчиков перезаписи страниц.
+// min_rewrites - необязательный указатель для минимального счетчика (может быть NULL).
+// max_rewrites - необязательный указатель для максимального счетчика (может быть NULL).
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_get_wear_spread(uint32_t *spread, uint32_t *min_rewrites, uint32_t *max_rewrites);
+
+// Задает бюджет кеша чтения в байтах и очищает кеш.
+// budget_bytes - максимальный суммарный размер закешированных значений, 0 выключает кеш.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_set_cache_budget(size_t budget_bytes);
+
+// Возвращает статистику кеша чтения.
+// hits   - количество чтений, обслуженных из кеша.
+// misses - количество чтений, потребовавших обращения к устройству.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_get_cache_stats(uint64_t *hits, uint64_t *misses);
+
+// Время операций эмулятора флеш-памяти. Каждая операция устройства добавляет свое время к виртуальным
+// часам хранилища, поэтому по ним видно, сколько заняла бы нагрузка на реальной памяти.
+typedef struct {
+    uint32_t read_ns;                   // tR: чтение страницы в регистр кристалла (по умолчанию 50 мкс)
+    uint32_t program_ns;                // tPROG: программирование страницы (по умолчанию 600 мкс)
+    uint32_t erase_ns;                  // tBERS: стирание страницы (по умолчанию 3 мс)
+    uint32_t bus_ps_per_byte;           // Передача байта по шине канала в пикосекундах (по умолчанию 2500)
+    bool sleep;                         // Поток, выполняющий операцию, действительно ждет смоделированное время
+} kvs_device_timing;
+
+// Задает время операций устройства хранилища. Накопленное время на часах не меняется.
+// timing - новое время операций.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_set_device_timing(const kvs_device_timing *timing);
+
+// Возвращает время устройства по виртуальным часам хранилища: смоделированное время всех операций
+// с флеш-памятью с открытия хранилища, выполненных по одной.
+// device_ns - сюда записывается время в наносекундах.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_get_device_time(uint64_t *device_ns);
+
+// Путь, по которому хранилище пишет на устройство.
+typedef enum {
+    KVS_WRITE_PATH_PUT = 0,             // Запись ключей и значений (put, update, сброс буфера записи)
+    KVS_WRITE_PATH_DELETE,              // Удаление: очистка областей данных и метаданных через стирание страниц
+    KVS_WRITE_PATH_GC,                  // Сборка мусора: перенос живых данных и очистка освобожденных страниц
+    KVS_WRITE_PATH_WEAR_LEVEL,          // Статическое выравнивание износа
+    KVS_WRITE_PATH_PERSIST,             // Сохранение служебных данных (суперблок, биткарты, счетчики, CRC)
+    KVS_WRITE_PATH_COUNT
+} kvs_write_path;
+
+// Счетчики записи одного пути. Усиление записи пути - programmed_bytes / host_bytes,
+// всего хранилища - сумма programmed_bytes всех путей, деленная на сумму host_bytes.
+typedef struct {
+    uint64_t host_bytes;                // Байт ключей и значений, переданных пользователем (только у KVS_WRITE_PATH_PUT)
+    uint64_t programmed_bytes;          // Байт, переданных устройству на программирование, включая перезапись страниц после стирания
+    uint64_t erased_pages;              // Стерто страниц
+} kvs_write_counters;
+
+// Статистика записи хранилища.
+typedef struct {
+    kvs_write_counters paths[KVS_WRITE_PATH_COUNT]; // Счетчики по путям записи
+    uint64_t nand_violations;           // Записей, требовавших перевода битов 0 -> 1 без стирания (см. kvs_set_strict_nand)
+} kvs_write_stats;
+
+// Включает или выключает строгий режим NAND. Флеш-память при программировании может только сбрасывать
+// биты (1 -> 0), вернуть бит в 1 можно лишь стиранием страницы. В строгом режиме эмулятор отклоняет
+// запись, нарушающую это правило, и учитывает ее в nand_violations, а хранилище само стирает страницу
+// перед записью, если записываемые данные нельзя запрограммировать поверх текущих. По умолчанию режим
+// выключен: эмулятор позволяет перезаписывать слова на месте.
+// strict - true включает строгий режим.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_set_strict_nand(bool strict);
+
+// Возвращает статистику записи хранилища с его открытия.
+// stats - сюда записывается статистика.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_get_write_stats(kvs_write_stats *stats);
+
+// Операции API, которые учитывает kvs_get_stats.
+typedef enum {
+    KVS_OP_GET = 0,                     // kvs_get
+    KVS_OP_PUT,                         // kvs_put
+    KVS_OP_UPDATE,                      // kvs_update
+    KVS_OP_DELETE,                      // kvs_delete
+    KVS_OP_EXISTS,                      // kvs_exists
+    KVS_OP_COUNT
+} kvs_op_type;
+
+// Результаты операций API, которые учитывает kvs_get_stats.
+typedef enum {
+    KVS_OP_RESULT_OK = 0,               // KVS_SUCCESS (у kvs_exists - ключ найден)
+    KVS_OP_RESULT_NOT_FOUND,            // KVS_ERROR_KEY_NOT_FOUND (у kvs_exists - ключ не найден)
+    KVS_OP_RESULT_ALREADY_EXISTS,       // KVS_ERROR_KEY_ALREADY_EXISTS
+    KVS_OP_RESULT_NO_SPACE,             // KVS_ERROR_NO_SPACE
+    KVS_OP_RESULT_ERROR,                // Остальные ошибки
+    KVS_OP_RESULT_COUNT
+} kvs_op_result;
+
+// Операции, время выполнения которых записывается в гистограммы задержек.
+// Время операции API включает ожидание блокировки хранилища, а также вложенные сборку мусора и сохранение.
+typedef enum {
+    KVS_LATENCY_GET = 0,                // kvs_get
+    KVS_LATENCY_PUT,                    // kvs_put
+    KVS_LATENCY_DELETE,                 // kvs_delete
+    KVS_LATENCY_UPDATE,                 // kvs_update
+    KVS_LATENCY_GC,                     // Один запуск сборщика мусора
+    KVS_LATENCY_PERSIST,                // Одно сохранение служебных данных
+    KVS_LATENCY_OP_COUNT
+} kvs_latency_op;
+
+// Сводка гистограммы задержек одной операции. Гистограмма логарифмическая: интервал значений делится
+// на 32 корзины на каждую степень двойки, поэтому процентили завышены не больше чем на 1/32 (около 3%).
+typedef struct {
+    uint64_t count;                     // Количество замеров
+    uint64_t total_ns;                  // Суммарное время
+    uint64_t p50_ns;                    // Медиана
+    uint64_t p99_ns;                    // 99-й процентиль
+    uint64_t p999_ns;                   // 99.9-й процентиль
+    uint64_t max_ns;                    // Наибольшее время
+} kvs_latency_summary;
+
+// Статистика хранилища: счетчики с его открытия и текущие показатели.
+typedef struct {
+    uint64_t ops[KVS_OP_COUNT][KVS_OP_RESULT_COUNT]; // Операции API по типу и результату
+
+    uint64_t device_words_read;         // Прочитано слов устройства
+    uint64_t device_words_written;      // Записано слов устройства
+    uint64_t device_pages_erased;       // Стерто страниц устройства
+
+    uint64_t gc_cycles;                 // Запусков сборщика мусора
+    uint64_t gc_bytes_moved;            // Байт живых данных, перенесенных сборщиком мусора
+    uint64_t persist_count;             // Сохранений служебных данных
+    uint64_t persist_bytes;             // Байт, записанных на устройство при сохранении служебных данных
+
+    uint64_t cache_hits;                // Чтений, обслуженных из кеша
+    uint64_t cache_misses;              // Чтений, потребовавших обращения к устройству
+    double   cache_hit_rate;            // Доля попаданий в кеш (0, если чтений не было)
+
+    uint32_t key_count;                 // Текущее количество ключей
+    uint32_t max_key_count;             // Наибольшее количество ключей (количество слотов метаданных)
+
+    uint64_t data_bytes;                // Размер области пользовательских данных
+    uint64_t free_bytes;                // Свободно в области данных
+    uint64_t largest_free_bytes;        // Наибольший непрерывный свободный участок области данных
+    double   fragmentation;             // 1 - largest_free_bytes / free_bytes: 0 - все свободное место одним участком
+
+    uint32_t wear_spread;               // Разность максимального и минимального счетчиков перезаписи страниц данных
+    uint32_t wear_min;                  // Минимальный счетчик перезаписи страницы данных
+    uint32_t wear_max;                  // Максимальный счетчик перезаписи страницы данных
+
+    kvs_latency_summary latency[KVS_LATENCY_OP_COUNT]; // Задержки операций (с открытия или с последней выгрузки со сбросом)
+} kvs_stats;
+
+// Возвращает статистику хранилища. Счетчики операций ведутся всегда: каждый поток увеличивает
+// свою полосу счетчиков без барьеров, kvs_get_stats складывает полосы.
+// stats - сюда записывается статистика.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_get_stats(kvs_stats *stats);
+
+// Формат выгрузки метрик.
+typedef enum {
+    KVS_METRICS_JSON = 0,               // Объект JSON: {"latency_ns": {"get": {"count": ..., "p50": ..., ...}, ...}}
+    KVS_METRICS_PROMETHEUS              // Текстовый формат Prometheus: метрика kvs_latency_seconds типа summary
+} kvs_metrics_format;
+
+// Выгружает сводки гистограмм задержек в текст.
+// format     - формат выгрузки.
+// reset      - true: замеры, вошедшие в выгрузку, удаляются из гистограмм, и следующая выгрузка
+//              покажет только новые. Замеры, сделанные во время выгрузки, не теряются.
+// buffer     - буфер для текста; текст завершается нулевым байтом.
+// buffer_len - на входе размер буфера, на выходе размер текста вместе с нулевым байтом.
+// Возвращает KVS_SUCCESS при успехе, KVS_ERROR_BUFFER_TOO_SMALL если буфер слишком мал (гистограммы
+// при этом не сбрасываются, а в buffer_len записывается нужный размер), или другой код ошибки.
+kvs_status kvs_export_latency(kvs_metrics_format format, bool reset, char *buffer, size_t *buffer_len);
+
+// Вид записи трассы ввода-вывода.
+typedef enum {
+    KVS_TRACE_READ = 0,                 // Чтение слов first_word..first_word + word_count - 1 страницы page
+    KVS_TRACE_WRITE,                    // Запись слов страницы
+    KVS_TRACE_ERASE,                    // Стирание страницы
+    KVS_TRACE_API                       // Завершение операции API: page - длина значения, status - результат
+} kvs_trace_kind;
+
+// Значение api_op и path записи трассы вне операции API (открытие, сброс буфера записи, закрытие).
+#define KVS_TRACE_NONE 0xFF
+
+// Запись трассы ввода-вывода, 32 байта. Операции устройства записываются до события KVS_TRACE_API
+// операции, которая их вызвала; подряд идущие слова одной страницы образуют одну запись.
+typedef struct {
+    uint64_t time_ns;                   // Время от начала трассы
+    uint64_t device_ns;                 // Виртуальные часы устройства перед операцией (см. kvs_get_device_time)
+    uint32_t key_hash;                  // Хеш ключа операции API (0 - без ключа)
+    uint32_t page;                      // Страница устройства; у KVS_TRACE_API - длина значения
+    uint16_t first_word;                // Первое слово диапазона
+    uint16_t word_count;                // Количество слов (у стирания - все слова страницы)
+    uint8_t  kind;                      // kvs_trace_kind
+    uint8_t  api_op;                    // kvs_op_type операции API или KVS_TRACE_NONE
+    uint8_t  path;                      // kvs_write_path, действовавший во время операции, или KVS_TRACE_NONE
+    int8_t   status;                    // У KVS_TRACE_API - kvs_status операции, иначе 0
+} kvs_trace_record;
+
+// Начинает трассу ввода-вывода хранилища. Если трасса уже идет, она начинается заново.
+// path         - файл трассы (создается заново); его можно воспроизвести утилитой kvs_trace_replay.
+//                NULL - трасса пишется в кольцо в памяти, записи забираются kvs_trace_read.
+// ring_records - емкость кольца в записях (при path == NULL); заполненное кольцо перезаписывает самые старые.
+// Возвращает KVS_SUCCESS при успехе, KVS_ERROR_INVALID_PARAM или KVS_ERROR_STORAGE_FAILURE, если файл не создан.
+kvs_status kvs_trace_start(const char *path, uint32_t ring_records);
+
+// Останавливает трассу и закрывает ее файл. Без трассы ничего не делает.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_trace_stop(void);
+
+// Забирает самые старые записи из кольца трассы.
+// records - буфер для записей.
+// count   - на входе емкость буфера в записях, на выходе количество записанных.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_trace_read(kvs_trace_record *records, size_t *count);
+
+// Включает, перенастраивает или выключает буфер записи (memtable) в ОЗУ.
+// Пока буфер включен, put, update и delete только записываются в него, а get и exists сначала
+// проверяют буфер. Ключ, удаленный или перезаписанный до сброса, не доходит до устройства.
+// Буфер сбрасывается на устройство при заполнении, при вызове kvs_flush и при kvs_deinit.
+// Операции, не сброшенные до сбоя питания, теряются; ошибки нехватки места проявляются при сбросе.
+// Перед сменой настроек накопленные операции сбрасываются.
+// budget_bytes - суммарный размер ключей и значений в буфере, при достижении которого он сбрасывается;
+//                0 выключает буфер (по умолчанию буфер выключен).
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_set_write_buffer(size_t budget_bytes);
+
+// Точка надежности: применяет к устройству все операции из буфера записи.
+// Операции применяются в порядке ключей, служебные данные сохраняются один раз на страницу записанных данных.
+// Возвращает KVS_SUCCESS при успехе (в том числе если буфер выключен или пуст) или код ошибки.
+kvs_status kvs_flush(void);
 
 // Инициализирует KVS. Пытается загрузить существующее хранилище или создает новое.
 // storage_size_bytes - размер пользовательской области данных.
 // Возвращает KVS_SUCCESS при успехе или код ошибки.
 kvs_status kvs_init(size_t storage_size_bytes);
 
+// Инициализирует KVS так же, как kvs_init, но новое хранилище создается с заданной раскладкой метаданных.
+// У загружаемого существующего хранилища раскладка берется из его суперблока.
+// storage_size_bytes - размер пользовательской области данных.
+// layout             - раскладка слотов метаданных для нового хранилища.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_init_with_layout(size_t storage_size_bytes, kvs_metadata_layout layout);
+
 // Деинициализирует KVS, освобождая все ресурсы.
 void kvs_deinit(void);
 
+// Уровень важности сообщения лога.
+typedef enum {
+    KVS_LOG_DEBUG = 0,                  // Подробности работы
+    KVS_LOG_INFO,                       // Обычные события: открытие и закрытие хранилища, сборка мусора
+    KVS_LOG_WARNING,                    // Сбой, после которого хранилище продолжает работу
+    KVS_LOG_ERROR,                      // Ошибка, из-за которой операция не выполнена
+    KVS_LOG_OFF                         // Лог выключен (только для kvs_set_log_level)
+} kvs_log_level;
+
+// Куда пишется лог.
+typedef enum {
+    KVS_LOG_SINK_FILE = 0,              // Файл: дописывается в конец, открыт, пока открыто хотя бы одно хранилище
+    KVS_LOG_SINK_FD,                    // Открытый файловый дескриптор; библиотека его не закрывает
+    KVS_LOG_SINK_CALLBACK               // Функция обратного вызова
+} kvs_log_sink_type;
+
+// Функция, получающая сообщения лога. Вызывается из фонового потока лога (или из потока, записавшего
+// сообщение, если ни одно хранилище не открыто), по одному сообщению за раз.
+// message - текст без даты и перевода строки, действителен только во время вызова.
+// Функция не должна вызывать функции библиотеки KVS.
+typedef void (*kvs_log_callback)(kvs_log_level level, const char *message, void *user_data);
+
+// Приемник лога.
+typedef struct {
+    kvs_log_sink_type type;             // Вид приемника
+    const char *path;                   // KVS_LOG_SINK_FILE: путь к файлу; NULL - файл по умолчанию (../kvs_log.txt)
+    int fd;                             // KVS_LOG_SINK_FD: дескриптор
+    kvs_log_callback callback;          // KVS_LOG_SINK_CALLBACK: функция
+    void *user_data;                    // KVS_LOG_SINK_CALLBACK: передается в функцию
+} kvs_log_sink;
+
+// Лог общий для всех хранилищ процесса. Запись сообщения не ждет ввода-вывода: текст помещается в кольцо
+// без блокировок, а в приемник его пишет фоновый поток, работающий, пока открыто хотя бы одно хранилище.
+// Если кольцо заполнено, сообщение отбрасывается и учитывается в kvs_get_log_stats.
+
+// Задает наименьший уровень записываемых сообщений (по умолчанию KVS_LOG_INFO).
+// Сообщения ниже этого уровня отбрасываются до форматирования.
+// Возвращает KVS_SUCCESS при успехе или KVS_ERROR_INVALID_PARAM.
+kvs_status kvs_set_log_level(kvs_log_level level);
+
+// Задает приемник лога. Сообщения, записанные до вызова, сначала дописываются в прежний приемник.
+// sink - новый приемник; NULL - файл по умолчанию.
+// Возвращает KVS_SUCCESS при успехе, KVS_ERROR_INVALID_PARAM при неверном приемнике
+// или KVS_ERROR_STORAGE_FAILURE, если файл не удалось открыть (приемник при этом не меняется).
+kvs_status kvs_set_log_sink(const kvs_log_sink *sink);
+
+// Ждет, пока все сообщения, записанные до вызова, будут переданы приемнику.
+void kvs_log_flush(void);
+
+// Возвращает статистику лога с запуска процесса.
+// written - сообщений, переданных приемнику.
+// dropped - сообщений, отброшенных из-за заполненного кольца.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_get_log_stats(uint64_t *written, uint64_t *dropped);
+
+// Курсор упорядоченного обхода ключей. Ключи возвращаются в порядке возрастания: побайтово,
+// а при общем префиксе короткий ключ раньше длинного. Значения читаются заранее пакетами,
+// чтение с устройства внутри пакета идет в порядке смещений.
+// Изменения, сделанные во время обхода, видны для ключей, которые еще не пройдены.
+// Перед чтением каждого пакета буфер записи сбрасывается на устройство.
+// Итератор нужно закрыть до kvs_deinit.
+typedef struct kvs_iterator kvs_iterator;
+
+// Открывает итератор по диапазону ключей [start, end).
+// start, start_len - нижняя граница (включительно); NULL - с первого ключа.
+// end, end_len     - верхняя граница (не включительно); NULL - до последнего ключа.
+//                    Длина границы - 1..KVS_KEY_SIZE, читаются только указанные байты.
+// iter_out         - сюда записывается открытый итератор.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_iter_open(const void *start, size_t start_len, const void *end, size_t end_len, kvs_iterator **iter_out);
+
+// Открывает итератор по всем ключам, начинающимся с prefix.
+// prefix_len - длина префикса (1..KVS_KEY_SIZE).
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_iter_open_prefix(const void *prefix, size_t prefix_len, kvs_iterator **iter_out);
+
+// Возвращает следующую пару ключ-значение.
+// key       - буфер размером KVS_KEY_SIZE байт, дополняется нулями после ключа.
+// key_len   - сюда записывается длина ключа (может быть NULL).
+// value     - буфер для значения.
+// value_len - на входе размер буфера value, на выходе фактический размер значения.
+// Возвращает KVS_SUCCESS при успехе, KVS_ERROR_KEY_NOT_FOUND если ключи закончились,
+// KVS_ERROR_BUFFER_TOO_SMALL если буфер мал (итератор при этом не сдвигается), или другой код ошибки.
+kvs_status kvs_iter_next(kvs_iterator *iter, void *key, size_t *key_len, void *value, size_t *value_len);
+
+// Закрывает итератор и освобождает его ресурсы. iter может быть NULL.
+void kvs_iter_close(kvs_iterator *iter);
+
+// Снимок хранилища: неизменное состояние всех ключей на момент создания.
+// Чтение из снимка не видит put, update и delete, сделанные после его создания. Пока открыт снимок,
+// удаленные и перезаписанные версии, которые он видит, продолжают занимать место в области данных:
+// сборщик мусора переносит их вместе с живыми данными, а освобождаются они вместе с последним снимком,
+// которому нужны. Снимки существуют только в ОЗУ и не переживают перезапуск.
+// Снимок нужно освободить до kvs_deinit, а итераторы по снимку - закрыть до его освобождения.
+typedef struct kvs_snapshot kvs_snapshot;
+
+// Создает снимок текущего состояния. Перед этим буфер записи сбрасывается на устройство.
+// snapshot_out - сюда записывается созданный снимок.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_snapshot_create(kvs_snapshot **snapshot_out);
+
+// Освобождает снимок и место, которое занимали только нужные ему версии. snapshot может быть NULL.
+void kvs_snapshot_release(kvs_snapshot *snapshot);
+
+// Получает значение ключа в том виде, в котором оно было на момент создания снимка.
+// Параметры и коды возврата те же, что у kvs_get.
+kvs_status kvs_snapshot_get(const kvs_snapshot *snapshot, const void *key, size_t key_len, void *value, size_t *value_len);
+
+// Открывает итератор по диапазону ключей [start, end) в состоянии снимка.
+// snapshot - снимок; NULL - текущее состояние (то же, что kvs_iter_open).
+// Остальные параметры и коды возврата те же, что у kvs_iter_open.
+kvs_status kvs_snapshot_iter_open(const kvs_snapshot *snapshot, const void *start, size_t start_len,
+                                  const void *end, size_t end_len, kvs_iterator **iter_out);
+
+// Открывает итератор по всем ключам снимка, начинающимся с prefix.
+// snapshot - снимок; NULL - текущее состояние (то же, что kvs_iter_open_prefix).
+kvs_status kvs_snapshot_iter_open_prefix(const kvs_snapshot *snapshot, const void *prefix, size_t prefix_len, kvs_iterator **iter_out);
+
+
+// Дескриптор хранилища. Каждое хранилище открывается в своем файле-эмуляторе и имеет собственное
+// состояние в ОЗУ и собственное состояние симулятора, поэтому в одном процессе их может быть несколько.
+// Функции без дескриптора (kvs_put, kvs_get, ...) работают с хранилищем по умолчанию, которое открывает kvs_init.
+// Разные хранилища можно использовать из разных потоков одновременно. Одно хранилище без режима
+// параллельного чтения (kvs_options.concurrent) в каждый момент должно использоваться только одним потоком.
+// Один файл нельзя открыть дважды.
+typedef struct kvs_handle kvs_handle;
+
+// Параметры открытия хранилища.
+typedef struct {
+    size_t storage_size_bytes;          // Размер пользовательской области данных нового хранилища
+    kvs_metadata_layout layout;         // Раскладка слотов метаданных нового хранилища
+    bool concurrent;                    // Режим параллельного чтения: хранилищем можно пользоваться из нескольких потоков.
+                                        // kvs_get, kvs_exists и kvs_snapshot_get выполняются параллельно под разделяемой
+                                        // блокировкой, остальные функции - по одной под исключительной
+    bool stripe_dies;                   // Политика чередования: соседние значения размещаются на страницах разных кристаллов
+                                        // эмулятора, чтобы их программирование шло параллельно. Область данных при этом
+                                        // заполняется вразброс, а свободные хвосты страниц занимаются на следующем круге
+} kvs_options;
+
+// Открывает хранилище в файле path: загружает существующее или создает новое с параметрами options.
+// path       - путь к файлу-эмулятору; NULL - файл по умолчанию (тот же, что у kvs_init).
+// options    - параметры нового хранилища (у существующего размер и раскладка берутся из его суперблока).
+// handle_out - сюда записывается дескриптор открытого хранилища.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_open(const char *path, const kvs_options *options, kvs_handle **handle_out);
+
+// Сбрасывает буфер записи, сохраняет служебные данные и закрывает хранилище. handle может быть NULL.
+// Итераторы и снимки хранилища нужно закрыть до этого.
+void kvs_close(kvs_handle *handle);
+
+// Возвращает дескриптор хранилища по умолчанию (NULL, если kvs_init не вызывался).
+kvs_handle *kvs_get_default_handle(void);
+
+// Функции с дескриптором: то же, что одноименные функции без суффикса _h, но над хранилищем handle.
+int kvs_exists_h(kvs_handle *handle, const void *key, size_t key_len);
+kvs_status kvs_delete_h(kvs_handle *handle, const void *key, size_t key_len);
+kvs_status kvs_get_h(kvs_handle *handle, const void *key, size_t key_len, void *value, size_t *value_len);
+kvs_status kvs_put_h(kvs_handle *handle, const void *key, size_t key_len, const void *value, size_t value_len);
+kvs_status kvs_update_h(kvs_handle *handle, const void *key, size_t key_len, const void *value, size_t value_len);
+kvs_status kvs_get_wear_spread_h(kvs_handle *handle, uint32_t *spread, uint32_t *min_rewrites, uint32_t *max_rewrites);
+kvs_status kvs_set_cache_budget_h(kvs_handle *handle, size_t budget_bytes);
+kvs_status kvs_get_cache_stats_h(kvs_handle *handle, uint64_t *hits, uint64_t *misses);
+kvs_status kvs_set_device_timing_h(kvs_handle *handle, const kvs_device_timing *timing);
+kvs_status kvs_get_device_time_h(kvs_handle *handle, uint64_t *device_ns);
+kvs_status kvs_set_strict_nand_h(kvs_handle *handle, bool strict);
+kvs_status kvs_get_write_stats_h(kvs_handle *handle, kvs_write_stats *stats);
+kvs_status kvs_get_stats_h(kvs_handle *handle, kvs_stats *stats);
+kvs_status kvs_export_latency_h(kvs_handle *handle, kvs_metrics_format format, bool reset, char *buffer, size_t *buffer_len);
+kvs_status kvs_trace_start_h(kvs_handle *handle, const char *path, uint32_t ring_records);
+kvs_status kvs_trace_stop_h(kvs_handle *handle);
+kvs_status kvs_trace_read_h(kvs_handle *handle, kvs_trace_record *records, size_t *count);
+kvs_status kvs_set_write_buffer_h(kvs_handle *handle, size_t budget_bytes);
+kvs_status kvs_flush_h(kvs_handle *handle);
+kvs_status kvs_iter_open_h(kvs_handle *handle, const void *start, size_t start_len, const void *end, size_t end_len, kvs_iterator **iter_out);
+kvs_status kvs_iter_open_prefix_h(kvs_handle *handle, const void *prefix, size_t prefix_len, kvs_iterator **iter_out);
+kvs_status kvs_snapshot_create_h(kvs_handle *handle, kvs_snapshot **snapshot_out);
+// Итераторы и снимки помнят свое хранилище, поэтому kvs_iter_next, kvs_snapshot_get, kvs_snapshot_release
+// и kvs_snapshot_iter_open работают с ними без дескриптора (kvs_snapshot_iter_open с NULL - с хранилищем по умолчанию).
+
+
+// Хранилище, разделенное на шарды. Пространство ключей делится по хешу ключа между shard_count
+// независимыми хранилищами: у каждого свой файл-эмулятор, своя доля пользовательской области, свои слоты
+// метаданных, биткарты, "карусели" и сборка мусора, своя блокировка. Поэтому запись в разные шарды из
+// разных потоков идет без общей блокировки. Номер набора, количество шардов и номер шарда сохраняются
+// в суперблоке каждого шарда: при повторном открытии набор проверяется, и шард от другого набора
+// или набора другого размера не будет принят.
+typedef struct kvs_sharded kvs_sharded;
+
+// Открывает хранилище из shard_count шардов в файлах "path.0", "path.1", ...: загружает существующие
+// или создает новые. Шарды всегда открываются в режиме параллельного чтения.
+// path        - префикс путей к файлам-эмуляторам шардов.
+// options     - параметры новых шардов; storage_size_bytes - суммарный размер пользовательской области всех шардов.
+// shard_count - количество шардов (1..64); у существующего хранилища должно совпадать с сохраненным.
+// store_out   - сюда записывается открытое хранилище.
+// Возвращает KVS_SUCCESS при успехе, KVS_ERROR_INVALID_PARAM, если файлы принадлежат другому набору
+// шардов или набору другого размера, или другой код ошибки.
+kvs_status kvs_sharded_open(const char *path, const kvs_options *options, uint32_t shard_count, kvs_sharded **store_out);
+
+// Сбрасывает буферы записи и закрывает все шарды. store может быть NULL.
+void kvs_sharded_close(kvs_sharded *store);
+
+// Возвращает количество шардов (0, если store равен NULL).
+uint32_t kvs_sharded_shard_count(const kvs_sharded *store);
+
+// Возвращает дескриптор шарда с номером index (NULL, если такого нет).
+// Через него шард можно обойти итератором, снять с него снимок или прочитать его статистику.
+kvs_handle *kvs_sharded_shard(const kvs_sharded *store, uint32_t index);
+
+// Возвращает дескриптор шарда, в котором хранится ключ key (NULL, если store или key равны NULL).
+kvs_handle *kvs_sharded_shard_for_key(const kvs_sharded *store, const void *key, size_t key_len);
+
+// Операции над ключом: то же, что одноименные функции без префикса kvs_sharded_, в шарде ключа.
+int kvs_sharded_exists(kvs_sharded *store, const void *key, size_t key_len);
+kvs_status kvs_sharded_delete(kvs_sharded *store, const void *key, size_t key_len);
+kvs_status kvs_sharded_get(kvs_sharded *store, const void *key, size_t key_len, void *value, size_t *value_len);
+kvs_status kvs_sharded_put(kvs_sharded *store, const void *key, size_t key_len, const void *value, size_t value_len);
+kvs_status kvs_sharded_update(kvs_sharded *store, const void *key, size_t key_len, const void *value, size_t value_len);
+
+// Сбрасывает буферы записи всех шардов. Возвращает KVS_SUCCESS или первый код ошибки.
+kvs_status kvs_sharded_flush(kvs_sharded *store);
+
+
+// Асинхронный доступ к хранилищу. Запросы отправляются в очередь и выполняются рабочим потоком очереди,
+// а вызывающий поток тем временем продолжает работу. Рабочий поток забирает запросы пакетами: чтения,
+// идущие подряд, выполняются в порядке страниц метаданных, а служебные данные после записей пакета
+// сохраняются один раз на страницу записанных данных, а не после каждой записи. Запросы выполняются в порядке
+// отправки, меняется только порядок соседних чтений. Очереди отправки и выполнения - кольца без блокировок.
+typedef struct kvs_async kvs_async;
+
+// Операция асинхронного запроса.
+typedef enum {
+    KVS_ASYNC_GET    = 0,            // kvs_get: value - буфер, value_len - его размер, после выполнения - длина значения
+    KVS_ASYNC_PUT    = 1,            // kvs_put: value и value_len - значение
+    KVS_ASYNC_UPDATE = 2,            // kvs_update: value и value_len - новое значение
+    KVS_ASYNC_DELETE = 3             // kvs_delete
+} kvs_async_op;
+
+typedef struct kvs_async_request kvs_async_request;
+
+// Функция обратного вызова. Вызывается в рабочем потоке очереди после выполнения запроса.
+typedef void (*kvs_async_callback)(kvs_async_request *request);
+
+// Асинхронный запрос. Принадлежит вызывающему: запрос, ключ и значение должны оставаться
+// доступными и неизменными до завершения запроса.
+struct kvs_async_request {
+    kvs_async_op op;                 // Операция
+    const void *key;                 // Ключ
+    size_t key_len;                  // Размер ключа (1..KVS_KEY_SIZE)
+    void *value;                     // Значение (KVS_ASYNC_PUT, KVS_ASYNC_UPDATE) или буфер для него (KVS_ASYNC_GET)
+    size_t value_len;                // Длина значения или размер буфера; для KVS_ASYNC_GET после выполнения - длина значения
+    kvs_async_callback callback;     // Вызывается после выполнения; NULL - запрос забирается через kvs_async_poll
+    void *user_data;                 // Данные вызывающего, библиотека их не использует
+    kvs_status status;               // Результат (заполняется при выполнении)
+};
+
+// Открывает очередь асинхронных запросов к хранилищу handle и запускает ее рабочий поток.
+// Пока очередь открыта, хранилище без режима параллельного чтения (kvs_options.concurrent)
+// можно использовать только через нее.
+// queue_depth - наибольшее количество запросов в работе (1..65536, округляется вверх до степени двойки).
+// queue_out   - сюда записывается открытая очередь.
+// Возвращает KVS_SUCCESS при успехе или код ошибки.
+kvs_status kvs_async_open(kvs_handle *handle, uint32_t queue_depth, kvs_async **queue_out);
+
+// Отправляет запрос в очередь и сразу возвращает управление. Вызывать можно из нескольких потоков.
+// Возвращает KVS_SUCCESS, KVS_ERROR_NO_SPACE, если в работе уже queue_depth запросов
+// (нужно забрать выполненные и повторить), или KVS_ERROR_INVALID_PARAM.
+kvs_status kvs_async_submit(kvs_async *queue, kvs_async_request *request);
+
+// Забирает до max выполненных запросов без функции обратного вызова, не дожидаясь новых.
+// Запросы возвращаются в порядке выполнения. Возвращает количество забранных запросов.
+size_t kvs_async_poll(kvs_async *queue, kvs_async_request **completed, size_t max);
+
+// Ждет, пока будут выполнены все отправленные к этому моменту запросы.
+void kvs_async_drain(kvs_async *queue);
+
+// Выполняет оставшиеся запросы, останавливает рабочий поток и закрывает очередь. queue может быть NULL.
+// Выполненные, но не забранные запросы остаются у вызывающего в заполненном виде.
+void kvs_async_close(kvs_async *queue);
+
 
 #endif //SSDMMCSTORE_KVS_H
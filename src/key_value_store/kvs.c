@@ -2,8 +2,16 @@
 #include "kvs_metadata.h"
 #include "kvs_internal_io.h"
 #include "kvs_valid.h"
+#include "kvs_cache.h"
+#include "kvs_memtable.h"
+#include "kvs_iter.h"
+#include "kvs_snapshot.h"
+#include "kvs_async.h"
+#include "kvs_stats.h"
 
-int kvs_exists(const void *key)
+// Проверяет существование ключа на устройстве, минуя буфер записи.
+// Возвращает 1 если ключ существует, 0 если не найден, или код ошибки.
+static int kvs_exists_on_flash(const void *key, uint32_t key_len)
 {
     // Шаг 1: Проверяем базовые параметры
     if (!device) {
@@ -16,28 +24,27 @@ int kvs_exists(const void *key)
         return 0;
     }
 
-    // Шаг 2: Ищем ключ в отсортированном key_index с помощью бинарного поиска
-    uint32_t left = 0, right = device->key_count - 1;
-    while (left <= right) {
-        uint32_t mid = left + (right - left) / 2;
-        int n = memcmp(device->key_index[mid].key, key, KVS_KEY_SIZE);
+    // Шаг 2: Ищем ключ: бинарным поиском по key_index или по хешу на устройстве, в зависимости от раскладки
+    uint32_t pos = 0;
+    if (!kvs_key_locate(key, key_len, &pos)) {
+        return 0;
+    }
 
-        if (n == 0) {
-            // Шаг 3: Ключ найден в key_index. Проверяем его валидность
-            return is_key_valid(mid) == 1 ? 1 : 0;
-        } else if (n < 0) {
-            left = mid + 1;
-        } else {
-            if (mid == 0) {
-                break;
-            }
-            right = mid - 1;
-        }
+    // Шаг 3: Ключ найден. Если он есть в кеше чтения, он уже проверен
+    uint32_t slot_index = (kvs_key_metadata_offset(pos) - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+    kvs_cache_lock();
+    bool cached = kvs_cache_lookup(slot_index) != NULL;
+    kvs_cache_unlock();
+    if (cached) {
+        return 1;
     }
-    return 0;
+
+    // Шаг 4: Иначе проверяем его валидность
+    return is_key_valid(pos) == 1 ? 1 : 0;
 }
 
-kvs_status kvs_delete(const void *key) {
+// Удаляет запись по ключу с устройства, минуя буфер записи.
+static kvs_status kvs_delete_on_flash(const void *key, uint32_t key_len) {
 
     // Шаг 1: Проверяем базовые параметры
     if (!device) {
@@ -46,28 +53,14 @@ kvs_status kvs_delete(const void *key) {
     if (!key) {
         return KVS_ERROR_INVALID_PARAM;
     }
+    kvs_set_write_path(KVS_WRITE_PATH_DELETE);
     if (device->key_count == 0) {
         return KVS_ERROR_KEY_NOT_FOUND;
     }
 
-    // Шаг 2: Ищем ключ в key_index
-    uint32_t left = 0, right = device->key_count - 1, mid = 0;
-    bool found = false;
-    while (left <= right) {
-        mid = left + (right - left) / 2;
-        int n = memcmp(device->key_index[mid].key, key, KVS_KEY_SIZE);
-        if (n == 0) {
-            found = true;
-            break;
-        } else if (n < 0) {
-            left = mid + 1;
-        } else {
-            if (mid == 0) {
-                break;
-            }
-            right = mid - 1;
-        }
-    }
+    // Шаг 2: Ищем ключ способом, соответствующим раскладке метаданных
+    uint32_t mid = 0;
+    bool found = kvs_key_locate(key, key_len, &mid);
 
     // Шаг 3: Проверяем, что ключ был найден и он полностью валиден
     if (!found || is_key_valid(mid) != 1) {
@@ -76,51 +69,66 @@ kvs_status kvs_delete(const void *key) {
 
     // Шаг 4: Получаем информацию о расположении данных
     kvs_metadata temp_metadata;
-    uint32_t metadata_offset = device->key_index[mid].metadata_offset;
-    if (kvs_read_region(device->fp, metadata_offset, &temp_metadata, sizeof(kvs_metadata)) < 0) {
+    uint32_t metadata_offset = kvs_key_metadata_offset(mid);
+    if (kvs_read_region(device->sim, metadata_offset, &temp_metadata, sizeof(kvs_metadata)) < 0) {
         return KVS_ERROR_STORAGE_FAILURE;
     }
 
-    // Шаг 5: Физически очищаем на диске область данных и область метаданных
-    uint32_t aligned_value_len = align_up(temp_metadata.value_size, device->superblock.word_size_bytes);
-    if (kvs_clear_region(device->fp, temp_metadata.value_offset, aligned_value_len) < 0) {
+    // Шаг 5: Если запись видит открытый снимок, сохраняем ее версию: область данных остается
+    // занятой до освобождения снимка, а слот метаданных освобождается сразу
+    uint32_t slot_index = (metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+    int retained = kvs_snapshot_retain(&temp_metadata, slot_index);
+    if (retained < 0) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+
+    // Шаг 6: Физически очищаем на диске область данных и область метаданных.
+    // Значение, хранящееся в слоте, стирается вместе с ним, область данных оно не занимает
+    bool inline_value = kvs_value_is_inline(&temp_metadata);
+    bool free_data = !inline_value && !retained;
+    uint32_t aligned_value_len = kvs_record_data_size(&temp_metadata);
+    if (free_data && kvs_clear_region(device->sim, temp_metadata.value_offset, aligned_value_len) < 0) {
         return KVS_ERROR_STORAGE_FAILURE;
     }
-    if (kvs_clear_region(device->fp, metadata_offset, sizeof(kvs_metadata)) < 0) {
+    if (kvs_clear_region(device->sim, metadata_offset, sizeof(kvs_metadata)) < 0) {
         return KVS_ERROR_STORAGE_FAILURE;
     }
 
-    // Шаг 6: Обновляем служебные структуры в ОЗУ
-    uint32_t slot_index = (metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+    // Шаг 7: Обновляем служебные структуры в ОЗУ
+    kvs_cache_invalidate(slot_index);
 
     if (bitmap_clear_metadata_slot(slot_index) < 0) {
-        kvs_log("KVS_DELETE ВНИМАНИЕ: Не удалось сбросить бит в биткарте метаданных для слота %u", slot_index);
+        kvs_log_at(KVS_LOG_WARNING, "KVS_DELETE ВНИМАНИЕ: Не удалось сбросить бит в биткарте метаданных для слота %u", slot_index);
     }
     if (rewrite_count_increment_region(metadata_offset, sizeof(kvs_metadata)) < 0) {
-        kvs_log("KVS_DELETE ВНИМАНИЕ: Не удалось увеличить счетчик перезаписи для метаданных");
+        kvs_log_at(KVS_LOG_WARNING, "KVS_DELETE ВНИМАНИЕ: Не удалось увеличить счетчик перезаписи для метаданных");
     }
-    if (rewrite_count_increment_region(temp_metadata.value_offset, aligned_value_len) < 0) {
-        kvs_log("KVS_DELETE ВНИМАНИЕ: Не удалось увеличить счетчик перезаписи для данных");
+    if (free_data && rewrite_count_increment_region(temp_metadata.value_offset, aligned_value_len) < 0) {
+        kvs_log_at(KVS_LOG_WARNING, "KVS_DELETE ВНИМАНИЕ: Не удалось увеличить счетчик перезаписи для данных");
     }
-    if (bitmap_clear_region(temp_metadata.value_offset, aligned_value_len) < 0) {
-        kvs_log("KVS_DELETE ВНИМАНИЕ: Не удалось сбросить биты в битовой карте данных");
+    if (free_data && bitmap_clear_region(temp_metadata.value_offset, aligned_value_len) < 0) {
+        kvs_log_at(KVS_LOG_WARNING, "KVS_DELETE ВНИМАНИЕ: Не удалось сбросить биты в битовой карте данных");
     }
 
-    // Шаг 7: Удаляем ключ из кеша key_index в ОЗУ
-    for (uint32_t i = mid; i < device->key_count - 1; i++) {
-        device->key_index[i] = device->key_index[i+1];
-    }
-    device->key_count--;
+    // Шаг 8: Удаляем ключ из кеша key_index в ОЗУ (в хеш-раскладке - только из количества ключей)
+    kvs_key_index_remove(mid);
+    device->mutation_count++;
 
-    // Шаг 8: Сохраняем все изменения служебных областей на диск
-    if (kvs_persist_all_service_data() < 0) {
+    // Шаг 9: Сохраняем все изменения служебных областей на диск.
+    // При пакетном сбросе буфера записи это делается один раз на пакет.
+    if (!device->persist_deferred && kvs_persist_all_service_data() < 0) {
         return KVS_ERROR_STORAGE_FAILURE;
     }
 
+    // Шаг 10: Периодически выравниваем износ страниц
+    kvs_wear_level_tick();
+
     return KVS_SUCCESS;
 }
 
-kvs_status kvs_get(const void *key, void *value, size_t *value_len)
+// Читает значение по ключу с устройства (или из кеша чтения), минуя буфер записи.
+// snapshot - снимок, состояние которого нужно прочитать (NULL - текущее состояние).
+static kvs_status kvs_get_from_flash(const kvs_snapshot *snapshot, const void *key, uint32_t key_len, void *value, size_t *value_len)
 {
     // Шаг 1: Проверяем базовые параметры
     if (!device) {
@@ -129,196 +137,251 @@ kvs_status kvs_get(const void *key, void *value, size_t *value_len)
     if (!key || !value || !value_len) {
         return KVS_ERROR_INVALID_PARAM;
     }
+
+    // Шаг 2: Версия, удаленная или перезаписанная после создания снимка, хранится отдельно от key_index
+    uint32_t version_pos = snapshot ? kvs_snapshot_find_version(key, key_len, snapshot->seq) : UINT32_MAX;
+    if (version_pos != UINT32_MAX) {
+        const kvs_snapshot_version *version = &device->snapshot_versions[version_pos];
+        if (*value_len < version->metadata.value_size) {
+            *value_len = version->metadata.value_size;
+            return KVS_ERROR_BUFFER_TOO_SMALL;
+        }
+        int valid = kvs_snapshot_read_version(version, value);
+        if (valid < 0) {
+            return KVS_ERROR_STORAGE_FAILURE;
+        }
+        if (valid == 0) {
+            return KVS_ERROR_KEY_NOT_FOUND;
+        }
+        *value_len = version->metadata.value_size;
+        return KVS_SUCCESS;
+    }
     if (device->key_count == 0) {
         return KVS_ERROR_KEY_NOT_FOUND;
     }
 
-    // Шаг 2: Ищем ключ в отсортированном key_index
-    uint32_t left = 0, right = device->key_count - 1, mid = 0;
-    bool found = false;
-    while (left <= right) {
-        mid = left + (right - left) / 2;
-        int n = memcmp(device->key_index[mid].key, key, KVS_KEY_SIZE);
-        if (n == 0) {
-            found = true;
-            break;
-        } else if (n < 0) {
-            left = mid + 1;
-        } else {
-            if (mid == 0) {
-                break;
-            }
-            right = mid - 1;
-        }
+    // Шаг 3: Ищем позицию ключа в key_index (в хеш-раскладке - слот в корзине на устройстве).
+    // Снимок не видит запись, сделанную после его создания
+    uint32_t mid = 0;
+    bool found = kvs_key_locate(key, key_len, &mid);
+    if (!found) {
+        return KVS_ERROR_KEY_NOT_FOUND;
     }
-
-    // Шаг 3: Проверяем, что ключ был найден и он полностью валиден
-    if (!found || is_key_valid(mid) != 1) {
+    uint32_t slot_index = (kvs_key_metadata_offset(mid) - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+    if (snapshot && !kvs_snapshot_slot_visible(slot_index, snapshot->seq)) {
         return KVS_ERROR_KEY_NOT_FOUND;
     }
 
-    // Шаг 4: Читаем метаданные ключа
+    // Шаг 4: Если значение есть в кеше чтения, отдаем его без обращения к устройству
+    kvs_cache_lock();
+    const kvs_cache_entry *cached = kvs_cache_lookup(slot_index);
+    if (cached) {
+        kvs_status status = KVS_SUCCESS;
+        if (*value_len < cached->value_size) {
+            status = KVS_ERROR_BUFFER_TOO_SMALL;
+        } else {
+            kvs_cache_copy_value(cached, value);
+        }
+        *value_len = cached->value_size;
+        kvs_cache_unlock();
+        return status;
+    }
+    kvs_cache_unlock();
+
+    // Шаг 5: Проверяем, что ключ полностью валиден, и получаем прочитанные при проверке метаданные
     kvs_metadata temp_metadata;
-    if (kvs_read_region(device->fp, device->key_index[mid].metadata_offset, &temp_metadata, sizeof(kvs_metadata)) < 0) {
-        return KVS_ERROR_STORAGE_FAILURE;
+    if (is_key_valid_read(mid, &temp_metadata) != 1) {
+        return KVS_ERROR_KEY_NOT_FOUND;
     }
 
-    // Шаг 5: Проверяем, достаточно ли велик буфер пользователя
+    // Шаг 6: Проверяем, достаточно ли велик буфер пользователя
     if (*value_len < temp_metadata.value_size) {
         *value_len = temp_metadata.value_size;
         return KVS_ERROR_BUFFER_TOO_SMALL;
     }
 
-    // Шаг 6: Читаем данные с диска
+    // Значение, хранящееся в слоте метаданных, уже прочитано вместе с ним
+    if (kvs_value_is_inline(&temp_metadata)) {
+        memcpy(value, kvs_inline_value(&temp_metadata), temp_metadata.value_size);
+        kvs_cache_lock();
+        kvs_cache_insert(slot_index, kvs_inline_value(&temp_metadata), temp_metadata.value_size);
+        kvs_cache_unlock();
+        *value_len = temp_metadata.value_size;
+        return KVS_SUCCESS;
+    }
+
+    // Шаг 7: Читаем данные с диска
     uint32_t aligned_value_len = align_up(temp_metadata.value_size, device->superblock.word_size_bytes);
-    uint8_t *temp_buffer = calloc(1,aligned_value_len);
+    uint8_t *temp_buffer = kvs_scratch_acquire(aligned_value_len);
     if (!temp_buffer) {
         return KVS_ERROR_STORAGE_FAILURE;
     }
-    if (kvs_read_region(device->fp, temp_metadata.value_offset, temp_buffer, aligned_value_len) < 0) {
-        free(temp_buffer);
+    if (kvs_read_region(device->sim, temp_metadata.value_offset, temp_buffer, aligned_value_len) < 0) {
+        kvs_scratch_release(temp_buffer);
         return KVS_ERROR_STORAGE_FAILURE;
     }
 
-    // Шаг 7: Копируем точное количество байт в буфер пользователя
+    // Шаг 8: Копируем точное количество байт в буфер пользователя и запоминаем значение в кеше
     memcpy(value, temp_buffer, temp_metadata.value_size);
-    free(temp_buffer);
+    kvs_cache_lock();
+    kvs_cache_insert(slot_index, temp_buffer, temp_metadata.value_size);
+    kvs_cache_unlock();
+    kvs_scratch_release(temp_buffer);
     *value_len = temp_metadata.value_size;
 
     return KVS_SUCCESS;
 }
 
-kvs_status kvs_put(const void *key, size_t key_len, const void *value, size_t value_len) {
+// Записывает новую пару ключ-значение.
+// update_count - счетчик обновлений, который будет сохранен в метаданных записи.
+//                По нему выбирается горячая или холодная область для данных.
+static kvs_status kvs_put_entry(const void *key, uint32_t key_len, const void *value, size_t value_len, uint32_t update_count) {
+    kvs_set_write_path(KVS_WRITE_PATH_PUT);
 
-    // Шаг 1: Проверяем базовые параметры
-    if (!device) {
-        return KVS_ERROR_NOT_INITIALIZED;
-    }
-    if (!key || !value || key_len != KVS_KEY_SIZE || value_len == 0) {
-        return KVS_ERROR_INVALID_PARAM;
-    }
+    // Шаг 1: Проверяем, есть ли место для еще одного ключа
     if (device->key_count >= device->superblock.max_key_count) {
         return KVS_ERROR_NO_SPACE;
     }
 
     // Шаг 2: Если ключ уже существует, возвращаем ошибку
-    if (kvs_exists(key) == 1) {
+    if (kvs_exists_on_flash(key, key_len) == 1) {
         return KVS_ERROR_KEY_ALREADY_EXISTS;
     }
 
-    // Шаг 3: Выравниваем данные до размера слова
-    uint32_t aligned_value_len = align_up(value_len, device->superblock.word_size_bytes);
+    // Шаг 3: Малое значение записывается прямо в слот метаданных: место в области данных ему не нужно.
+    // Остальные значения выравниваем до размера слова, а хвост длинного ключа кладем сразу за значением
+    uint32_t aligned_value_len = kvs_value_data_size(key_len, value_len);
+    bool inline_value = aligned_value_len == 0;
     uint8_t *padded_buffer = NULL;
     const void *final_value = value;
-    if (aligned_value_len != value_len) {
-        padded_buffer = calloc(1,aligned_value_len);
+    if (!inline_value && aligned_value_len != value_len) {
+        padded_buffer = kvs_scratch_acquire(aligned_value_len);
         if (!padded_buffer) {
             return KVS_ERROR_STORAGE_FAILURE;
         }
-        memcpy(padded_buffer, value, value_len);
-        memset(padded_buffer + value_len, 0xFF, aligned_value_len - value_len);
+        kvs_record_data_fill(padded_buffer, key, key_len, value, value_len);
         final_value = padded_buffer;
     }
 
     // Шаг 4: Ищем место для метаданных. Если не находим, запускаем сборщик мусора.
-    uint32_t metadata_offset = kvs_find_free_metadata_offset();
+    uint32_t metadata_offset = kvs_find_free_metadata_offset(key, key_len);
     while (metadata_offset == UINT32_MAX){
         kvs_log("Нет места для метаданных, запускаем сборщик мусора...");
-        if(kvs_gc(CLEAN_METADATA) == 0){
-            kvs_log("После очистки всего мусора, не нашлось места для метаданных");
-            if (padded_buffer) free(padded_buffer);
+        if(kvs_gc(CLEAN_METADATA, sizeof(kvs_metadata)) == 0){
+            kvs_log_at(KVS_LOG_WARNING, "После очистки всего мусора, не нашлось места для метаданных");
+            kvs_scratch_release(padded_buffer);
             return KVS_ERROR_NO_SPACE;
         }
-        metadata_offset = kvs_find_free_metadata_offset();
+        metadata_offset = kvs_find_free_metadata_offset(key, key_len);
     }
 
     // Шаг 5: Ищем место для данных. Если не находим, запускаем сборщик мусора.
-    uint32_t data_offset = kvs_find_free_data_offset(aligned_value_len);
+    int temperature = kvs_data_temperature(update_count);
+    uint32_t data_offset = inline_value ? KVS_INLINE_VALUE_OFFSET : kvs_find_free_data_offset(aligned_value_len, temperature);
     while (data_offset == UINT32_MAX){
         kvs_log("Нет места для данных, запускаем сборщик мусора...");
-        if( kvs_gc(CLEAN_DATA) == 0){
-            kvs_log("После очистки всего мусора, не нашлось места для данных");
-            if (padded_buffer) free(padded_buffer);
+        if( kvs_gc(CLEAN_DATA, aligned_value_len) == 0){
+            kvs_log_at(KVS_LOG_WARNING, "После очистки всего мусора, не нашлось места для данных");
+            kvs_scratch_release(padded_buffer);
             return KVS_ERROR_NO_SPACE;
         }
-        data_offset = kvs_find_free_data_offset(aligned_value_len);
+        data_offset = kvs_find_free_data_offset(aligned_value_len, temperature);
     }
 
     // Шаг 6: Записываем данные и метаданные на диск
     kvs_key_index_entry temp_key_entry;
-    memcpy(temp_key_entry.key, key, KVS_KEY_SIZE);
+    memset(temp_key_entry.key, 0, KVS_KEY_SIZE);
+    memcpy(temp_key_entry.key, key, key_len);
+    temp_key_entry.key_len = (uint8_t)key_len;
     temp_key_entry.metadata_offset = metadata_offset;
     temp_key_entry.flags = 2;
 
+    // Слот заполняется целиком, чтобы неиспользуемые байты ключа и выравнивание не влияли на CRC
     kvs_metadata temp_metadata;
-    memcpy(temp_metadata.key, key, KVS_KEY_SIZE);
+    memset(&temp_metadata, 0, sizeof(kvs_metadata));
+    temp_metadata.key_len = (uint8_t)key_len;
+    memcpy(temp_metadata.key, key, key_len - kvs_key_tail_size(key_len));
     temp_metadata.value_size = value_len;
     temp_metadata.value_offset = data_offset;
+    temp_metadata.update_count = update_count;
+    if (inline_value) {
+        kvs_inline_value_set(&temp_metadata, value, value_len);
+    }
 
-    device->key_index[device->key_count++] = temp_key_entry;
+    // Вставляем ключ на его место в отсортированном key_index
+    uint32_t index_pos = 0;
+    if (kvs_key_index_insert(&temp_key_entry, &index_pos) < 0) {
+        kvs_scratch_release(padded_buffer);
+        return KVS_ERROR_NO_SPACE;
+    }
 
     // Проверяем соответствует ли регион для записи биткарте данных
     // если нет, то очищаем те места, которые помечены в биткарте как пустые
 
-    if (kvs_verify_and_prepare_region(data_offset,aligned_value_len) < 0) {
-        device->key_count--;
-        if (padded_buffer) free(padded_buffer);
+    if (!inline_value && kvs_verify_and_prepare_region(data_offset,aligned_value_len) < 0) {
+        kvs_key_index_remove(index_pos);
+        kvs_scratch_release(padded_buffer);
         return KVS_ERROR_STORAGE_FAILURE;
     }
 
-    if (kvs_write_region(device->fp, metadata_offset, &temp_metadata, sizeof(kvs_metadata)) < 0) {
-        device->key_count--;
-        if (padded_buffer) free(padded_buffer);
+    if (kvs_write_region(device->sim, metadata_offset, &temp_metadata, sizeof(kvs_metadata)) < 0) {
+        kvs_key_index_remove(index_pos);
+        kvs_scratch_release(padded_buffer);
         return KVS_ERROR_STORAGE_FAILURE;
     }
-    if (kvs_write_region(device->fp, data_offset, final_value, aligned_value_len) < 0) {
-        kvs_clear_region(device->fp, metadata_offset, sizeof(kvs_metadata));
-        device->key_count--;
-        if (padded_buffer) free(padded_buffer);
+    if (!inline_value && kvs_write_region(device->sim, data_offset, final_value, aligned_value_len) < 0) {
+        kvs_clear_region(device->sim, metadata_offset, sizeof(kvs_metadata));
+        kvs_key_index_remove(index_pos);
+        kvs_scratch_release(padded_buffer);
         return KVS_ERROR_STORAGE_FAILURE;
     }
-    if (padded_buffer) {
-        free(padded_buffer);
-    }
+    kvs_scratch_release(padded_buffer);
 
     // Шаг 7: Обновляем служебные структуры в ОЗУ
-    qsort(device->key_index, device->key_count, sizeof(kvs_key_index_entry), kvs_key_index_entry_cmp);
     uint32_t slot_index = (metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+    kvs_cache_invalidate(slot_index);
 
     if (kvs_update_entry_crc(slot_index) < 0) {
-        kvs_log("KVS_PUT ВНИМАНИЕ: Не удалось обновить единый CRC для слота %u", slot_index);
+        kvs_log_at(KVS_LOG_WARNING, "KVS_PUT ВНИМАНИЕ: Не удалось обновить единый CRC для слота %u", slot_index);
     }
 
     if (bitmap_set_metadata_slot(slot_index) < 0) {
-        kvs_log("KVS_PUT ВНИМАНИЕ: Не удалось установить бит в биткарте метаданных для слота %u", slot_index);
+        kvs_log_at(KVS_LOG_WARNING, "KVS_PUT ВНИМАНИЕ: Не удалось установить бит в биткарте метаданных для слота %u", slot_index);
     }
     if (rewrite_count_increment_region(metadata_offset, sizeof(kvs_metadata)) < 0) {
-        kvs_log("KVS_PUT ВНИМАНИЕ: Не удалось увеличить счетчик перезаписи для метаданных");
+        kvs_log_at(KVS_LOG_WARNING, "KVS_PUT ВНИМАНИЕ: Не удалось увеличить счетчик перезаписи для метаданных");
     }
-    if (rewrite_count_increment_region(data_offset, aligned_value_len) < 0) {
-        kvs_log("KVS_PUT ВНИМАНИЕ: Не удалось увеличить счетчик перезаписи для данных");
+    if (!inline_value && rewrite_count_increment_region(data_offset, aligned_value_len) < 0) {
+        kvs_log_at(KVS_LOG_WARNING, "KVS_PUT ВНИМАНИЕ: Не удалось увеличить счетчик перезаписи для данных");
     }
-    if (bitmap_set_region(data_offset, aligned_value_len) < 0) {
-        kvs_log("KVS_PUT ВНИМАНИЕ: Не удалось установить биты в битовой карте данных");
+    if (!inline_value && bitmap_set_region(data_offset, aligned_value_len) < 0) {
+        kvs_log_at(KVS_LOG_WARNING, "KVS_PUT ВНИМАНИЕ: Не удалось установить биты в битовой карте данных");
     }
 
-    // Помечаем ключ как валидный в ОЗУ
-    for (uint32_t i = 0; i < device->key_count; i++) {
-        if (device->key_index[i].metadata_offset == metadata_offset) {
-            device->key_index[i].flags = 1;
-            break;
-        }
+    // Помечаем ключ как валидный в ОЗУ, позицию находим по обратному отображению слотов.
+    // В хеш-раскладке ключ становится валидным, как только установлен бит его слота
+    uint32_t flag_pos = device->key_index ? kvs_slot_to_index(slot_index) : UINT32_MAX;
+    if (flag_pos != UINT32_MAX) {
+        device->key_index[flag_pos].flags = 1;
     }
+    // Номер этого изменения определяет, какие снимки видят запись
+    device->mutation_count++;
+    device->slot_write_seq[slot_index] = device->mutation_count;
 
-    // Шаг 8: Сохраняем все изменения в служебных структурах на диск
-    if (kvs_persist_all_service_data() < 0) {
+    // Шаг 8: Сохраняем все изменения в служебных структурах на диск.
+    // При пакетном сбросе буфера записи это делается один раз на пакет.
+    if (!device->persist_deferred && kvs_persist_all_service_data() < 0) {
         return KVS_ERROR_STORAGE_FAILURE;
     }
 
+    // Шаг 9: Периодически выравниваем износ страниц
+    kvs_wear_level_tick();
+
     return KVS_SUCCESS;
 }
 
-kvs_status kvs_update(const void *key, const void *value, size_t value_len) {
+// Обновляет значение существующего ключа на устройстве, минуя буфер записи.
+static kvs_status kvs_update_on_flash(const void *key, uint32_t key_len, const void *value, size_t value_len) {
 
     // Шаг 1: Проверка базовых параметров.
     if (!device) {
@@ -328,22 +391,1370 @@ kvs_status kvs_update(const void *key, const void *value, size_t value_len) {
         return KVS_ERROR_INVALID_PARAM;
     }
 
-    // Шаг 2: Сначала удаляем старую запись.
-    kvs_status delete_status = kvs_delete(key);
+    // Шаг 2: Запоминаем счетчик обновлений старой записи, чтобы новая попала в нужную область
+    uint32_t update_count = 0;
+    uint32_t pos = 0;
+    if (kvs_key_locate(key, key_len, &pos) && is_key_valid(pos) == 1) {
+        kvs_metadata old_metadata;
+        if (kvs_read_region(device->sim, kvs_key_metadata_offset(pos), &old_metadata, sizeof(kvs_metadata)) == KVS_INTERNAL_OK) {
+            update_count = old_metadata.update_count;
+        }
+    }
+    if (update_count < UINT32_MAX) {
+        update_count++;
+    }
+
+    // Шаг 3: Сначала удаляем старую запись.
+    kvs_status delete_status = kvs_delete_on_flash(key, key_len);
 
     if (delete_status != KVS_SUCCESS) {
         // Если удаление не удалось возвращаем ошибку.
         return delete_status;
     }
 
-    // Шаг 3: После успешного удаления, создаем новую запись с тем же ключом.
-    kvs_status put_status = kvs_put(key, KVS_KEY_SIZE, value, value_len);
+    // Шаг 4: После успешного удаления, создаем новую запись с тем же ключом.
+    kvs_status put_status = kvs_put_entry(key, key_len, value, value_len, update_count);
 
     if (put_status != KVS_SUCCESS) {
         // Критическая ошибка: старые данные удалены, новые не записаны.
-        kvs_log("КРИТИЧЕСКАЯ ОШИБКА UPDATE: ключ '%s' был удален, но не смог быть записан заново. Код ошибки: %d", (char*)key, put_status);
+        kvs_log_at(KVS_LOG_ERROR, "КРИТИЧЕСКАЯ ОШИБКА UPDATE: ключ '%s' был удален, но не смог быть записан заново. Код ошибки: %d", (char*)key, put_status);
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+
+    return KVS_SUCCESS;
+}
+
+
+// Применяет к устройству все отложенные операции буфера записи в порядке ключей.
+// Служебные данные сохраняются один раз на каждую страницу примененных ключей и значений.
+// Примененные операции убираются из буфера, при ошибке остальные остаются в нем.
+static kvs_status kvs_memtable_flush(void)
+{
+    if (!device->memtable || device->memtable_count == 0) {
+        return KVS_SUCCESS;
+    }
+
+    // Шаг 1: Откладываем сохранение служебных данных до конца пакета
+    uint32_t page_size = device->superblock.page_size_bytes;
+    uint64_t batch_bytes = 0;
+    uint32_t applied = 0;
+    kvs_status status = KVS_SUCCESS;
+    device->persist_deferred = true;
+
+    // Шаг 2: Записи буфера уже отсортированы по ключу, применяем их по порядку
+    while (applied < device->memtable_count) {
+        const kvs_memtable_entry *entry = &device->memtable[applied];
+        if (entry->op == KVS_MEMTABLE_PUT) {
+            status = kvs_put_entry(entry->key, entry->key_len, entry->value, entry->value_size, 0);
+        } else if (entry->op == KVS_MEMTABLE_UPDATE) {
+            status = kvs_update_on_flash(entry->key, entry->key_len, entry->value, entry->value_size);
+            // Ключ мог пропасть с устройства (например, из-за повреждения), тогда значение записывается заново
+            if (status == KVS_ERROR_KEY_NOT_FOUND) {
+                status = kvs_put_entry(entry->key, entry->key_len, entry->value, entry->value_size, 0);
+            }
+        } else {
+            status = kvs_delete_on_flash(entry->key, entry->key_len);
+            // Ключ мог пропасть с устройства (например, из-за повреждения), удалять уже нечего
+            if (status == KVS_ERROR_KEY_NOT_FOUND) {
+                status = KVS_SUCCESS;
+            }
+        }
+        if (status != KVS_SUCCESS) {
+            kvs_log_at(KVS_LOG_ERROR, "KVS_FLUSH ОШИБКА: не удалось применить отложенную операцию %u для ключа '%s'. Код ошибки: %d", entry->op, (char*)entry->key, status);
+            break;
+        }
+        applied++;
+        device->memtable_flushed++;
+
+        // Шаг 3: Закрываем пакет, когда накопилась страница данных
+        batch_bytes += entry->key_len + entry->value_size;
+        if (batch_bytes >= page_size) {
+            if (kvs_persist_all_service_data() < 0) {
+                status = KVS_ERROR_STORAGE_FAILURE;
+                break;
+            }
+            batch_bytes = 0;
+        }
+    }
+
+    // Шаг 4: Сохраняем последний неполный пакет и убираем примененные операции из буфера
+    device->persist_deferred = false;
+    if (kvs_persist_all_service_data() < 0 && status == KVS_SUCCESS) {
+        status = KVS_ERROR_STORAGE_FAILURE;
+    }
+    kvs_memtable_drop_front(applied);
+    kvs_memtable_sync_free_space();
+    return status;
+}
+
+// Освобождает место под новую операцию: если буфер записи заполнен, сбрасывает его на устройство.
+// Вызывается до поиска ключа в буфере, так как сброс меняет и буфер, и устройство.
+static kvs_status kvs_memtable_reserve(void)
+{
+    if (kvs_memtable_full()) {
+        return kvs_memtable_flush();
+    }
+    return KVS_SUCCESS;
+}
+
+// Записывает отложенную операцию в буфер и переводит внутренний код ошибки в пользовательский.
+static kvs_status kvs_memtable_put_op(const void *key, uint32_t key_len, uint8_t op, const void *value, size_t value_len,
+                                      uint32_t replaced_data_bytes)
+{
+    if (kvs_memtable_set(key, key_len, op, value, (uint32_t)value_len, replaced_data_bytes) < 0) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+    return KVS_SUCCESS;
+}
+
+// Возвращает, сколько байт области данных освободит удаление записи ключа на устройстве при сбросе буфера.
+// Пока открыт снимок, удаленная запись может остаться занятой, поэтому ничего не засчитывается.
+// Снимок, открытый позже, сначала сбросит буфер.
+static uint32_t kvs_flash_data_bytes(const void *key, uint32_t key_len)
+{
+    uint32_t pos = 0;
+    kvs_metadata metadata;
+    if (device->snapshots || !kvs_key_locate(key, key_len, &pos)
+        || kvs_read_region(device->sim, kvs_key_metadata_offset(pos), &metadata, sizeof(kvs_metadata)) != KVS_INTERNAL_OK
+        || kvs_value_is_inline(&metadata)) {
+        return 0;
+    }
+    return kvs_record_data_size(&metadata);
+}
+
+static int kvs_exists_current(const void *key, size_t key_len)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!key || key_len == 0 || key_len > KVS_KEY_SIZE) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Отложенная операция в буфере записи новее состояния устройства
+    uint32_t pos = 0;
+    if (kvs_memtable_find(key, key_len, &pos)) {
+        return device->memtable[pos].op == KVS_MEMTABLE_DELETE ? 0 : 1;
+    }
+
+    // Шаг 3: Иначе проверяем ключ на устройстве
+    return kvs_exists_on_flash(key, key_len);
+}
+
+static kvs_status kvs_get_current(const void *key, size_t key_len, void *value, size_t *value_len)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!key || key_len == 0 || key_len > KVS_KEY_SIZE || !value || !value_len) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Если ключ есть в буфере записи, отвечаем из него
+    uint32_t pos = 0;
+    if (kvs_memtable_find(key, key_len, &pos)) {
+        const kvs_memtable_entry *entry = &device->memtable[pos];
+        if (entry->op == KVS_MEMTABLE_DELETE) {
+            return KVS_ERROR_KEY_NOT_FOUND;
+        }
+        if (*value_len < entry->value_size) {
+            *value_len = entry->value_size;
+            return KVS_ERROR_BUFFER_TOO_SMALL;
+        }
+        memcpy(value, entry->value, entry->value_size);
+        *value_len = entry->value_size;
+        return KVS_SUCCESS;
+    }
+
+    // Шаг 3: Иначе читаем с устройства
+    return kvs_get_from_flash(NULL, key, key_len, value, value_len);
+}
+
+static kvs_status kvs_delete_current(const void *key, size_t key_len)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!key || key_len == 0 || key_len > KVS_KEY_SIZE) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    if (!device->memtable) {
+        return kvs_delete_on_flash(key, key_len);
+    }
+
+    // Шаг 2: Буфер записи включен, при необходимости освобождаем в нем место
+    kvs_status status = kvs_memtable_reserve();
+    if (status != KVS_SUCCESS) {
+        return status;
+    }
+
+    // Шаг 3: Ключ уже есть в буфере
+    uint32_t pos = 0;
+    if (kvs_memtable_find(key, key_len, &pos)) {
+        uint8_t op = device->memtable[pos].op;
+        if (op == KVS_MEMTABLE_DELETE) {
+            return KVS_ERROR_KEY_NOT_FOUND;
+        }
+        device->memtable_absorbed++;
+        if (op == KVS_MEMTABLE_PUT) {
+            // Ключа еще нет на устройстве: запись просто отменяется и никогда не попадет на flash
+            kvs_memtable_remove(pos);
+            return KVS_SUCCESS;
+        }
+        return kvs_memtable_put_op(key, key_len, KVS_MEMTABLE_DELETE, NULL, 0, 0);
+    }
+
+    // Шаг 4: Ключа в буфере нет, откладываем удаление существующего на устройстве ключа
+    if (kvs_exists_on_flash(key, key_len) != 1) {
+        return KVS_ERROR_KEY_NOT_FOUND;
+    }
+    return kvs_memtable_put_op(key, key_len, KVS_MEMTABLE_DELETE, NULL, 0, 0);
+}
+
+// Выполняет put над текущим устройством: через буфер записи, если он включен, иначе сразу на устройство.
+static kvs_status kvs_put_dispatch(const void *key, size_t key_len, const void *value, size_t value_len) {
+
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!key || !value || key_len == 0 || key_len > KVS_KEY_SIZE || value_len == 0) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Без буфера записи новый ключ сразу пишется на устройство.
+    // Он еще ни разу не обновлялся, его данные считаются холодными
+    if (!device->memtable) {
+        return kvs_put_entry(key, key_len, value, value_len, 0);
+    }
+
+    // Шаг 3: Буфер записи включен, при необходимости освобождаем в нем место
+    kvs_status status = kvs_memtable_reserve();
+    if (status != KVS_SUCCESS) {
+        return status;
+    }
+
+    // Шаг 4: Ключ не должен существовать ни в буфере, ни на устройстве.
+    // Поверх отложенного удаления ключ на устройстве будет перезаписан, это обновление
+    uint8_t op = KVS_MEMTABLE_PUT;
+    uint32_t replaced_data_bytes = 0;
+    uint32_t pos = 0;
+    if (kvs_memtable_find(key, key_len, &pos)) {
+        if (device->memtable[pos].op != KVS_MEMTABLE_DELETE) {
+            return KVS_ERROR_KEY_ALREADY_EXISTS;
+        }
+        op = KVS_MEMTABLE_UPDATE;
+        replaced_data_bytes = kvs_flash_data_bytes(key, key_len);
+    }
+
+    // Шаг 5: Значение должно поместиться на устройство вместе со всеми отложенными операциями,
+    // иначе ошибка проявилась бы только при сбросе и оставила бы буфер заполненным.
+    // Если места не хватает, сбрасываем буфер (отложенные удаления освобождают место) и проверяем снова.
+    // После сброса отложенное удаление уже применено, и это снова вставка нового ключа
+    if (!kvs_memtable_admits(key, key_len, op, value_len, replaced_data_bytes)) {
+        status = kvs_memtable_flush();
+        if (status != KVS_SUCCESS) {
+            return status;
+        }
+        op = KVS_MEMTABLE_PUT;
+        replaced_data_bytes = 0;
+        if (!kvs_memtable_admits(key, key_len, op, value_len, replaced_data_bytes)) {
+            return KVS_ERROR_NO_SPACE;
+        }
+    }
+    if (op == KVS_MEMTABLE_PUT && kvs_exists_on_flash(key, key_len) == 1) {
+        return KVS_ERROR_KEY_ALREADY_EXISTS;
+    }
+    return kvs_memtable_put_op(key, key_len, op, value, value_len, replaced_data_bytes);
+}
+
+// Определяет, какой отложенной операцией станет update ключа при включенном буфере записи.
+// absorbed - true, если прежнее отложенное значение ключа так и не попадет на устройство.
+// Возвращает KVS_SUCCESS или KVS_ERROR_KEY_NOT_FOUND.
+static kvs_status kvs_update_plan(const void *key, uint32_t key_len, uint8_t *op, uint32_t *replaced_data_bytes, bool *absorbed)
+{
+    // Шаг 1: Ключ уже есть в буфере: обновление заменяет отложенную операцию, сохраняя ее вид
+    uint32_t pos = 0;
+    if (kvs_memtable_find(key, key_len, &pos)) {
+        const kvs_memtable_entry *entry = &device->memtable[pos];
+        if (entry->op == KVS_MEMTABLE_DELETE) {
+            return KVS_ERROR_KEY_NOT_FOUND;
+        }
+        *op = entry->op;
+        *replaced_data_bytes = entry->replaced_data_bytes;
+        *absorbed = true;
+        return KVS_SUCCESS;
+    }
+
+    // Шаг 2: Ключа в буфере нет, откладываем обновление существующего на устройстве ключа
+    if (kvs_exists_on_flash(key, key_len) != 1) {
+        return KVS_ERROR_KEY_NOT_FOUND;
+    }
+    *op = KVS_MEMTABLE_UPDATE;
+    *replaced_data_bytes = kvs_flash_data_bytes(key, key_len);
+    *absorbed = false;
+    return KVS_SUCCESS;
+}
+
+// Выполняет update над текущим устройством: через буфер записи, если он включен, иначе сразу на устройство.
+static kvs_status kvs_update_dispatch(const void *key, size_t key_len, const void *value, size_t value_len) {
+
+    // Шаг 1: Проверка базовых параметров.
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!key || key_len == 0 || key_len > KVS_KEY_SIZE || !value || value_len == 0) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    if (!device->memtable) {
+        return kvs_update_on_flash(key, key_len, value, value_len);
+    }
+
+    // Шаг 2: Буфер записи включен, при необходимости освобождаем в нем место
+    kvs_status status = kvs_memtable_reserve();
+    if (status != KVS_SUCCESS) {
+        return status;
+    }
+
+    // Шаг 3: Определяем отложенную операцию
+    uint8_t op = KVS_MEMTABLE_UPDATE;
+    uint32_t replaced_data_bytes = 0;
+    bool absorbed = false;
+    status = kvs_update_plan(key, key_len, &op, &replaced_data_bytes, &absorbed);
+    if (status != KVS_SUCCESS) {
+        return status;
+    }
+
+    // Шаг 4: Выросшее значение должно поместиться на устройство вместе со всеми отложенными операциями:
+    // при сбросе старая запись удаляется раньше записи новой и при нехватке места ключ был бы потерян.
+    // Если места не хватает, сбрасываем буфер и определяем операцию заново
+    if (!kvs_memtable_admits(key, key_len, op, value_len, replaced_data_bytes)) {
+        status = kvs_memtable_flush();
+        if (status != KVS_SUCCESS) {
+            return status;
+        }
+        status = kvs_update_plan(key, key_len, &op, &replaced_data_bytes, &absorbed);
+        if (status != KVS_SUCCESS) {
+            return status;
+        }
+        if (!kvs_memtable_admits(key, key_len, op, value_len, replaced_data_bytes)) {
+            return KVS_ERROR_NO_SPACE;
+        }
+    }
+    if (absorbed) {
+        device->memtable_absorbed++;
+    }
+    return kvs_memtable_put_op(key, key_len, op, value, value_len, replaced_data_bytes);
+}
+
+// Ключи и значения успешных put и update засчитываются как байты, записанные пользователем.
+static kvs_status kvs_put_current(const void *key, size_t key_len, const void *value, size_t value_len) {
+    kvs_status status = kvs_put_dispatch(key, key_len, value, value_len);
+    if (status == KVS_SUCCESS) {
+        device->write_counters[KVS_WRITE_PATH_PUT].host_bytes += key_len + value_len;
+    }
+    return status;
+}
+
+static kvs_status kvs_update_current(const void *key, size_t key_len, const void *value, size_t value_len) {
+    kvs_status status = kvs_update_dispatch(key, key_len, value, value_len);
+    if (status == KVS_SUCCESS) {
+        device->write_counters[KVS_WRITE_PATH_PUT].host_bytes += key_len + value_len;
+    }
+    return status;
+}
+
+static kvs_status kvs_flush_current(void)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    return kvs_memtable_flush();
+}
+
+static kvs_status kvs_set_write_buffer_current(size_t budget_bytes)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+
+    // Шаг 1: Сбрасываем операции, накопленные при прежних настройках
+    kvs_status status = kvs_memtable_flush();
+    if (status != KVS_SUCCESS) {
+        return status;
+    }
+    kvs_memtable_destroy();
+
+    // Шаг 2: Нулевой размер выключает буфер записи
+    if (budget_bytes == 0) {
+        return KVS_SUCCESS;
+    }
+    if (kvs_memtable_create(budget_bytes) < 0) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_get_wear_spread_current(uint32_t *spread, uint32_t *min_rewrites, uint32_t *max_rewrites)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!spread) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Считаем разброс по счетчикам перезаписи страниц данных
+    *spread = kvs_wear_spread(min_rewrites, max_rewrites);
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_set_cache_budget_current(size_t budget_bytes)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+
+    if (kvs_cache_set_budget(budget_bytes) != KVS_INTERNAL_OK) {
         return KVS_ERROR_STORAGE_FAILURE;
     }
+    return KVS_SUCCESS;
+}
 
+static kvs_status kvs_get_cache_stats_current(uint64_t *hits, uint64_t *misses)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!hits || !misses) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    *hits   = device->cache_hits;
+    *misses = device->cache_misses;
     return KVS_SUCCESS;
-}
\ No newline at end of file
+}
+
+static kvs_status kvs_set_device_timing_current(const kvs_device_timing *timing)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!timing) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    ssdmmc_sim_timing sim_timing = {timing->read_ns, timing->program_ns, timing->erase_ns, timing->bus_ps_per_byte, timing->sleep};
+    if (ssdmmc_sim_set_timing(device->sim, &sim_timing) != SSDMMC_OK) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_get_device_time_current(uint64_t *device_ns)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!device_ns) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    *device_ns = ssdmmc_sim_get_clock_ns(device->sim);
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_set_strict_nand_current(bool strict)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    ssdmmc_sim_set_nand_mode(device->sim, strict ? SSDMMC_SIM_NAND_STRICT : SSDMMC_SIM_NAND_LENIENT);
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_get_write_stats_current(kvs_write_stats *stats)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!stats) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    ssdmmc_sim_nand_report report;
+    ssdmmc_sim_get_nand_report(device->sim, &report);
+    memcpy(stats->paths, device->write_counters, sizeof(stats->paths));
+    stats->nand_violations = report.violations;
+    return KVS_SUCCESS;
+}
+
+// Заполняет сводную статистику текущего устройства.
+static kvs_status kvs_get_stats_current(kvs_stats *stats)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!stats) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    kvs_stats_collect(stats);
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_export_latency_current(kvs_metrics_format format, bool reset, char *buffer, size_t *buffer_len)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!buffer_len || (format != KVS_METRICS_JSON && format != KVS_METRICS_PROMETHEUS)) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Снимаем копию гистограмм и считаем сводки
+    kvs_latency_counts *counts = malloc(KVS_LATENCY_OP_COUNT * sizeof(kvs_latency_counts));
+    if (!counts) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+    kvs_latency_summary summaries[KVS_LATENCY_OP_COUNT];
+    kvs_latency_take(counts);
+    for (uint32_t op = 0; op < KVS_LATENCY_OP_COUNT; op++) {
+        kvs_latency_summarize(&counts[op], &summaries[op]);
+    }
+
+    // Шаг 3: Печатаем текст; если он не помещается, сообщаем нужный размер и гистограммы не трогаем
+    size_t needed = kvs_latency_format(format, summaries, buffer, buffer ? *buffer_len : 0) + 1;
+    if (!buffer || needed > *buffer_len) {
+        *buffer_len = needed;
+        free(counts);
+        return KVS_ERROR_BUFFER_TOO_SMALL;
+    }
+    *buffer_len = needed;
+
+    // Шаг 4: Удаляем выгруженные замеры
+    if (reset) {
+        kvs_latency_release(counts);
+    }
+    free(counts);
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_trace_start_current(const char *path, uint32_t ring_records)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!path && ring_records == 0) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    if (ssdmmc_sim_trace_start(device->sim, path, ring_records) != SSDMMC_OK) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+    atomic_store(&device->tracing, true);
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_trace_stop_current(void)
+{
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    atomic_store(&device->tracing, false);
+    ssdmmc_sim_trace_stop(device->sim);
+    return KVS_SUCCESS;
+}
+
+static kvs_status kvs_trace_read_current(kvs_trace_record *records, size_t *count)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!records || !count) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Забираем записи симулятора частями и переводим их в записи API
+    ssdmmc_sim_trace_record chunk[64];
+    size_t total = 0;
+    while (total < *count) {
+        size_t want = *count - total < 64 ? *count - total : 64;
+        size_t got = ssdmmc_sim_trace_read(device->sim, chunk, want);
+        for (size_t i = 0; i < got; i++) {
+            kvs_trace_record *record = &records[total + i];
+            record->time_ns    = chunk[i].time_ns;
+            record->device_ns  = chunk[i].device_ns;
+            record->key_hash   = chunk[i].key_hash;
+            record->page       = chunk[i].page;
+            record->first_word = chunk[i].first_word;
+            record->word_count = chunk[i].word_count;
+            record->kind       = chunk[i].op;
+            record->api_op     = chunk[i].api_op;
+            record->path       = chunk[i].path;
+            record->status     = chunk[i].status;
+        }
+        total += got;
+        if (got < want) {
+            break;
+        }
+    }
+    *count = total;
+    return KVS_SUCCESS;
+}
+
+// Открывает итератор над текущим устройством. snapshot - снимок этого устройства или NULL.
+static kvs_status kvs_iter_open_current(const kvs_snapshot *snapshot, const void *start, size_t start_len,
+                                        const void *end, size_t end_len, kvs_iterator **iter_out)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!iter_out || (start && (start_len == 0 || start_len > KVS_KEY_SIZE)) || (end && (end_len == 0 || end_len > KVS_KEY_SIZE))) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Создаем итератор. Пакет будет прочитан при первом вызове kvs_iter_next
+    kvs_iterator *iter = calloc(1, sizeof(kvs_iterator));
+    if (!iter) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+    iter->owner = device;
+    if (start) {
+        memcpy(iter->start, start, start_len);
+        iter->start_len = (uint8_t)start_len;
+    }
+    if (end) {
+        memcpy(iter->end, end, end_len);
+        iter->end_len = (uint8_t)end_len;
+    }
+    if (snapshot) {
+        iter->snapshot     = true;
+        iter->snapshot_seq = snapshot->seq;
+    }
+    *iter_out = iter;
+    return KVS_SUCCESS;
+}
+
+// Вычисляет верхнюю границу обхода по префиксу: наименьший ключ больше всех ключей с этим префиксом.
+// Последний байт префикса, меньший 0xFF, увеличиваем на единицу и отбрасываем все после него.
+// Возвращает длину границы; 0, если префикс состоит из одних 0xFF и верхней границы нет.
+static size_t kvs_prefix_end(const void *prefix, size_t prefix_len, uint8_t *end)
+{
+    size_t end_len = prefix_len;
+    memcpy(end, prefix, prefix_len);
+    while (end_len > 0 && end[end_len - 1] == 0xFF) {
+        end_len--;
+    }
+    if (end_len > 0) {
+        end[end_len - 1]++;
+    }
+    return end_len;
+}
+
+static kvs_status kvs_iter_next_current(kvs_iterator *iter, void *key, size_t *key_len, void *value, size_t *value_len)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!iter || !key || !value || !value_len) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Если после чтения пакета содержимое хранилища менялось, непройденную часть пакета перечитываем
+    if (iter->mutation_count != device->mutation_count) {
+        kvs_iter_release_batch(iter);
+    }
+
+    while (true) {
+        // Шаг 3: Пакет пройден - сбрасываем буфер записи, чтобы обход видел отложенные операции, и читаем следующий.
+        // Обходу снимка отложенные операции не видны, буфер для него не сбрасывается
+        if (iter->item_next >= iter->item_count) {
+            if (iter->exhausted) {
+                return KVS_ERROR_KEY_NOT_FOUND;
+            }
+            kvs_status status = iter->snapshot ? KVS_SUCCESS : kvs_memtable_flush();
+            if (status != KVS_SUCCESS) {
+                return status;
+            }
+            if (kvs_iter_fill(iter) < 0) {
+                kvs_iter_release_batch(iter);
+                return KVS_ERROR_STORAGE_FAILURE;
+            }
+            if (iter->item_count == 0) {
+                return KVS_ERROR_KEY_NOT_FOUND;
+            }
+        }
+
+        // Шаг 4: Невалидные записи пропускаем, запоминая их ключ как пройденный
+        const kvs_iter_item *item = &iter->items[iter->item_next];
+        if (!item->valid) {
+            memcpy(iter->last, item->key, KVS_KEY_SIZE);
+            iter->last_len = item->key_len;
+            iter->item_next++;
+            continue;
+        }
+
+        // Шаг 5: Отдаем ключ и значение. При нехватке буфера итератор не сдвигается
+        if (*value_len < item->value_size) {
+            *value_len = item->value_size;
+            return KVS_ERROR_BUFFER_TOO_SMALL;
+        }
+        memcpy(key, item->key, KVS_KEY_SIZE);
+        if (key_len) {
+            *key_len = item->key_len;
+        }
+        memcpy(value, item->value, item->value_size);
+        *value_len = item->value_size;
+        memcpy(iter->last, item->key, KVS_KEY_SIZE);
+        iter->last_len = item->key_len;
+        iter->item_next++;
+        return KVS_SUCCESS;
+    }
+}
+
+void kvs_iter_close(kvs_iterator *iter)
+{
+    if (!iter) {
+        return;
+    }
+    kvs_iter_release_batch(iter);
+    free(iter->values);
+    free(iter);
+}
+
+static kvs_status kvs_snapshot_create_current(kvs_snapshot **snapshot_out)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!snapshot_out) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Снимок читает только устройство, поэтому отложенные операции сначала применяются
+    kvs_status status = kvs_memtable_flush();
+    if (status != KVS_SUCCESS) {
+        return status;
+    }
+
+    // Шаг 3: Снимок видит все изменения с номером не больше текущего
+    kvs_snapshot *snapshot = calloc(1, sizeof(kvs_snapshot));
+    if (!snapshot) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
+    snapshot->owner = device;
+    snapshot->seq = device->mutation_count;
+    snapshot->next = device->snapshots;
+    device->snapshots = snapshot;
+    *snapshot_out = snapshot;
+    return KVS_SUCCESS;
+}
+
+static void kvs_snapshot_release_current(kvs_snapshot *snapshot)
+{
+    if (!device || !snapshot) {
+        return;
+    }
+
+    // Шаг 1: Убираем снимок из списка открытых
+    kvs_snapshot **link = &device->snapshots;
+    while (*link && *link != snapshot) {
+        link = &(*link)->next;
+    }
+    if (!*link) {
+        return;
+    }
+    *link = snapshot->next;
+    free(snapshot);
+
+    // Шаг 2: Версии, которые больше не нужны ни одному снимку, освобождают свои области данных
+    if (kvs_snapshot_prune() != KVS_INTERNAL_OK) {
+        kvs_log_at(KVS_LOG_WARNING, "SNAPSHOT ВНИМАНИЕ: Не удалось полностью освободить данные версий после освобождения снимка");
+    }
+}
+
+static kvs_status kvs_snapshot_get_current(const kvs_snapshot *snapshot, const void *key, size_t key_len, void *value, size_t *value_len)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_ERROR_NOT_INITIALIZED;
+    }
+    if (!snapshot || !key || key_len == 0 || key_len > KVS_KEY_SIZE || !value || !value_len) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Буфер записи содержит только изменения, сделанные после создания снимка, поэтому читаем устройство
+    return kvs_get_from_flash(snapshot, key, key_len, value, value_len);
+}
+
+// Чтение пакета асинхронных запросов и страница, с которой оно начнется.
+typedef struct {
+    kvs_async_request *request;
+    uint32_t page;
+} kvs_async_read;
+
+static int kvs_async_read_cmp(const void *a, const void *b)
+{
+    const kvs_async_read *ra = a;
+    const kvs_async_read *rb = b;
+    return (ra->page > rb->page) - (ra->page < rb->page);
+}
+
+// Возвращает страницу области метаданных, с которой начнется чтение ключа запроса: страницу его слота
+// в линейной раскладке (по key_index в ОЗУ) или его домашнюю корзину в хеш-раскладке (корзина - одна страница).
+// UINT32_MAX - ключа нет на устройстве или запрос некорректен.
+static uint32_t kvs_async_read_page(const kvs_async_request *request)
+{
+    if (!request->key || request->key_len == 0 || request->key_len > KVS_KEY_SIZE) {
+        return UINT32_MAX;
+    }
+    uint32_t key_len = (uint32_t)request->key_len;
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        return kvs_key_hash(request->key, key_len) % device->superblock.hash_bucket_count;
+    }
+    uint32_t pos = 0;
+    if (kvs_key_locate(request->key, key_len, &pos) != 1) {
+        return UINT32_MAX;
+    }
+    return (kvs_key_metadata_offset(pos) - device->superblock.metadata_offset) / device->superblock.page_size_bytes;
+}
+
+// Выполняет одно изменение асинхронного пакета.
+static kvs_status kvs_async_apply(const kvs_async_request *request)
+{
+    switch (request->op) {
+        case KVS_ASYNC_PUT:
+            return kvs_put_current(request->key, request->key_len, request->value, request->value_len);
+        case KVS_ASYNC_UPDATE:
+            return kvs_update_current(request->key, request->key_len, request->value, request->value_len);
+        case KVS_ASYNC_DELETE:
+            return kvs_delete_current(request->key, request->key_len);
+        default:
+            return KVS_ERROR_INVALID_PARAM;
+    }
+}
+
+// Возвращает операцию API, которой соответствует асинхронный запрос, для статистики.
+static kvs_op_type kvs_async_op_type(kvs_async_op op)
+{
+    switch (op) {
+        case KVS_ASYNC_GET:
+            return KVS_OP_GET;
+        case KVS_ASYNC_PUT:
+            return KVS_OP_PUT;
+        case KVS_ASYNC_UPDATE:
+            return KVS_OP_UPDATE;
+        case KVS_ASYNC_DELETE:
+            return KVS_OP_DELETE;
+        default:
+            return KVS_OP_COUNT;
+    }
+}
+
+void kvs_async_execute(kvs_handle *handle, kvs_async_request **batch, uint32_t count)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    bool writes = false;
+    for (uint32_t i = 0; i < count; i++) {
+        if (batch[i]->op != KVS_ASYNC_GET) {
+            writes = true;
+        }
+    }
+    if (writes) {
+        kvs_lock_exclusive();
+    } else {
+        kvs_lock_shared();
+    }
+
+    uint32_t page_size = device->superblock.page_size_bytes;
+    uint64_t batch_bytes = 0;
+    uint32_t unsaved = 0;             // Первый запрос, служебные данные которого еще не сохранены
+    uint32_t i = 0;
+    while (i < count) {
+        // Шаг 1: Подряд идущие чтения не зависят друг от друга, выполняем их в порядке страниц метаданных
+        if (batch[i]->op == KVS_ASYNC_GET) {
+            kvs_async_read reads[KVS_ASYNC_BATCH_MAX];
+            uint32_t read_count = 0;
+            while (i + read_count < count && batch[i + read_count]->op == KVS_ASYNC_GET) {
+                reads[read_count].request = batch[i + read_count];
+                reads[read_count].page    = kvs_async_read_page(batch[i + read_count]);
+                read_count++;
+            }
+            qsort(reads, read_count, sizeof(kvs_async_read), kvs_async_read_cmp);
+            for (uint32_t r = 0; r < read_count; r++) {
+                kvs_async_request *request = reads[r].request;
+                batch[i++] = request;
+                kvs_trace_begin(KVS_OP_GET, request->key, request->key_len);
+                request->status = kvs_get_current(request->key, request->key_len, request->value, &request->value_len);
+                kvs_trace_end(request->status == KVS_SUCCESS ? request->value_len : 0, request->status);
+            }
+            continue;
+        }
+
+        // Шаг 2: Изменения выполняем в порядке отправки, откладывая сохранение служебных данных.
+        // Сброс буфера записи внутри изменения снимает признак, поэтому ставим его перед каждым
+        kvs_async_request *request = batch[i++];
+        device->persist_deferred = true;
+        kvs_trace_begin(kvs_async_op_type(request->op), request->key, request->key_len);
+        request->status = kvs_async_apply(request);
+        kvs_trace_end(request->op == KVS_ASYNC_DELETE ? 0 : request->value_len, request->status);
+
+        // Шаг 3: Сохраняем служебные данные, когда накопилась страница записанных данных
+        if (request->status == KVS_SUCCESS) {
+            batch_bytes += request->value_len;
+        }
+        if (batch_bytes >= page_size) {
+            if (kvs_persist_all_service_data() < 0) {
+                break;
+            }
+            batch_bytes = 0;
+            unsaved = i;
+        }
+    }
+
+    // Шаг 4: Сохраняем служебные данные последней части пакета. Если сохранить не удалось,
+    // успешные изменения с последнего сохранения на устройстве не закреплены
+    if (writes) {
+        device->persist_deferred = false;
+        if (kvs_persist_all_service_data() < 0) {
+            for (uint32_t j = unsaved; j < count; j++) {
+                if (batch[j]->op != KVS_ASYNC_GET && batch[j]->status == KVS_SUCCESS) {
+                    batch[j]->status = KVS_ERROR_STORAGE_FAILURE;
+                }
+            }
+        }
+        // Запросы после неудачного сохранения в середине пакета не выполнялись
+        for (uint32_t j = i; j < count; j++) {
+            batch[j]->status = KVS_ERROR_STORAGE_FAILURE;
+        }
+    }
+    kvs_unlock();
+
+    // Шаг 5: Учитываем запросы в статистике по их окончательному результату
+    for (uint32_t j = 0; j < count; j++) {
+        kvs_stats_count_op(kvs_async_op_type(batch[j]->op), batch[j]->status);
+    }
+    kvs_bind_device(previous);
+}
+
+// --- API с дескриптором: вызов выполняется над устройством дескриптора ---
+
+int kvs_exists_h(kvs_handle *handle, const void *key, size_t key_len)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_trace_begin(KVS_OP_EXISTS, key, key_len);
+    kvs_lock_shared();
+    int result = kvs_exists_current(key, key_len);
+    kvs_unlock();
+    kvs_trace_end(0, result == 1 ? KVS_SUCCESS : result == 0 ? KVS_ERROR_KEY_NOT_FOUND : (kvs_status)result);
+    kvs_stats_count_op(KVS_OP_EXISTS, result == 1 ? KVS_SUCCESS : result == 0 ? KVS_ERROR_KEY_NOT_FOUND : (kvs_status)result);
+    kvs_bind_device(previous);
+    return result;
+}
+
+kvs_status kvs_get_h(kvs_handle *handle, const void *key, size_t key_len, void *value, size_t *value_len)
+{
+    uint64_t start_ns = kvs_stats_now_ns();
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_trace_begin(KVS_OP_GET, key, key_len);
+    kvs_lock_shared();
+    kvs_status status = kvs_get_current(key, key_len, value, value_len);
+    kvs_unlock();
+    kvs_trace_end(status == KVS_SUCCESS ? *value_len : 0, status);
+    kvs_stats_count_op(KVS_OP_GET, status);
+    kvs_latency_record(KVS_LATENCY_GET, start_ns);
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_delete_h(kvs_handle *handle, const void *key, size_t key_len)
+{
+    uint64_t start_ns = kvs_stats_now_ns();
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_trace_begin(KVS_OP_DELETE, key, key_len);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_delete_current(key, key_len);
+    kvs_unlock();
+    kvs_trace_end(0, status);
+    kvs_stats_count_op(KVS_OP_DELETE, status);
+    kvs_latency_record(KVS_LATENCY_DELETE, start_ns);
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_put_h(kvs_handle *handle, const void *key, size_t key_len, const void *value, size_t value_len)
+{
+    uint64_t start_ns = kvs_stats_now_ns();
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_trace_begin(KVS_OP_PUT, key, key_len);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_put_current(key, key_len, value, value_len);
+    kvs_unlock();
+    kvs_trace_end(value_len, status);
+    kvs_stats_count_op(KVS_OP_PUT, status);
+    kvs_latency_record(KVS_LATENCY_PUT, start_ns);
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_update_h(kvs_handle *handle, const void *key, size_t key_len, const void *value, size_t value_len)
+{
+    uint64_t start_ns = kvs_stats_now_ns();
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_trace_begin(KVS_OP_UPDATE, key, key_len);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_update_current(key, key_len, value, value_len);
+    kvs_unlock();
+    kvs_trace_end(value_len, status);
+    kvs_stats_count_op(KVS_OP_UPDATE, status);
+    kvs_latency_record(KVS_LATENCY_UPDATE, start_ns);
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_flush_h(kvs_handle *handle)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_flush_current();
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_set_write_buffer_h(kvs_handle *handle, size_t budget_bytes)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_set_write_buffer_current(budget_bytes);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_get_wear_spread_h(kvs_handle *handle, uint32_t *spread, uint32_t *min_rewrites, uint32_t *max_rewrites)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_get_wear_spread_current(spread, min_rewrites, max_rewrites);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_set_cache_budget_h(kvs_handle *handle, size_t budget_bytes)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_set_cache_budget_current(budget_bytes);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_get_cache_stats_h(kvs_handle *handle, uint64_t *hits, uint64_t *misses)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_get_cache_stats_current(hits, misses);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_set_device_timing_h(kvs_handle *handle, const kvs_device_timing *timing)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_set_device_timing_current(timing);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_get_device_time_h(kvs_handle *handle, uint64_t *device_ns)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_shared();
+    kvs_status status = kvs_get_device_time_current(device_ns);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_set_strict_nand_h(kvs_handle *handle, bool strict)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_set_strict_nand_current(strict);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_get_write_stats_h(kvs_handle *handle, kvs_write_stats *stats)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_get_write_stats_current(stats);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_get_stats_h(kvs_handle *handle, kvs_stats *stats)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_get_stats_current(stats);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_export_latency_h(kvs_handle *handle, kvs_metrics_format format, bool reset, char *buffer, size_t *buffer_len)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_export_latency_current(format, reset, buffer, buffer_len);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_trace_start_h(kvs_handle *handle, const char *path, uint32_t ring_records)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_trace_start_current(path, ring_records);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_trace_stop_h(kvs_handle *handle)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_trace_stop_current();
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_trace_read_h(kvs_handle *handle, kvs_trace_record *records, size_t *count)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_trace_read_current(records, count);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_iter_open_h(kvs_handle *handle, const void *start, size_t start_len, const void *end, size_t end_len, kvs_iterator **iter_out)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_iter_open_current(NULL, start, start_len, end, end_len, iter_out);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_iter_open_prefix_h(kvs_handle *handle, const void *prefix, size_t prefix_len, kvs_iterator **iter_out)
+{
+    if (!prefix || prefix_len == 0 || prefix_len > KVS_KEY_SIZE) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    uint8_t end[KVS_KEY_SIZE];
+    size_t end_len = kvs_prefix_end(prefix, prefix_len, end);
+    return kvs_iter_open_h(handle, prefix, prefix_len, end_len > 0 ? end : NULL, end_len, iter_out);
+}
+
+kvs_status kvs_snapshot_create_h(kvs_handle *handle, kvs_snapshot **snapshot_out)
+{
+    kvs_device *previous = kvs_bind_device(handle);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_snapshot_create_current(snapshot_out);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+// --- Итераторы и снимки помнят свое хранилище ---
+
+kvs_status kvs_iter_next(kvs_iterator *iter, void *key, size_t *key_len, void *value, size_t *value_len)
+{
+    if (!iter) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    kvs_device *previous = kvs_bind_device(iter->owner);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_iter_next_current(iter, key, key_len, value, value_len);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_snapshot_iter_open(const kvs_snapshot *snapshot, const void *start, size_t start_len,
+                                  const void *end, size_t end_len, kvs_iterator **iter_out)
+{
+    kvs_device *previous = kvs_bind_device(snapshot ? snapshot->owner : kvs_default_device);
+    kvs_lock_exclusive();
+    kvs_status status = kvs_iter_open_current(snapshot, start, start_len, end, end_len, iter_out);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+kvs_status kvs_snapshot_iter_open_prefix(const kvs_snapshot *snapshot, const void *prefix, size_t prefix_len, kvs_iterator **iter_out)
+{
+    if (!prefix || prefix_len == 0 || prefix_len > KVS_KEY_SIZE) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    uint8_t end[KVS_KEY_SIZE];
+    size_t end_len = kvs_prefix_end(prefix, prefix_len, end);
+    return kvs_snapshot_iter_open(snapshot, prefix, prefix_len, end_len > 0 ? end : NULL, end_len, iter_out);
+}
+
+void kvs_snapshot_release(kvs_snapshot *snapshot)
+{
+    if (!snapshot) {
+        return;
+    }
+    kvs_device *previous = kvs_bind_device(snapshot->owner);
+    kvs_lock_exclusive();
+    kvs_snapshot_release_current(snapshot);
+    kvs_unlock();
+    kvs_bind_device(previous);
+}
+
+kvs_status kvs_snapshot_get(const kvs_snapshot *snapshot, const void *key, size_t key_len, void *value, size_t *value_len)
+{
+    if (!snapshot) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    kvs_device *previous = kvs_bind_device(snapshot->owner);
+    kvs_lock_shared();
+    kvs_status status = kvs_snapshot_get_current(snapshot, key, key_len, value, value_len);
+    kvs_unlock();
+    kvs_bind_device(previous);
+    return status;
+}
+
+// --- Функции без дескриптора работают с хранилищем по умолчанию (kvs_init) ---
+
+int kvs_exists(const void *key, size_t key_len)
+{
+    return kvs_exists_h(kvs_default_device, key, key_len);
+}
+
+kvs_status kvs_get(const void *key, size_t key_len, void *value, size_t *value_len)
+{
+    return kvs_get_h(kvs_default_device, key, key_len, value, value_len);
+}
+
+kvs_status kvs_delete(const void *key, size_t key_len)
+{
+    return kvs_delete_h(kvs_default_device, key, key_len);
+}
+
+kvs_status kvs_put(const void *key, size_t key_len, const void *value, size_t value_len)
+{
+    return kvs_put_h(kvs_default_device, key, key_len, value, value_len);
+}
+
+kvs_status kvs_update(const void *key, size_t key_len, const void *value, size_t value_len)
+{
+    return kvs_update_h(kvs_default_device, key, key_len, value, value_len);
+}
+
+kvs_status kvs_flush(void)
+{
+    return kvs_flush_h(kvs_default_device);
+}
+
+kvs_status kvs_set_write_buffer(size_t budget_bytes)
+{
+    return kvs_set_write_buffer_h(kvs_default_device, budget_bytes);
+}
+
+kvs_status kvs_get_wear_spread(uint32_t *spread, uint32_t *min_rewrites, uint32_t *max_rewrites)
+{
+    return kvs_get_wear_spread_h(kvs_default_device, spread, min_rewrites, max_rewrites);
+}
+
+kvs_status kvs_set_cache_budget(size_t budget_bytes)
+{
+    return kvs_set_cache_budget_h(kvs_default_device, budget_bytes);
+}
+
+kvs_status kvs_get_cache_stats(uint64_t *hits, uint64_t *misses)
+{
+    return kvs_get_cache_stats_h(kvs_default_device, hits, misses);
+}
+
+kvs_status kvs_set_device_timing(const kvs_device_timing *timing)
+{
+    return kvs_set_device_timing_h(kvs_default_device, timing);
+}
+
+kvs_status kvs_get_device_time(uint64_t *device_ns)
+{
+    return kvs_get_device_time_h(kvs_default_device, device_ns);
+}
+
+kvs_status kvs_set_strict_nand(bool strict)
+{
+    return kvs_set_strict_nand_h(kvs_default_device, strict);
+}
+
+kvs_status kvs_get_write_stats(kvs_write_stats *stats)
+{
+    return kvs_get_write_stats_h(kvs_default_device, stats);
+}
+
+kvs_status kvs_get_stats(kvs_stats *stats)
+{
+    return kvs_get_stats_h(kvs_default_device, stats);
+}
+
+kvs_status kvs_export_latency(kvs_metrics_format format, bool reset, char *buffer, size_t *buffer_len)
+{
+    return kvs_export_latency_h(kvs_default_device, format, reset, buffer, buffer_len);
+}
+
+kvs_status kvs_trace_start(const char *path, uint32_t ring_records)
+{
+    return kvs_trace_start_h(kvs_default_device, path, ring_records);
+}
+
+kvs_status kvs_trace_stop(void)
+{
+    return kvs_trace_stop_h(kvs_default_device);
+}
+
+kvs_status kvs_trace_read(kvs_trace_record *records, size_t *count)
+{
+    return kvs_trace_read_h(kvs_default_device, records, count);
+}
+
+kvs_status kvs_iter_open(const void *start, size_t start_len, const void *end, size_t end_len, kvs_iterator **iter_out)
+{
+    return kvs_iter_open_h(kvs_default_device, start, start_len, end, end_len, iter_out);
+}
+
+kvs_status kvs_iter_open_prefix(const void *prefix, size_t prefix_len, kvs_iterator **iter_out)
+{
+    return kvs_iter_open_prefix_h(kvs_default_device, prefix, prefix_len, iter_out);
+}
+
+kvs_status kvs_snapshot_create(kvs_snapshot **snapshot_out)
+{
+    return kvs_snapshot_create_h(kvs_default_device, snapshot_out);
+}
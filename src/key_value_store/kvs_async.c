@@ -0,0 +1,180 @@
+#include "kvs_async.h"
+
+#define KVS_ASYNC_MAX_DEPTH 65536
+
+// Рабочий поток очереди: забирает запросы пакетами, выполняет их и выдает результаты.
+static void *kvs_async_worker(void *arg)
+{
+    kvs_async *queue = arg;
+    kvs_async_request *batch[KVS_ASYNC_BATCH_MAX];
+    for (;;) {
+        // Шаг 1: Забираем все отправленные запросы, но не больше одного пакета
+        uint32_t count = 0;
+        while (count < KVS_ASYNC_BATCH_MAX && (batch[count] = kvs_ring_pop(&queue->submissions)) != NULL) {
+            count++;
+        }
+
+        // Шаг 2: Запросов нет - засыпаем до следующей отправки. Признак сна ставится до повторной проверки кольца,
+        // а отправитель проверяет его после записи в кольцо, поэтому хотя бы один из них заметит другого
+        if (count == 0) {
+            if (atomic_load(&queue->stopping)) {
+                break;
+            }
+            pthread_mutex_lock(&queue->mutex);
+            atomic_store(&queue->worker_sleeping, true);
+            atomic_thread_fence(memory_order_seq_cst);
+            while (kvs_ring_empty(&queue->submissions) && !atomic_load(&queue->stopping)) {
+                pthread_cond_wait(&queue->wake, &queue->mutex);
+            }
+            atomic_store(&queue->worker_sleeping, false);
+            pthread_mutex_unlock(&queue->mutex);
+            continue;
+        }
+
+        // Шаг 3: Выполняем пакет и выдаем результаты. Кольцо выполненных не переполняется:
+        // в работе никогда не больше запросов, чем в нем ячеек
+        kvs_async_execute(queue->handle, batch, count);
+        queue->batches++;
+        for (uint32_t i = 0; i < count; i++) {
+            if (batch[i]->callback) {
+                batch[i]->callback(batch[i]);
+                atomic_fetch_sub(&queue->inflight, 1);
+            } else {
+                kvs_ring_push(&queue->completions, batch[i]);
+            }
+        }
+
+        // Шаг 4: Будим ожидающих в kvs_async_drain
+        pthread_mutex_lock(&queue->mutex);
+        atomic_fetch_add(&queue->executed, count);
+        pthread_cond_broadcast(&queue->done);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    return NULL;
+}
+
+// Освобождает кольца и саму очередь (рабочий поток уже остановлен или не запускался).
+static void kvs_async_free(kvs_async *queue)
+{
+    free(queue->submissions.cells);
+    free(queue->completions.cells);
+    free(queue);
+}
+
+kvs_status kvs_async_open(kvs_handle *handle, uint32_t queue_depth, kvs_async **queue_out)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!handle || !queue_out || queue_depth == 0 || queue_depth > KVS_ASYNC_MAX_DEPTH) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    uint32_t capacity = 1;
+    while (capacity < queue_depth) {
+        capacity <<= 1;
+    }
+
+    // Шаг 2: Создаем кольца отправки и выполнения одинакового размера
+    kvs_async *queue = calloc(1, sizeof(kvs_async));
+    if (!queue) {
+        return KVS_ERROR_UNKNOWN;
+    }
+    queue->handle = handle;
+    queue->depth  = capacity;
+    if (kvs_ring_create(&queue->submissions, capacity) != KVS_INTERNAL_OK
+        || kvs_ring_create(&queue->completions, capacity) != KVS_INTERNAL_OK) {
+        kvs_async_free(queue);
+        return KVS_ERROR_UNKNOWN;
+    }
+    atomic_init(&queue->inflight, 0);
+    atomic_init(&queue->submitted, 0);
+    atomic_init(&queue->executed, 0);
+    atomic_init(&queue->stopping, false);
+    atomic_init(&queue->worker_sleeping, false);
+
+    // Шаг 3: Запускаем рабочий поток
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->wake, NULL);
+    pthread_cond_init(&queue->done, NULL);
+    if (pthread_create(&queue->worker, NULL, kvs_async_worker, queue) != 0) {
+        kvs_log_at(KVS_LOG_ERROR, "Ошибка: не удалось запустить рабочий поток асинхронной очереди");
+        pthread_cond_destroy(&queue->wake);
+        pthread_cond_destroy(&queue->done);
+        pthread_mutex_destroy(&queue->mutex);
+        kvs_async_free(queue);
+        return KVS_ERROR_UNKNOWN;
+    }
+    *queue_out = queue;
+    return KVS_SUCCESS;
+}
+
+kvs_status kvs_async_submit(kvs_async *queue, kvs_async_request *request)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!queue || !request || !request->key) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    if (request->op != KVS_ASYNC_GET && request->op != KVS_ASYNC_PUT && request->op != KVS_ASYNC_UPDATE && request->op != KVS_ASYNC_DELETE) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Занимаем место в очереди. Оно освобождается, только когда результат забран
+    if (atomic_fetch_add(&queue->inflight, 1) >= queue->depth) {
+        atomic_fetch_sub(&queue->inflight, 1);
+        return KVS_ERROR_NO_SPACE;
+    }
+
+    // Шаг 3: Отправляем запрос и будим рабочий поток, если он спит
+    atomic_fetch_add(&queue->submitted, 1);
+    kvs_ring_push(&queue->submissions, request);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&queue->worker_sleeping)) {
+        pthread_mutex_lock(&queue->mutex);
+        pthread_cond_signal(&queue->wake);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    return KVS_SUCCESS;
+}
+
+size_t kvs_async_poll(kvs_async *queue, kvs_async_request **completed, size_t max)
+{
+    if (!queue || !completed) {
+        return 0;
+    }
+    size_t count = 0;
+    while (count < max && (completed[count] = kvs_ring_pop(&queue->completions)) != NULL) {
+        atomic_fetch_sub(&queue->inflight, 1);
+        count++;
+    }
+    return count;
+}
+
+void kvs_async_drain(kvs_async *queue)
+{
+    if (!queue) {
+        return;
+    }
+    uint64_t target = atomic_load(&queue->submitted);
+    pthread_mutex_lock(&queue->mutex);
+    while (atomic_load(&queue->executed) < target) {
+        pthread_cond_wait(&queue->done, &queue->mutex);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+void kvs_async_close(kvs_async *queue)
+{
+    if (!queue) {
+        return;
+    }
+
+    // Рабочий поток выполняет оставшиеся запросы и завершается, когда кольцо отправки опустеет
+    pthread_mutex_lock(&queue->mutex);
+    atomic_store(&queue->stopping, true);
+    pthread_cond_signal(&queue->wake);
+    pthread_mutex_unlock(&queue->mutex);
+    pthread_join(queue->worker, NULL);
+
+    pthread_cond_destroy(&queue->wake);
+    pthread_cond_destroy(&queue->done);
+    pthread_mutex_destroy(&queue->mutex);
+    kvs_async_free(queue);
+}
@@ -0,0 +1,15 @@
+#ifndef SSDMMCSTORE_KVS_ASYNC_H
+#define SSDMMCSTORE_KVS_ASYNC_H
+
+#include "kvs_types.h"
+#include "kvs_internal.h"
+
+
+// Выполняет пакет асинхронных запросов над хранилищем handle под одной блокировкой
+// (исключительной, если в пакете есть изменения, иначе разделяемой) и заполняет их поле status.
+// Подряд идущие чтения переупорядочиваются по страницам их метаданных, остальной порядок сохраняется.
+// Служебные данные после изменений пакета сохраняются один раз на страницу записанных данных и в конце пакета.
+// Меняет порядок указателей в batch так, как запросы были выполнены.
+void kvs_async_execute(kvs_handle *handle, kvs_async_request **batch, uint32_t count);
+
+#endif //SSDMMCSTORE_KVS_ASYNC_H
@@ -0,0 +1,279 @@
+#include "kvs_cache.h"
+
+// Выделяет область копий значений под бюджет budget_bytes и собирает все ее блоки в список свободных.
+// Прежняя область освобождается, записи кеша к этому моменту должны быть удалены.
+static kvs_internal_status kvs_cache_arena_create(uint64_t budget_bytes)
+{
+    // Шаг 1: Освобождаем прежнюю область
+    free(device->cache_arena);
+    free(device->cache_chunk_next);
+    device->cache_arena       = NULL;
+    device->cache_chunk_next  = NULL;
+    device->cache_chunk_count = 0;
+    device->cache_free_chunk  = UINT32_MAX;
+    device->cache_free_chunks = 0;
+
+    // Шаг 2: Выделяем блоки, покрывающие бюджет (нулевой бюджет - кеш выключен, область не нужна)
+    uint64_t chunk_count = (budget_bytes + KVS_CACHE_CHUNK_BYTES - 1) / KVS_CACHE_CHUNK_BYTES;
+    if (chunk_count == 0) {
+        return KVS_INTERNAL_OK;
+    }
+    if (chunk_count >= UINT32_MAX) {
+        return KVS_INTERNAL_ERR_INVALID_PARAM;
+    }
+    device->cache_arena      = malloc(chunk_count * KVS_CACHE_CHUNK_BYTES);
+    device->cache_chunk_next = malloc(chunk_count * sizeof(uint32_t));
+    if (!device->cache_arena || !device->cache_chunk_next) {
+        free(device->cache_arena);
+        free(device->cache_chunk_next);
+        device->cache_arena      = NULL;
+        device->cache_chunk_next = NULL;
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+
+    // Шаг 3: Все блоки свободны
+    for (uint32_t i = 0; i < chunk_count; i++) {
+        device->cache_chunk_next[i] = (i + 1 < chunk_count) ? i + 1 : UINT32_MAX;
+    }
+    device->cache_chunk_count = (uint32_t)chunk_count;
+    device->cache_free_chunk  = 0;
+    device->cache_free_chunks = (uint32_t)chunk_count;
+    return KVS_INTERNAL_OK;
+}
+
+// Освобождает запись кеша с номером idx и возвращает блоки ее значения в список свободных.
+static void kvs_cache_drop_entry(uint32_t idx)
+{
+    kvs_cache_entry *entry = &device->cache_entries[idx];
+    if (entry->slot == UINT32_MAX) {
+        return;
+    }
+    device->cache_slot_map[entry->slot] = UINT32_MAX;
+    device->cache_used_bytes -= entry->value_size;
+    uint32_t chunk = entry->first_chunk;
+    while (chunk != UINT32_MAX) {
+        uint32_t next = device->cache_chunk_next[chunk];
+        device->cache_chunk_next[chunk] = device->cache_free_chunk;
+        device->cache_free_chunk = chunk;
+        device->cache_free_chunks++;
+        chunk = next;
+    }
+    entry->first_chunk = UINT32_MAX;
+    entry->value_size  = 0;
+    entry->slot       = UINT32_MAX;
+    entry->referenced = 0;
+}
+
+// Ищет запись для вытеснения по алгоритму CLOCK.
+// Записи с установленным битом обращения получают второй шанс, бит сбрасывается.
+static uint32_t kvs_cache_clock_victim(void)
+{
+    for (uint32_t step = 0; step < 2 * device->cache_capacity; step++) {
+        uint32_t idx = device->cache_hand;
+        device->cache_hand = (device->cache_hand + 1) % device->cache_capacity;
+
+        kvs_cache_entry *entry = &device->cache_entries[idx];
+        if (entry->slot == UINT32_MAX) {
+            continue;
+        }
+        if (entry->referenced) {
+            entry->referenced = 0;
+            continue;
+        }
+        return idx;
+    }
+    return UINT32_MAX;
+}
+
+kvs_internal_status kvs_cache_create(void)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+
+    // Шаг 2: Выделяем записи кеша и обратное отображение слотов
+    uint32_t max_key_count = device->superblock.max_key_count;
+    device->cache_capacity = (max_key_count < KVS_CACHE_MAX_ENTRIES) ? max_key_count : KVS_CACHE_MAX_ENTRIES;
+    device->cache_entries  = calloc(device->cache_capacity, sizeof(kvs_cache_entry));
+    device->cache_slot_map = malloc(max_key_count * sizeof(uint32_t));
+    if (!device->cache_entries || !device->cache_slot_map) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+
+    // Шаг 3: Помечаем все записи и слоты как свободные
+    for (uint32_t i = 0; i < device->cache_capacity; i++) {
+        device->cache_entries[i].slot        = UINT32_MAX;
+        device->cache_entries[i].first_chunk = UINT32_MAX;
+    }
+    memset(device->cache_slot_map, 0xFF, max_key_count * sizeof(uint32_t));
+    device->cache_hand         = 0;
+    device->cache_used_bytes   = 0;
+    device->cache_budget_bytes = KVS_CACHE_BUDGET_BYTES;
+
+    // Шаг 4: Область копий значений выделяется один раз, промахи чтения не обращаются к malloc
+    return kvs_cache_arena_create(device->cache_budget_bytes);
+}
+
+void kvs_cache_destroy(void)
+{
+    if (!device) {
+        return;
+    }
+    if (device->cache_entries) {
+        kvs_cache_clear();
+        free(device->cache_entries);
+        device->cache_entries = NULL;
+    }
+    if (device->cache_slot_map) {
+        free(device->cache_slot_map);
+        device->cache_slot_map = NULL;
+    }
+    free(device->cache_arena);
+    free(device->cache_chunk_next);
+    device->cache_arena       = NULL;
+    device->cache_chunk_next  = NULL;
+    device->cache_chunk_count = 0;
+    device->cache_free_chunks = 0;
+    device->cache_capacity    = 0;
+}
+
+kvs_internal_status kvs_cache_set_budget(uint64_t budget_bytes)
+{
+    if (!device || !device->cache_entries) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+
+    // Сбрасываем кеш целиком и перевыделяем область под новый бюджет, чтобы он соблюдался сразу
+    kvs_cache_clear();
+    kvs_internal_status status = kvs_cache_arena_create(budget_bytes);
+    device->cache_budget_bytes = (status == KVS_INTERNAL_OK) ? budget_bytes : 0;
+    return status;
+}
+
+const kvs_cache_entry *kvs_cache_lookup(uint32_t slot_index)
+{
+    if (!device || !device->cache_entries || device->cache_budget_bytes == 0 || slot_index >= device->superblock.max_key_count) {
+        return NULL;
+    }
+
+    uint32_t idx = device->cache_slot_map[slot_index];
+    if (idx == UINT32_MAX) {
+        device->cache_misses++;
+        return NULL;
+    }
+
+    device->cache_hits++;
+    device->cache_entries[idx].referenced = 1;
+    return &device->cache_entries[idx];
+}
+
+void kvs_cache_insert(uint32_t slot_index, const void *value, uint32_t value_size)
+{
+    // Шаг 1: Проверяем базовые параметры и решаем, стоит ли кешировать значение
+    if (!device || !device->cache_entries || !value || slot_index >= device->superblock.max_key_count) {
+        return;
+    }
+    if (device->cache_budget_bytes == 0 || value_size > device->cache_budget_bytes / 4) {
+        return;
+    }
+
+    // Шаг 2: Старую запись слота, если она есть, заменяем новой
+    kvs_cache_invalidate(slot_index);
+
+    // Шаг 3: Освобождаем место: вытесняем записи, пока для значения не найдутся свободные блоки и свободная запись
+    uint32_t chunks_needed = (value_size + KVS_CACHE_CHUNK_BYTES - 1) / KVS_CACHE_CHUNK_BYTES;
+    uint32_t free_idx = UINT32_MAX;
+    while (true) {
+        if (device->cache_free_chunks >= chunks_needed) {
+            for (uint32_t i = 0; i < device->cache_capacity; i++) {
+                uint32_t idx = (device->cache_hand + i) % device->cache_capacity;
+                if (device->cache_entries[idx].slot == UINT32_MAX) {
+                    free_idx = idx;
+                    break;
+                }
+            }
+            if (free_idx != UINT32_MAX) {
+                break;
+            }
+        }
+        uint32_t victim = kvs_cache_clock_victim();
+        if (victim == UINT32_MAX) {
+            return;
+        }
+        kvs_cache_drop_entry(victim);
+    }
+
+    // Шаг 4: Копируем значение в блоки, снятые со списка свободных
+    uint32_t first_chunk = UINT32_MAX;
+    uint32_t *link = &first_chunk;
+    const uint8_t *src = value;
+    for (uint32_t left = value_size; left > 0; ) {
+        uint32_t chunk = device->cache_free_chunk;
+        device->cache_free_chunk = device->cache_chunk_next[chunk];
+        device->cache_free_chunks--;
+        uint32_t n = (left < KVS_CACHE_CHUNK_BYTES) ? left : KVS_CACHE_CHUNK_BYTES;
+        memcpy(device->cache_arena + (size_t)chunk * KVS_CACHE_CHUNK_BYTES, src, n);
+        src  += n;
+        left -= n;
+        *link = chunk;
+        link  = &device->cache_chunk_next[chunk];
+    }
+    *link = UINT32_MAX;
+
+    kvs_cache_entry *entry = &device->cache_entries[free_idx];
+    entry->slot        = slot_index;
+    entry->first_chunk = first_chunk;
+    entry->value_size  = value_size;
+    entry->referenced = 0;
+    device->cache_slot_map[slot_index] = free_idx;
+    device->cache_used_bytes += value_size;
+}
+
+void kvs_cache_copy_value(const kvs_cache_entry *entry, void *dst)
+{
+    uint8_t *out = dst;
+    uint32_t left = entry->value_size;
+    for (uint32_t chunk = entry->first_chunk; chunk != UINT32_MAX && left > 0; chunk = device->cache_chunk_next[chunk]) {
+        uint32_t n = (left < KVS_CACHE_CHUNK_BYTES) ? left : KVS_CACHE_CHUNK_BYTES;
+        memcpy(out, device->cache_arena + (size_t)chunk * KVS_CACHE_CHUNK_BYTES, n);
+        out  += n;
+        left -= n;
+    }
+}
+
+void kvs_cache_invalidate(uint32_t slot_index)
+{
+    if (!device || !device->cache_entries || slot_index >= device->superblock.max_key_count) {
+        return;
+    }
+    uint32_t idx = device->cache_slot_map[slot_index];
+    if (idx != UINT32_MAX) {
+        kvs_cache_drop_entry(idx);
+    }
+}
+
+void kvs_cache_clear(void)
+{
+    if (!device || !device->cache_entries) {
+        return;
+    }
+    for (uint32_t i = 0; i < device->cache_capacity; i++) {
+        kvs_cache_drop_entry(i);
+    }
+    device->cache_hand = 0;
+}
+
+void kvs_cache_lock(void)
+{
+    if (device && device->concurrent) {
+        pthread_mutex_lock(&device->cache_lock);
+    }
+}
+
+void kvs_cache_unlock(void)
+{
+    if (device && device->concurrent) {
+        pthread_mutex_unlock(&device->cache_lock);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef SSDMMCSTORE_KVS_CACHE_H
+#define SSDMMCSTORE_KVS_CACHE_H
+
+#include "kvs_types.h"
+#include "kvs_internal.h"
+
+
+// Создает кеш чтения устройства с бюджетом KVS_CACHE_BUDGET_BYTES.
+// Копии значений хранятся в области, выделенной под бюджет один раз.
+// Вызывается, когда max_key_count уже известен.
+// Возвращает KVS_INTERNAL_OK при успехе или код ошибки.
+kvs_internal_status kvs_cache_create(void);
+
+// Освобождает все записи кеша и его служебные массивы.
+void kvs_cache_destroy(void);
+
+// Очищает кеш и перевыделяет область копий значений под бюджет budget_bytes (0 выключает кеш).
+// Возвращает KVS_INTERNAL_OK при успехе или код ошибки (кеш при этом выключается).
+kvs_internal_status kvs_cache_set_budget(uint64_t budget_bytes);
+
+// Ищет в кеше значение ключа, метаданные которого лежат в слоте slot_index.
+// Возвращает указатель на запись или NULL при промахе.
+// Попадание и промах учитываются в device->cache_hits / device->cache_misses.
+const kvs_cache_entry *kvs_cache_lookup(uint32_t slot_index);
+
+// Помещает в кеш проверенное значение слота slot_index, при необходимости вытесняя
+// записи по алгоритму CLOCK. Значения больше четверти бюджета не кешируются.
+void kvs_cache_insert(uint32_t slot_index, const void *value, uint32_t value_size);
+
+// Копирует значение записи кеша в буфер dst размером не меньше entry->value_size байт.
+void kvs_cache_copy_value(const kvs_cache_entry *entry, void *dst);
+
+// Удаляет из кеша запись слота slot_index.
+// Вызывается при любом изменении метаданных или данных слота (put, delete, перенос данных).
+void kvs_cache_invalidate(uint32_t slot_index);
+
+// Удаляет из кеша все записи.
+void kvs_cache_clear(void);
+
+// Захватывает и освобождает кеш в режиме параллельного чтения (без него ничего не делают).
+// Под разделяемой блокировкой хранилища поиск с копированием значения и вставка выполняются внутри этой пары:
+// запись, возвращенную kvs_cache_lookup, другой читатель может вытеснить сразу после освобождения кеша.
+void kvs_cache_lock(void);
+void kvs_cache_unlock(void);
+
+#endif //SSDMMCSTORE_KVS_CACHE_H
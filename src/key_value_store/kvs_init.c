@@ -2,14 +2,31 @@
 #include "kvs_metadata.h"
 #include "kvs_valid.h"
 #include "kvs_internal_io.h"
+#include "kvs_cache.h"
+#include "kvs_log.h"
 
 
-kvs_internal_status kvs_setup_device(size_t user_size_bytes) {
+// Выделяет key_index и обратное отображение слотов под device->superblock.max_key_count ключей.
+// В хеш-раскладке ключи находятся по корзинам на устройстве, и индекс в ОЗУ не выделяется.
+static kvs_internal_status kvs_key_index_alloc(void)
+{
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        return KVS_INTERNAL_OK;
+    }
+    device->key_index     = calloc(1, device->superblock.max_key_count * sizeof(kvs_key_index_entry));
+    device->slot_to_index = malloc(device->superblock.max_key_count * sizeof(uint32_t));
+    if (!device->key_index || !device->slot_to_index) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    return KVS_INTERNAL_OK;
+}
+
+kvs_internal_status kvs_setup_device(size_t user_size_bytes, kvs_metadata_layout layout) {
 
     // Шаг 1: Выделяем память под основную управляющую структуру
     device = calloc(1, sizeof(kvs_device));
     if (!device) {
-        kvs_log("Ошибка: не удалось выделить память под структуру устройства");
+        kvs_log_at(KVS_LOG_ERROR, "Ошибка: не удалось выделить память под структуру устройства");
         return KVS_INTERNAL_ERR_MALLOC_FAILED;
     }
 
@@ -68,6 +85,7 @@ kvs_internal_status kvs_setup_device(size_t user_size_bytes) {
 
     // Шаг 4: Заполняем структуру superblock всеми рассчитанными значениями
     device->superblock.magic                      = KVS_SUPERBLOCK_MAGIC;
+    device->superblock.format_version             = KVS_FORMAT_VERSION;
     device->superblock.word_size_bytes            = word_size;
     device->superblock.userdata_size_bytes        = user_data_size;
     device->superblock.global_page_count          = global_page_count;
@@ -81,6 +99,7 @@ kvs_internal_status kvs_setup_device(size_t user_size_bytes) {
     device->superblock.max_key_count              = metadata_size / sizeof(kvs_metadata);
     device->superblock.metadata_bitmap_size_bytes = metadata_bitmap_bytes;
     device->superblock.last_data_word_checked     = 0;
+    device->superblock.last_hot_data_word_checked = total_words / 2;
     device->superblock.last_metadata_slot_checked = 0;
     device->superblock.bitmap_offset              = superblock_size;
     device->superblock.metadata_bitmap_offset     = superblock_size + bitmap_bytes;
@@ -90,12 +109,31 @@ kvs_internal_status kvs_setup_device(size_t user_size_bytes) {
     device->superblock.metadata_offset            = superblock_size + bitmap_bytes + metadata_bitmap_bytes + page_rewrite_bytes + crc_region_bytes + user_data_size;
     device->superblock.superblock_backup_offset   = storage_size - superblock_backup_size;
 
+    // Задаем раскладку слотов метаданных. В хеш-раскладке корзина слотов помещается в одну страницу
+    device->superblock.max_key_size               = KVS_KEY_SIZE;
+    device->superblock.metadata_layout            = layout;
+    device->superblock.inline_value_size          = KVS_INLINE_VALUE_SIZE;
+    device->superblock.hash_bucket_slots          = page_size / sizeof(kvs_metadata);
+    device->superblock.hash_bucket_count          = device->superblock.max_key_count / device->superblock.hash_bucket_slots;
+    device->superblock.hash_max_probe             = 0;
+    device->superblock.slot_key_size              = KVS_SLOT_KEY_BYTES;
+    device->superblock.shard_set_id               = 0;
+    device->superblock.shard_index                = 0;
+    device->superblock.shard_count                = 0;
+
     // Инициализируем указатели как NULL, на случай если выделение памяти далее провалится
     device->bitmap                     = NULL;
     device->metadata_bitmap            = NULL;
     device->page_rewrite_count         = NULL;
     device->page_crc.entry_crc         = NULL;
     device->key_index                  = NULL;
+    device->slot_to_index              = NULL;
+    device->slot_write_seq             = NULL;
+    device->scratch_arena              = NULL;
+    device->cache_entries              = NULL;
+    device->cache_slot_map             = NULL;
+    device->cache_arena                = NULL;
+    device->cache_chunk_next           = NULL;
 
     // Проверяем, что в нашем хранилище будет место как минимум для KVS_MIN_NUM_METADATA метаданных
     if (device->superblock.max_key_count < KVS_MIN_NUM_METADATA) {
@@ -108,49 +146,58 @@ kvs_internal_status kvs_setup_device(size_t user_size_bytes) {
     device->metadata_bitmap            = calloc(1, device->superblock.metadata_bitmap_size_bytes);
     device->page_rewrite_count         = calloc(1, page_rewrite_bytes);
     device->page_crc.entry_crc         = calloc(1, device->superblock.max_key_count * sizeof(uint32_t));
-    device->key_index                  = calloc(1, device->superblock.max_key_count * sizeof(kvs_key_index_entry));
-
-    if (!device->bitmap || !device->metadata_bitmap || !device->page_rewrite_count || !device->page_crc.entry_crc || !device->key_index) {
-        kvs_log("Ошибка: не удалось выделить память для служебных массивов");
+    device->page_crc.entry_crc_dirty_first = 0;                                  // Новое хранилище: массив
+    device->page_crc.entry_crc_dirty_end   = device->superblock.max_key_count;   // CRC сохраняется целиком
+    device->slot_write_seq             = calloc(device->superblock.max_key_count, sizeof(uint64_t));
+
+    if (!device->bitmap || !device->metadata_bitmap || !device->page_rewrite_count || !device->page_crc.entry_crc
+        || kvs_key_index_alloc() != KVS_INTERNAL_OK || !device->slot_write_seq
+        || kvs_scratch_pool_create() != KVS_INTERNAL_OK || kvs_cache_create() != KVS_INTERNAL_OK) {
+        kvs_log_at(KVS_LOG_ERROR, "Ошибка: не удалось выделить память для служебных массивов");
         kvs_free_device();
         return KVS_INTERNAL_ERR_MALLOC_FAILED;
     }
 
     device->key_count = 0;
-    device->fp = NULL;
+    kvs_slot_map_rebuild();
+    device->hot_update_threshold = KVS_HOT_UPDATE_THRESHOLD;
+    device->wear_level_threshold = KVS_WEAR_LEVEL_THRESHOLD;
+    device->inline_value_limit = KVS_INLINE_VALUE_SIZE;
+    device->write_path = KVS_WRITE_PATH_PERSIST;
+    device->sim = NULL;
     return KVS_INTERNAL_OK;
 }
 
-kvs_internal_status kvs_init_new(size_t storage_size_bytes) {
+kvs_internal_status kvs_init_new(const char *path, size_t storage_size_bytes, kvs_metadata_layout layout) {
 
     kvs_log("Создание нового хранилища KVS (размер пользовательских данных: %lu байт)", storage_size_bytes);
 
     // Шаг 1: Настраиваем геометрию и выделяем память под структуры
-    if (kvs_setup_device(storage_size_bytes) != KVS_INTERNAL_OK) {
+    if (kvs_setup_device(storage_size_bytes, layout) != KVS_INTERNAL_OK) {
         return KVS_INTERNAL_ERR_MALLOC_FAILED;
     }
 
     // Шаг 2: Создаем и открываем файл хранилища
-    device->fp = fopen(ssdmmc_sim_get_storage_filename(), "wb+");
-    if (!device->fp) {
+    device->sim = ssdmmc_sim_open(path, true);
+    if (!device->sim) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_FILE_OPEN_FAILED;
     }
 
     // Шаг 3: Полностью стираем диск, заполняя его 0xFF
-    if (ssdmmc_sim_format(device->fp) < 0) {
+    if (ssdmmc_sim_format(device->sim) < 0) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_ERASE_FAILED;
     }
 
     // Шаг 4: Записываем на диск свежесозданный superblock
-    if (kvs_write_region(device->fp, 0, &device->superblock, device->superblock.superblock_size_bytes) < 0) {
+    if (kvs_write_region(device->sim, 0, &device->superblock, device->superblock.superblock_size_bytes) < 0) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
 
     // Шаг 5: Записываем на диск резервную копию суперблока
-    if (kvs_write_region(device->fp, device->superblock.superblock_backup_offset, &device->superblock, device->superblock.superblock_size_bytes) < 0) {
+    if (kvs_write_region(device->sim, device->superblock.superblock_backup_offset, &device->superblock, device->superblock.superblock_size_bytes) < 0) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
@@ -165,23 +212,34 @@ kvs_internal_status kvs_init_new(size_t storage_size_bytes) {
     return KVS_INTERNAL_OK;
 }
 
-kvs_internal_status kvs_load_existing(void) {
+// Возвращает true, если суперблок принадлежит хранилищу другой версии формата
+// (записанному до появления версии или с версией, отличной от KVS_FORMAT_VERSION).
+static bool kvs_superblock_is_other_format(const kvs_superblock *sb)
+{
+    return sb->magic == KVS_SUPERBLOCK_MAGIC_V1 || (sb->magic == KVS_SUPERBLOCK_MAGIC && sb->format_version != KVS_FORMAT_VERSION);
+}
+
+kvs_internal_status kvs_load_existing(const char *path) {
 
     kvs_log("Попытка загрузить существующее хранилище KVS");
 
     // Шаг 1: Пытаемся открыть файл
-    FILE* fp = fopen(ssdmmc_sim_get_storage_filename(), "rb+");
-    if (!fp) {
+    ssdmmc_sim_device *sim = ssdmmc_sim_open(path, false);
+    if (!sim) {
         return KVS_INTERNAL_ERR_FILE_OPEN_FAILED;
     }
 
     // Шаг 2: Создаем временную структуру для безопасного чтения
     device = calloc(1, sizeof(kvs_device));
     if (!device) {
-        fclose(fp);
+        ssdmmc_sim_close(sim);
         return KVS_INTERNAL_ERR_MALLOC_FAILED;
     }
-    device->fp = fp;
+    device->sim = sim;
+    device->hot_update_threshold = KVS_HOT_UPDATE_THRESHOLD;
+    device->wear_level_threshold = KVS_WEAR_LEVEL_THRESHOLD;
+    device->inline_value_limit = KVS_INLINE_VALUE_SIZE;
+    device->write_path = KVS_WRITE_PATH_PERSIST;
     device->superblock.word_size_bytes = ssdmmc_sim_get_word_size();
     device->superblock.words_per_page  = ssdmmc_sim_get_words_per_page();
     device->superblock.global_page_count = ssdmmc_sim_get_page_count();
@@ -189,6 +247,7 @@ kvs_internal_status kvs_load_existing(void) {
     device->page_rewrite_count         = NULL;
     device->metadata_bitmap            = NULL;
     device->key_index                  = NULL;
+    device->slot_to_index              = NULL;
     device->bitmap                     = NULL;
     device->page_crc.entry_crc         = NULL;
 
@@ -198,40 +257,61 @@ kvs_internal_status kvs_load_existing(void) {
     uint32_t backup_offset = storage_size - superblock_size;
 
     kvs_superblock primary_sb, backup_sb;
-    if (kvs_read_region(device->fp, backup_offset, &backup_sb, superblock_size) < 0) {
+    if (kvs_read_region(device->sim, backup_offset, &backup_sb, superblock_size) < 0) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
-    if (kvs_read_region(device->fp, 0, &primary_sb, superblock_size) < 0) {
+    if (kvs_read_region(device->sim, 0, &primary_sb, superblock_size) < 0) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
 
+    // Магическое число и версия формата стоят в начале суперблока и читаются при любой раскладке.
+    // Проверяем их до CRC: CRC суперблока другого формата не сойдется, и без этой проверки
+    // хранилище было бы принято за поврежденное и перезаписано новым
+    if (kvs_superblock_is_other_format(&primary_sb) || kvs_superblock_is_other_format(&backup_sb)) {
+        const kvs_superblock *other = kvs_superblock_is_other_format(&primary_sb) ? &primary_sb : &backup_sb;
+        kvs_log_at(KVS_LOG_ERROR, "ОШИБКА: Хранилище записано в формате версии %u, а библиотека поддерживает версию %u.",
+                   other->magic == KVS_SUPERBLOCK_MAGIC_V1 ? 1u : other->format_version, KVS_FORMAT_VERSION);
+        kvs_free_device();
+        return KVS_INTERNAL_ERR_INCOMPATIBLE_FORMAT;
+    }
+
     // Шаг 4: Проверяем валидность обоих суперблоков
     uint32_t primary_sb_crc = 0, backup_sb_crc = 0;
-    kvs_read_region(device->fp, primary_sb.page_crc_offset, &primary_sb_crc, sizeof(uint32_t));
-    kvs_read_region(device->fp, backup_sb.page_crc_offset + sizeof(uint32_t), &backup_sb_crc, sizeof(uint32_t));
+    kvs_read_region(device->sim, primary_sb.page_crc_offset, &primary_sb_crc, sizeof(uint32_t));
+    kvs_read_region(device->sim, backup_sb.page_crc_offset + sizeof(uint32_t), &backup_sb_crc, sizeof(uint32_t));
 
-    bool primary_valid = (primary_sb_crc == crc32_calc(&primary_sb, sizeof(kvs_superblock)));
-    bool backup_valid = (backup_sb_crc == crc32_calc(&backup_sb, sizeof(kvs_superblock)));
+    bool primary_valid = primary_sb.magic == KVS_SUPERBLOCK_MAGIC && (primary_sb_crc == crc32_calc(&primary_sb, sizeof(kvs_superblock)));
+    bool backup_valid = backup_sb.magic == KVS_SUPERBLOCK_MAGIC && (backup_sb_crc == crc32_calc(&backup_sb, sizeof(kvs_superblock)));
 
     // Шаг 5: Выбираем, какой суперблок использовать
     if (primary_valid) {
         device->superblock = primary_sb;
     } else if (backup_valid) {
-        kvs_log("ВНИМАНИЕ: Основной суперблок поврежден! Восстанавливаем из резервной копии.");
+        kvs_log_at(KVS_LOG_WARNING, "ВНИМАНИЕ: Основной суперблок поврежден! Восстанавливаем из резервной копии.");
         device->superblock = backup_sb;
-        if (kvs_write_region(device->fp, 0, &device->superblock, device->superblock.superblock_size_bytes) < 0) {
-            kvs_log("КРИТИЧЕСКАЯ ОШИБКА: Не удалось восстановить основной суперблок.");
+        if (kvs_write_region(device->sim, 0, &device->superblock, device->superblock.superblock_size_bytes) < 0) {
+            kvs_log_at(KVS_LOG_ERROR, "КРИТИЧЕСКАЯ ОШИБКА: Не удалось восстановить основной суперблок.");
             kvs_free_device();
             return KVS_INTERNAL_ERR_WRITE_FAILED;
         }
     } else {
-        kvs_log("ОШИБКА: Оба суперблока повреждены. Хранилище не может быть загружено.");
+        kvs_log_at(KVS_LOG_ERROR, "ОШИБКА: Оба суперблока повреждены. Хранилище не может быть загружено.");
         kvs_free_device();
         return KVS_INTERNAL_ERR_CORRUPT_SUPERBLOCK;
     }
 
+    // Размер слота метаданных зависит от KVS_KEY_SIZE, KVS_SLOT_KEY_SIZE и KVS_INLINE_VALUE_SIZE: хранилище другой сборки читать нельзя
+    if (device->superblock.max_key_size != KVS_KEY_SIZE || device->superblock.inline_value_size != KVS_INLINE_VALUE_SIZE
+        || device->superblock.slot_key_size != KVS_SLOT_KEY_BYTES) {
+        kvs_log_at(KVS_LOG_ERROR, "ОШИБКА: Хранилище создано с KVS_KEY_SIZE=%u, KVS_SLOT_KEY_SIZE=%u, KVS_INLINE_VALUE_SIZE=%u, а библиотека собрана с KVS_KEY_SIZE=%u, KVS_SLOT_KEY_SIZE=%u, KVS_INLINE_VALUE_SIZE=%u.",
+                device->superblock.max_key_size, device->superblock.slot_key_size, device->superblock.inline_value_size,
+                KVS_KEY_SIZE, KVS_SLOT_KEY_BYTES, KVS_INLINE_VALUE_SIZE);
+        kvs_free_device();
+        return KVS_INTERNAL_ERR_INCOMPATIBLE_FORMAT;
+    }
+
 
     // Шаг 6: Теперь, когда у нас есть валидный суперблок, выделяем память и читаем служебные данные
     device->page_crc.entry_crc = calloc(1, device->superblock.max_key_count * sizeof(uint32_t));
@@ -243,39 +323,44 @@ kvs_internal_status kvs_load_existing(void) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
+    device->page_crc.entry_crc_dirty_first = device->superblock.max_key_count;  // Массив CRC совпадает с диском
+    device->page_crc.entry_crc_dirty_end   = 0;
 
     uint32_t rewrite_size = device->superblock.page_crc_offset - device->superblock.page_rewrite_offset;
     device->bitmap = calloc(1, device->superblock.bitmap_size_bytes);
     device->metadata_bitmap = calloc(1, device->superblock.metadata_bitmap_size_bytes);
     device->page_rewrite_count = calloc(1, rewrite_size);
-    device->key_index = calloc(1, device->superblock.max_key_count * sizeof(kvs_key_index_entry));
-    if (!device->bitmap || !device->metadata_bitmap || !device->page_rewrite_count || !device->key_index) {
+    device->slot_write_seq = calloc(device->superblock.max_key_count, sizeof(uint64_t));
+    if (!device->bitmap || !device->metadata_bitmap || !device->page_rewrite_count || kvs_key_index_alloc() != KVS_INTERNAL_OK
+        || !device->slot_write_seq
+        || kvs_scratch_pool_create() != KVS_INTERNAL_OK || kvs_cache_create() != KVS_INTERNAL_OK) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_MALLOC_FAILED;
     }
 
-    if (kvs_read_region(device->fp, device->superblock.bitmap_offset, device->bitmap, device->superblock.bitmap_size_bytes) < 0) {
+    if (kvs_read_region(device->sim, device->superblock.bitmap_offset, device->bitmap, device->superblock.bitmap_size_bytes) < 0) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
-    if (kvs_read_region(device->fp, device->superblock.metadata_bitmap_offset, device->metadata_bitmap, device->superblock.metadata_bitmap_size_bytes) < 0) {
+    if (kvs_read_region(device->sim, device->superblock.metadata_bitmap_offset, device->metadata_bitmap, device->superblock.metadata_bitmap_size_bytes) < 0) {
         kvs_free_device(); return KVS_INTERNAL_ERR_READ_FAILED;
     }
-    if (kvs_read_region(device->fp, device->superblock.page_rewrite_offset, device->page_rewrite_count, rewrite_size) < 0) {
+    if (kvs_read_region(device->sim, device->superblock.page_rewrite_offset, device->page_rewrite_count, rewrite_size) < 0) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
 
     // Шаг 7: Проверяем и при необходимости восстанавливаем служебные области
     if (is_metadata_bitmap_valid() != 1) {
-        kvs_log("Биткарта метаданных повреждена, пересоздаем...");
+        kvs_log_at(KVS_LOG_WARNING, "Биткарта метаданных повреждена, пересоздаем...");
         if (kvs_metadata_bitmap_create() < 0) {
             kvs_free_device();
             return KVS_INTERNAL_ERR_WRITE_FAILED;
         }
     }
 
-    // Шаг 8: Строим key_index ключей в ОЗУ.
+    // Шаг 8: Строим key_index ключей в ОЗУ. В хеш-раскладке слоты не читаются, только считаются по биткарте
+    // метаданных: испорченные слоты обнаружатся при первом обращении к ним.
     if (build_key_index() < 0) {
         kvs_free_device();
         return KVS_INTERNAL_ERR_READ_FAILED;
@@ -283,7 +368,7 @@ kvs_internal_status kvs_load_existing(void) {
 
     // Шаг 9: Теперь, имея надежный key_index, проверяем и восстанавливаем битовую карту данных.
     if (is_bitmap_valid() != 1) {
-        kvs_log("Биткарта данных повреждена, пересоздаем...");
+        kvs_log_at(KVS_LOG_WARNING, "Биткарта данных повреждена, пересоздаем...");
         if (kvs_bitmap_create() < 0) {
             kvs_free_device();
             return KVS_INTERNAL_ERR_WRITE_FAILED;
@@ -291,8 +376,8 @@ kvs_internal_status kvs_load_existing(void) {
     }
 
     if (is_page_rewrite_count_valid() != 1) {
-        kvs_log("Счетчики перезаписи повреждены, сбрасываем...");
-        if (kvs_clear_region(device->fp, device->superblock.page_rewrite_offset, rewrite_size) < 0) {
+        kvs_log_at(KVS_LOG_WARNING, "Счетчики перезаписи повреждены, сбрасываем...");
+        if (kvs_clear_region(device->sim, device->superblock.page_rewrite_offset, rewrite_size) < 0) {
             kvs_free_device();
             return KVS_INTERNAL_ERR_WRITE_FAILED;
         }
@@ -302,62 +387,134 @@ kvs_internal_status kvs_load_existing(void) {
     return KVS_INTERNAL_OK;
 }
 
-kvs_status kvs_init(size_t storage_size_bytes)
+// Открывает хранилище в файле path, создавая новое, если загрузить существующее не удалось.
+// При успехе открытое устройство остается текущим (device), при ошибке device равен NULL.
+static kvs_status kvs_open_device(const char *path, size_t storage_size_bytes, kvs_metadata_layout layout)
 {
-    // Выравниваем запрошенный размер до размера слова
+    // Шаг 1: Выравниваем запрошенный размер до размера слова
     uint32_t word_size = ssdmmc_sim_get_word_size();
     size_t real_storage_size_bytes = align_up(storage_size_bytes,word_size);
 
-    // Проверяем, не была ли библиотека уже инициализирована
-    if (device) {
-        kvs_log("Предупреждение: KVS уже инициализирован.");
-        return KVS_ERROR_ALREADY_INITIALIZED;
+    // Шаг 2: Для пути по умолчанию создаем директорию для хранения данных, если ее нет
+    if (!path) {
+        if (ssdmmc_sim_ensure_data_dir_exists() != SSDMMC_OK) {
+            kvs_log_at(KVS_LOG_ERROR, "КРИТИЧЕСКАЯ ОШИБКА: Не удалось создать директорию для данных.");
+            return KVS_ERROR_STORAGE_FAILURE;
+        }
+        path = ssdmmc_sim_get_storage_filename();
     }
 
-    // Создаем директорию для хранения данных, если ее нет
-    if (ssdmmc_sim_ensure_data_dir_exists() != SSDMMC_OK) {
-        kvs_log("КРИТИЧЕСКАЯ ОШИБКА: Не удалось создать директорию для данных.");
-        return KVS_ERROR_STORAGE_FAILURE;
-    }
+    // Записываем разделитель в лог для удобства чтения
+    kvs_log("------------------------------ НОВЫЙ ЗАПУСК ------------------------------");
 
-    // Записываем разделитель в лог-файл для удобства чтения
-    FILE *log_fp = fopen(KVS_LOG_FILENAME,"a");
-    if(log_fp){
-        fprintf(log_fp,"\n------------------------------ НОВЫЙ ЗАПУСК ------------------------------\n\n");
-        fflush(log_fp);
-        fclose(log_fp);
-    }
-
-    // Пытаемся загрузить существующее хранилище
-    if (kvs_load_existing() == KVS_INTERNAL_OK) {
-        kvs_log("Инициализация завершена: загружено существующее хранилище");
+    // Шаг 3: Пытаемся загрузить существующее хранилище
+    kvs_internal_status load_status = kvs_load_existing(path);
+    if (load_status == KVS_INTERNAL_OK) {
+        kvs_log("Инициализация завершена: загружено существующее хранилище %s", path);
         return KVS_SUCCESS;
     }
 
+    // Хранилище несовместимого формата не перезаписываем новым
+    if (load_status == KVS_INTERNAL_ERR_INCOMPATIBLE_FORMAT) {
+        return KVS_ERROR_STORAGE_FAILURE;
+    }
 
-    if (kvs_init_new(real_storage_size_bytes) == KVS_INTERNAL_OK) {
-        kvs_log("Инициализация завершена: создано новое хранилище");
+    // Шаг 4: Иначе создаем новое
+    if (kvs_init_new(path, real_storage_size_bytes, layout) == KVS_INTERNAL_OK) {
+        kvs_log("Инициализация завершена: создано новое хранилище %s", path);
         return KVS_SUCCESS;
     }
 
     // Если произошла любая другая ошибка при загрузке (повреждение и т.д.), сообщаем о сбое
-    kvs_log("Ошибка: не удалось инициализировать KVS из-за повреждения или другой ошибки.");
+    kvs_log_at(KVS_LOG_ERROR, "Ошибка: не удалось инициализировать KVS из-за повреждения или другой ошибки.");
     kvs_free_device();
     return KVS_ERROR_STORAGE_FAILURE;
 }
 
-void kvs_deinit(void)
+kvs_status kvs_open(const char *path, const kvs_options *options, kvs_handle **handle_out)
 {
-    // Если устройство не было инициализировано, ничего не делаем
-    if (!device) {
+    // Шаг 1: Проверяем базовые параметры
+    if (!options || !handle_out) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    if (options->layout != KVS_LAYOUT_LINEAR && options->layout != KVS_LAYOUT_HASH) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Новое устройство открывается как текущее, после чего текущим снова становится прежнее.
+    // Пока хранилище открыто, лог пишет фоновый поток
+    kvs_log_start();
+    kvs_device *previous = kvs_bind_device(NULL);
+    kvs_status status = kvs_open_device(path, options->storage_size_bytes, options->layout);
+    if (status == KVS_SUCCESS && kvs_locks_create(options->concurrent) != KVS_INTERNAL_OK) {
+        kvs_free_device();
+        status = KVS_ERROR_STORAGE_FAILURE;
+    }
+    if (status == KVS_SUCCESS) {
+        device->stripe_allocations = options->stripe_dies;
+        *handle_out = device;
+    } else {
+        kvs_log_stop();
+    }
+    kvs_bind_device(previous);
+    return status;
+}
+
+void kvs_close(kvs_handle *handle)
+{
+    if (!handle) {
         return;
     }
 
-    // Сохраняем все служебные данные и освобождаем ресурсы
+    // Сбрасываем буфер записи, сохраняем все служебные данные и освобождаем ресурсы
+    kvs_device *previous = kvs_bind_device(handle);
     kvs_log("Деинициализация KVS...");
+    if (kvs_flush_h(handle) != KVS_SUCCESS) {
+        kvs_log_at(KVS_LOG_WARNING, "Внимание: не удалось сбросить буфер записи перед деинициализацией.");
+    }
     if (kvs_persist_all_service_data() < 0) {
-        kvs_log("Внимание: не удалось сохранить финальное состояние служебных данных перед деинициализацией.");
+        kvs_log_at(KVS_LOG_WARNING, "Внимание: не удалось сохранить финальное состояние служебных данных перед деинициализацией.");
     }
     kvs_free_device();
     kvs_log("Деинициализация завершена.");
-}
\ No newline at end of file
+    kvs_log_stop();
+    kvs_bind_device(previous == handle ? NULL : previous);
+}
+
+kvs_handle *kvs_get_default_handle(void)
+{
+    return kvs_default_device;
+}
+
+kvs_status kvs_init(size_t storage_size_bytes)
+{
+    return kvs_init_with_layout(storage_size_bytes, KVS_LAYOUT_LINEAR);
+}
+
+kvs_status kvs_init_with_layout(size_t storage_size_bytes, kvs_metadata_layout layout)
+{
+    // Шаг 1: Проверяем, не была ли библиотека уже инициализирована
+    if (kvs_default_device) {
+        kvs_log_at(KVS_LOG_WARNING, "Предупреждение: KVS уже инициализирован.");
+        return KVS_ERROR_ALREADY_INITIALIZED;
+    }
+
+    // Шаг 2: Открываем хранилище по пути по умолчанию
+    kvs_options options = {storage_size_bytes, layout, false, false};
+    kvs_handle *handle = NULL;
+    kvs_status status = kvs_open(NULL, &options, &handle);
+    if (status != KVS_SUCCESS) {
+        return status;
+    }
+
+    // Шаг 3: Оно становится хранилищем по умолчанию и текущим устройством вызвавшего потока
+    kvs_default_device = handle;
+    kvs_bind_device(handle);
+    return KVS_SUCCESS;
+}
+
+void kvs_deinit(void)
+{
+    // Если устройство не было инициализировано, ничего не делаем
+    kvs_close(kvs_default_device);
+}
@@ -7,15 +7,19 @@
 
 
 // Создает новое хранилище: выделяет память, рассчитывает параметры, форматирует файл, записывает superblock и инициализирует служебные структуры.
+// path   - путь к файлу-эмулятору (создается заново).
+// layout - раскладка слотов метаданных (KVS_LAYOUT_LINEAR или KVS_LAYOUT_HASH).
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-kvs_internal_status kvs_init_new(size_t storage_size_bytes);
+kvs_internal_status kvs_init_new(const char *path, size_t storage_size_bytes, kvs_metadata_layout layout);
 
 // Загружает и валидирует существующее хранилище: открывает файл, читает superblock, выделяет память, валидирует и восстанавливает служебные структуры.
+// path - путь к файлу-эмулятору.
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-kvs_internal_status kvs_load_existing(void);
+kvs_internal_status kvs_load_existing(const char *path);
 
 // Заполняет поля superblock и выделяет память под служебные массивы.
+// layout - раскладка слотов метаданных (KVS_LAYOUT_LINEAR или KVS_LAYOUT_HASH).
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-kvs_internal_status kvs_setup_device(size_t storage_size_bytes);
+kvs_internal_status kvs_setup_device(size_t storage_size_bytes, kvs_metadata_layout layout);
 
 #endif //SSDMMCSTORE_KVS_INIT_H
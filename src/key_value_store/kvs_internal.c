@@ -1,23 +1,24 @@
 #include "kvs_internal.h"
-#include <time.h>
-
-kvs_device *device = NULL;
-
-void kvs_log(const char *format, ...) {
-    FILE *log_file;
-    if ((log_file = fopen(KVS_LOG_FILENAME, "a")) == NULL) return;
-    time_t now;
-    time(&now);
-    struct tm *local_time = localtime(&now);
-    char time_buffer[80];
-    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", local_time);
-    fprintf(log_file, "[%s] ", time_buffer);
-    va_list args;
-    va_start(args, format);
-    vfprintf(log_file, format, args);
-    fprintf(log_file, "\n");
-    va_end(args);
-    fclose(log_file);
+#include "kvs_cache.h"
+#include "kvs_memtable.h"
+#include "kvs_snapshot.h"
+
+_Thread_local kvs_device *device = NULL;
+kvs_device *kvs_default_device = NULL;
+
+kvs_device *kvs_bind_device(kvs_device *dev)
+{
+    kvs_device *previous = device;
+    device = dev;
+    return previous;
+}
+
+kvs_write_path kvs_set_write_path(kvs_write_path path)
+{
+    kvs_write_path previous = device->write_path;
+    device->write_path = path;
+    ssdmmc_sim_trace_set_path((uint8_t)path);
+    return previous;
 }
 
 uint32_t align_up(uint32_t size, uint32_t align) {
@@ -25,16 +26,197 @@ uint32_t align_up(uint32_t size, uint32_t align) {
     return ((size + align - 1) / align) * align;
 }
 
+int kvs_key_compare(const void *a, uint32_t a_len, const void *b, uint32_t b_len)
+{
+    int n = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (n != 0) {
+        return n;
+    }
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+bool kvs_value_is_inline(const kvs_metadata *metadata)
+{
+    return KVS_INLINE_VALUE_SIZE > 0 && metadata->value_offset == KVS_INLINE_VALUE_OFFSET;
+}
+
+const void *kvs_inline_value(const kvs_metadata *metadata)
+{
+#if KVS_INLINE_VALUE_SIZE > 0
+    return metadata->inline_value;
+#else
+    (void)metadata;
+    return NULL;
+#endif
+}
+
+void kvs_inline_value_set(kvs_metadata *metadata, const void *value, size_t value_len)
+{
+#if KVS_INLINE_VALUE_SIZE > 0
+    memcpy(metadata->inline_value, value, value_len);
+#else
+    (void)metadata; (void)value; (void)value_len;
+#endif
+}
+
+uint32_t kvs_key_tail_size(uint32_t key_len)
+{
+    return key_len > KVS_SLOT_KEY_BYTES ? key_len - KVS_SLOT_KEY_BYTES : 0;
+}
+
+uint32_t kvs_value_data_size(uint32_t key_len, size_t value_len)
+{
+    uint32_t tail = kvs_key_tail_size(key_len);
+    if (tail == 0 && value_len <= device->inline_value_limit && value_len <= KVS_INLINE_VALUE_SIZE) {
+        return 0;
+    }
+    uint32_t word_size = device->superblock.word_size_bytes;
+    return align_up((uint32_t)value_len, word_size) + align_up(tail, word_size);
+}
+
+uint32_t kvs_record_data_size(const kvs_metadata *metadata)
+{
+    if (kvs_value_is_inline(metadata)) {
+        return 0;
+    }
+    uint32_t word_size = device->superblock.word_size_bytes;
+    return align_up(metadata->value_size, word_size) + align_up(kvs_key_tail_size(metadata->key_len), word_size);
+}
+
+void kvs_record_data_fill(uint8_t *buffer, const void *key, uint32_t key_len, const void *value, size_t value_len)
+{
+    uint32_t word_size = device->superblock.word_size_bytes;
+    uint32_t aligned_value_len = align_up((uint32_t)value_len, word_size);
+    uint32_t tail = kvs_key_tail_size(key_len);
+    memcpy(buffer, value, value_len);
+    memset(buffer + value_len, 0xFF, aligned_value_len - value_len);
+    if (tail > 0) {
+        memcpy(buffer + aligned_value_len, (const uint8_t *)key + KVS_SLOT_KEY_BYTES, tail);
+        memset(buffer + aligned_value_len + tail, 0xFF, align_up(tail, word_size) - tail);
+    }
+}
+
+kvs_internal_status kvs_scratch_pool_create(void)
+{
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+
+    // Размер буфера кратен странице, а сама область выровнена по странице
+    uint32_t page_size = device->superblock.page_size_bytes;
+    device->scratch_buffer_size = page_size * KVS_SCRATCH_BUFFER_PAGES;
+    device->scratch_in_use = 0;
+    device->scratch_arena = aligned_alloc(page_size, (size_t)device->scratch_buffer_size * KVS_SCRATCH_BUFFER_COUNT);
+    if (!device->scratch_arena) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    return KVS_INTERNAL_OK;
+}
+
+void *kvs_scratch_acquire(uint32_t size)
+{
+    // Шаг 1: Ищем свободный буфер в пуле, если запрошенный размер в него помещается.
+    // Буфер занимается атомарно: в режиме параллельного чтения пулом пользуются несколько потоков
+    if (device && device->scratch_arena && size <= device->scratch_buffer_size) {
+        uint32_t in_use = atomic_load_explicit(&device->scratch_in_use, memory_order_relaxed);
+        while (true) {
+            uint32_t i = 0;
+            while (i < KVS_SCRATCH_BUFFER_COUNT && (in_use & (1u << i))) {
+                i++;
+            }
+            if (i == KVS_SCRATCH_BUFFER_COUNT) {
+                break;
+            }
+            if (atomic_compare_exchange_weak_explicit(&device->scratch_in_use, &in_use, in_use | (1u << i),
+                                                      memory_order_acquire, memory_order_relaxed)) {
+                return device->scratch_arena + (size_t)i * device->scratch_buffer_size;
+            }
+        }
+    }
+
+    // Шаг 2: Пул занят или буфер слишком велик, выделяем память в куче и учитываем это
+    if (device) {
+        device->heap_alloc_count++;
+    }
+    return malloc(size > 0 ? size : 1);
+}
+
+void kvs_scratch_release(void *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+
+    // Буферы из пула просто помечаем свободными, остальные возвращаем в кучу
+    if (device && device->scratch_arena) {
+        uint8_t *p = buffer;
+        size_t arena_size = (size_t)device->scratch_buffer_size * KVS_SCRATCH_BUFFER_COUNT;
+        if (p >= device->scratch_arena && p < device->scratch_arena + arena_size) {
+            uint32_t i = (uint32_t)((p - device->scratch_arena) / device->scratch_buffer_size);
+            atomic_fetch_and_explicit(&device->scratch_in_use, ~(1u << i), memory_order_release);
+            return;
+        }
+    }
+    free(buffer);
+}
+
+kvs_internal_status kvs_locks_create(bool concurrent)
+{
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (!concurrent) {
+        device->concurrent = false;
+        return KVS_INTERNAL_OK;
+    }
+    if (pthread_rwlock_init(&device->lock, NULL) != 0) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    if (pthread_mutex_init(&device->cache_lock, NULL) != 0) {
+        pthread_rwlock_destroy(&device->lock);
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    device->concurrent = true;
+    return KVS_INTERNAL_OK;
+}
+
+void kvs_lock_shared(void)
+{
+    if (device && device->concurrent) {
+        pthread_rwlock_rdlock(&device->lock);
+    }
+}
+
+void kvs_lock_exclusive(void)
+{
+    if (device && device->concurrent) {
+        pthread_rwlock_wrlock(&device->lock);
+    }
+}
+
+void kvs_unlock(void)
+{
+    if (device && device->concurrent) {
+        pthread_rwlock_unlock(&device->lock);
+    }
+}
+
 void kvs_free_device() {
     if (!device) {
         return;
     }
-    if (device->fp) {
-        fclose(device->fp);
+    if (device->sim) {
+        ssdmmc_sim_close(device->sim);
     }
     if (device->key_index) {
         free(device->key_index);
     }
+    if (device->slot_to_index) {
+        free(device->slot_to_index);
+    }
+    if (device->slot_write_seq) {
+        free(device->slot_write_seq);
+    }
     if (device->page_crc.entry_crc) {
         free(device->page_crc.entry_crc);
     }
@@ -47,6 +229,86 @@ void kvs_free_device() {
     if (device->bitmap) {
         free(device->bitmap);
     }
+    if (device->scratch_arena) {
+        free(device->scratch_arena);
+    }
+    kvs_cache_destroy();
+    kvs_memtable_destroy();
+    kvs_snapshot_destroy();
+    if (device->concurrent) {
+        pthread_mutex_destroy(&device->cache_lock);
+        pthread_rwlock_destroy(&device->lock);
+    }
+    if (kvs_default_device == device) {
+        kvs_default_device = NULL;
+    }
     free(device);
     device = NULL;
-}
\ No newline at end of file
+}
+
+kvs_internal_status kvs_ring_create(kvs_ring *ring, uint32_t capacity)
+{
+    ring->cells = malloc(capacity * sizeof(kvs_ring_cell));
+    if (!ring->cells) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+        atomic_init(&ring->cells[i].seq, i);
+        ring->cells[i].value = NULL;
+    }
+    ring->mask = capacity - 1;
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+    return KVS_INTERNAL_OK;
+}
+
+bool kvs_ring_push(kvs_ring *ring, void *value)
+{
+    uint64_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        kvs_ring_cell *cell = &ring->cells[pos & ring->mask];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            // Ячейка свободна: занимаем позицию, после чего ячейка принадлежит только нам
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                cell->value = value;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // Элемент круг назад еще не забран
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+void *kvs_ring_pop(kvs_ring *ring)
+{
+    uint64_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        kvs_ring_cell *cell = &ring->cells[pos & ring->mask];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                void *value = cell->value;
+                // Освобождаем ячейку для записи на следующем круге
+                atomic_store_explicit(&cell->seq, pos + ring->mask + 1, memory_order_release);
+                return value;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+bool kvs_ring_empty(kvs_ring *ring)
+{
+    uint64_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    return atomic_load_explicit(&ring->cells[pos & ring->mask].seq, memory_order_acquire) != pos + 1;
+}
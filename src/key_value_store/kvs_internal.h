@@ -28,19 +28,105 @@ typedef enum {
 
     // Ошибки целостности и повреждения данных
     KVS_INTERNAL_ERR_CORRUPT_SUPERBLOCK = -15,
+    KVS_INTERNAL_ERR_INCOMPATIBLE_FORMAT = -16,
 
 
 } kvs_internal_status;
 
 
-// Освобождает всю память, выделенную под устройство, и закрывает файл.
+// Освобождает всю память, выделенную под текущее устройство, и закрывает его файл.
+// Если это устройство по умолчанию, kvs_default_device обнуляется.
 void kvs_free_device();
 
-// Записывает сообщение в лог-файл библиотеки KVS.
+// Делает dev текущим устройством вызывающего потока (переменная device) и возвращает прежнее текущее устройство.
+// Каждая функция API выполняется над устройством, переданным через дескриптор: в начале вызова оно
+// становится текущим, а в конце текущим снова становится прежнее.
+kvs_device *kvs_bind_device(kvs_device *dev);
+
+// Делает path путем, которому засчитываются записи текущего устройства на flash (device->write_counters),
+// и возвращает прежний путь. Вложенные пути (сборка мусора, выравнивание износа, сохранение служебных
+// данных внутри put или delete) восстанавливают прежний путь по завершении. Путь переносится и в записи трассы ввода-вывода.
+kvs_write_path kvs_set_write_path(kvs_write_path path);
+
+// Записывает сообщение уровня KVS_LOG_INFO в лог библиотеки KVS (см. kvs_log_at).
 void kvs_log(const char *format, ...);
 
+// Записывает сообщение уровня level в лог библиотеки KVS. Сообщения ниже уровня, заданного kvs_set_log_level,
+// отбрасываются до форматирования. Пока открыто хранилище, сообщение только форматируется в свободную запись
+// кольца, а в приемник его пишет фоновый поток; если свободных записей нет, сообщение теряется.
+void kvs_log_at(kvs_log_level level, const char *format, ...);
+
 // Выравнивает значение size вверх до ближайшего кратного align.
 uint32_t align_up(uint32_t size, uint32_t align);
 
+// Сравнивает ключи a и b по их реальным байтам; при общем префиксе короткий ключ меньше.
+// Возвращает отрицательное значение, 0 или положительное значение, как memcmp.
+int kvs_key_compare(const void *a, uint32_t a_len, const void *b, uint32_t b_len);
+
+// Проверяет, хранится ли значение записи прямо в слоте метаданных (inline_value), а не в области данных.
+bool kvs_value_is_inline(const kvs_metadata *metadata);
+
+// Возвращает значение, хранящееся в слоте метаданных (NULL, если сборка без значений в слоте).
+const void *kvs_inline_value(const kvs_metadata *metadata);
+
+// Записывает значение длиной не больше KVS_INLINE_VALUE_SIZE в слот метаданных.
+void kvs_inline_value_set(kvs_metadata *metadata, const void *value, size_t value_len);
+
+// Возвращает, сколько байт ключа длиной key_len не помещается в слот метаданных (хвост ключа).
+uint32_t kvs_key_tail_size(uint32_t key_len);
+
+// Возвращает, сколько байт области данных займет запись с ключом длиной key_len и значением длиной value_len:
+// 0, если значение будет записано в слот метаданных, иначе выровненное значение и выровненный хвост ключа.
+// Ключ с хвостом всегда хранит значение в области данных.
+uint32_t kvs_value_data_size(uint32_t key_len, size_t value_len);
+
+// Возвращает размер области данных, которую занимает запись metadata (0 для значения в слоте).
+uint32_t kvs_record_data_size(const kvs_metadata *metadata);
+
+// Заполняет область данных записи в buffer (kvs_value_data_size байт): значение, хвост ключа
+// с границы слова после значения; байты выравнивания заполняются 0xFF.
+void kvs_record_data_fill(uint8_t *buffer, const void *key, uint32_t key_len, const void *value, size_t value_len);
+
+// Создает пул временных буферов устройства: KVS_SCRATCH_BUFFER_COUNT буферов
+// по KVS_SCRATCH_BUFFER_PAGES страниц, выровненных по границе страницы.
+// Вызывается, когда геометрия суперблока уже известна.
+kvs_internal_status kvs_scratch_pool_create(void);
+
+// Выдает временный буфер размером не меньше size байт.
+// Буфер берется из пула без обращения к malloc; если свободного буфера нужного размера нет,
+// он выделяется в куче, а device->heap_alloc_count увеличивается.
+// Содержимое буфера не инициализируется. Возвращает NULL при нехватке памяти.
+void *kvs_scratch_acquire(uint32_t size);
+
+// Возвращает буфер, полученный через kvs_scratch_acquire.
+void kvs_scratch_release(void *buffer);
+
+// Настраивает блокировки текущего устройства.
+// concurrent - true включает режим параллельного чтения (см. kvs_options.concurrent), false - блокировки не используются.
+// Возвращает KVS_INTERNAL_OK при успехе или код ошибки.
+kvs_internal_status kvs_locks_create(bool concurrent);
+
+// Захватывает блокировку текущего устройства на чтение (get, exists) или на изменение.
+// Без режима параллельного чтения ничего не делают.
+void kvs_lock_shared(void);
+void kvs_lock_exclusive(void);
+
+// Освобождает блокировку, захваченную kvs_lock_shared или kvs_lock_exclusive.
+void kvs_unlock(void);
+
+// Создает пустое кольцо без блокировок на capacity ячеек (capacity - степень двойки).
+// Ячейки освобождаются через free(ring->cells).
+// Возвращает KVS_INTERNAL_OK при успехе или код ошибки.
+kvs_internal_status kvs_ring_create(kvs_ring *ring, uint32_t capacity);
+
+// Добавляет элемент в кольцо. Возвращает false, если кольцо заполнено.
+bool kvs_ring_push(kvs_ring *ring, void *value);
+
+// Забирает элемент из кольца. Возвращает NULL, если кольцо пусто.
+void *kvs_ring_pop(kvs_ring *ring);
+
+// Проверяет, есть ли в кольце элемент, готовый к чтению.
+bool kvs_ring_empty(kvs_ring *ring);
+
 
 #endif //SSDMMCSTORE_KVS_INTERNAL_H
\ No newline at end of file
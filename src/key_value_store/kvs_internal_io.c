@@ -1,7 +1,106 @@
 #include "kvs_internal.h"
 #include "kvs_internal_io.h"
 
-kvs_internal_status kvs_write_region(FILE *fp, uint32_t offset, const void *data, uint32_t size)
+// Учитывает живые слова пользовательских данных страницы page_buf (начинается со смещения page_start_offset),
+// которые придется записать заново после ее стирания.
+static void kvs_count_erase_copy(const uint8_t *page_buf, uint32_t page_start_offset)
+{
+    uint32_t words_per_page = device->superblock.words_per_page;
+    uint32_t word_size      = device->superblock.word_size_bytes;
+    for (uint32_t i = 0; i < words_per_page; i++) {
+        uint32_t word_offset = page_start_offset + i * word_size;
+        if (word_offset < device->superblock.data_offset || word_offset >= device->superblock.metadata_offset) {
+            continue;
+        }
+        const uint8_t *word = page_buf + i * word_size;
+        for (uint32_t b = 0; b < word_size; b++) {
+            if (word[b] != 0xFF) {
+                device->erase_copy_bytes += word_size;
+                break;
+            }
+        }
+    }
+}
+
+// Записывает регион в строгом режиме NAND: программирование может только сбрасывать биты, поэтому
+// страница, на которой новые данные требуют перевода хотя бы одного бита 0 -> 1, сначала стирается,
+// а затем на нее записываются ее прежние данные вместе с новыми (слова из одних 0xFF после стирания
+// записывать не нужно). Остальные страницы программируются как обычно.
+static kvs_internal_status kvs_write_region_erase_first(ssdmmc_sim_device *sim, uint32_t offset, const uint8_t *src, uint32_t size)
+{
+    uint32_t page_size      = device->superblock.page_size_bytes;
+    uint32_t words_per_page = device->superblock.words_per_page;
+    uint32_t word_size      = device->superblock.word_size_bytes;
+    kvs_write_counters *counters = &device->write_counters[device->write_path];
+
+    uint32_t start = offset;
+    uint32_t end   = offset + size;
+    while (start < end) {
+
+        // Шаг 1: Границы записи внутри текущей страницы
+        uint32_t cur_page          = start / page_size;
+        uint32_t page_start_offset = cur_page * page_size;
+        uint32_t write_start       = start - page_start_offset;
+        uint32_t write_end         = (end - page_start_offset < page_size) ? end - page_start_offset : page_size;
+        uint32_t write_len         = write_end - write_start;
+
+        // Шаг 2: Считываем страницу и проверяем, можно ли запрограммировать новые данные поверх текущих
+        uint8_t *page_buf = kvs_scratch_acquire(page_size);
+        if (!page_buf) {
+            return KVS_INTERNAL_ERR_MALLOC_FAILED;
+        }
+        for (uint32_t i = 0; i < words_per_page; i++) {
+            if (ssdmmc_sim_read_word(sim, cur_page, i, page_buf + i * word_size) < 0) {
+                kvs_scratch_release(page_buf);
+                return KVS_INTERNAL_ERR_READ_FAILED;
+            }
+        }
+        bool needs_erase = false;
+        for (uint32_t b = 0; b < write_len && !needs_erase; b++) {
+            needs_erase = (page_buf[write_start + b] & src[b]) != src[b];
+        }
+        memcpy(page_buf + write_start, src, write_len);
+
+        // Шаг 3: Программируем только записываемые слова или стираем страницу и записываем ее целиком
+        uint32_t first_word = write_start / word_size;
+        uint32_t end_word   = write_end / word_size;
+        if (needs_erase) {
+            kvs_count_erase_copy(page_buf, page_start_offset);
+            if (ssdmmc_sim_erase_page(sim, cur_page) < 0) {
+                kvs_scratch_release(page_buf);
+                return KVS_INTERNAL_ERR_ERASE_FAILED;
+            }
+            counters->erased_pages++;
+            first_word = 0;
+            end_word   = words_per_page;
+        }
+        for (uint32_t i = first_word; i < end_word; i++) {
+            const uint8_t *word = page_buf + i * word_size;
+            if (needs_erase) {
+                bool erased = true;
+                for (uint32_t b = 0; b < word_size && erased; b++) {
+                    erased = word[b] == 0xFF;
+                }
+                if (erased) {
+                    continue;
+                }
+            }
+            if (ssdmmc_sim_write_word(sim, cur_page, i, word) < 0) {
+                kvs_scratch_release(page_buf);
+                return KVS_INTERNAL_ERR_WRITE_FAILED;
+            }
+            counters->programmed_bytes += word_size;
+        }
+        kvs_scratch_release(page_buf);
+
+        // Шаг 4: Переходим к следующей странице
+        src  += write_len;
+        start = page_start_offset + write_end;
+    }
+    return KVS_INTERNAL_OK;
+}
+
+kvs_internal_status kvs_write_region(ssdmmc_sim_device *sim, uint32_t offset, const void *data, uint32_t size)
 {
     // Шаг 1: Проверяем базовые условия
     if (!device) {
@@ -15,6 +114,17 @@ kvs_internal_status kvs_write_region(FILE *fp, uint32_t offset, const void *data
         return KVS_INTERNAL_ERR_INVALID_PARAM;
     }
 
+    // В строгом режиме NAND страницы, которые нельзя запрограммировать поверх, сначала стираются
+    if (ssdmmc_sim_get_nand_mode(sim) == SSDMMC_SIM_NAND_STRICT) {
+        kvs_internal_status status = kvs_write_region_erase_first(sim, offset, data, size);
+        if (status != KVS_INTERNAL_OK) {
+            return status;
+        }
+        device->io_write_ops++;
+        device->io_write_bytes += size;
+        return KVS_INTERNAL_OK;
+    }
+
     // Шаг 2: Вычисляем начальные координаты для записи
     const uint8_t *src      = data;
     uint32_t words_to_write = size / word_size;
@@ -23,7 +133,7 @@ kvs_internal_status kvs_write_region(FILE *fp, uint32_t offset, const void *data
 
     // Шаг 3: В цикле записываем каждое слово
     for (uint32_t i = 0; i < words_to_write; i++) {
-        if (ssdmmc_sim_write_word(fp, cur_page, cur_word, src) < 0) {
+        if (ssdmmc_sim_write_word(sim, cur_page, cur_word, src) < 0) {
             return KVS_INTERNAL_ERR_WRITE_FAILED;
         }
 
@@ -38,10 +148,13 @@ kvs_internal_status kvs_write_region(FILE *fp, uint32_t offset, const void *data
         }
     }
 
+    device->io_write_ops++;
+    device->io_write_bytes += size;
+    device->write_counters[device->write_path].programmed_bytes += size;
     return KVS_INTERNAL_OK;
 }
 
-kvs_internal_status kvs_read_region(FILE *fp, uint32_t offset, void *data, uint32_t size)
+kvs_internal_status kvs_read_region(ssdmmc_sim_device *sim, uint32_t offset, void *data, uint32_t size)
 {
     // Шаг 1: Проверяем базовые условия
     if (!device) {
@@ -64,7 +177,7 @@ kvs_internal_status kvs_read_region(FILE *fp, uint32_t offset, void *data, uint3
 
     // Шаг 3: В цикле считываем каждое слово
     for (uint32_t i = 0; i < words_to_read; i++) {
-        if (ssdmmc_sim_read_word(fp, cur_page, cur_word, dst) < 0) {
+        if (ssdmmc_sim_read_word(sim, cur_page, cur_word, dst) < 0) {
             return KVS_INTERNAL_ERR_READ_FAILED;
         }
 
@@ -78,10 +191,12 @@ kvs_internal_status kvs_read_region(FILE *fp, uint32_t offset, void *data, uint3
             cur_page++;
         }
     }
+    device->io_read_ops++;
+    device->io_read_bytes += size;
     return KVS_INTERNAL_OK;
 }
 
-kvs_internal_status kvs_clear_region(FILE *fp, uint32_t offset, uint32_t size)
+kvs_internal_status kvs_clear_region(ssdmmc_sim_device *sim, uint32_t offset, uint32_t size)
 {
     // Проверяем базовые условия
     if (!device) {
@@ -108,15 +223,15 @@ kvs_internal_status kvs_clear_region(FILE *fp, uint32_t offset, uint32_t size)
         uint32_t clear_end   = (end < page_end_offset) ? (end - page_start_offset) : page_size;
 
         // Шаг 3: Выполняем цикл
-        uint8_t *page_buf = calloc(1, page_size);
+        uint8_t *page_buf = kvs_scratch_acquire(page_size);
         if (!page_buf) {
             return KVS_INTERNAL_ERR_MALLOC_FAILED;
         }
 
         // 3.1. Считываем всю страницу в буфер, чтобы не потерять данные, которые не нужно стирать
         for (uint32_t i = 0; i < words_per_page; i++) {
-            if (ssdmmc_sim_read_word(fp, cur_page, i, page_buf + i * word_size) < 0) {
-                free(page_buf);
+            if (ssdmmc_sim_read_word(sim, cur_page, i, page_buf + i * word_size) < 0) {
+                kvs_scratch_release(page_buf);
                 return KVS_INTERNAL_ERR_READ_FAILED;
             }
         }
@@ -124,21 +239,26 @@ kvs_internal_status kvs_clear_region(FILE *fp, uint32_t offset, uint32_t size)
         // 3.2. Стираем нужную часть данных в буфере, заполняя ее 0xFF
         memset(page_buf + clear_start, 0xFF, clear_end - clear_start);
 
+        // Учитываем живые слова пользовательских данных, которые придется записать заново после стирания страницы
+        kvs_count_erase_copy(page_buf, page_start_offset);
+
         // 3.3. Стираем всю физическую страницу на устройстве
-        if (ssdmmc_sim_erase_page(fp, cur_page) < 0) {
-            free(page_buf);
+        if (ssdmmc_sim_erase_page(sim, cur_page) < 0) {
+            kvs_scratch_release(page_buf);
             return KVS_INTERNAL_ERR_ERASE_FAILED;
         }
 
         // 3.4. Записываем измененный буфер обратно на только что очищенную страницу
         for (uint32_t i = 0; i < words_per_page; i++) {
-            if (ssdmmc_sim_write_word(fp, cur_page, i, page_buf + i * word_size) < 0) {
-                free(page_buf);
+            if (ssdmmc_sim_write_word(sim, cur_page, i, page_buf + i * word_size) < 0) {
+                kvs_scratch_release(page_buf);
                 return KVS_INTERNAL_ERR_WRITE_FAILED;
             }
         }
+        device->write_counters[device->write_path].erased_pages++;
+        device->write_counters[device->write_path].programmed_bytes += page_size;
 
-        free(page_buf);
+        kvs_scratch_release(page_buf);
 
         // Шаг 4: Переходим к началу следующей страницы для следующей итерации
         start = page_end_offset;
@@ -153,36 +273,36 @@ kvs_internal_status kvs_read_crc_info(void) {
         return KVS_INTERNAL_ERR_NULL_DEVICE;
     }
 
-    FILE *fp               = device->fp;
+    ssdmmc_sim_device *sim = device->sim;
     uint32_t offset        = device->superblock.page_crc_offset;
     kvs_crc_info *crc_info = &device->page_crc;
     uint32_t key_count     = device->superblock.max_key_count;
     uint32_t cur           = offset;
 
     // Шаг 2: Последовательно читаем каждое поле структуры CRC
-    if (kvs_read_region(fp, cur, &crc_info->superblock_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_read_region(sim, cur, &crc_info->superblock_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
     cur += sizeof(uint32_t);
-    if (kvs_read_region(fp, cur, &crc_info->superblock_backup_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_read_region(sim, cur, &crc_info->superblock_backup_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
     cur += sizeof(uint32_t);
-    if (kvs_read_region(fp, cur, &crc_info->bitmap_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_read_region(sim, cur, &crc_info->bitmap_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
     cur += sizeof(uint32_t);
-    if (kvs_read_region(fp, cur, &crc_info->rewrite_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_read_region(sim, cur, &crc_info->rewrite_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
     cur += sizeof(uint32_t);
-    if (kvs_read_region(fp, cur, &crc_info->metadata_bitmap_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_read_region(sim, cur, &crc_info->metadata_bitmap_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
     cur += sizeof(uint32_t);
 
     // Шаг 3: Читаем единый массив CRC для всех записей
-    if (kvs_read_region(fp, cur, crc_info->entry_crc, key_count * sizeof(uint32_t)) < 0) {
+    if (kvs_read_region(sim, cur, crc_info->entry_crc, key_count * sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
 
@@ -195,38 +315,45 @@ kvs_internal_status kvs_write_crc_info(void) {
     if (!device) {
         return KVS_INTERNAL_ERR_NULL_DEVICE;
     }
-    FILE *fp               = device->fp;
+    ssdmmc_sim_device *sim = device->sim;
     uint32_t offset        = device->superblock.page_crc_offset;
     kvs_crc_info *crc_info = &device->page_crc;
     uint32_t key_count     = device->superblock.max_key_count;
     uint32_t cur           = offset;
 
     // Шаг 2: Последовательно записываем каждое поле структуры CRC
-    if (kvs_write_region(fp, cur, &crc_info->superblock_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_write_region(sim, cur, &crc_info->superblock_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
     cur += sizeof(uint32_t);
-    if (kvs_write_region(fp, cur, &crc_info->superblock_backup_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_write_region(sim, cur, &crc_info->superblock_backup_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
     cur += sizeof(uint32_t);
-    if (kvs_write_region(fp, cur, &crc_info->bitmap_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_write_region(sim, cur, &crc_info->bitmap_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
     cur += sizeof(uint32_t);
-    if (kvs_write_region(fp, cur, &crc_info->rewrite_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_write_region(sim, cur, &crc_info->rewrite_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
     cur += sizeof(uint32_t);
-    if (kvs_write_region(fp, cur, &crc_info->metadata_bitmap_crc, sizeof(uint32_t)) < 0) {
+    if (kvs_write_region(sim, cur, &crc_info->metadata_bitmap_crc, sizeof(uint32_t)) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
     cur += sizeof(uint32_t);
 
-    // Шаг 3: Записываем единый массив CRC для всех записей
-    if (kvs_write_region(fp, cur, crc_info->entry_crc, key_count * sizeof(uint32_t)) < 0) {
-        return KVS_INTERNAL_ERR_WRITE_FAILED;
+    // Шаг 3: Записываем из массива CRC записей только слоты, измененные после прошлого сохранения
+    uint32_t first = crc_info->entry_crc_dirty_first;
+    uint32_t end   = crc_info->entry_crc_dirty_end < key_count ? crc_info->entry_crc_dirty_end : key_count;
+    if (first < end) {
+        if (kvs_write_region(sim, cur + first * sizeof(uint32_t), &crc_info->entry_crc[first],
+                             (end - first) * sizeof(uint32_t)) < 0) {
+            return KVS_INTERNAL_ERR_WRITE_FAILED;
+        }
     }
+    crc_info->entry_crc_dirty_first = key_count;
+    crc_info->entry_crc_dirty_end   = 0;
 
     return KVS_INTERNAL_OK;
 }
@@ -241,20 +368,25 @@ int is_data_region_empty(uint32_t data_offset, size_t data_size)
         return 1;
     }
 
-    uint8_t *buf = calloc(1, data_size);
+    // Читаем регион фрагментами размером с временный буфер, чтобы не выделять память под весь регион
+    uint32_t chunk_size = (data_size < device->superblock.page_size_bytes) ? data_size : device->superblock.page_size_bytes;
+    uint8_t *buf = kvs_scratch_acquire(chunk_size);
     if (!buf) {
         return KVS_INTERNAL_ERR_MALLOC_FAILED;
     }
-    if (kvs_read_region(device->fp, data_offset, buf, data_size) < 0) {
-        free(buf);
-        return KVS_INTERNAL_ERR_READ_FAILED;
-    }
-    for (size_t i = 0; i < data_size; i++) {
-        if (buf[i] != 0xFF) {
-            free(buf);
-            return 0;
+    for (size_t done = 0; done < data_size; done += chunk_size) {
+        uint32_t part = (data_size - done < chunk_size) ? (uint32_t)(data_size - done) : chunk_size;
+        if (kvs_read_region(device->sim, data_offset + done, buf, part) < 0) {
+            kvs_scratch_release(buf);
+            return KVS_INTERNAL_ERR_READ_FAILED;
+        }
+        for (uint32_t i = 0; i < part; i++) {
+            if (buf[i] != 0xFF) {
+                kvs_scratch_release(buf);
+                return 0;
+            }
         }
     }
-    free(buf);
+    kvs_scratch_release(buf);
     return 1;
 }
\ No newline at end of file
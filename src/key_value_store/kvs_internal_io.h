@@ -5,27 +5,32 @@
 #include "kvs_internal.h"
 
 // Считывает данные из региона файла.
-// fp - указатель на открытый файл
+// sim - открытое эмулируемое устройство
 // offset - смещение (в байтах) относительно начала файла, с которого начинается чтение
 // data - указатель на буфер, куда будут считаны данные
 // size - размер данных в байтах
+// Успешное чтение учитывается в device->io_read_ops и device->io_read_bytes.
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-kvs_internal_status kvs_read_region(FILE *fp, uint32_t offset, void *data, uint32_t size);
+kvs_internal_status kvs_read_region(ssdmmc_sim_device *sim, uint32_t offset, void *data, uint32_t size);
 
 // Записывает данные в регион файла.
-// fp - указатель на открытый файл
+// sim - открытое эмулируемое устройство
 // offset - смещение (в байтах) относительно начала файла, с которого начинается запись
 // data - указатель на буфер с данными для записи
 // size - размер данных в байтах
+// Успешная запись учитывается в device->io_write_ops и device->io_write_bytes, а записанные на устройство
+// байты и стертые страницы - в счетчиках текущего пути записи (device->write_path).
+// В строгом режиме NAND страница, которую нельзя запрограммировать поверх, предварительно стирается.
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-kvs_internal_status kvs_write_region(FILE *fp, uint32_t offset, const void *data, uint32_t size);
+kvs_internal_status kvs_write_region(ssdmmc_sim_device *sim, uint32_t offset, const void *data, uint32_t size);
 
 // Очищает регион файла (заполняет 0xFF).
-// fp - указатель на открытый файл
+// sim - открытое эмулируемое устройство
 // offset - смещение (в байтах) относительно начала файла, с которого начинается очистка
 // size - размер региона в байтах
+// Каждая затронутая страница стирается и записывается заново целиком; это учитывается в счетчиках текущего пути записи.
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-kvs_internal_status kvs_clear_region(FILE *fp, uint32_t offset, uint32_t size);
+kvs_internal_status kvs_clear_region(ssdmmc_sim_device *sim, uint32_t offset, uint32_t size);
 
 // Проверяет, что область данных по заданному смещению пуста (заполнена 0xFF).
 // Возвращает 1, если область пуста, 0 — если найдены отличные от 0xFF байты, отрицательное значение — код ошибки.
@@ -0,0 +1,378 @@
+#include "kvs_iter.h"
+#include "kvs_metadata.h"
+#include "kvs_internal_io.h"
+#include "kvs_valid.h"
+#include "kvs_cache.h"
+#include "kvs_snapshot.h"
+
+// Одно чтение пакета: номер записи и смещение на устройстве, по которому упорядочиваются чтения.
+typedef struct {
+    uint32_t item;
+    uint32_t offset;
+} kvs_iter_read;
+
+static int kvs_iter_read_cmp(const void *a, const void *b)
+{
+    const kvs_iter_read *ra = a;
+    const kvs_iter_read *rb = b;
+    return (ra->offset > rb->offset) - (ra->offset < rb->offset);
+}
+
+// Возвращает позицию в key_index, с которой продолжается обход.
+static uint32_t kvs_iter_first_pos(const kvs_iterator *iter)
+{
+    if (iter->last_len > 0) {
+        uint32_t pos = kvs_key_index_lower_bound(iter->last, iter->last_len);
+        if (pos < device->key_count &&
+            kvs_key_compare(device->key_index[pos].key, device->key_index[pos].key_len, iter->last, iter->last_len) == 0) {
+            pos++;
+        }
+        return pos;
+    }
+    if (iter->start_len > 0) {
+        return kvs_key_index_lower_bound(iter->start, iter->start_len);
+    }
+    return 0;
+}
+
+// Проверяет, входит ли ключ в еще не пройденную часть диапазона итератора.
+static bool kvs_iter_key_ahead(const kvs_iterator *iter, const uint8_t *key, uint32_t key_len)
+{
+    if (iter->last_len > 0) {
+        if (kvs_key_compare(key, key_len, iter->last, iter->last_len) <= 0) {
+            return false;
+        }
+    } else if (iter->start_len > 0 && kvs_key_compare(key, key_len, iter->start, iter->start_len) < 0) {
+        return false;
+    }
+    return iter->end_len == 0 || kvs_key_compare(key, key_len, iter->end, iter->end_len) < 0;
+}
+
+// В хеш-раскладке key_index нет, а слоты не упорядочены по ключу. Читает область метаданных
+// по корзинам и отбирает до KVS_ITER_BATCH_KEYS наименьших ключей непройденной части диапазона,
+// текущую запись которых видит обход. Поэтому каждый пакет такого обхода читает все корзины.
+// entries   - массив на KVS_ITER_BATCH_KEYS записей, куда ключи складываются по возрастанию.
+// count_out - количество отобранных ключей.
+static kvs_internal_status kvs_iter_collect_hash(const kvs_iterator *iter, kvs_key_index_entry *entries, uint32_t *count_out)
+{
+    uint32_t total_slots  = device->superblock.max_key_count;
+    uint32_t bucket_slots = device->superblock.hash_bucket_slots;
+    kvs_metadata *bucket = kvs_scratch_acquire(bucket_slots * sizeof(kvs_metadata));
+    if (!bucket) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t first_slot = 0; first_slot < total_slots; first_slot += bucket_slots) {
+        uint32_t slots = (first_slot + bucket_slots <= total_slots) ? bucket_slots : total_slots - first_slot;
+
+        // Корзину без занятых слотов читать не нужно
+        bool occupied = false;
+        for (uint32_t i = 0; i < slots && !occupied; i++) {
+            occupied = get_bit(device->metadata_bitmap, first_slot + i);
+        }
+        if (!occupied) {
+            continue;
+        }
+        uint32_t bucket_offset = device->superblock.metadata_offset + first_slot * sizeof(kvs_metadata);
+        if (kvs_read_region(device->sim, bucket_offset, bucket, slots * sizeof(kvs_metadata)) < 0) {
+            kvs_scratch_release(bucket);
+            return KVS_INTERNAL_ERR_READ_FAILED;
+        }
+
+        for (uint32_t i = 0; i < slots; i++) {
+            uint32_t slot = first_slot + i;
+            const kvs_metadata *md = &bucket[i];
+            if (!get_bit(device->metadata_bitmap, slot) || md->key_len == 0 || md->key_len > KVS_KEY_SIZE) {
+                continue;
+            }
+            // Хвост длинного ключа дочитываем из области данных; ключ, который не удалось прочитать, пропускаем
+            uint8_t full_key[KVS_KEY_SIZE];
+            const uint8_t *key = md->key;
+            if (kvs_key_tail_size(md->key_len) > 0) {
+                if (kvs_metadata_read_key(md, full_key) != KVS_INTERNAL_OK) {
+                    continue;
+                }
+                key = full_key;
+            }
+            if (!kvs_iter_key_ahead(iter, key, md->key_len)) {
+                continue;
+            }
+            if (iter->snapshot && !kvs_snapshot_slot_visible(slot, iter->snapshot_seq)) {
+                continue;
+            }
+            if (count == KVS_ITER_BATCH_KEYS &&
+                kvs_key_compare(key, md->key_len, entries[count - 1].key, entries[count - 1].key_len) >= 0) {
+                continue;
+            }
+
+            // Вставляем ключ на его место; если пакет полон, наибольший ключ из него вытесняется
+            uint32_t at = count < KVS_ITER_BATCH_KEYS ? count : KVS_ITER_BATCH_KEYS - 1;
+            while (at > 0 && kvs_key_compare(entries[at - 1].key, entries[at - 1].key_len, key, md->key_len) > 0) {
+                entries[at] = entries[at - 1];
+                at--;
+            }
+            memcpy(entries[at].key, key, KVS_KEY_SIZE);
+            entries[at].key_len         = md->key_len;
+            entries[at].metadata_offset = bucket_offset + i * sizeof(kvs_metadata);
+            entries[at].flags           = 1;
+            if (count < KVS_ITER_BATCH_KEYS) {
+                count++;
+            }
+        }
+    }
+    kvs_scratch_release(bucket);
+    *count_out = count;
+    return KVS_INTERNAL_OK;
+}
+
+// Возвращает позицию в device->snapshot_versions, с которой продолжается обход снимка.
+static uint32_t kvs_iter_first_version(const kvs_iterator *iter)
+{
+    if (iter->last_len > 0) {
+        uint32_t pos = kvs_snapshot_version_lower_bound(iter->last, iter->last_len);
+        while (pos < device->snapshot_version_count &&
+               kvs_key_compare(device->snapshot_versions[pos].key, device->snapshot_versions[pos].metadata.key_len,
+                               iter->last, iter->last_len) == 0) {
+            pos++;
+        }
+        return pos;
+    }
+    if (iter->start_len > 0) {
+        return kvs_snapshot_version_lower_bound(iter->start, iter->start_len);
+    }
+    return 0;
+}
+
+void kvs_iter_release_batch(kvs_iterator *iter)
+{
+    // Значения лежат в области значений итератора, она остается для следующего пакета
+    for (uint32_t i = 0; i < iter->item_count; i++) {
+        iter->items[i].value = NULL;
+    }
+    iter->item_count = 0;
+    iter->item_next  = 0;
+}
+
+kvs_internal_status kvs_iter_fill(kvs_iterator *iter)
+{
+    // Шаг 1: Проверяем базовые параметры и освобождаем прежний пакет
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (!iter) {
+        return KVS_INTERNAL_ERR_NULL_PARAM;
+    }
+    kvs_iter_release_batch(iter);
+    if (iter->exhausted) {
+        return KVS_INTERNAL_OK;
+    }
+
+    // Шаг 2: Отбираем следующие ключи диапазона в порядке ключей.
+    // Ключи, запись которых не завершена, пропускаем так же, как это делает kvs_get.
+    // Обход снимка сливает key_index с сохраненными версиями и берет ту версию ключа, которую видит снимок
+    const kvs_key_index_entry *entries = NULL;
+    uint32_t entry_count = 0;
+    kvs_key_index_entry hash_entries[KVS_ITER_BATCH_KEYS];
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        kvs_internal_status status = kvs_iter_collect_hash(iter, hash_entries, &entry_count);
+        if (status != KVS_INTERNAL_OK) {
+            return status;
+        }
+        entries = hash_entries;
+    } else {
+        uint32_t first_pos = kvs_iter_first_pos(iter);
+        entries     = device->key_index + first_pos;
+        entry_count = device->key_count - first_pos;
+    }
+
+    uint32_t count = 0;
+    uint32_t pos = 0;
+    uint32_t version_pos = iter->snapshot ? kvs_iter_first_version(iter) : device->snapshot_version_count;
+    while (count < KVS_ITER_BATCH_KEYS) {
+        const kvs_key_index_entry *entry = pos < entry_count ? &entries[pos] : NULL;
+        const kvs_snapshot_version *version = version_pos < device->snapshot_version_count ? &device->snapshot_versions[version_pos] : NULL;
+        if (!entry && !version) {
+            break;
+        }
+        const uint8_t *key = entry ? entry->key : version->key;
+        uint8_t key_len    = entry ? entry->key_len : version->metadata.key_len;
+        if (entry && version && kvs_key_compare(version->key, version->metadata.key_len, key, key_len) < 0) {
+            key     = version->key;
+            key_len = version->metadata.key_len;
+        }
+        if (iter->end_len > 0 && kvs_key_compare(key, key_len, iter->end, iter->end_len) >= 0) {
+            break;
+        }
+
+        uint32_t visible_version = UINT32_MAX;
+        while (version_pos < device->snapshot_version_count &&
+               kvs_key_compare(device->snapshot_versions[version_pos].key, device->snapshot_versions[version_pos].metadata.key_len, key, key_len) == 0) {
+            if (kvs_snapshot_version_visible(&device->snapshot_versions[version_pos], iter->snapshot_seq)) {
+                visible_version = version_pos;
+            }
+            version_pos++;
+        }
+        bool current = false;
+        uint32_t metadata_offset = UINT32_MAX;
+        if (entry && kvs_key_compare(entry->key, entry->key_len, key, key_len) == 0) {
+            metadata_offset = entry->metadata_offset;
+            uint32_t slot_index = (metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+            current = entry->flags != 2 && (!iter->snapshot || kvs_snapshot_slot_visible(slot_index, iter->snapshot_seq));
+            pos++;
+        }
+        if (visible_version == UINT32_MAX && !current) {
+            continue;
+        }
+
+        kvs_iter_item *item = &iter->items[count++];
+        memcpy(item->key, key, KVS_KEY_SIZE);
+        item->key_len         = key_len;
+        item->metadata_offset = metadata_offset;
+        item->version_pos     = visible_version;
+        item->value_size      = 0;
+        item->value           = NULL;
+        item->valid           = false;
+    }
+    iter->mutation_count = device->mutation_count;
+    if (count == 0) {
+        iter->exhausted = true;
+        return KVS_INTERNAL_OK;
+    }
+
+    // Шаг 3: Значения из кеша чтения уже проверены. Метаданные остальных ключей читаем в порядке смещений слотов
+    kvs_metadata metadata[KVS_ITER_BATCH_KEYS];
+    bool metadata_ok[KVS_ITER_BATCH_KEYS] = {false};
+    const kvs_cache_entry *cached_entries[KVS_ITER_BATCH_KEYS] = {NULL};
+    kvs_iter_read reads[KVS_ITER_BATCH_KEYS];
+    uint32_t read_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        kvs_iter_item *item = &iter->items[i];
+        // Метаданные сохраненной версии уже в ОЗУ, данные читаются с их текущего места
+        if (item->version_pos != UINT32_MAX) {
+            const kvs_snapshot_version *version = &device->snapshot_versions[item->version_pos];
+            metadata[i] = version->metadata;
+            metadata[i].value_offset = version->value_offset;
+            metadata_ok[i] = true;
+            item->value_size = version->metadata.value_size;
+            continue;
+        }
+        uint32_t slot_index = (item->metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+        const kvs_cache_entry *cached = kvs_cache_lookup(slot_index);
+        if (cached) {
+            cached_entries[i] = cached;
+            item->value_size = cached->value_size;
+            item->valid = true;
+            continue;
+        }
+        reads[read_count].item   = i;
+        reads[read_count].offset = item->metadata_offset;
+        read_count++;
+    }
+    iter->item_count = count;
+    qsort(reads, read_count, sizeof(kvs_iter_read), kvs_iter_read_cmp);
+    for (uint32_t r = 0; r < read_count; r++) {
+        kvs_iter_item *item = &iter->items[reads[r].item];
+        kvs_metadata *md = &metadata[reads[r].item];
+        if (kvs_read_region(device->sim, item->metadata_offset, md, sizeof(kvs_metadata)) < 0) {
+            return KVS_INTERNAL_ERR_READ_FAILED;
+        }
+        // Слот должен принадлежать именно этому ключу. Хвост длинного ключа сверяется на шаге 6
+        if (md->key_len == item->key_len && memcmp(md->key, item->key, item->key_len - kvs_key_tail_size(item->key_len)) == 0) {
+            metadata_ok[reads[r].item] = true;
+            item->value_size = md->value_size;
+        }
+    }
+
+    // Шаг 4: Ограничиваем пакет по объему значений. Первая запись берется всегда,
+    // отброшенные ключи войдут в следующий пакет
+    uint64_t batch_bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i > 0 && batch_bytes + iter->items[i].value_size > KVS_ITER_BATCH_BYTES) {
+            count = i;
+            break;
+        }
+        batch_bytes += iter->items[i].value_size;
+    }
+    iter->item_count = count;
+
+    // Шаг 5: Размещаем значения пакета в области значений итератора. Значения с устройства читаются
+    // с выравниванием до слова вместе с хвостом длинного ключа.
+    // Область расширяется, только если пакет в нее не помещается
+    uint32_t value_offsets[KVS_ITER_BATCH_KEYS];
+    uint64_t values_size = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        value_offsets[i] = (uint32_t)values_size;
+        if (cached_entries[i]) {
+            values_size += cached_entries[i]->value_size;
+        } else if (metadata_ok[i]) {
+            values_size += kvs_value_is_inline(&metadata[i]) ? metadata[i].value_size : kvs_record_data_size(&metadata[i]);
+        }
+    }
+    if (values_size > iter->values_capacity) {
+        uint64_t capacity = (uint64_t)iter->values_capacity * 2;
+        if (capacity < values_size) {
+            capacity = values_size;
+        }
+        free(iter->values);
+        iter->values_capacity = 0;
+        iter->values = malloc(capacity);
+        if (!iter->values) {
+            iter->item_count = 0;
+            return KVS_INTERNAL_ERR_MALLOC_FAILED;
+        }
+        iter->values_capacity = (uint32_t)capacity;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (cached_entries[i]) {
+            iter->items[i].value = iter->values + value_offsets[i];
+            kvs_cache_copy_value(cached_entries[i], iter->items[i].value);
+        }
+    }
+
+    // Шаг 6: Читаем данные оставшихся ключей в порядке их смещений в области данных.
+    // Значение, хранящееся в слоте, уже прочитано вместе с метаданными
+    read_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (metadata_ok[i]) {
+            reads[read_count].item   = i;
+            reads[read_count].offset = metadata[i].value_offset;
+            read_count++;
+        }
+    }
+    qsort(reads, read_count, sizeof(kvs_iter_read), kvs_iter_read_cmp);
+    for (uint32_t r = 0; r < read_count; r++) {
+        kvs_iter_item *item = &iter->items[reads[r].item];
+        const kvs_metadata *md = &metadata[reads[r].item];
+        bool inline_value = kvs_value_is_inline(md);
+        uint32_t aligned_value_len = kvs_record_data_size(md);
+
+        uint8_t *buffer = iter->values + value_offsets[reads[r].item];
+        if (inline_value) {
+            memcpy(buffer, kvs_inline_value(md), md->value_size);
+        } else if (kvs_read_region(device->sim, md->value_offset, buffer, aligned_value_len) < 0) {
+            return KVS_INTERNAL_ERR_READ_FAILED;
+        }
+        // Слот с теми же первыми байтами ключа мог достаться другому длинному ключу: сверяем хвост
+        uint32_t tail = kvs_key_tail_size(md->key_len);
+        uint32_t tail_offset = align_up(md->value_size, device->superblock.word_size_bytes);
+        if (tail > 0 && memcmp(buffer + tail_offset, item->key + KVS_SLOT_KEY_BYTES, tail) != 0) {
+            continue;
+        }
+
+        // Запись с несовпавшим CRC пропускается, как если бы ключа не было.
+        // В кеш чтения значения не кладем, чтобы однократный обход не вытеснял из него горячие ключи
+        int crc_valid;
+        if (item->version_pos != UINT32_MAX) {
+            crc_valid = kvs_snapshot_version_crc_valid(&device->snapshot_versions[item->version_pos], inline_value ? NULL : buffer, aligned_value_len);
+        } else {
+            uint32_t slot_index = (item->metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+            crc_valid = is_entry_crc_valid(slot_index, md, inline_value ? NULL : buffer, aligned_value_len);
+        }
+        if (crc_valid == 1) {
+            item->value = buffer;
+            item->valid = true;
+        }
+    }
+    return KVS_INTERNAL_OK;
+}
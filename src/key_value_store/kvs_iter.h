@@ -0,0 +1,19 @@
+#ifndef SSDMMCSTORE_KVS_ITER_H
+#define SSDMMCSTORE_KVS_ITER_H
+
+#include "kvs_types.h"
+#include "kvs_internal.h"
+
+
+// Читает следующий пакет итератора: до KVS_ITER_BATCH_KEYS ключей диапазона после iter->last
+// (не больше KVS_ITER_BATCH_BYTES значений). Метаданные и данные читаются в порядке смещений
+// на устройстве, каждая запись сверяется с единым CRC. Прежний пакет освобождается.
+// Итератор снимка берет каждый ключ в той версии, которую видит снимок: текущую запись или сохраненную версию.
+// Если ключей в диапазоне больше нет, пакет остается пустым, а iter->exhausted становится true.
+// Возвращает KVS_INTERNAL_OK при успехе или код ошибки.
+kvs_internal_status kvs_iter_fill(kvs_iterator *iter);
+
+// Делает пакет итератора пустым. Область значений остается за итератором до kvs_iter_close.
+void kvs_iter_release_batch(kvs_iterator *iter);
+
+#endif //SSDMMCSTORE_KVS_ITER_H
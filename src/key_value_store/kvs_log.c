@@ -0,0 +1,328 @@
+#include "kvs_log.h"
+#include <unistd.h>
+#include <errno.h>
+
+// Записи кольца лога. Свободные записи лежат в kvs_log_free, заполненные ждут фонового потока в kvs_log_ready.
+// Кольца создаются при первом запуске потока и не освобождаются до конца процесса.
+static kvs_log_record kvs_log_records[KVS_LOG_RING_SIZE];
+static kvs_ring kvs_log_free;
+static kvs_ring kvs_log_ready;
+static bool kvs_log_rings_created = false;
+
+static atomic_int kvs_log_min_level = KVS_LOG_INFO;
+static atomic_bool kvs_log_running = false;            // Сообщения идут через кольцо
+static atomic_bool kvs_log_stopping = false;           // Фоновый поток дописывает кольцо и завершается
+static atomic_bool kvs_log_writer_sleeping = false;
+static atomic_uint_fast64_t kvs_log_enqueued = 0;      // Сообщений, помещенных в кольцо
+static atomic_uint_fast64_t kvs_log_delivered = 0;     // Из них переданных приемнику
+static atomic_uint_fast64_t kvs_log_written = 0;       // Всего переданных приемнику (вместе с записанными сразу)
+static atomic_uint_fast64_t kvs_log_dropped = 0;
+
+// kvs_log_mutex защищает запуск и остановку потока и его сон, kvs_log_sink_mutex - приемник и запись в него.
+static pthread_mutex_t kvs_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t kvs_log_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t kvs_log_done = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t kvs_log_sink_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t kvs_log_users = 0;
+static pthread_t kvs_log_writer;
+
+static kvs_log_sink kvs_log_sink_config = {KVS_LOG_SINK_FILE, NULL, -1, NULL, NULL};
+static char *kvs_log_path = NULL;                      // Копия пути файла; NULL - KVS_LOG_FILENAME
+static FILE *kvs_log_file = NULL;
+
+// Дата последней записанной секунды: strftime вызывается не чаще раза в секунду.
+static time_t kvs_log_time_second = (time_t)-1;
+static char kvs_log_time_text[32];
+
+static const char *kvs_log_file_path(void)
+{
+    return kvs_log_path ? kvs_log_path : KVS_LOG_FILENAME;
+}
+
+// Пишет len байт в дескриптор, повторяя запись после частичной записи или прерывания сигналом.
+static void kvs_log_write_fd(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+// Передает запись приемнику. Вызывается под kvs_log_sink_mutex.
+static void kvs_log_emit(const kvs_log_record *record)
+{
+    if (kvs_log_sink_config.type == KVS_LOG_SINK_CALLBACK) {
+        kvs_log_sink_config.callback(record->level, record->text, kvs_log_sink_config.user_data);
+        return;
+    }
+
+    if (record->time.tv_sec != kvs_log_time_second) {
+        struct tm local_time;
+        localtime_r(&record->time.tv_sec, &local_time);
+        strftime(kvs_log_time_text, sizeof(kvs_log_time_text), "%Y-%m-%d %H:%M:%S", &local_time);
+        kvs_log_time_second = record->time.tv_sec;
+    }
+    if (kvs_log_sink_config.type == KVS_LOG_SINK_FD) {
+        char line[KVS_LOG_MESSAGE_SIZE + 48];
+        int len = snprintf(line, sizeof(line), "[%s] %s\n", kvs_log_time_text, record->text);
+        kvs_log_write_fd(kvs_log_sink_config.fd, line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+        return;
+    }
+    if (!kvs_log_file && (kvs_log_file = fopen(kvs_log_file_path(), "a")) == NULL) {
+        return;
+    }
+    fprintf(kvs_log_file, "[%s] %s\n", kvs_log_time_text, record->text);
+}
+
+// Фоновый поток лога: забирает записи пакетами, передает их приемнику и возвращает в свободные.
+static void *kvs_log_writer_main(void *arg)
+{
+    (void)arg;
+    kvs_log_record *batch[KVS_LOG_BATCH_MAX];
+    for (;;) {
+        // Шаг 1: Забираем заполненные записи, но не больше одного пакета
+        uint32_t count = 0;
+        while (count < KVS_LOG_BATCH_MAX && (batch[count] = kvs_ring_pop(&kvs_log_ready)) != NULL) {
+            count++;
+        }
+
+        // Шаг 2: Записей нет - засыпаем так же, как рабочий поток асинхронной очереди (см. kvs_async_worker)
+        if (count == 0) {
+            if (atomic_load(&kvs_log_stopping)) {
+                break;
+            }
+            pthread_mutex_lock(&kvs_log_mutex);
+            atomic_store(&kvs_log_writer_sleeping, true);
+            atomic_thread_fence(memory_order_seq_cst);
+            while (kvs_ring_empty(&kvs_log_ready) && !atomic_load(&kvs_log_stopping)) {
+                pthread_cond_wait(&kvs_log_wake, &kvs_log_mutex);
+            }
+            atomic_store(&kvs_log_writer_sleeping, false);
+            pthread_mutex_unlock(&kvs_log_mutex);
+            continue;
+        }
+
+        // Шаг 3: Передаем пакет приемнику одним захватом блокировки и одним сбросом файла
+        pthread_mutex_lock(&kvs_log_sink_mutex);
+        for (uint32_t i = 0; i < count; i++) {
+            kvs_log_emit(batch[i]);
+            kvs_ring_push(&kvs_log_free, batch[i]);
+        }
+        if (kvs_log_file) {
+            fflush(kvs_log_file);
+        }
+        pthread_mutex_unlock(&kvs_log_sink_mutex);
+
+        // Шаг 4: Будим ожидающих в kvs_log_flush
+        pthread_mutex_lock(&kvs_log_mutex);
+        atomic_fetch_add(&kvs_log_written, count);
+        atomic_fetch_add(&kvs_log_delivered, count);
+        pthread_cond_broadcast(&kvs_log_done);
+        pthread_mutex_unlock(&kvs_log_mutex);
+    }
+
+    pthread_mutex_lock(&kvs_log_mutex);
+    pthread_cond_broadcast(&kvs_log_done);
+    pthread_mutex_unlock(&kvs_log_mutex);
+    return NULL;
+}
+
+// Создает кольца лога и заполняет кольцо свободных записей. Вызывается под kvs_log_mutex.
+static bool kvs_log_create_rings(void)
+{
+    if (kvs_log_rings_created) {
+        return true;
+    }
+    if (kvs_ring_create(&kvs_log_free, KVS_LOG_RING_SIZE) != KVS_INTERNAL_OK) {
+        return false;
+    }
+    if (kvs_ring_create(&kvs_log_ready, KVS_LOG_RING_SIZE) != KVS_INTERNAL_OK) {
+        free(kvs_log_free.cells);
+        return false;
+    }
+    for (uint32_t i = 0; i < KVS_LOG_RING_SIZE; i++) {
+        kvs_ring_push(&kvs_log_free, &kvs_log_records[i]);
+    }
+    kvs_log_rings_created = true;
+    return true;
+}
+
+void kvs_log_start(void)
+{
+    pthread_mutex_lock(&kvs_log_mutex);
+    if (kvs_log_users++ == 0 && kvs_log_create_rings()) {
+        atomic_store(&kvs_log_stopping, false);
+        if (pthread_create(&kvs_log_writer, NULL, kvs_log_writer_main, NULL) == 0) {
+            atomic_store(&kvs_log_running, true);
+        }
+    }
+    pthread_mutex_unlock(&kvs_log_mutex);
+}
+
+void kvs_log_stop(void)
+{
+    // Шаг 1: Последний пользователь останавливает поток. Новые сообщения с этого момента пишутся сразу,
+    // а поток перед выходом дописывает все, что уже в кольце
+    pthread_mutex_lock(&kvs_log_mutex);
+    if (kvs_log_users == 0 || --kvs_log_users > 0 || !atomic_load(&kvs_log_running)) {
+        pthread_mutex_unlock(&kvs_log_mutex);
+        return;
+    }
+    atomic_store(&kvs_log_running, false);
+    atomic_store(&kvs_log_stopping, true);
+    pthread_cond_signal(&kvs_log_wake);
+    pthread_mutex_unlock(&kvs_log_mutex);
+    pthread_join(kvs_log_writer, NULL);
+
+    // Шаг 2: Закрываем файл лога до открытия следующего хранилища
+    pthread_mutex_lock(&kvs_log_sink_mutex);
+    if (kvs_log_file) {
+        fclose(kvs_log_file);
+        kvs_log_file = NULL;
+    }
+    pthread_mutex_unlock(&kvs_log_sink_mutex);
+}
+
+// Записывает отформатированное сообщение: в кольцо, пока работает фоновый поток, иначе сразу в приемник.
+static void kvs_log_write(kvs_log_level level, const char *format, va_list args)
+{
+    // Шаг 1: Без фонового потока пишем сразу; файл открывается только на время записи
+    if (!atomic_load(&kvs_log_running)) {
+        kvs_log_record record;
+        record.level = level;
+        clock_gettime(CLOCK_REALTIME, &record.time);
+        vsnprintf(record.text, sizeof(record.text), format, args);
+        pthread_mutex_lock(&kvs_log_sink_mutex);
+        kvs_log_emit(&record);
+        if (kvs_log_file && !atomic_load(&kvs_log_running)) {
+            fclose(kvs_log_file);
+            kvs_log_file = NULL;
+        }
+        pthread_mutex_unlock(&kvs_log_sink_mutex);
+        atomic_fetch_add(&kvs_log_written, 1);
+        return;
+    }
+
+    // Шаг 2: Берем свободную запись. Если кольцо заполнено, сообщение теряется, но вызывающий поток не ждет
+    kvs_log_record *record = kvs_ring_pop(&kvs_log_free);
+    if (!record) {
+        atomic_fetch_add_explicit(&kvs_log_dropped, 1, memory_order_relaxed);
+        return;
+    }
+    record->level = level;
+    clock_gettime(CLOCK_REALTIME, &record->time);
+    vsnprintf(record->text, sizeof(record->text), format, args);
+
+    // Шаг 3: Отдаем запись фоновому потоку и будим его, если он спит. Кольцо заполненных не переполняется:
+    // записей всего столько же, сколько в нем ячеек
+    atomic_fetch_add(&kvs_log_enqueued, 1);
+    kvs_ring_push(&kvs_log_ready, record);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&kvs_log_writer_sleeping)) {
+        pthread_mutex_lock(&kvs_log_mutex);
+        pthread_cond_signal(&kvs_log_wake);
+        pthread_mutex_unlock(&kvs_log_mutex);
+    }
+}
+
+void kvs_log(const char *format, ...)
+{
+    if (atomic_load_explicit(&kvs_log_min_level, memory_order_relaxed) > KVS_LOG_INFO) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    kvs_log_write(KVS_LOG_INFO, format, args);
+    va_end(args);
+}
+
+void kvs_log_at(kvs_log_level level, const char *format, ...)
+{
+    if (level >= KVS_LOG_OFF || (int)level < atomic_load_explicit(&kvs_log_min_level, memory_order_relaxed)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    kvs_log_write(level, format, args);
+    va_end(args);
+}
+
+kvs_status kvs_set_log_level(kvs_log_level level)
+{
+    if (level < KVS_LOG_DEBUG || level > KVS_LOG_OFF) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    atomic_store(&kvs_log_min_level, level);
+    return KVS_SUCCESS;
+}
+
+kvs_status kvs_set_log_sink(const kvs_log_sink *sink)
+{
+    // Шаг 1: Проверяем приемник и копируем путь файла
+    kvs_log_sink config = {KVS_LOG_SINK_FILE, NULL, -1, NULL, NULL};
+    if (sink) {
+        config = *sink;
+    }
+    if ((config.type == KVS_LOG_SINK_FD && config.fd < 0) || (config.type == KVS_LOG_SINK_CALLBACK && !config.callback)
+        || (config.type != KVS_LOG_SINK_FILE && config.type != KVS_LOG_SINK_FD && config.type != KVS_LOG_SINK_CALLBACK)) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    char *path = NULL;
+    FILE *file = NULL;
+    if (config.type == KVS_LOG_SINK_FILE) {
+        if (config.path && (path = strdup(config.path)) == NULL) {
+            return KVS_ERROR_STORAGE_FAILURE;
+        }
+        if ((file = fopen(path ? path : KVS_LOG_FILENAME, "a")) == NULL) {
+            free(path);
+            return KVS_ERROR_STORAGE_FAILURE;
+        }
+    }
+
+    // Шаг 2: Дописываем уже отправленные сообщения в прежний приемник и заменяем его.
+    // Новый файл остается открытым, только пока работает фоновый поток
+    kvs_log_flush();
+    pthread_mutex_lock(&kvs_log_sink_mutex);
+    if (kvs_log_file) {
+        fclose(kvs_log_file);
+        kvs_log_file = NULL;
+    }
+    if (file && !atomic_load(&kvs_log_running)) {
+        fclose(file);
+        file = NULL;
+    }
+    kvs_log_file = file;
+    free(kvs_log_path);
+    kvs_log_path = path;
+    config.path = NULL;
+    kvs_log_sink_config = config;
+    pthread_mutex_unlock(&kvs_log_sink_mutex);
+    return KVS_SUCCESS;
+}
+
+void kvs_log_flush(void)
+{
+    uint64_t target = atomic_load(&kvs_log_enqueued);
+    pthread_mutex_lock(&kvs_log_mutex);
+    while (atomic_load(&kvs_log_delivered) < target && atomic_load(&kvs_log_running)) {
+        pthread_cond_wait(&kvs_log_done, &kvs_log_mutex);
+    }
+    pthread_mutex_unlock(&kvs_log_mutex);
+}
+
+kvs_status kvs_get_log_stats(uint64_t *written, uint64_t *dropped)
+{
+    if (!written || !dropped) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    *written = atomic_load(&kvs_log_written);
+    *dropped = atomic_load(&kvs_log_dropped);
+    return KVS_SUCCESS;
+}
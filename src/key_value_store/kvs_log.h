@@ -0,0 +1,17 @@
+#ifndef SSDMMCSTORE_KVS_LOG_H
+#define SSDMMCSTORE_KVS_LOG_H
+
+#include "kvs_types.h"
+#include "kvs_internal.h"
+
+
+// Запускает фоновый поток лога, если он еще не запущен. Вызывается при открытии каждого хранилища:
+// поток работает, пока открыто хотя бы одно из них, а файл лога все это время остается открытым.
+// Если поток не удалось создать, сообщения пишутся в приемник сразу, как без открытых хранилищ.
+void kvs_log_start(void);
+
+// Парный вызов к kvs_log_start. Последний вызов дописывает все сообщения из кольца,
+// останавливает фоновый поток и закрывает файл лога.
+void kvs_log_stop(void);
+
+#endif //SSDMMCSTORE_KVS_LOG_H
@@ -0,0 +1,238 @@
+#include "kvs_memtable.h"
+#include "kvs_metadata.h"
+
+// Возвращает, сколько байт области данных дополнительно займет операция op при сбросе буфера.
+// Обновление сначала удаляет прежнюю запись ключа: значение не больше прежнего гарантированно
+// поместится на ее место, а большему нужно новое непрерывное место, как и вставке.
+static uint64_t kvs_memtable_data_bytes(uint8_t op, uint32_t key_len, size_t value_size, uint32_t replaced_data_bytes)
+{
+    if (op == KVS_MEMTABLE_DELETE) {
+        return 0;
+    }
+    uint32_t data_bytes = kvs_value_data_size(key_len, value_size);
+    if (op == KVS_MEMTABLE_UPDATE && data_bytes <= replaced_data_bytes) {
+        return 0;
+    }
+    return data_bytes;
+}
+
+// Освобождает значение записи и вычитает ее из занятого объема буфера и из отложенных вставок.
+static void kvs_memtable_release_entry(kvs_memtable_entry *entry)
+{
+    device->memtable_bytes -= entry->key_len + entry->value_size;
+    if (entry->op == KVS_MEMTABLE_PUT) {
+        device->memtable_pending_inserts--;
+    }
+    device->memtable_pending_data_bytes -= kvs_memtable_data_bytes(entry->op, entry->key_len, entry->value_size, entry->replaced_data_bytes);
+    free(entry->value);
+    entry->value      = NULL;
+    entry->value_size = 0;
+}
+
+kvs_internal_status kvs_memtable_create(uint64_t budget_bytes)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (budget_bytes == 0) {
+        return KVS_INTERNAL_ERR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Выделяем массив записей буфера
+    device->memtable = calloc(KVS_MEMTABLE_MAX_ENTRIES, sizeof(kvs_memtable_entry));
+    if (!device->memtable) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    device->memtable_count        = 0;
+    device->memtable_bytes        = 0;
+    device->memtable_budget_bytes = budget_bytes;
+    device->memtable_pending_inserts    = 0;
+    device->memtable_pending_data_bytes = 0;
+    kvs_memtable_sync_free_space();
+    return KVS_INTERNAL_OK;
+}
+
+void kvs_memtable_destroy(void)
+{
+    if (!device || !device->memtable) {
+        return;
+    }
+    for (uint32_t i = 0; i < device->memtable_count; i++) {
+        free(device->memtable[i].value);
+    }
+    free(device->memtable);
+    device->memtable       = NULL;
+    device->memtable_count = 0;
+    device->memtable_bytes = 0;
+    device->memtable_pending_inserts    = 0;
+    device->memtable_pending_data_bytes = 0;
+}
+
+int kvs_memtable_find(const void *key, uint32_t key_len, uint32_t *pos_out)
+{
+    if (!device || !device->memtable || !key) {
+        return 0;
+    }
+
+    // Бинарный поиск; при промахе left указывает на позицию вставки
+    uint32_t left = 0, right = device->memtable_count;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        int n = kvs_key_compare(device->memtable[mid].key, device->memtable[mid].key_len, key, key_len);
+        if (n == 0) {
+            if (pos_out) {
+                *pos_out = mid;
+            }
+            return 1;
+        } else if (n < 0) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+    if (pos_out) {
+        *pos_out = left;
+    }
+    return 0;
+}
+
+kvs_internal_status kvs_memtable_set(const void *key, uint32_t key_len, uint8_t op, const void *value, uint32_t value_size,
+                                     uint32_t replaced_data_bytes)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device || !device->memtable) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (!key || key_len == 0 || key_len > KVS_KEY_SIZE || (op != KVS_MEMTABLE_DELETE && (!value || value_size == 0))) {
+        return KVS_INTERNAL_ERR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Копируем значение до изменения буфера, чтобы при ошибке он остался прежним
+    uint8_t *copy = NULL;
+    if (op != KVS_MEMTABLE_UPDATE) {
+        replaced_data_bytes = 0;
+    }
+    if (op == KVS_MEMTABLE_DELETE) {
+        value_size = 0;
+    } else {
+        copy = malloc(value_size);
+        if (!copy) {
+            return KVS_INTERNAL_ERR_MALLOC_FAILED;
+        }
+        memcpy(copy, value, value_size);
+    }
+
+    // Шаг 3: Ищем ключ. Если его нет, освобождаем место в отсортированном массиве
+    uint32_t pos = 0;
+    kvs_memtable_entry *entry;
+    if (kvs_memtable_find(key, key_len, &pos)) {
+        entry = &device->memtable[pos];
+        kvs_memtable_release_entry(entry);
+    } else {
+        if (device->memtable_count >= KVS_MEMTABLE_MAX_ENTRIES) {
+            free(copy);
+            return KVS_INTERNAL_ERR_KEY_INDEX_FULL;
+        }
+        memmove(&device->memtable[pos + 1], &device->memtable[pos],
+                (device->memtable_count - pos) * sizeof(kvs_memtable_entry));
+        device->memtable_count++;
+        entry = &device->memtable[pos];
+        memset(entry->key, 0, KVS_KEY_SIZE);
+        memcpy(entry->key, key, key_len);
+        entry->key_len = (uint8_t)key_len;
+    }
+
+    // Шаг 4: Заполняем запись
+    entry->op         = op;
+    entry->value      = copy;
+    entry->value_size = value_size;
+    entry->replaced_data_bytes = replaced_data_bytes;
+    device->memtable_bytes += key_len + value_size;
+    if (op == KVS_MEMTABLE_PUT) {
+        device->memtable_pending_inserts++;
+    }
+    device->memtable_pending_data_bytes += kvs_memtable_data_bytes(op, key_len, value_size, replaced_data_bytes);
+    device->mutation_count++;
+    return KVS_INTERNAL_OK;
+}
+
+void kvs_memtable_remove(uint32_t pos)
+{
+    if (!device || !device->memtable || pos >= device->memtable_count) {
+        return;
+    }
+    kvs_memtable_release_entry(&device->memtable[pos]);
+    memmove(&device->memtable[pos], &device->memtable[pos + 1],
+            (device->memtable_count - pos - 1) * sizeof(kvs_memtable_entry));
+    device->memtable_count--;
+    device->mutation_count++;
+}
+
+void kvs_memtable_drop_front(uint32_t count)
+{
+    if (!device || !device->memtable || count == 0) {
+        return;
+    }
+    if (count > device->memtable_count) {
+        count = device->memtable_count;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        kvs_memtable_release_entry(&device->memtable[i]);
+    }
+    memmove(&device->memtable[0], &device->memtable[count],
+            (device->memtable_count - count) * sizeof(kvs_memtable_entry));
+    device->memtable_count -= count;
+}
+
+bool kvs_memtable_full(void)
+{
+    if (!device || !device->memtable) {
+        return false;
+    }
+    return device->memtable_bytes >= device->memtable_budget_bytes
+        || device->memtable_count >= KVS_MEMTABLE_MAX_ENTRIES;
+}
+
+void kvs_memtable_sync_free_space(void)
+{
+    if (!device) {
+        return;
+    }
+    uint32_t total_words = device->superblock.userdata_size_bytes / device->superblock.word_size_bytes;
+    uint64_t free_words = 0;
+    for (uint32_t i = 0; i < total_words; i++) {
+        if (get_bit(device->bitmap, i) == 0) {
+            free_words++;
+        }
+    }
+    device->memtable_free_data_bytes = free_words * device->superblock.word_size_bytes;
+}
+
+bool kvs_memtable_admits(const void *key, uint32_t key_len, uint8_t op, size_t value_len, uint32_t replaced_data_bytes)
+{
+    if (!device || !device->memtable) {
+        return false;
+    }
+
+    // Шаг 1: Новая операция заменит прежнюю операцию ключа в буфере, ее вклад не учитываем
+    uint32_t pending_inserts = device->memtable_pending_inserts;
+    uint64_t pending_data_bytes = device->memtable_pending_data_bytes;
+    uint32_t pos = 0;
+    if (kvs_memtable_find(key, key_len, &pos)) {
+        const kvs_memtable_entry *entry = &device->memtable[pos];
+        if (entry->op == KVS_MEMTABLE_PUT) {
+            pending_inserts--;
+        }
+        pending_data_bytes -= kvs_memtable_data_bytes(entry->op, entry->key_len, entry->value_size, entry->replaced_data_bytes);
+    }
+
+    // Шаг 2: Новому ключу нужен слот метаданных.
+    // Отложенные удаления не учитываются: при сбросе в порядке ключей вставка может примениться раньше них
+    if (op == KVS_MEMTABLE_PUT && device->key_count + pending_inserts >= device->superblock.max_key_count) {
+        return false;
+    }
+
+    // Шаг 3: Значение должно поместиться в область данных вместе со всеми отложенными значениями
+    return pending_data_bytes + kvs_memtable_data_bytes(op, key_len, value_len, replaced_data_bytes) <= device->memtable_free_data_bytes;
+}
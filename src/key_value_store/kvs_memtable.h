@@ -0,0 +1,48 @@
+#ifndef SSDMMCSTORE_KVS_MEMTABLE_H
+#define SSDMMCSTORE_KVS_MEMTABLE_H
+
+#include "kvs_types.h"
+#include "kvs_internal.h"
+
+
+// Создает буфер записи на KVS_MEMTABLE_MAX_ENTRIES операций.
+// budget_bytes - суммарный размер ключей и значений, при достижении которого буфер нужно сбросить.
+// Возвращает KVS_INTERNAL_OK при успехе или код ошибки.
+kvs_internal_status kvs_memtable_create(uint64_t budget_bytes);
+
+// Освобождает все записи буфера и сам буфер. Несброшенные операции теряются.
+void kvs_memtable_destroy(void);
+
+// Ищет ключ длиной key_len байт в буфере бинарным поиском.
+// pos_out - позиция найденной записи или позиция, на которую ключ нужно вставить.
+// Возвращает 1, если ключ найден, и 0 в противном случае.
+int kvs_memtable_find(const void *key, uint32_t key_len, uint32_t *pos_out);
+
+// Записывает в буфер отложенную операцию op над ключом длиной key_len байт, заменяя прежнюю операцию этого ключа.
+// Для KVS_MEMTABLE_DELETE значение не копируется (value может быть NULL).
+// replaced_data_bytes - для KVS_MEMTABLE_UPDATE место в области данных, которое освободит прежняя запись ключа на устройстве.
+// Возвращает KVS_INTERNAL_OK при успехе или код ошибки.
+kvs_internal_status kvs_memtable_set(const void *key, uint32_t key_len, uint8_t op, const void *value, uint32_t value_size,
+                                     uint32_t replaced_data_bytes);
+
+// Удаляет из буфера запись с позицией pos.
+void kvs_memtable_remove(uint32_t pos);
+
+// Удаляет из буфера первые count записей (уже примененные к устройству).
+void kvs_memtable_drop_front(uint32_t count);
+
+// Проверяет, нужно ли сбросить буфер: исчерпан бюджет по байтам или по количеству записей.
+// Возвращает true, если буфер заполнен.
+bool kvs_memtable_full(void);
+
+// Запоминает свободное место области данных. Вызывается после каждого сброса буфера:
+// пока операции ждут в буфере, устройство ими не меняется.
+void kvs_memtable_sync_free_space(void);
+
+// Проверяет, поместится ли на устройство отложенная операция op над ключом со значением длиной value_len
+// вместе со всеми остальными операциями буфера (слоты метаданных и место в области данных).
+// replaced_data_bytes - как в kvs_memtable_set.
+// Возвращает true, если операцию можно принять в буфер.
+bool kvs_memtable_admits(const void *key, uint32_t key_len, uint8_t op, size_t value_len, uint32_t replaced_data_bytes);
+
+#endif //SSDMMCSTORE_KVS_MEMTABLE_H
@@ -1,11 +1,13 @@
 #include "kvs_metadata.h"
 #include "kvs_internal_io.h"
 #include "kvs_valid.h"
+#include "kvs_cache.h"
+#include "kvs_snapshot.h"
+#include "kvs_stats.h"
 
-uint32_t crc32_calc(const void *data, size_t size)
+uint32_t crc32_update(uint32_t crc, const void *data, size_t size)
 {
     const uint8_t *buf = (const uint8_t *)data;
-    uint32_t crc = 0xFFFFFFFF;
 
     for (size_t i = 0; i < size; i++) {
         crc ^= buf[i];
@@ -14,7 +16,12 @@ uint32_t crc32_calc(const void *data, size_t size)
         }
     }
 
-    return ~crc;
+    return crc;
+}
+
+uint32_t crc32_calc(const void *data, size_t size)
+{
+    return ~crc32_update(0xFFFFFFFF, data, size);
 }
 
 kvs_internal_status kvs_update_entry_crc(uint32_t slot_index) {
@@ -27,40 +34,38 @@ kvs_internal_status kvs_update_entry_crc(uint32_t slot_index) {
     // Шаг 2: Читаем с диска метаданные, соответствующие слоту
     kvs_metadata metadata;
     uint32_t metadata_offset = device->superblock.metadata_offset + (slot_index * sizeof(kvs_metadata));
-    if (kvs_read_region(device->fp, metadata_offset, &metadata, sizeof(kvs_metadata)) < 0) {
+    if (kvs_read_region(device->sim, metadata_offset, &metadata, sizeof(kvs_metadata)) < 0) {
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
 
-    // Шаг 3: Выделяем буфер и читаем с диска данные, на которые указывают метаданные
-    uint32_t aligned_value_len = align_up(metadata.value_size, device->superblock.word_size_bytes);
-    uint8_t *value_buffer = calloc(1, aligned_value_len);
-    if (!value_buffer) {
-        return KVS_INTERNAL_ERR_MALLOC_FAILED;
-    }
-    if (kvs_read_region(device->fp, metadata.value_offset, value_buffer, aligned_value_len) < 0) {
-        free(value_buffer);
-        return KVS_INTERNAL_ERR_READ_FAILED;
-    }
-
-    // Шаг 4: Создаем единый буфер, объединяя метаданные и данные
-    size_t total_size = sizeof(kvs_metadata) + aligned_value_len;
-    uint8_t *check_buffer = calloc(1,total_size);
-    if (!check_buffer) {
-        free(value_buffer);
-        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    // Шаг 3: Считаем CRC метаданных. Значение, хранящееся в слоте, в него уже входит
+    uint32_t calculated_crc = crc32_update(0xFFFFFFFF, &metadata, sizeof(kvs_metadata));
+    if (kvs_value_is_inline(&metadata)) {
+        calculated_crc = ~calculated_crc;
+    } else {
+        // Шаг 4: Иначе берем временный буфер, читаем данные, на которые указывают метаданные
+        // (значение и хвост длинного ключа), и продолжаем CRC с одного фрагмента на другой
+        uint32_t aligned_value_len = kvs_record_data_size(&metadata);
+        uint8_t *value_buffer = kvs_scratch_acquire(aligned_value_len);
+        if (!value_buffer) {
+            return KVS_INTERNAL_ERR_MALLOC_FAILED;
+        }
+        if (kvs_read_region(device->sim, metadata.value_offset, value_buffer, aligned_value_len) < 0) {
+            kvs_scratch_release(value_buffer);
+            return KVS_INTERNAL_ERR_READ_FAILED;
+        }
+        calculated_crc = ~crc32_update(calculated_crc, value_buffer, aligned_value_len);
+        kvs_scratch_release(value_buffer);
     }
-    memcpy(check_buffer, &metadata, sizeof(kvs_metadata));
-    memcpy(check_buffer + sizeof(kvs_metadata), value_buffer, aligned_value_len);
 
-    // Шаг 5: Считаем CRC для этого единого буфера
-    uint32_t calculated_crc = crc32_calc(check_buffer, total_size);
-
-    // Шаг 6: Записываем полученный CRC в соответствующую ячейку массива entry_crc в ОЗУ
+    // Шаг 5: Записываем полученный CRC в соответствующую ячейку массива entry_crc в ОЗУ
     device->page_crc.entry_crc[slot_index] = calculated_crc;
-
-    // Шаг 7: Освобождаем всю выделенную память
-    free(value_buffer);
-    free(check_buffer);
+    if (slot_index < device->page_crc.entry_crc_dirty_first) {
+        device->page_crc.entry_crc_dirty_first = slot_index;
+    }
+    if (slot_index >= device->page_crc.entry_crc_dirty_end) {
+        device->page_crc.entry_crc_dirty_end = slot_index + 1;
+    }
 
     return KVS_INTERNAL_OK;
 }
@@ -158,24 +163,30 @@ kvs_internal_status kvs_bitmap_create(void)
     }
     // Шаг 2: Сначала полностью очищаем битовую карту в памяти
     memset(device->bitmap, 0, device->superblock.bitmap_size_bytes);
-    if (device->key_count == 0) {
-        return KVS_INTERNAL_OK;
-    }
-    // Шаг 3: Проходим по всем валидным ключам в key_index
+
+    // Шаг 3: Проходим по всем ключам (в хеш-раскладке - по занятым слотам метаданных)
     kvs_metadata temp;
 
-    for(uint32_t i = 0; i < device->key_count; i++)
+    for(uint32_t i = 0; i < kvs_key_pos_end(); i++)
     {
+        if (!kvs_key_pos_live(i)) {
+            continue;
+        }
         // Для каждого ключа читаем его метаданные, чтобы узнать, где лежат его данные
-        if (kvs_read_region(device->fp, device->key_index[i].metadata_offset, &temp, sizeof(kvs_metadata)) < 0) {
+        if (kvs_read_region(device->sim, kvs_key_metadata_offset(i), &temp, sizeof(kvs_metadata)) < 0) {
             return KVS_INTERNAL_ERR_READ_FAILED;
         }
-        // Помечаем область данных этого ключа как занятую
-        if(bitmap_set_region(temp.value_offset, temp.value_size) < 0) {
+        // Помечаем область данных этого ключа как занятую (значение из слота метаданных ее не занимает).
+        // Слоты хеш-раскладки при загрузке не проверяются, поэтому испорченный слот здесь пропускаем
+        if (kvs_value_is_inline(&temp) || !is_metadata_entry_valid(&temp)) {
+            continue;
+        }
+        if(bitmap_set_region(temp.value_offset, kvs_record_data_size(&temp)) < 0) {
             return KVS_INTERNAL_ERR_WRITE_FAILED;
         }
     }
-    return KVS_INTERNAL_OK;
+    // Шаг 4: Данные версий, которые видят открытые снимки, тоже заняты, хотя их ключей в key_index уже нет
+    return kvs_snapshot_mark_extents();
 }
 
 kvs_internal_status build_key_index(void) {
@@ -187,6 +198,15 @@ kvs_internal_status build_key_index(void) {
     // Шаг 2: Обнуляем текущее значение ключей перед построением
     device->key_count = 0;
 
+    // В хеш-раскладке key_index в ОЗУ не строится: ключи находятся по корзинам на устройстве,
+    // а их количество берется из биткарты метаданных без чтения слотов
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        for (uint32_t i = 0; i < device->superblock.max_key_count; i++) {
+            device->key_count += get_bit(device->metadata_bitmap, i);
+        }
+        return KVS_INTERNAL_OK;
+    }
+
     // Шаг 3: Проходим по всем возможным слотам метаданных
     kvs_metadata temp;
     for (uint32_t i = 0; i < device->superblock.max_key_count; i++) {
@@ -198,7 +218,7 @@ kvs_internal_status build_key_index(void) {
 
         // Если бит установлен, читаем слот с диска
         uint32_t current_position = device->superblock.metadata_offset + (i * sizeof(kvs_metadata));
-        if (kvs_read_region(device->fp, current_position, &temp, sizeof(temp)) < 0) {
+        if (kvs_read_region(device->sim, current_position, &temp, sizeof(temp)) < 0) {
             return KVS_INTERNAL_ERR_READ_FAILED;
         }
 
@@ -213,13 +233,234 @@ kvs_internal_status build_key_index(void) {
     if (device->key_count > 0) {
         qsort(device->key_index, device->key_count, sizeof(kvs_key_index_entry), kvs_key_index_entry_cmp);
     }
+
+    // Шаг 5: Позиции ключей изменились, пересобираем обратное отображение слотов
+    kvs_slot_map_rebuild();
     return KVS_INTERNAL_OK;
 }
 
 int kvs_key_index_entry_cmp(const void *a, const void *b) {
     const kvs_key_index_entry *temp_a = a;
     const kvs_key_index_entry *temp_b = b;
-    return memcmp(temp_a->key, temp_b->key, KVS_KEY_SIZE);
+    return kvs_key_compare(temp_a->key, temp_a->key_len, temp_b->key, temp_b->key_len);
+}
+
+kvs_internal_status kvs_metadata_read_key(const kvs_metadata *metadata, uint8_t *key_out)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (!metadata || !key_out) {
+        return KVS_INTERNAL_ERR_NULL_PARAM;
+    }
+    if (metadata->key_len == 0 || metadata->key_len > KVS_KEY_SIZE) {
+        return KVS_INTERNAL_ERR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Первые байты ключа хранятся в слоте
+    uint32_t tail = kvs_key_tail_size(metadata->key_len);
+    memset(key_out, 0, KVS_KEY_SIZE);
+    memcpy(key_out, metadata->key, metadata->key_len - tail);
+    if (tail == 0) {
+        return KVS_INTERNAL_OK;
+    }
+
+    // Шаг 3: Хвост длинного ключа дочитываем из области данных, где он лежит сразу за выровненным значением
+    uint32_t word_size = device->superblock.word_size_bytes;
+    uint32_t aligned_tail = align_up(tail, word_size);
+    uint8_t *tail_buffer = kvs_scratch_acquire(aligned_tail);
+    if (!tail_buffer) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    uint32_t tail_offset = metadata->value_offset + align_up(metadata->value_size, word_size);
+    if (kvs_read_region(device->sim, tail_offset, tail_buffer, aligned_tail) < 0) {
+        kvs_scratch_release(tail_buffer);
+        return KVS_INTERNAL_ERR_READ_FAILED;
+    }
+    memcpy(key_out + KVS_SLOT_KEY_BYTES, tail_buffer, tail);
+    kvs_scratch_release(tail_buffer);
+    return KVS_INTERNAL_OK;
+}
+
+int kvs_metadata_key_equals(const kvs_metadata *metadata, const void *key, uint32_t key_len)
+{
+    // Длина и байты в слоте отсекают почти все несовпадения без чтения области данных
+    uint32_t tail = kvs_key_tail_size(key_len);
+    if (metadata->key_len != key_len || memcmp(metadata->key, key, key_len - tail) != 0) {
+        return 0;
+    }
+    if (tail == 0) {
+        return 1;
+    }
+    uint8_t full_key[KVS_KEY_SIZE];
+    kvs_internal_status status = kvs_metadata_read_key(metadata, full_key);
+    if (status != KVS_INTERNAL_OK) {
+        return status;
+    }
+    return memcmp(full_key + KVS_SLOT_KEY_BYTES, (const uint8_t *)key + KVS_SLOT_KEY_BYTES, tail) == 0 ? 1 : 0;
+}
+
+int kvs_key_index_find(const void *key, uint32_t key_len, uint32_t *pos_out)
+{
+    if (!device || !key || device->key_count == 0) {
+        return 0;
+    }
+
+    uint32_t left = 0, right = device->key_count - 1;
+    while (left <= right) {
+        uint32_t mid = left + (right - left) / 2;
+        int n = kvs_key_compare(device->key_index[mid].key, device->key_index[mid].key_len, key, key_len);
+        if (n == 0) {
+            if (pos_out) {
+                *pos_out = mid;
+            }
+            return 1;
+        } else if (n < 0) {
+            left = mid + 1;
+        } else {
+            if (mid == 0) {
+                break;
+            }
+            right = mid - 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t kvs_key_index_lower_bound(const void *key, uint32_t key_len)
+{
+    uint32_t left = 0, right = device->key_count;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        if (kvs_key_compare(device->key_index[mid].key, device->key_index[mid].key_len, key, key_len) < 0) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+    return left;
+}
+
+// Переводит смещение метаданных в номер слота.
+static uint32_t kvs_metadata_slot_of(uint32_t metadata_offset)
+{
+    return (metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+}
+
+// Обновляет обратное отображение для позиций key_index начиная с first_pos.
+static void kvs_slot_map_update_from(uint32_t first_pos)
+{
+    for (uint32_t i = first_pos; i < device->key_count; i++) {
+        device->slot_to_index[kvs_metadata_slot_of(device->key_index[i].metadata_offset)] = i;
+    }
+}
+
+void kvs_slot_map_rebuild(void)
+{
+    if (!device || !device->slot_to_index) {
+        return;
+    }
+    memset(device->slot_to_index, 0xFF, device->superblock.max_key_count * sizeof(uint32_t));
+    kvs_slot_map_update_from(0);
+}
+
+uint32_t kvs_slot_to_index(uint32_t slot_index)
+{
+    if (!device || slot_index >= device->superblock.max_key_count) {
+        return UINT32_MAX;
+    }
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        return get_bit(device->metadata_bitmap, slot_index) ? slot_index : UINT32_MAX;
+    }
+    if (!device->slot_to_index) {
+        return UINT32_MAX;
+    }
+    return device->slot_to_index[slot_index];
+}
+
+uint32_t kvs_key_pos_end(void)
+{
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        return device->superblock.max_key_count;
+    }
+    return device->key_count;
+}
+
+bool kvs_key_pos_live(uint32_t pos)
+{
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        return pos < device->superblock.max_key_count && get_bit(device->metadata_bitmap, pos);
+    }
+    return pos < device->key_count;
+}
+
+uint32_t kvs_key_metadata_offset(uint32_t pos)
+{
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        return device->superblock.metadata_offset + pos * sizeof(kvs_metadata);
+    }
+    return device->key_index[pos].metadata_offset;
+}
+
+kvs_internal_status kvs_key_index_insert(const kvs_key_index_entry *entry, uint32_t *pos_out)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (!entry) {
+        return KVS_INTERNAL_ERR_NULL_PARAM;
+    }
+    if (device->key_count >= device->superblock.max_key_count) {
+        return KVS_INTERNAL_ERR_KEY_INDEX_FULL;
+    }
+
+    // В хеш-раскладке key_index нет: позиция ключа - номер его слота, учитывается только количество ключей
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        device->key_count++;
+        if (pos_out) {
+            *pos_out = kvs_metadata_slot_of(entry->metadata_offset);
+        }
+        return KVS_INTERNAL_OK;
+    }
+
+    // Шаг 2: Бинарным поиском находим первую позицию, ключ на которой не меньше вставляемого
+    uint32_t left = kvs_key_index_lower_bound(entry->key, entry->key_len);
+
+    // Шаг 3: Сдвигаем хвост и вставляем запись, вместо полной пересортировки индекса
+    memmove(&device->key_index[left + 1], &device->key_index[left], (device->key_count - left) * sizeof(kvs_key_index_entry));
+    device->key_index[left] = *entry;
+    device->key_count++;
+
+    // Шаг 4: Позиции сдвинутых записей изменились, обновляем их в обратном отображении
+    kvs_slot_map_update_from(left);
+
+    if (pos_out) {
+        *pos_out = left;
+    }
+    return KVS_INTERNAL_OK;
+}
+
+void kvs_key_index_remove(uint32_t pos)
+{
+    if (!device) {
+        return;
+    }
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        if (device->key_count > 0) {
+            device->key_count--;
+        }
+        return;
+    }
+    if (pos >= device->key_count) {
+        return;
+    }
+
+    device->slot_to_index[kvs_metadata_slot_of(device->key_index[pos].metadata_offset)] = UINT32_MAX;
+    memmove(&device->key_index[pos], &device->key_index[pos + 1], (device->key_count - pos - 1) * sizeof(kvs_key_index_entry));
+    device->key_count--;
+    kvs_slot_map_update_from(pos);
 }
 
 int get_bit(const uint8_t *bitmap, uint32_t bit)
@@ -227,13 +468,42 @@ int get_bit(const uint8_t *bitmap, uint32_t bit)
     return (bitmap[bit / 8] >> (bit % 8)) & 1;
 }
 
-uint32_t kvs_find_free_data_offset(uint32_t value_len)
+int kvs_data_temperature(uint32_t update_count)
+{
+    if (!device) {
+        return KVS_DATA_COLD;
+    }
+    return update_count >= device->hot_update_threshold ? KVS_DATA_HOT : KVS_DATA_COLD;
+}
+
+// Политика чередования: возвращает слово, с которого начнется следующий поиск места после блока,
+// заканчивающегося словом last_word, - первое слово ближайшей следующей страницы другого кристалла.
+// Соседние выделения попадают на разные кристаллы и могут программироваться одновременно.
+static uint32_t kvs_stripe_next_word(uint32_t last_word)
+{
+    uint32_t word_size = device->superblock.word_size_bytes;
+    uint32_t page_size = device->superblock.page_size_bytes;
+    uint32_t page = (device->superblock.data_offset + last_word * word_size) / page_size;
+    uint32_t die  = ssdmmc_sim_get_page_die(page);
+    uint32_t next = page + 1;
+    for (uint32_t n = 0; n < ssdmmc_sim_get_die_count() && ssdmmc_sim_get_page_die(next) == die; n++) {
+        next++;
+    }
+    // Слово за концом области данных поиск воспринимает как начало новой карусели
+    return (next * page_size - device->superblock.data_offset) / word_size;
+}
+
+uint32_t kvs_find_free_data_offset(uint32_t value_len, int temperature)
 {
     // Выполняем базовую проверку
     if (!device) {
         return UINT32_MAX;
     }
 
+    // У горячих и холодных данных свои карусели, поэтому они заполняют разные открытые области
+    uint32_t *last_checked = (temperature == KVS_DATA_HOT) ? &device->superblock.last_hot_data_word_checked
+                                                           : &device->superblock.last_data_word_checked;
+
     // Рассчитываем то количество слов, которое нам нужно выделить
     uint32_t word_size = device->superblock.word_size_bytes;
     uint32_t total_words = device->superblock.userdata_size_bytes / word_size;
@@ -244,8 +514,11 @@ uint32_t kvs_find_free_data_offset(uint32_t value_len)
     }
 
     // Будем делать два прохода, для реализации метода выравнивания путем карусели
-    uint32_t start_scan_idx = device->superblock.last_data_word_checked;
+    uint32_t start_scan_idx = *last_checked;
     uint32_t run_length = 0;
+    if (start_scan_idx >= total_words) {
+        start_scan_idx = 0;
+    }
 
     // Проход 1: От последнего найденного места до конца
     for (uint32_t i = start_scan_idx; i < total_words;i++) {
@@ -258,7 +531,7 @@ uint32_t kvs_find_free_data_offset(uint32_t value_len)
 
         if (run_length >= words_needed) {
             uint32_t block_start_idx = i - (words_needed - 1);
-            device->superblock.last_data_word_checked = i;
+            *last_checked = device->stripe_allocations ? kvs_stripe_next_word(i) : i;
             return device->superblock.data_offset + block_start_idx * word_size;
         }
     }
@@ -274,7 +547,7 @@ uint32_t kvs_find_free_data_offset(uint32_t value_len)
             }
             if (run_length >= words_needed) {
                 uint32_t block_start_idx = i - (words_needed - 1);
-                device->superblock.last_data_word_checked = i;
+                *last_checked = device->stripe_allocations ? kvs_stripe_next_word(i) : i;
                 return device->superblock.data_offset + block_start_idx * word_size;
             }
         }
@@ -284,13 +557,154 @@ uint32_t kvs_find_free_data_offset(uint32_t value_len)
     return UINT32_MAX;
 }
 
-uint32_t kvs_find_free_metadata_offset(void)
+uint32_t kvs_key_hash(const void *key, uint32_t key_len)
+{
+    const uint8_t *p = (const uint8_t *)key;
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < key_len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Ищет свободный слот для ключа в хеш-раскладке: корзины перебираются линейно, начиная с домашней.
+// Внутри корзины поиск начинается со слота, следующего за последним выделенным,
+// чтобы повторные записи одного ключа не изнашивали один и тот же слот.
+// Возвращает смещение найденного слота или UINT32_MAX, если места нет.
+static uint32_t kvs_hash_find_free_offset(const void *key, uint32_t key_len)
+{
+    if (!key) {
+        return UINT32_MAX;
+    }
+
+    uint32_t bucket_count = device->superblock.hash_bucket_count;
+    uint32_t bucket_slots = device->superblock.hash_bucket_slots;
+    uint32_t home   = kvs_key_hash(key, key_len) % bucket_count;
+    uint32_t rotate = (device->superblock.last_metadata_slot_checked + 1) % bucket_slots;
+
+    for (uint32_t distance = 0; distance < bucket_count; distance++) {
+        uint32_t first_slot = ((home + distance) % bucket_count) * bucket_slots;
+        for (uint32_t i = 0; i < bucket_slots; i++) {
+            uint32_t current_slot = first_slot + (rotate + i) % bucket_slots;
+            if (get_bit(device->metadata_bitmap, current_slot)) {
+                continue;
+            }
+
+            // Запоминаем наибольшее удаление от домашней корзины: дальше него поиск ключа не заходит
+            if (distance > device->superblock.hash_max_probe) {
+                device->superblock.hash_max_probe = distance;
+            }
+            device->superblock.last_metadata_slot_checked = current_slot;
+            return device->superblock.metadata_offset + (current_slot * sizeof(kvs_metadata));
+        }
+    }
+    return UINT32_MAX;
+}
+
+int kvs_hash_lookup(const void *key, uint32_t key_len, uint32_t *slot_out)
+{
+    // Шаг 1: Делаем базовую проверку
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (!key || !slot_out) {
+        return KVS_INTERNAL_ERR_NULL_PARAM;
+    }
+    if (device->superblock.metadata_layout != KVS_LAYOUT_HASH) {
+        return KVS_INTERNAL_ERR_INVALID_PARAM;
+    }
+
+    // Шаг 2: Готовим буфер под одну корзину слотов
+    uint32_t bucket_count = device->superblock.hash_bucket_count;
+    uint32_t bucket_slots = device->superblock.hash_bucket_slots;
+    uint32_t bucket_bytes = bucket_slots * sizeof(kvs_metadata);
+    uint32_t home = kvs_key_hash(key, key_len) % bucket_count;
+    uint32_t max_distance = device->superblock.hash_max_probe;
+    if (max_distance >= bucket_count) {
+        max_distance = bucket_count - 1;
+    }
+    kvs_metadata *bucket = kvs_scratch_acquire(bucket_bytes);
+    if (!bucket) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    device->hash_lookups++;
+
+    // Шаг 3: Читаем корзины от домашней до наибольшего удаления, с которым когда-либо размещался ключ.
+    // Удаление стирает слот, поэтому пустой слот не означает конец цепочки
+    int result = 0;
+    for (uint32_t distance = 0; distance <= max_distance && result == 0; distance++) {
+        uint32_t first_slot = ((home + distance) % bucket_count) * bucket_slots;
+
+        // Корзину без занятых слотов читать не нужно
+        bool occupied = false;
+        for (uint32_t i = 0; i < bucket_slots && !occupied; i++) {
+            occupied = get_bit(device->metadata_bitmap, first_slot + i);
+        }
+        if (!occupied) {
+            continue;
+        }
+
+        uint32_t bucket_offset = device->superblock.metadata_offset + first_slot * sizeof(kvs_metadata);
+        if (kvs_read_region(device->sim, bucket_offset, bucket, bucket_bytes) < 0) {
+            result = KVS_INTERNAL_ERR_READ_FAILED;
+            break;
+        }
+        device->hash_bucket_reads++;
+
+        for (uint32_t i = 0; i < bucket_slots; i++) {
+            if (!get_bit(device->metadata_bitmap, first_slot + i)) {
+                continue;
+            }
+            int equal = kvs_metadata_key_equals(&bucket[i], key, key_len);
+            if (equal != 0) {
+                if (equal == 1) {
+                    *slot_out = first_slot + i;
+                }
+                result = equal;
+                break;
+            }
+        }
+    }
+
+    kvs_scratch_release(bucket);
+    return result;
+}
+
+int kvs_key_locate(const void *key, uint32_t key_len, uint32_t *pos_out)
+{
+    if (!device || !key || device->key_count == 0) {
+        return 0;
+    }
+
+    // В линейной раскладке ключ ищется бинарным поиском по key_index
+    if (device->superblock.metadata_layout != KVS_LAYOUT_HASH) {
+        return kvs_key_index_find(key, key_len, pos_out);
+    }
+
+    // В хеш-раскладке слот находится чтением корзины с устройства, он же и есть позиция ключа
+    uint32_t slot = 0;
+    if (kvs_hash_lookup(key, key_len, &slot) != 1) {
+        return 0;
+    }
+    if (pos_out) {
+        *pos_out = slot;
+    }
+    return 1;
+}
+
+uint32_t kvs_find_free_metadata_offset(const void *key, uint32_t key_len)
 {
     // Делаем базовую проверку
     if (!device) {
         return UINT32_MAX;
     }
 
+    // В хеш-раскладке слот определяется ключом
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        return kvs_hash_find_free_offset(key, key_len);
+    }
+
     uint32_t total_slots = device->superblock.max_key_count;
 
     // Начинаем поиск с последнего выделенного слота
@@ -313,12 +727,9 @@ uint32_t kvs_find_free_metadata_offset(void)
     return UINT32_MAX;
 }
 
-kvs_internal_status kvs_persist_all_service_data(void)
+// Пересчитывает CRC и записывает все служебные области на устройство.
+static kvs_internal_status kvs_write_service_areas(void)
 {
-    // Делаем базовую проверку
-    if (!device) {
-        return KVS_INTERNAL_ERR_NULL_DEVICE;
-    }
 
     // Шаг 1: Пересчитываем CRC для всех служебных областей перед записью
     device->page_crc.superblock_crc        = crc32_calc(&device->superblock, sizeof(kvs_superblock));
@@ -329,19 +740,19 @@ kvs_internal_status kvs_persist_all_service_data(void)
     device->page_crc.rewrite_crc           = crc32_calc(device->page_rewrite_count, rewrite_size);
 
     // Шаг 2: Последовательно записываем каждую служебную область
-    if (kvs_write_region(device->fp, 0, &device->superblock, sizeof(kvs_superblock)) < 0) {
+    if (kvs_write_region(device->sim, 0, &device->superblock, sizeof(kvs_superblock)) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
-    if (kvs_write_region(device->fp, device->superblock.superblock_backup_offset, &device->superblock, sizeof(kvs_superblock)) < 0) {
+    if (kvs_write_region(device->sim, device->superblock.superblock_backup_offset, &device->superblock, sizeof(kvs_superblock)) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
-    if (kvs_write_region(device->fp, device->superblock.bitmap_offset, device->bitmap, device->superblock.bitmap_size_bytes) < 0) {
+    if (kvs_write_region(device->sim, device->superblock.bitmap_offset, device->bitmap, device->superblock.bitmap_size_bytes) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
-    if (kvs_write_region(device->fp, device->superblock.metadata_bitmap_offset, device->metadata_bitmap, device->superblock.metadata_bitmap_size_bytes) < 0) {
+    if (kvs_write_region(device->sim, device->superblock.metadata_bitmap_offset, device->metadata_bitmap, device->superblock.metadata_bitmap_size_bytes) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
-    if (kvs_write_region(device->fp, device->superblock.page_rewrite_offset, device->page_rewrite_count, rewrite_size) < 0) {
+    if (kvs_write_region(device->sim, device->superblock.page_rewrite_offset, device->page_rewrite_count, rewrite_size) < 0) {
         return KVS_INTERNAL_ERR_WRITE_FAILED;
     }
 
@@ -351,10 +762,26 @@ kvs_internal_status kvs_persist_all_service_data(void)
     }
 
     // Шаг 4: Принудительно сбрасываем буферы файла на диск
-    fflush(device->fp);
+    ssdmmc_sim_sync(device->sim);
     return KVS_INTERNAL_OK;
 }
 
+kvs_internal_status kvs_persist_all_service_data(void)
+{
+    // Делаем базовую проверку
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+
+    uint64_t start_ns = kvs_stats_now_ns();
+    device->persist_count++;
+    kvs_write_path previous_path = kvs_set_write_path(KVS_WRITE_PATH_PERSIST);
+    kvs_internal_status status = kvs_write_service_areas();
+    kvs_set_write_path(previous_path);
+    kvs_latency_record(KVS_LATENCY_PERSIST, start_ns);
+    return status;
+}
+
 kvs_internal_status bitmap_set_metadata_slot(uint32_t slot_index)
 {
     if (!device || slot_index >= device->superblock.max_key_count) {
@@ -404,9 +831,13 @@ kvs_internal_status kvs_add_metadata_entry(const kvs_metadata *new_metadata, uin
         return KVS_INTERNAL_ERR_KEY_INDEX_FULL;
     }
 
-    // Добавляем метаданные в key_index
+    // Добавляем метаданные в key_index. Хвост длинного ключа дочитывается из области данных
     kvs_key_index_entry temp;
-    memcpy(temp.key, new_metadata->key, KVS_KEY_SIZE);
+    kvs_internal_status status = kvs_metadata_read_key(new_metadata, temp.key);
+    if (status != KVS_INTERNAL_OK) {
+        return status;
+    }
+    temp.key_len = new_metadata->key_len;
     temp.metadata_offset = pos;
     temp.flags = 1;
     device->key_index[device->key_count++] = temp;
@@ -441,8 +872,9 @@ uint32_t kvs_find_victim_page(int clean_mod, const uint8_t *valid_bitmap, uint32
         real_usage_bitmap     = device->metadata_bitmap;
         word_size             = sizeof(kvs_metadata);
         words_per_page        = device->superblock.page_size_bytes / word_size;
-        page_count            = (device->superblock.metadata_size_bytes + device->superblock.page_size_bytes - 1) / device->superblock.page_size_bytes;
         total_words_in_area   = device->superblock.max_key_count;
+        // Размер области считаем по числу слотов: 16-битное поле metadata_size_bytes переполняется на больших областях
+        page_count            = (total_words_in_area + words_per_page - 1) / words_per_page;
         last_checked_word_ptr = &device->superblock.last_metadata_slot_checked;
     } else {
         return UINT32_MAX;
@@ -506,294 +938,406 @@ uint32_t kvs_find_victim_page(int clean_mod, const uint8_t *valid_bitmap, uint32
     return victim_page_local;
 }
 
-uint32_t kvs_gc(int clean_mod){
-
-    // Шаг 1: Проверяем базовые параметры
-    if(!device)
+// Собирает мусор в области пользовательских данных.
+// Выбирает набор страниц-жертв, достаточный для ожидающего выделения bytes_needed,
+// эвакуирует все их живые данные одной последовательной записью и стирает страницы подряд.
+static uint32_t kvs_gc_data(uint32_t bytes_needed)
+{
+    uint32_t page_size   = device->superblock.page_size_bytes;
+    uint32_t word_size   = device->superblock.word_size_bytes;
+    uint32_t data_start  = device->superblock.data_offset;
+    uint32_t data_end    = device->superblock.data_offset + device->superblock.userdata_size_bytes;
+    uint32_t bitmap_size = device->superblock.bitmap_size_bytes;
+
+    // Шаг 2: Один раз проверяем все ключи и запоминаем расположение живых данных
+    uint8_t *valid_bitmap = calloc(1, bitmap_size);
+    gc_item *live_items   = calloc(device->key_count + device->snapshot_version_count + 1, sizeof(gc_item));
+    if (!valid_bitmap || !live_items) {
+        kvs_log_at(KVS_LOG_ERROR, "GC Ошибка: не удалось выделить память для valid_bitmap.");
+        free(valid_bitmap);
+        free(live_items);
         return 0;
+    }
 
-    if (clean_mod == CLEAN_DATA){
-
-        // Шаг 2: Анализ и поиск страницы-жертвы.
-        uint32_t bitmap_size = device->superblock.bitmap_size_bytes;
-        uint8_t *valid_bitmap = calloc(1,bitmap_size);
-        if (!valid_bitmap) {
-            kvs_log("GC Ошибка: не удалось выделить память для valid_bitmap.");
-            return 0;
-        }
+    uint32_t live_count = 0;
+    for (uint32_t i = 0; i < kvs_key_pos_end(); i++) {
+        if (!kvs_key_pos_live(i) || is_key_valid(i) != 1)
+            continue;
+        kvs_metadata temp;
+        if (kvs_read_region(device->sim, kvs_key_metadata_offset(i), &temp, sizeof(kvs_metadata)) < 0)
+            continue;
+        // Значение в слоте метаданных не лежит в области данных и не переносится
+        if (kvs_value_is_inline(&temp))
+            continue;
 
-        // Проходим по всем ключам в кеше и отмечаем их данные во временной биткарте
-        for( int i = 0; i < device->key_count; i++ ) {
-            if(is_key_valid(i) == 1){
-                kvs_metadata temp;
-                if(kvs_read_region(device->fp, device->key_index[i].metadata_offset, &temp, sizeof(kvs_metadata)) < 0) continue;
-
-                uint32_t word_size  = device->superblock.word_size_bytes;
-                uint32_t start_word = (temp.value_offset - device->superblock.data_offset) / word_size;
-                uint32_t num_words  = align_up(temp.value_size, word_size) / word_size;
-                for (uint32_t k = 0; k < num_words; k++) {
-                    uint32_t current_word_index = start_word + k;
-                    if ((current_word_index / 8) >= bitmap_size) continue;
-                    uint32_t byte_index = current_word_index / 8;
-                    uint8_t  bit_index  = current_word_index % 8;
-                    valid_bitmap[byte_index] |= (1 << bit_index);
-                }
-            }
+        gc_item *item = &live_items[live_count++];
+        item->key_index_pos      = i;
+        item->metadata_offset    = kvs_key_metadata_offset(i);
+        item->old_value_offset   = temp.value_offset;
+        item->value_size         = temp.value_size;
+        item->aligned_value_size = kvs_record_data_size(&temp);
+        item->update_count       = temp.update_count;
+
+        // Отмечаем данные ключа во временной биткарте живых слов
+        uint32_t start_word = (temp.value_offset - data_start) / word_size;
+        uint32_t num_words  = item->aligned_value_size / word_size;
+        for (uint32_t k = 0; k < num_words; k++) {
+            uint32_t current_word_index = start_word + k;
+            if ((current_word_index / 8) >= bitmap_size) continue;
+            valid_bitmap[current_word_index / 8] |= (1 << (current_word_index % 8));
         }
+    }
 
-        // Находим локальный индекс страницы с наибольшим количеством мусора
-        uint32_t live_data_on_page = 0;
-        uint32_t victim_page_local = kvs_find_victim_page(CLEAN_DATA, valid_bitmap, bitmap_size, &live_data_on_page);
-        free(valid_bitmap);
+    // Данные версий, которые видят открытые снимки, живые до освобождения снимков и переносятся вместе с ключами
+    for (uint32_t i = 0; i < device->snapshot_version_count; i++) {
+        const kvs_snapshot_version *version = &device->snapshot_versions[i];
+        if (kvs_value_is_inline(&version->metadata))
+            continue;
 
-        if(victim_page_local == UINT32_MAX){
-            kvs_log("GC: Не найдено подходящих для очистки страниц данных.");
-            return 0;
+        gc_item *item = &live_items[live_count++];
+        item->key_index_pos      = i;
+        item->metadata_offset    = UINT32_MAX;
+        item->old_value_offset   = version->value_offset;
+        item->value_size         = version->metadata.value_size;
+        item->aligned_value_size = kvs_record_data_size(&version->metadata);
+        item->update_count       = version->metadata.update_count;
+
+        uint32_t start_word = (version->value_offset - data_start) / word_size;
+        uint32_t num_words  = item->aligned_value_size / word_size;
+        for (uint32_t k = 0; k < num_words; k++) {
+            uint32_t current_word_index = start_word + k;
+            if ((current_word_index / 8) >= bitmap_size) continue;
+            valid_bitmap[current_word_index / 8] |= (1 << (current_word_index % 8));
         }
+    }
 
-        // Шаг 3: Точное определение границ и проверка наложения
-        uint32_t page_size = device->superblock.page_size_bytes;
-
-        // Вычисляем абсолютное смещение начала нашей локальной страницы-жертвы.
-        uint32_t victim_region_start = device->superblock.data_offset + (victim_page_local * page_size);
-
-        // Теперь вычисляем глобальный номер страницы, в которую попадает это смещение.
-        uint32_t victim_page_global = victim_region_start / page_size;
+    // Шаг 3: Подбираем набор страниц-жертв, пока освобождаемого места не хватит для ожидающего выделения
+    uint32_t victims[KVS_GC_MAX_VICTIM_PAGES];
+    uint32_t victim_count = 0;
+    uint32_t reclaim_estimate = 0;
+
+    while (victim_count < KVS_GC_MAX_VICTIM_PAGES && reclaim_estimate < bytes_needed) {
+        uint32_t live_on_page = 0;
+        uint32_t page_local = kvs_find_victim_page(CLEAN_DATA, valid_bitmap, bitmap_size, &live_on_page);
+        if (page_local == UINT32_MAX)
+            break;
+
+        victims[victim_count++] = page_local;
+        reclaim_estimate += page_size - live_on_page;
+
+        // Помечаем выбранную страницу как полностью "живую", чтобы она не была выбрана повторно
+        uint32_t first_word = page_local * device->superblock.words_per_page;
+        uint32_t total_words = device->superblock.userdata_size_bytes / word_size;
+        for (uint32_t w = 0; w < device->superblock.words_per_page && first_word + w < total_words; w++) {
+            valid_bitmap[(first_word + w) / 8] |= (1 << ((first_word + w) % 8));
+        }
+    }
+    free(valid_bitmap);
 
-        // Абсолютное смещение начала и конца этой ГЛОБАЛЬНОЙ страницы
-        uint32_t victim_page_start_global = victim_page_global * page_size;
-        uint32_t victim_page_end_global = victim_page_start_global + page_size;
+    if (victim_count == 0) {
+        kvs_log("GC: Не найдено подходящих для очистки страниц данных.");
+        free(live_items);
+        return 0;
+    }
 
-        // Проверяем, не пересекается ли страница-жертва с областью метаданных
-        if (victim_page_end_global > device->superblock.metadata_offset) {
-            for (uint32_t i = 0; i < device->superblock.max_key_count; i++) {
-                uint32_t slot_offset = device->superblock.metadata_offset + (i * sizeof(kvs_metadata));
-                if (slot_offset >= victim_page_start_global && slot_offset < victim_page_end_global) {
-                    if (get_bit(device->metadata_bitmap, i)) {
-                        kvs_log("GC: Страница #%u содержит валидные метаданные. Очистка отменена.", victim_page_global);
-                        return 0;
+    // Шаг 4: Находим место для эвакуации. Если места для всех живых данных нет, уменьшаем набор жертв.
+    // Горячие и холодные данные эвакуируются двумя пакетами, каждый в свою открытую область.
+    uint8_t *saved_bitmap = malloc(bitmap_size);
+    gc_item *items_to_move = calloc(live_count + 1, sizeof(gc_item));
+    if (!saved_bitmap || !items_to_move) {
+        free(saved_bitmap);
+        free(items_to_move);
+        free(live_items);
+        return 0;
+    }
+    memcpy(saved_bitmap, device->bitmap, bitmap_size);
+
+    uint32_t items_count = 0;
+    uint32_t evacuation_size = 0;
+    uint32_t batch_start[2] = {0, 0};
+    uint32_t batch_size[2] = {0, 0};
+    uint32_t batch_offset[2] = {UINT32_MAX, UINT32_MAX};
+
+    while (victim_count > 0) {
+        // Переезжают все живые записи, хотя бы частично попадающие на страницы-жертвы.
+        // В буфере эвакуации сначала идет холодный пакет, затем горячий.
+        items_count = 0;
+        evacuation_size = 0;
+        for (int t = KVS_DATA_COLD; t <= KVS_DATA_HOT; t++) {
+            batch_start[t] = evacuation_size;
+            for (uint32_t i = 0; i < live_count; i++) {
+                if (kvs_data_temperature(live_items[i].update_count) != t)
+                    continue;
+                uint32_t item_start = live_items[i].old_value_offset;
+                uint32_t item_end   = item_start + live_items[i].aligned_value_size;
+                for (uint32_t v = 0; v < victim_count; v++) {
+                    uint32_t region_start = data_start + victims[v] * page_size;
+                    uint32_t region_end   = (region_start + page_size < data_end) ? region_start + page_size : data_end;
+                    if (item_start < region_end && item_end > region_start) {
+                        items_to_move[items_count] = live_items[i];
+                        items_to_move[items_count].offset_in_buffer = evacuation_size;
+                        evacuation_size += live_items[i].aligned_value_size;
+                        items_count++;
+                        break;
                     }
                 }
             }
+            batch_size[t] = evacuation_size - batch_start[t];
         }
 
-        // Шаг 4: Обработка страницы-жертвы
-        if(live_data_on_page == 0){
-            kvs_log("GC: Логическая страница #%u не содержит живых данных. Очищаем регион.", victim_page_local);
+        if (evacuation_size == 0)
+            break;
 
-            // Используем kvs_clear_region для безопасной очистки физической области
-            if( kvs_clear_region(device->fp, victim_region_start, page_size) < 0)
-                return 0;
-            if( bitmap_clear_region(victim_region_start, page_size) < 0 )
-                return 0;
-
-            rewrite_count_increment_region(victim_page_start_global, page_size);
-            return kvs_persist_all_service_data() == KVS_INTERNAL_OK ? page_size : 0;
+        // На время поиска помечаем жертвы занятыми, чтобы место назначения не попало на стираемые страницы
+        for (uint32_t v = 0; v < victim_count; v++) {
+            uint32_t region_start = data_start + victims[v] * page_size;
+            uint32_t region_size  = (region_start + page_size < data_end) ? page_size : data_end - region_start;
+            bitmap_set_region(region_start, region_size);
         }
-
-        // Шаг 5: Подготовка к эвакуации живых данных
-        uint32_t new_base_offset = kvs_find_free_data_offset(live_data_on_page);
-        if(new_base_offset == UINT32_MAX){
-            kvs_log("GC Ошибка: нет места для эвакуации %u байт живых данных.", live_data_on_page);
-            return 0;
+        bool found = true;
+        for (int t = KVS_DATA_COLD; t <= KVS_DATA_HOT && found; t++) {
+            batch_offset[t] = UINT32_MAX;
+            if (batch_size[t] == 0)
+                continue;
+            batch_offset[t] = kvs_find_free_data_offset(batch_size[t], t);
+            if (batch_offset[t] == UINT32_MAX) {
+                found = false;
+                break;
+            }
+            // Резервируем найденное место, чтобы второй пакет не лег поверх первого
+            bitmap_set_region(batch_offset[t], batch_size[t]);
         }
+        memcpy(device->bitmap, saved_bitmap, bitmap_size);
 
-        gc_item  *items_to_move = calloc(device->key_count,sizeof(gc_item));
-        uint32_t items_count = 0;
-        uint32_t buffer_offset_counter = 0;
-
-        for( int i = 0; i < device->key_count; i++){
+        if (found)
+            break;
 
-            if(is_key_valid(i) != 1)
-                continue;
+        // Места для всех живых данных нет, отказываемся от наименее грязной страницы-жертвы
+        victim_count--;
+    }
+    free(saved_bitmap);
+    free(live_items);
 
-            kvs_metadata temp;
-            if(kvs_read_region(device->fp, device->key_index[i].metadata_offset, &temp, sizeof(kvs_metadata)) < 0)
-                continue;
+    if (victim_count == 0) {
+        kvs_log_at(KVS_LOG_ERROR, "GC Ошибка: нет места для эвакуации живых данных.");
+        free(items_to_move);
+        return 0;
+    }
 
-            if(temp.value_offset >= victim_page_start_global && temp.value_offset < victim_page_end_global){
-                items_to_move[items_count].metadata_offset    = device->key_index[i].metadata_offset;
-                items_to_move[items_count].old_value_offset   = temp.value_offset;
-                items_to_move[items_count].aligned_value_size = align_up(temp.value_size, device->superblock.word_size_bytes);
-                items_to_move[items_count].offset_in_buffer   = buffer_offset_counter;
-                buffer_offset_counter += items_to_move[items_count].aligned_value_size;
-                items_count++;
-            }
+    // Шаг 5: Эвакуация живых данных: по одной последовательной записи на каждый пакет
+    if (items_count > 0) {
+        uint8_t *evacuation_buffer = calloc(1, evacuation_size);
+        if (!evacuation_buffer) {
+            free(items_to_move);
+            return 0;
         }
-
-        // Шаг 6: Выполнение эвакуации
-        if (items_count > 0) {
-            uint8_t *evacuation_buffer = calloc(1,live_data_on_page);
-            if (!evacuation_buffer) { free(items_to_move); return 0; }
-            for (uint32_t i = 0; i < items_count; i++) {
-                kvs_read_region(device->fp, items_to_move[i].old_value_offset, evacuation_buffer + items_to_move[i].offset_in_buffer, items_to_move[i].aligned_value_size);
-            }
-            if (kvs_write_region(device->fp, new_base_offset, evacuation_buffer, live_data_on_page) < 0) {
-                free(evacuation_buffer); free(items_to_move); return 0;
-            }
-
-            if(kvs_clear_region(device->fp, victim_region_start, page_size) < 0) {
-                free(evacuation_buffer); free(items_to_move); return 0;
+        for (uint32_t i = 0; i < items_count; i++) {
+            if (kvs_read_region(device->sim, items_to_move[i].old_value_offset, evacuation_buffer + items_to_move[i].offset_in_buffer, items_to_move[i].aligned_value_size) < 0) {
+                free(evacuation_buffer);
+                free(items_to_move);
+                return 0;
             }
-            free(evacuation_buffer);
-
-            if( bitmap_clear_region(victim_region_start, page_size) < 0 ) {
+        }
+        for (int t = KVS_DATA_COLD; t <= KVS_DATA_HOT; t++) {
+            if (batch_size[t] == 0)
+                continue;
+            if (kvs_verify_and_prepare_region(batch_offset[t], batch_size[t]) < 0 ||
+                kvs_write_region(device->sim, batch_offset[t], evacuation_buffer + batch_start[t], batch_size[t]) < 0) {
+                free(evacuation_buffer);
                 free(items_to_move);
                 return 0;
             }
-
-            for (uint32_t i = 0; i < items_count; i++) {
-                kvs_metadata temp;
-                if(kvs_read_region(device->fp, items_to_move[i].metadata_offset, &temp, sizeof(kvs_metadata)) < 0)
-                    continue;
-                temp.value_offset = new_base_offset + items_to_move[i].offset_in_buffer;
-                if(kvs_write_region(device->fp, items_to_move[i].metadata_offset, &temp, sizeof(kvs_metadata)) < 0)
-                    continue;
-                uint32_t slot_index = (items_to_move[i].metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
-                kvs_update_entry_crc(slot_index);
+            rewrite_count_increment_region(batch_offset[t], batch_size[t]);
+        }
+        free(evacuation_buffer);
+        device->gc_bytes_moved += evacuation_size;
+
+        // Перенаправляем метаданные на новые копии до стирания старых, чтобы сбой не оставил ключи без данных
+        for (uint32_t i = 0; i < items_count; i++) {
+            int t = kvs_data_temperature(items_to_move[i].update_count);
+            uint32_t new_value_offset = batch_offset[t] + (items_to_move[i].offset_in_buffer - batch_start[t]);
+            if (items_to_move[i].metadata_offset == UINT32_MAX) {
+                // У версии снимка слота нет, ее новое место запоминается только в ОЗУ
+                device->snapshot_versions[items_to_move[i].key_index_pos].value_offset = new_value_offset;
+                continue;
             }
+            kvs_metadata temp;
+            if (kvs_read_region(device->sim, items_to_move[i].metadata_offset, &temp, sizeof(kvs_metadata)) < 0)
+                continue;
+            temp.value_offset = new_value_offset;
+            if (kvs_write_region(device->sim, items_to_move[i].metadata_offset, &temp, sizeof(kvs_metadata)) < 0)
+                continue;
+            uint32_t slot_index = (items_to_move[i].metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+            kvs_update_entry_crc(slot_index);
+            kvs_cache_invalidate(slot_index);
         }
-        free(items_to_move);
-
-        // Шаг 7: Финальное обновление служебных структур
-        kvs_log("GC (Данные): Запускаем полный пересбор служебных структур...");
-        if (kvs_metadata_bitmap_create() != KVS_INTERNAL_OK)
-            return 0;
-        if (build_key_index() != KVS_INTERNAL_OK)
-            return 0;
-        if (kvs_bitmap_create() != KVS_INTERNAL_OK)
-            return 0;
-        if (kvs_persist_all_service_data() != KVS_INTERNAL_OK)
-            return 0;
-
-        kvs_log("GC: Сборка мусора для данных успешно завершена.");
-        return page_size;
     }
-
-    else if (clean_mod == CLEAN_METADATA){
-
-        // Шаг 2: Анализ и поиск страницы-жертвы для метаданных
-        uint32_t metadata_bitmap_size = device->superblock.metadata_bitmap_size_bytes;
-        uint8_t *valid_metadata_bitmap = calloc(1,metadata_bitmap_size);
-        if (!valid_metadata_bitmap) {
-            kvs_log("GC (Метаданные) Ошибка: не удалось выделить память для valid_bitmap.");
-            return 0;
+    free(items_to_move);
+
+    // Сортируем жертвы по возрастанию, чтобы стирать соседние страницы одним проходом
+    for (uint32_t i = 1; i < victim_count; i++) {
+        uint32_t v = victims[i];
+        uint32_t j = i;
+        while (j > 0 && victims[j - 1] > v) {
+            victims[j] = victims[j - 1];
+            j--;
         }
+        victims[j] = v;
+    }
 
-        // Создаем временную карту валидных слотов на основе текущего key_index
-        for (uint32_t i = 0; i < device->key_count; i++) {
-            if (is_key_valid(i) == 1) {
-                uint32_t slot_index = (device->key_index[i].metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
-                uint32_t byte_index = slot_index / 8;
-                uint8_t  bit_index  = slot_index % 8;
-                if (byte_index < metadata_bitmap_size) {
-                    valid_metadata_bitmap[byte_index] |= (1 << bit_index);
-                }
-            }
+    // Шаг 6: Стираем страницы-жертвы подряд, объединяя соседние в один регион
+    uint32_t reclaimed = 0;
+    uint32_t v = 0;
+    while (v < victim_count) {
+        uint32_t run_start = data_start + victims[v] * page_size;
+        uint32_t run_pages = 1;
+        while (v + run_pages < victim_count && victims[v + run_pages] == victims[v] + run_pages) {
+            run_pages++;
         }
+        uint32_t run_end  = (run_start + run_pages * page_size < data_end) ? run_start + run_pages * page_size : data_end;
+        uint32_t run_size = run_end - run_start;
 
-        // Находим страницу метаданных с наибольшим количеством "мусора"
-        uint32_t live_metadata_on_page = 0;
-        uint32_t victim_page_local = kvs_find_victim_page(CLEAN_METADATA, valid_metadata_bitmap, metadata_bitmap_size, &live_metadata_on_page);
-        free(valid_metadata_bitmap);
-
-        if (victim_page_local == UINT32_MAX) {
-            kvs_log("GC (Метаданные): Не найдено подходящих для очистки страниц метаданных.");
+        if (kvs_clear_region(device->sim, run_start, run_size) < 0)
             return 0;
-        }
-
-        // Шаг 3: Точное определение границ и обработка
-        uint32_t page_size = device->superblock.page_size_bytes;
-        uint32_t victim_region_start = device->superblock.metadata_offset + (victim_page_local * page_size);
+        rewrite_count_increment_region(run_start, run_size);
+        reclaimed += run_size;
+        v += run_pages;
+    }
+    kvs_log("GC: Очищено %u страниц данных, эвакуировано %u байт живых данных.", victim_count, evacuation_size);
 
-        // Если на странице нет "живых" метаданных, просто очищаем ее
-        if (live_metadata_on_page == 0) {
+    // Шаг 7: Единый пересбор служебных структур и фиксация на диске
+    if (build_key_index() != KVS_INTERNAL_OK)
+        return 0;
+    if (kvs_bitmap_create() != KVS_INTERNAL_OK)
+        return 0;
+    if (kvs_persist_all_service_data() != KVS_INTERNAL_OK)
+        return 0;
 
-            if (kvs_clear_region(device->fp, victim_region_start, page_size) < 0)
-                return 0;
-            rewrite_count_increment_region(victim_region_start, page_size);
+    kvs_log("GC: Сборка мусора для данных успешно завершена.");
+    return reclaimed;
+}
 
-        } else {
+// Проверяет, жив ли занятый слот метаданных. В линейной раскладке слот жив, если его ключ есть в key_index.
+// В хеш-раскладке индекса нет, поэтому слот читается с устройства и проверяется так же, как при построении key_index.
+static bool kvs_metadata_slot_live(uint32_t slot)
+{
+    if (device->superblock.metadata_layout != KVS_LAYOUT_HASH) {
+        return kvs_slot_to_index(slot) != UINT32_MAX;
+    }
+    if (!get_bit(device->metadata_bitmap, slot)) {
+        return false;
+    }
+    kvs_metadata temp;
+    if (kvs_read_region(device->sim, device->superblock.metadata_offset + slot * sizeof(kvs_metadata), &temp, sizeof(temp)) < 0) {
+        return true;
+    }
+    return is_metadata_entry_valid(&temp) == 1;
+}
 
-            // Шаг 4: Подготовка к эвакуации живых метаданных
-            uint32_t slots_to_move_count = live_metadata_on_page / sizeof(kvs_metadata);
-            kvs_metadata *evacuation_buffer = calloc(slots_to_move_count, sizeof(kvs_metadata));
-            if(!evacuation_buffer) return 0;
-
-            uint32_t buffer_idx = 0;
-            uint32_t slots_per_page = page_size / sizeof(kvs_metadata);
-            uint32_t start_slot = (victim_region_start - device->superblock.metadata_offset) / sizeof(kvs_metadata);
-
-            // Считываем все живые слоты в буфер
-            for (uint32_t i = 0; i < slots_per_page; i++) {
-                uint32_t current_slot = start_slot + i;
-                if (get_bit(device->metadata_bitmap, current_slot) == 1 && buffer_idx < slots_to_move_count) {
-
-                    // Проверяем, что это действительно живой ключ
-                    bool is_live = false;
-                    for(uint32_t k = 0; k < device->key_count; k++) {
-                        if(device->key_index[k].metadata_offset == (device->superblock.metadata_offset + current_slot * sizeof(kvs_metadata))) {
-                            is_live = true;
-                            break;
-                        }
-                    }
-                    if(is_live) {
-                        uint32_t old_offset = device->superblock.metadata_offset + (current_slot * sizeof(kvs_metadata));
-                        kvs_read_region(device->fp, old_offset, &evacuation_buffer[buffer_idx], sizeof(kvs_metadata));
-                        buffer_idx++;
-                    }
+// Собирает мусор в области метаданных, освобождая мусорные слоты одной страницы.
+// Живые слоты остаются на своих местах, поэтому key_index и CRC записей не меняются.
+static uint32_t kvs_gc_metadata(void)
+{
+    // Шаг 2: Строим карту живых слотов
+    uint32_t metadata_bitmap_size = device->superblock.metadata_bitmap_size_bytes;
+    uint8_t *valid_metadata_bitmap = calloc(1,metadata_bitmap_size);
+    if (!valid_metadata_bitmap) {
+        kvs_log_at(KVS_LOG_ERROR, "GC (Метаданные) Ошибка: не удалось выделить память для valid_bitmap.");
+        return 0;
+    }
+    for (uint32_t slot = 0; slot < device->superblock.max_key_count; slot++) {
+        if (kvs_metadata_slot_live(slot)) {
+            valid_metadata_bitmap[slot / 8] |= (1 << (slot % 8));
+        }
+    }
 
-                }
-            }
+    // Находим страницу метаданных с наибольшим количеством "мусора"
+    uint32_t live_metadata_on_page = 0;
+    uint32_t victim_page_local = kvs_find_victim_page(CLEAN_METADATA, valid_metadata_bitmap, metadata_bitmap_size, &live_metadata_on_page);
 
-            // Шаг 5: Эвакуация
-            // Записываем спасенные метаданные в новые свободные слоты
-            for (uint32_t i = 0; i < slots_to_move_count; i++) {
-                uint32_t new_meta_offset = kvs_find_free_metadata_offset();
-                if (new_meta_offset == UINT32_MAX) {
-                    kvs_log("GC (Метаданные) КРИТИЧЕСКАЯ ОШИБКА: нет места для эвакуации.");
-                    free(evacuation_buffer);
-                    return 0;
-                }
-                kvs_write_region(device->fp, new_meta_offset, &evacuation_buffer[i], sizeof(kvs_metadata));
-            }
+    if (victim_page_local == UINT32_MAX) {
+        free(valid_metadata_bitmap);
+        kvs_log("GC (Метаданные): Не найдено подходящих для очистки страниц метаданных.");
+        return 0;
+    }
 
+    // Шаг 3: Определяем границы страницы-жертвы внутри области метаданных
+    uint32_t page_size      = device->superblock.page_size_bytes;
+    uint32_t slots_per_page = page_size / sizeof(kvs_metadata);
+    uint32_t start_slot     = victim_page_local * slots_per_page;
+    uint32_t end_slot       = start_slot + slots_per_page;
+    if (end_slot > device->superblock.max_key_count) {
+        end_slot = device->superblock.max_key_count;
+    }
+    uint32_t region_start = device->superblock.metadata_offset + start_slot * sizeof(kvs_metadata);
+    uint32_t region_size  = (end_slot - start_slot) * sizeof(kvs_metadata);
 
-            // Очищаем старую область
-            if (kvs_clear_region(device->fp, victim_region_start, page_size) < 0) {
-                free(evacuation_buffer);
-                return 0;
-            }
-            rewrite_count_increment_region(victim_region_start, page_size);
-            free(evacuation_buffer);
+    // Шаг 4: Считываем страницу и затираем в буфере только мусорные слоты
+    uint8_t *page_buffer = malloc(region_size);
+    if (!page_buffer) {
+        free(valid_metadata_bitmap);
+        return 0;
+    }
+    if (kvs_read_region(device->sim, region_start, page_buffer, region_size) < 0) {
+        free(page_buffer);
+        free(valid_metadata_bitmap);
+        return 0;
+    }
+    uint32_t freed_slots = 0;
+    for (uint32_t slot = start_slot; slot < end_slot; slot++) {
+        if (get_bit(device->metadata_bitmap, slot) && !get_bit(valid_metadata_bitmap, slot)) {
+            memset(page_buffer + (slot - start_slot) * sizeof(kvs_metadata), 0xFF, sizeof(kvs_metadata));
+            bitmap_clear_metadata_slot(slot);
+            freed_slots++;
         }
+    }
+    free(valid_metadata_bitmap);
 
-        // Шаг 6: Финальный пересбор всех служебных структур
-        kvs_log("GC (Метаданные): Запускаем полный пересбор служебных структур...");
-        if (kvs_metadata_bitmap_create() != KVS_INTERNAL_OK)
-            return 0;
-        if (build_key_index() != KVS_INTERNAL_OK)
-            return 0;
-        if (kvs_bitmap_create() != KVS_INTERNAL_OK)
-            return 0;
+    // В хеш-раскладке мусорные слоты входили в количество ключей, взятое из биткарты метаданных
+    if (device->superblock.metadata_layout == KVS_LAYOUT_HASH) {
+        device->key_count -= freed_slots;
+    }
 
-        // После пересбора key_index нужно пересчитать все CRC для записей
-        for(uint32_t i = 0; i < device->key_count; i++) {
-            uint32_t slot_idx = (device->key_index[i].metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
-            kvs_update_entry_crc(slot_idx);
-        }
+    // Шаг 5: Стираем страницу и возвращаем на место живые слоты
+    if (kvs_clear_region(device->sim, region_start, region_size) < 0 ||
+        kvs_write_region(device->sim, region_start, page_buffer, region_size) < 0) {
+        free(page_buffer);
+        kvs_metadata_bitmap_create();
+        build_key_index();
+        return 0;
+    }
+    rewrite_count_increment_region(region_start, region_size);
+    free(page_buffer);
 
-        if (kvs_persist_all_service_data() != KVS_INTERNAL_OK)
-            return 0;
+    // Шаг 6: Фиксируем служебные структуры на диске
+    if (kvs_persist_all_service_data() != KVS_INTERNAL_OK)
+        return 0;
 
-        kvs_log("GC: Сборка мусора для метаданных и пересбор структур успешно завершены.");
-        return page_size;
-    }
+    kvs_log("GC: Сборка мусора для метаданных завершена, освобождено %u слотов.", freed_slots);
+    return freed_slots * sizeof(kvs_metadata);
+}
+
+uint32_t kvs_gc(int clean_mod, uint32_t bytes_needed){
 
+    // Шаг 1: Проверяем базовые параметры
+    if(!device)
+        return 0;
+
+    // Шаг 2: Записи сборщика засчитываются ему, а не операции, которая его запустила
+    uint32_t freed = 0;
+    uint64_t start_ns = kvs_stats_now_ns();
+    device->gc_cycles++;
+    kvs_write_path previous_path = kvs_set_write_path(KVS_WRITE_PATH_GC);
+    if (clean_mod == CLEAN_DATA)
+        freed = kvs_gc_data(bytes_needed);
+    else if (clean_mod == CLEAN_METADATA)
+        freed = kvs_gc_metadata();
     else
-        kvs_log("GC Ошибка: Неверный режим для сборки мусора.");
+        kvs_log_at(KVS_LOG_ERROR, "GC Ошибка: Неверный режим для сборки мусора.");
+    kvs_set_write_path(previous_path);
+    kvs_latency_record(KVS_LATENCY_GC, start_ns);
 
-    return 0;
+    return freed;
 }
 
 kvs_internal_status kvs_verify_and_prepare_region(uint32_t offset, uint32_t size)
@@ -850,11 +1394,11 @@ kvs_internal_status kvs_verify_and_prepare_region(uint32_t offset, uint32_t size
             kvs_log("Обнаружен мусор на логической странице #%u. Запускаем безопасную очистку.", p_idx);
 
             // 1. Считываем всю логическую страницу в ОЗУ
-            uint8_t *page_buffer = calloc(1, page_size);
+            uint8_t *page_buffer = kvs_scratch_acquire(page_size);
             if (!page_buffer) return KVS_INTERNAL_ERR_MALLOC_FAILED;
 
-            if (kvs_read_region(device->fp, logical_page_start_offset, page_buffer, page_size) < 0) {
-                free(page_buffer);
+            if (kvs_read_region(device->sim, logical_page_start_offset, page_buffer, page_size) < 0) {
+                kvs_scratch_release(page_buffer);
                 return KVS_INTERNAL_ERR_READ_FAILED;
             }
 
@@ -871,21 +1415,330 @@ kvs_internal_status kvs_verify_and_prepare_region(uint32_t offset, uint32_t size
             }
 
             // 3. Используем kvs_clear_region для безопасной физической очистки региона на диске
-            if (kvs_clear_region(device->fp, logical_page_start_offset, page_size) < 0) {
-                kvs_log("КРИТИЧЕСКАЯ ОШИБКА: kvs_clear_region не удалось очистить страницу.");
-                free(page_buffer);
+            if (kvs_clear_region(device->sim, logical_page_start_offset, page_size) < 0) {
+                kvs_log_at(KVS_LOG_ERROR, "КРИТИЧЕСКАЯ ОШИБКА: kvs_clear_region не удалось очистить страницу.");
+                kvs_scratch_release(page_buffer);
                 return KVS_INTERNAL_ERR_ERASE_FAILED;
             }
 
             // 4. Записываем наш исправленный буфер обратно в только что очищенный регион
-            if (kvs_write_region(device->fp, logical_page_start_offset, page_buffer, page_size) < 0) {
-                free(page_buffer);
+            if (kvs_write_region(device->sim, logical_page_start_offset, page_buffer, page_size) < 0) {
+                kvs_scratch_release(page_buffer);
                 return KVS_INTERNAL_ERR_WRITE_FAILED;
             }
 
-            free(page_buffer);
+            kvs_scratch_release(page_buffer);
+        }
+    }
+
+    return KVS_INTERNAL_OK;
+}
+// Определяет диапазон глобальных страниц [first, end), целиком лежащих в области пользовательских данных.
+// Крайние страницы, которые делятся со служебной областью или метаданными, в выравнивании износа не участвуют.
+static void kvs_wear_page_range(uint32_t *first_out, uint32_t *end_out)
+{
+    uint32_t page_size  = device->superblock.page_size_bytes;
+    uint32_t data_start = device->superblock.data_offset;
+    uint32_t data_end   = device->superblock.data_offset + device->superblock.userdata_size_bytes;
+
+    *first_out = (data_start + page_size - 1) / page_size;
+    *end_out   = data_end / page_size;
+    if (*end_out < *first_out) {
+        *end_out = *first_out;
+    }
+}
+
+uint32_t kvs_wear_spread(uint32_t *min_out, uint32_t *max_out)
+{
+    if (!device || !device->page_rewrite_count) {
+        return 0;
+    }
+
+    uint32_t first_page, end_page;
+    kvs_wear_page_range(&first_page, &end_page);
+    uint32_t start_tracked_page = device->superblock.data_offset / device->superblock.page_size_bytes;
+
+    uint32_t min_wear = UINT32_MAX;
+    uint32_t max_wear = 0;
+    for (uint32_t p = first_page; p < end_page; p++) {
+        uint32_t wear = device->page_rewrite_count[p - start_tracked_page];
+        if (wear < min_wear) min_wear = wear;
+        if (wear > max_wear) max_wear = wear;
+    }
+    if (min_wear == UINT32_MAX) {
+        min_wear = 0;
+    }
+
+    if (min_out) *min_out = min_wear;
+    if (max_out) *max_out = max_wear;
+    return max_wear - min_wear;
+}
+
+// Ищет внутри слов [start_word, end_word) области данных свободный участок длиной words_needed.
+// Слова [skip_start, skip_end) считаются занятыми, даже если свободны в битовой карте.
+// Возвращает индекс первого слова участка или UINT32_MAX.
+static uint32_t kvs_find_free_run_in_words(uint32_t start_word, uint32_t end_word, uint32_t words_needed,
+                                           uint32_t skip_start, uint32_t skip_end)
+{
+    uint32_t run_length = 0;
+    for (uint32_t i = start_word; i < end_word; i++) {
+        if ((i < skip_start || i >= skip_end) && get_bit(device->bitmap, i) == 0) {
+            run_length++;
+        } else {
+            run_length = 0;
+        }
+        if (run_length >= words_needed) {
+            return i - (words_needed - 1);
+        }
+    }
+    return UINT32_MAX;
+}
+
+kvs_internal_status kvs_wear_level_step(void)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+
+    uint32_t page_size  = device->superblock.page_size_bytes;
+    uint32_t word_size  = device->superblock.word_size_bytes;
+    uint32_t data_start = device->superblock.data_offset;
+    uint32_t start_tracked_page = data_start / page_size;
+
+    uint32_t first_page, end_page;
+    kvs_wear_page_range(&first_page, &end_page);
+    if (end_page - first_page < 2) {
+        return KVS_INTERNAL_OK;
+    }
+
+    // Шаг 2: Ищем наименее изношенную страницу, на которой есть занятые слова, и максимальный износ
+    uint32_t cold_page = UINT32_MAX;
+    uint32_t cold_wear = UINT32_MAX;
+    uint32_t max_wear  = 0;
+    for (uint32_t p = first_page; p < end_page; p++) {
+        uint32_t wear = device->page_rewrite_count[p - start_tracked_page];
+        if (wear > max_wear) {
+            max_wear = wear;
+        }
+        if (wear >= cold_wear) {
+            continue;
+        }
+        uint32_t first_word = (p * page_size - data_start) / word_size;
+        for (uint32_t w = 0; w < page_size / word_size; w++) {
+            if (get_bit(device->bitmap, first_word + w)) {
+                cold_page = p;
+                cold_wear = wear;
+                break;
+            }
+        }
+    }
+
+    // Если занятых страниц нет или разброс еще в пределах нормы, ничего не делаем
+    if (cold_page == UINT32_MAX || max_wear - cold_wear <= device->wear_level_threshold) {
+        return KVS_INTERNAL_OK;
+    }
+
+    uint32_t region_start = cold_page * page_size;
+    uint32_t region_end   = region_start + page_size;
+
+    // Шаг 3: Собираем живые записи, хотя бы частично лежащие на холодной странице.
+    // Каждая из них занимает на странице хотя бы одно слово, поэтому их не больше, чем слов на странице,
+    // и список помещается во временный буфер пула. Если записей больше, чем влезает в буфер, страницу пропускаем
+    uint32_t items_capacity = page_size / word_size;
+    if (items_capacity > device->scratch_buffer_size / sizeof(gc_item)) {
+        items_capacity = device->scratch_buffer_size / sizeof(gc_item);
+    }
+    gc_item *items_to_move = kvs_scratch_acquire(items_capacity * sizeof(gc_item));
+    if (!items_to_move) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    uint32_t items_count = 0;
+    uint32_t evacuation_size = 0;
+    bool items_overflow = false;
+    for (uint32_t i = 0; i < kvs_key_pos_end(); i++) {
+        if (!kvs_key_pos_live(i))
+            continue;
+        kvs_metadata temp;
+        if (kvs_read_region(device->sim, kvs_key_metadata_offset(i), &temp, sizeof(kvs_metadata)) < 0 || kvs_value_is_inline(&temp))
+            continue;
+        uint32_t aligned_size = kvs_record_data_size(&temp);
+        if (temp.value_offset >= region_end || temp.value_offset + aligned_size <= region_start)
+            continue;
+        if (is_key_valid(i) != 1)
+            continue;
+        if (items_count == items_capacity) {
+            items_overflow = true;
+            break;
+        }
+
+        gc_item *item = &items_to_move[items_count++];
+        item->key_index_pos      = i;
+        item->metadata_offset    = kvs_key_metadata_offset(i);
+        item->old_value_offset   = temp.value_offset;
+        item->value_size         = temp.value_size;
+        item->aligned_value_size = aligned_size;
+        item->update_count       = temp.update_count;
+        item->offset_in_buffer   = evacuation_size;
+        evacuation_size += aligned_size;
+    }
+    // Данные версий, которые видят открытые снимки, тоже живые: страница будет стерта
+    for (uint32_t i = 0; i < device->snapshot_version_count; i++) {
+        const kvs_snapshot_version *version = &device->snapshot_versions[i];
+        if (kvs_value_is_inline(&version->metadata))
+            continue;
+        uint32_t aligned_size = kvs_record_data_size(&version->metadata);
+        if (version->value_offset >= region_end || version->value_offset + aligned_size <= region_start)
+            continue;
+        if (items_count == items_capacity) {
+            items_overflow = true;
+            break;
+        }
+
+        gc_item *item = &items_to_move[items_count++];
+        item->key_index_pos      = i;
+        item->metadata_offset    = UINT32_MAX;
+        item->old_value_offset   = version->value_offset;
+        item->value_size         = version->metadata.value_size;
+        item->aligned_value_size = aligned_size;
+        item->update_count       = version->metadata.update_count;
+        item->offset_in_buffer   = evacuation_size;
+        evacuation_size += aligned_size;
+    }
+    if (items_overflow) {
+        kvs_log("WEAR: На холодной странице #%u больше %u записей, перенос пропущен.", cold_page, items_capacity);
+        kvs_scratch_release(items_to_move);
+        return KVS_INTERNAL_OK;
+    }
+
+    // Шаг 4: Выбираем самую изношенную страницу, на которой помещаются все переносимые данные.
+    // Холодные данные будут лежать там долго и дадут этой странице отдохнуть от перезаписей.
+    uint32_t new_offset = UINT32_MAX;
+    if (evacuation_size > 0) {
+        // Живые записи могут выходить за границы холодной страницы, поэтому окно поиска
+        // начинается на изношенной странице и захватывает столько соседних страниц, сколько нужно
+        uint32_t words_needed = evacuation_size / word_size;
+        uint32_t window_words = ((evacuation_size + page_size - 1) / page_size + 1) * (page_size / word_size);
+        uint32_t total_words  = device->superblock.userdata_size_bytes / word_size;
+        uint32_t best_wear = 0;
+
+        // Слова холодной страницы при поиске считаются занятыми: окно соседней страницы
+        // может дотянуться до нее, а на шаге 6 она будет стерта
+        uint32_t cold_first_word = (region_start - data_start) / word_size;
+        uint32_t cold_end_word   = cold_first_word + page_size / word_size;
+        for (uint32_t p = first_page; p < end_page; p++) {
+            uint32_t wear = device->page_rewrite_count[p - start_tracked_page];
+            if (p == cold_page || wear <= cold_wear + device->wear_level_threshold / 2)
+                continue;
+            if (new_offset != UINT32_MAX && wear <= best_wear)
+                continue;
+            uint32_t first_word = (p * page_size - data_start) / word_size;
+            uint32_t last_word  = (first_word + window_words < total_words) ? first_word + window_words : total_words;
+            uint32_t run_start  = kvs_find_free_run_in_words(first_word, last_word, words_needed, cold_first_word, cold_end_word);
+            if (run_start != UINT32_MAX) {
+                new_offset = data_start + run_start * word_size;
+                best_wear = wear;
+            }
+        }
+
+        if (new_offset == UINT32_MAX) {
+            kvs_log("WEAR: Нет изношенной страницы со свободным местом для %u байт холодных данных.", evacuation_size);
+            kvs_scratch_release(items_to_move);
+            return KVS_INTERNAL_OK;
         }
     }
 
+    // Шаг 5: Переносим живые данные одной записью и перенаправляем на них метаданные до стирания
+    if (items_count > 0) {
+        uint8_t *evacuation_buffer = kvs_scratch_acquire(evacuation_size);
+        if (!evacuation_buffer) {
+            kvs_scratch_release(items_to_move);
+            return KVS_INTERNAL_ERR_MALLOC_FAILED;
+        }
+        for (uint32_t i = 0; i < items_count; i++) {
+            if (kvs_read_region(device->sim, items_to_move[i].old_value_offset, evacuation_buffer + items_to_move[i].offset_in_buffer, items_to_move[i].aligned_value_size) < 0) {
+                kvs_scratch_release(evacuation_buffer);
+                kvs_scratch_release(items_to_move);
+                return KVS_INTERNAL_ERR_READ_FAILED;
+            }
+        }
+        if (kvs_verify_and_prepare_region(new_offset, evacuation_size) < 0 ||
+            kvs_write_region(device->sim, new_offset, evacuation_buffer, evacuation_size) < 0) {
+            kvs_scratch_release(evacuation_buffer);
+            kvs_scratch_release(items_to_move);
+            return KVS_INTERNAL_ERR_WRITE_FAILED;
+        }
+        kvs_scratch_release(evacuation_buffer);
+        rewrite_count_increment_region(new_offset, evacuation_size);
+        bitmap_set_region(new_offset, evacuation_size);
+
+        for (uint32_t i = 0; i < items_count; i++) {
+            if (items_to_move[i].metadata_offset == UINT32_MAX) {
+                device->snapshot_versions[items_to_move[i].key_index_pos].value_offset = new_offset + items_to_move[i].offset_in_buffer;
+                bitmap_clear_region(items_to_move[i].old_value_offset, items_to_move[i].aligned_value_size);
+                continue;
+            }
+
+            // Если метаданные не перенаправить, холодную страницу стирать нельзя: на нее еще ссылаются записи.
+            // Копии еще не перенаправленных записей освобождаем, перенаправленные уже живут на новом месте
+            kvs_metadata temp;
+            kvs_internal_status redirect_status = kvs_read_region(device->sim, items_to_move[i].metadata_offset, &temp, sizeof(kvs_metadata));
+            if (redirect_status == KVS_INTERNAL_OK) {
+                temp.value_offset = new_offset + items_to_move[i].offset_in_buffer;
+                redirect_status = kvs_write_region(device->sim, items_to_move[i].metadata_offset, &temp, sizeof(kvs_metadata));
+            }
+            if (redirect_status != KVS_INTERNAL_OK) {
+                kvs_log_at(KVS_LOG_ERROR, "WEAR Ошибка: не удалось перенаправить метаданные по смещению %u, перенос прерван.",
+                           items_to_move[i].metadata_offset);
+                for (uint32_t j = i; j < items_count; j++) {
+                    bitmap_clear_region(new_offset + items_to_move[j].offset_in_buffer, items_to_move[j].aligned_value_size);
+                }
+                kvs_scratch_release(items_to_move);
+                return redirect_status;
+            }
+            uint32_t slot_index = (items_to_move[i].metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+            kvs_update_entry_crc(slot_index);
+            kvs_cache_invalidate(slot_index);
+
+            // Старые копии больше никому не принадлежат
+            bitmap_clear_region(items_to_move[i].old_value_offset, items_to_move[i].aligned_value_size);
+        }
+        device->wear_level_bytes_moved += evacuation_size;
+    }
+    kvs_scratch_release(items_to_move);
+
+    // Шаг 6: Стираем холодную страницу, теперь она доступна для новых (в том числе горячих) записей
+    if (kvs_clear_region(device->sim, region_start, page_size) < 0) {
+        return KVS_INTERNAL_ERR_ERASE_FAILED;
+    }
+    rewrite_count_increment_region(region_start, page_size);
+    bitmap_clear_region(region_start, page_size);
+    device->wear_level_migrations++;
+
+    kvs_log("WEAR: Страница #%u (износ %u, максимум %u) освобождена, перенесено %u байт холодных данных.",
+            cold_page, cold_wear, max_wear, evacuation_size);
+
+    // Шаг 7: Фиксируем служебные структуры на диске
+    if (kvs_persist_all_service_data() != KVS_INTERNAL_OK) {
+        return KVS_INTERNAL_ERR_WRITE_FAILED;
+    }
     return KVS_INTERNAL_OK;
-}
\ No newline at end of file
+}
+
+void kvs_wear_level_tick(void)
+{
+    if (!device) {
+        return;
+    }
+    if (++device->wear_level_ops < KVS_WEAR_LEVEL_INTERVAL) {
+        return;
+    }
+    device->wear_level_ops = 0;
+
+    kvs_write_path previous_path = kvs_set_write_path(KVS_WRITE_PATH_WEAR_LEVEL);
+    kvs_internal_status status = kvs_wear_level_step();
+    kvs_set_write_path(previous_path);
+    if (status != KVS_INTERNAL_OK) {
+        kvs_log_at(KVS_LOG_WARNING, "WEAR ВНИМАНИЕ: Шаг выравнивания износа завершился с ошибкой %d.", status);
+    }
+}
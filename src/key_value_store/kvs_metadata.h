@@ -5,14 +5,17 @@
 #include "kvs_valid.h"
 #include "kvs_internal.h"
 
-// Вспомогательная структура для безопасной эвакуации данных(нужна для GC)
+// Вспомогательная структура для безопасной эвакуации данных(нужна для GC).
+// Данные версии, сохраненной для снимка, переносятся так же, как данные ключа: у такого элемента
+// metadata_offset равен UINT32_MAX, а key_index_pos - позиция версии в device->snapshot_versions
 typedef struct {
-    uint32_t key_index_pos;      // Индекс ключа в device->key_index
-    uint32_t metadata_offset;    // Смещение метаданных
+    uint32_t key_index_pos;      // Позиция ключа (см. kvs_key_pos_end)
+    uint32_t metadata_offset;    // Смещение метаданных (UINT32_MAX для версии снимка)
     uint32_t old_value_offset;   // Старое смещение данных
     uint32_t value_size;         // Размер данных (невыровненный)
-    uint32_t aligned_value_size; // Размер данных (выровненный)
+    uint32_t aligned_value_size; // Размер области данных: выровненное значение и хвост длинного ключа
     uint32_t offset_in_buffer;   // Смещение этого элемента в общем буфере эвакуации
+    uint32_t update_count;       // Счетчик обновлений ключа (определяет горячую или холодную область)
 } gc_item;
 
 // Увеличивает на 1 значение счетчика перезаписей для всех страниц, которые полностью или частично покрываются диапазоном [offset, offset + size).
@@ -34,9 +37,11 @@ kvs_internal_status bitmap_set_region(uint32_t offset, uint32_t size);
 kvs_internal_status bitmap_clear_region(uint32_t offset, uint32_t size);
 
 // Выполняет сборку мусора на устройстве хранения SSDMMC-симулятора.
-// clean_mod - переменная, значение которой определяет, какие данные будут очищены
+// clean_mod    - переменная, значение которой определяет, какие данные будут очищены
+// bytes_needed - размер ожидающего выделения. Для данных GC за один проход выбирает столько
+//                страниц-жертв (не более KVS_GC_MAX_VICTIM_PAGES), сколько нужно для его размещения.
 // Возвращает количество байт, которые были очищены в ходе сборки мусора.
-uint32_t kvs_gc(int clean_mod);
+uint32_t kvs_gc(int clean_mod, uint32_t bytes_needed);
 
 // Добавляет новую запись о ключе в key_index, который хранится в ОЗУ.
 // Вызывается при загрузке хранилища для построения key_index по валидным метаданным.
@@ -44,11 +49,26 @@ uint32_t kvs_gc(int clean_mod);
 // pos          - физическое смещение этих метаданных на диске.
 kvs_internal_status kvs_add_metadata_entry(const kvs_metadata *new_metadata, uint32_t pos);
 
+// Восстанавливает полный ключ записи: байты из слота и хвост длинного ключа из области данных.
+// key_out - буфер на KVS_KEY_SIZE байт; байты после key_len заполняются нулями.
+kvs_internal_status kvs_metadata_read_key(const kvs_metadata *metadata, uint8_t *key_out);
+
+// Сравнивает ключ записи metadata с ключом key. Область данных читается, только если совпали
+// длина и байты в слоте, а ключ длиннее KVS_SLOT_KEY_BYTES.
+// Возвращает 1 при совпадении, 0 при несовпадении или отрицательное значение (код ошибки).
+int kvs_metadata_key_equals(const kvs_metadata *metadata, const void *key, uint32_t key_len);
+
 // Вычисляет значение crc для данных
 // data - указатель на данные, для которого нужно вычислить crc
 // size - размер этих данных
 uint32_t crc32_calc(const void *data, size_t size);
 
+// Продолжает вычисление crc по очередному фрагменту данных.
+// crc  - промежуточное состояние (для первого фрагмента 0xFFFFFFFF).
+// Итоговое значение получается инверсией состояния: ~crc32_update(...).
+// Позволяет считать crc метаданных и данных без их склейки в общий буфер.
+uint32_t crc32_update(uint32_t crc, const void *data, size_t size);
+
 // Пересоздает битовую карту устройства на основе валидных ключей и их value.
 // Очищает весь пользовательский диапазон, затем отмечает метаданные и значения ключей занятыми страницами.
 // Возвращает:
@@ -59,17 +79,83 @@ kvs_internal_status kvs_bitmap_create(void);
 // Ищет непрерывный свободный регион для пользовательских данных заданного размера.
 // Реализует алгоритм карусель для выравнивания износа,
 // начиная поиск с последнего выделенного места.
-// value_len - требуемый размер данных в байтах.
+// value_len   - требуемый размер данных в байтах.
+// temperature - KVS_DATA_HOT или KVS_DATA_COLD. Горячие и холодные данные размещаются
+//               каждые со своей карусели, чтобы не перемешиваться на одних страницах.
 // Возвращает смещение найденного региона или UINT32_MAX, если места нет.
-uint32_t kvs_find_free_data_offset(uint32_t value_len);
-
-// Ищет свободный слот для размещения метаданных.
-// Реализует алгоритм карусель, начиная поиск со слота, следующего
-// за последним выделенным, чтобы выравнивать износ области метаданных.
+uint32_t kvs_find_free_data_offset(uint32_t value_len, int temperature);
+
+// Определяет, к какой области (горячей или холодной) относятся данные ключа.
+// update_count - сколько раз значение ключа обновлялось.
+// Возвращает KVS_DATA_HOT или KVS_DATA_COLD.
+int kvs_data_temperature(uint32_t update_count);
+
+// Ищет ключ в отсортированном key_index бинарным поиском.
+// key     - указатель на ключ.
+// key_len - длина ключа в байтах.
+// pos_out - сюда записывается позиция найденного ключа в key_index.
+// Возвращает 1 если ключ найден, 0 если нет.
+int kvs_key_index_find(const void *key, uint32_t key_len, uint32_t *pos_out);
+
+// Возвращает первую позицию в key_index, ключ на которой не меньше заданного
+// (device->key_count, если таких ключей нет).
+uint32_t kvs_key_index_lower_bound(const void *key, uint32_t key_len);
+
+// Вставляет запись в key_index, сохраняя сортировку, и обновляет обратное отображение слотов.
+// В хеш-раскладке только увеличивает device->key_count, позицией становится слот записи.
+// entry   - вставляемая запись.
+// pos_out - сюда записывается позиция, на которую встала запись (может быть NULL).
+// Возвращает KVS_INTERNAL_OK или код ошибки, если индекс заполнен.
+kvs_internal_status kvs_key_index_insert(const kvs_key_index_entry *entry, uint32_t *pos_out);
+
+// Удаляет запись с позиции pos из key_index и обновляет обратное отображение слотов.
+// В хеш-раскладке только уменьшает device->key_count.
+void kvs_key_index_remove(uint32_t pos);
+
+// Полностью пересобирает обратное отображение slot_to_index по текущему key_index.
+// Вызывается после любой перестройки или сортировки key_index.
+void kvs_slot_map_rebuild(void);
+
+// Возвращает позицию в key_index записи, метаданные которой лежат в слоте slot_index,
+// или UINT32_MAX, если такого ключа в индексе нет. В хеш-раскладке позиция совпадает со слотом.
+uint32_t kvs_slot_to_index(uint32_t slot_index);
+
+// Возвращает границу позиций ключей для обхода всех ключей устройства.
+// В линейной раскладке позиция - индекс в key_index, граница - device->key_count.
+// В хеш-раскладке key_index в ОЗУ нет: позиция ключа - номер его слота, граница - число слотов.
+uint32_t kvs_key_pos_end(void);
+
+// Проверяет, занята ли позиция pos ключом. В хеш-раскладке это бит слота в биткарте метаданных,
+// который устанавливается только после записи слота.
+bool kvs_key_pos_live(uint32_t pos);
+
+// Возвращает смещение слота метаданных ключа на позиции pos.
+uint32_t kvs_key_metadata_offset(uint32_t pos);
+
+// Хеш ключа FNV-1a по key_len реальным байтам ключа.
+uint32_t kvs_key_hash(const void *key, uint32_t key_len);
+
+// Ищет свободный слот для размещения метаданных ключа key.
+// В линейной раскладке реализует алгоритм карусель, начиная поиск со слота, следующего
+// за последним выделенным, чтобы выравнивать износ области метаданных (key не используется).
+// В хеш-раскладке перебирает корзины, начиная с домашней корзины ключа.
 // Возвращает смещение найденного слота или UINT32_MAX, если места нет.
-uint32_t kvs_find_free_metadata_offset(void);
+uint32_t kvs_find_free_metadata_offset(const void *key, uint32_t key_len);
+
+// Ищет ключ в хеш-раскладке без key_index: читает с устройства корзины от домашней
+// до удаления superblock.hash_max_probe. Обычно это одна корзина размером не больше страницы.
+// slot_out - номер найденного слота метаданных.
+// Возвращает 1, если ключ найден, 0 если нет, или отрицательный код ошибки.
+int kvs_hash_lookup(const void *key, uint32_t key_len, uint32_t *slot_out);
+
+// Находит позицию ключа способом, соответствующим раскладке метаданных:
+// бинарным поиском по key_index в линейной раскладке или через kvs_hash_lookup в хеш-раскладке
+// (там позиция - номер слота).
+// Возвращает 1, если ключ найден (позиция в pos_out), и 0 в противном случае.
+int kvs_key_locate(const void *key, uint32_t key_len, uint32_t *pos_out);
 
 // Вспомогательная функция для построения key_index по валидным метаданным.
+// В хеш-раскладке индекс не строится, а только пересчитывается device->key_count по биткарте метаданных.
 // device - указатель на структуру устройства
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
 kvs_internal_status build_key_index(void);
@@ -124,5 +210,21 @@ kvs_internal_status kvs_verify_and_prepare_region(uint32_t offset, uint32_t size
 // slot_index - порядковый номер слота метаданных для обновления.
 kvs_internal_status kvs_update_entry_crc(uint32_t slot_index);
 
+// Вычисляет разброс износа (max - min счетчиков перезаписи) по страницам,
+// целиком лежащим в области пользовательских данных.
+// min_out, max_out - необязательные указатели для минимального и максимального счетчиков.
+// Возвращает разброс или 0, если страниц для сравнения недостаточно.
+uint32_t kvs_wear_spread(uint32_t *min_out, uint32_t *max_out);
+
+// Один шаг статического выравнивания износа.
+// Если разброс износа превышает device->wear_level_threshold, переносит живые данные
+// с наименее изношенной занятой страницы на сильно изношенную и стирает освободившуюся страницу.
+// За один шаг переносится не больше одной страницы.
+kvs_internal_status kvs_wear_level_step(void);
+
+// Учитывает одну изменяющую операцию и раз в KVS_WEAR_LEVEL_INTERVAL операций
+// выполняет шаг выравнивания износа, чтобы не замедлять каждую запись.
+void kvs_wear_level_tick(void);
+
 
 #endif //SSDMMCSTORE_KVS_METADATA_H
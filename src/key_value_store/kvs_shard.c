@@ -0,0 +1,216 @@
+#include "kvs_shard.h"
+#include "kvs_metadata.h"
+#include <time.h>
+
+uint32_t kvs_shard_index(const void *key, uint32_t key_len, uint32_t shard_count)
+{
+    // Перемешиваем FNV-1a финализатором MurmurHash3: в хеш-раскладке корзина ключа внутри шарда
+    // берется из того же хеша по модулю, и без перемешивания ключи одного шарда делили бы корзины неравномерно
+    uint32_t hash = kvs_key_hash(key, key_len);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash % shard_count;
+}
+
+kvs_internal_status kvs_shard_map_apply(struct kvs_sharded *store)
+{
+    if (!store) {
+        return KVS_INTERNAL_ERR_NULL_PARAM;
+    }
+
+    // Шаг 1: Идентификатор набора берем у любого шарда, который уже в него входит. Если таких нет, набор новый
+    uint32_t set_id = 0;
+    for (uint32_t i = 0; i < store->shard_count && set_id == 0; i++) {
+        if (store->shards[i]->superblock.shard_count != 0) {
+            set_id = store->shards[i]->superblock.shard_set_id;
+        }
+    }
+    if (set_id == 0) {
+        set_id = (uint32_t)time(NULL) ^ (uint32_t)clock() ^ (uint32_t)(uintptr_t)store;
+        if (set_id == 0) {
+            set_id = 1;
+        }
+    }
+    store->shard_set_id = set_id;
+
+    // Шаг 2: Сверяем карту каждого шарда с набором
+    for (uint32_t i = 0; i < store->shard_count; i++) {
+        const kvs_superblock *sb = &store->shards[i]->superblock;
+        if (sb->shard_count == 0) {
+            if (store->shards[i]->key_count != 0) {
+                kvs_log_at(KVS_LOG_ERROR, "ОШИБКА: хранилище шарда %u содержит ключи, но не входит в набор шардов.", i);
+                return KVS_INTERNAL_ERR_INVALID_PARAM;
+            }
+            continue;
+        }
+        if (sb->shard_set_id != set_id || sb->shard_count != store->shard_count || sb->shard_index != i) {
+            kvs_log_at(KVS_LOG_ERROR, "ОШИБКА: шард %u принадлежит набору %u из %u шардов (позиция %u), ожидался набор %u из %u шардов.",
+                    i, sb->shard_set_id, sb->shard_count, sb->shard_index, set_id, store->shard_count);
+            return KVS_INTERNAL_ERR_INVALID_PARAM;
+        }
+    }
+
+    // Шаг 3: Записываем карту в суперблоки новых шардов
+    for (uint32_t i = 0; i < store->shard_count; i++) {
+        if (store->shards[i]->superblock.shard_count != 0) {
+            continue;
+        }
+        kvs_device *previous = kvs_bind_device(store->shards[i]);
+        device->superblock.shard_set_id = set_id;
+        device->superblock.shard_index  = (uint16_t)i;
+        device->superblock.shard_count  = (uint16_t)store->shard_count;
+        kvs_internal_status status = kvs_persist_all_service_data();
+        kvs_bind_device(previous);
+        if (status != KVS_INTERNAL_OK) {
+            return status;
+        }
+    }
+    return KVS_INTERNAL_OK;
+}
+
+// Возвращает шард, в котором хранится ключ key длиной key_len. Некорректный ключ направляется
+// в первый шард, который и вернет ошибку параметра.
+static kvs_handle *kvs_sharded_route(const kvs_sharded *store, const void *key, size_t key_len)
+{
+    if (!key || key_len == 0 || key_len > KVS_KEY_SIZE) {
+        return store->shards[0];
+    }
+    return store->shards[kvs_shard_index(key, (uint32_t)key_len, store->shard_count)];
+}
+
+kvs_status kvs_sharded_open(const char *path, const kvs_options *options, uint32_t shard_count, kvs_sharded **store_out)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!path || !options || !store_out || shard_count == 0 || shard_count > KVS_MAX_SHARDS) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    kvs_sharded *store = calloc(1, sizeof(kvs_sharded));
+    size_t path_size = strlen(path) + 16;
+    char *shard_path = malloc(path_size);
+    if (!store || !shard_path) {
+        free(store);
+        free(shard_path);
+        return KVS_ERROR_UNKNOWN;
+    }
+
+    // Шаг 2: Открываем шарды. Каждый получает свою долю пользовательской области и
+    // всегда работает в режиме параллельного чтения: к разным шардам обращаются разные потоки
+    kvs_options shard_options = *options;
+    shard_options.storage_size_bytes = options->storage_size_bytes / shard_count;
+    shard_options.concurrent = true;
+    kvs_status status = KVS_SUCCESS;
+    for (uint32_t i = 0; i < shard_count && status == KVS_SUCCESS; i++) {
+        snprintf(shard_path, path_size, "%s.%u", path, i);
+        status = kvs_open(shard_path, &shard_options, &store->shards[i]);
+        if (status == KVS_SUCCESS) {
+            store->shard_count++;
+        }
+    }
+    free(shard_path);
+
+    // Шаг 3: Сверяем и сохраняем карту шардов
+    if (status == KVS_SUCCESS) {
+        kvs_internal_status map_status = kvs_shard_map_apply(store);
+        if (map_status == KVS_INTERNAL_ERR_INVALID_PARAM) {
+            status = KVS_ERROR_INVALID_PARAM;
+        } else if (map_status != KVS_INTERNAL_OK) {
+            status = KVS_ERROR_STORAGE_FAILURE;
+        }
+    }
+    if (status != KVS_SUCCESS) {
+        kvs_sharded_close(store);
+        return status;
+    }
+    *store_out = store;
+    return KVS_SUCCESS;
+}
+
+void kvs_sharded_close(kvs_sharded *store)
+{
+    if (!store) {
+        return;
+    }
+    for (uint32_t i = 0; i < store->shard_count; i++) {
+        kvs_close(store->shards[i]);
+    }
+    free(store);
+}
+
+uint32_t kvs_sharded_shard_count(const kvs_sharded *store)
+{
+    return store ? store->shard_count : 0;
+}
+
+kvs_handle *kvs_sharded_shard(const kvs_sharded *store, uint32_t index)
+{
+    if (!store || index >= store->shard_count) {
+        return NULL;
+    }
+    return store->shards[index];
+}
+
+kvs_handle *kvs_sharded_shard_for_key(const kvs_sharded *store, const void *key, size_t key_len)
+{
+    if (!store || !key) {
+        return NULL;
+    }
+    return kvs_sharded_route(store, key, key_len);
+}
+
+int kvs_sharded_exists(kvs_sharded *store, const void *key, size_t key_len)
+{
+    if (!store) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    return kvs_exists_h(kvs_sharded_route(store, key, key_len), key, key_len);
+}
+
+kvs_status kvs_sharded_delete(kvs_sharded *store, const void *key, size_t key_len)
+{
+    if (!store) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    return kvs_delete_h(kvs_sharded_route(store, key, key_len), key, key_len);
+}
+
+kvs_status kvs_sharded_get(kvs_sharded *store, const void *key, size_t key_len, void *value, size_t *value_len)
+{
+    if (!store) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    return kvs_get_h(kvs_sharded_route(store, key, key_len), key, key_len, value, value_len);
+}
+
+kvs_status kvs_sharded_put(kvs_sharded *store, const void *key, size_t key_len, const void *value, size_t value_len)
+{
+    if (!store) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    return kvs_put_h(kvs_sharded_route(store, key, key_len), key, key_len, value, value_len);
+}
+
+kvs_status kvs_sharded_update(kvs_sharded *store, const void *key, size_t key_len, const void *value, size_t value_len)
+{
+    if (!store) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    return kvs_update_h(kvs_sharded_route(store, key, key_len), key, key_len, value, value_len);
+}
+
+kvs_status kvs_sharded_flush(kvs_sharded *store)
+{
+    if (!store) {
+        return KVS_ERROR_INVALID_PARAM;
+    }
+    kvs_status status = KVS_SUCCESS;
+    for (uint32_t i = 0; i < store->shard_count; i++) {
+        kvs_status shard_status = kvs_flush_h(store->shards[i]);
+        if (shard_status != KVS_SUCCESS && status == KVS_SUCCESS) {
+            status = shard_status;
+        }
+    }
+    return status;
+}
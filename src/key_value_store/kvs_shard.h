@@ -0,0 +1,19 @@
+#ifndef SSDMMCSTORE_KVS_SHARD_H
+#define SSDMMCSTORE_KVS_SHARD_H
+
+#include "kvs_types.h"
+#include "kvs_internal.h"
+
+
+// Возвращает номер шарда ключа среди shard_count шардов.
+// Номер зависит только от байт ключа, поэтому не меняется между запусками.
+uint32_t kvs_shard_index(const void *key, uint32_t key_len, uint32_t shard_count);
+
+// Сверяет карту шардов в суперблоках открытых шардов набора и записывает ее в шарды, у которых ее еще нет.
+// Пустое хранилище без карты (только что созданное) становится шардом набора; непустое - нет,
+// иначе его ключи оказались бы не в своих шардах.
+// Возвращает KVS_INTERNAL_OK при успехе, KVS_INTERNAL_ERR_INVALID_PARAM, если шарды принадлежат
+// другому набору или набору с другим числом шардов, или другой код ошибки.
+kvs_internal_status kvs_shard_map_apply(struct kvs_sharded *store);
+
+#endif //SSDMMCSTORE_KVS_SHARD_H
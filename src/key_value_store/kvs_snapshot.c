@@ -0,0 +1,254 @@
+#include "kvs_snapshot.h"
+#include "kvs_metadata.h"
+#include "kvs_internal_io.h"
+
+// Сравнивает сохраненную версию с ключом key и номером записи created_seq (порядок массива snapshot_versions).
+static int kvs_snapshot_version_cmp(const kvs_snapshot_version *version, const void *key, uint32_t key_len, uint64_t created_seq)
+{
+    int n = kvs_key_compare(version->key, version->metadata.key_len, key, key_len);
+    if (n != 0) {
+        return n;
+    }
+    return (version->created_seq > created_seq) - (version->created_seq < created_seq);
+}
+
+// Проверяет, нужна ли версия хотя бы одному открытому снимку.
+static bool kvs_snapshot_version_needed(const kvs_snapshot_version *version)
+{
+    for (const struct kvs_snapshot *s = device->snapshots; s; s = s->next) {
+        if (kvs_snapshot_version_visible(version, s->seq)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool kvs_snapshot_version_visible(const kvs_snapshot_version *version, uint64_t seq)
+{
+    return version->created_seq <= seq && seq < version->dead_seq;
+}
+
+bool kvs_snapshot_slot_visible(uint32_t slot_index, uint64_t seq)
+{
+    if (!device || !device->slot_write_seq || slot_index >= device->superblock.max_key_count) {
+        return false;
+    }
+    return device->slot_write_seq[slot_index] <= seq;
+}
+
+int kvs_snapshot_retain(const kvs_metadata *metadata, uint32_t slot_index)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (!metadata || slot_index >= device->superblock.max_key_count) {
+        return KVS_INTERNAL_ERR_INVALID_PARAM;
+    }
+    if (!device->snapshots) {
+        return 0;
+    }
+
+    // Шаг 2: Удаление получит следующий номер изменения. Версия нужна, если ее видит хотя бы один снимок
+    kvs_snapshot_version version;
+    version.metadata     = *metadata;
+    version.entry_crc    = device->page_crc.entry_crc[slot_index];
+    version.value_offset = metadata->value_offset;
+    version.created_seq  = device->slot_write_seq[slot_index];
+    version.dead_seq     = device->mutation_count + 1;
+    if (!kvs_snapshot_version_needed(&version)) {
+        return 0;
+    }
+    // Хвост длинного ключа нужен для порядка версий, дочитываем его, пока область данных на месте
+    kvs_internal_status key_status = kvs_metadata_read_key(metadata, version.key);
+    if (key_status != KVS_INTERNAL_OK) {
+        return key_status;
+    }
+
+    // Шаг 3: При необходимости расширяем массив версий
+    if (device->snapshot_version_count == device->snapshot_version_capacity) {
+        uint32_t capacity = device->snapshot_version_capacity ? device->snapshot_version_capacity * 2 : 16;
+        kvs_snapshot_version *grown = realloc(device->snapshot_versions, capacity * sizeof(kvs_snapshot_version));
+        if (!grown) {
+            return KVS_INTERNAL_ERR_MALLOC_FAILED;
+        }
+        device->snapshot_versions = grown;
+        device->snapshot_version_capacity = capacity;
+    }
+
+    // Шаг 4: Вставляем версию на ее место: по ключу, а у одного ключа - по номеру записи
+    uint32_t left = 0, right = device->snapshot_version_count;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        if (kvs_snapshot_version_cmp(&device->snapshot_versions[mid], version.key, metadata->key_len, version.created_seq) < 0) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+    memmove(&device->snapshot_versions[left + 1], &device->snapshot_versions[left],
+            (device->snapshot_version_count - left) * sizeof(kvs_snapshot_version));
+    device->snapshot_versions[left] = version;
+    device->snapshot_version_count++;
+    return 1;
+}
+
+kvs_internal_status kvs_snapshot_prune(void)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+
+    // Шаг 2: Оставляем версии, которые еще видит какой-либо снимок, сохраняя порядок массива.
+    // Области данных остальных стираем так же, как это сделало бы удаление ключа
+    kvs_internal_status status = KVS_INTERNAL_OK;
+    bool freed = false;
+    uint32_t kept = 0;
+    kvs_write_path previous_path = kvs_set_write_path(KVS_WRITE_PATH_DELETE);
+    for (uint32_t i = 0; i < device->snapshot_version_count; i++) {
+        const kvs_snapshot_version *version = &device->snapshot_versions[i];
+        if (kvs_snapshot_version_needed(version)) {
+            device->snapshot_versions[kept++] = *version;
+            continue;
+        }
+        if (kvs_value_is_inline(&version->metadata)) {
+            continue;
+        }
+        uint32_t aligned_value_len = kvs_record_data_size(&version->metadata);
+        if (kvs_clear_region(device->sim, version->value_offset, aligned_value_len) < 0) {
+            // Стереть не удалось: область все равно освобождаем, перед записью ее очистит kvs_verify_and_prepare_region
+            kvs_log_at(KVS_LOG_WARNING, "SNAPSHOT ВНИМАНИЕ: Не удалось стереть данные версии по смещению %u", version->value_offset);
+            status = KVS_INTERNAL_ERR_ERASE_FAILED;
+        } else {
+            rewrite_count_increment_region(version->value_offset, aligned_value_len);
+        }
+        bitmap_clear_region(version->value_offset, aligned_value_len);
+        freed = true;
+    }
+    device->snapshot_version_count = kept;
+    kvs_set_write_path(previous_path);
+
+    // Шаг 3: Фиксируем освобожденное место на диске
+    if (freed && !device->persist_deferred && kvs_persist_all_service_data() != KVS_INTERNAL_OK) {
+        return KVS_INTERNAL_ERR_WRITE_FAILED;
+    }
+    return status;
+}
+
+uint32_t kvs_snapshot_version_lower_bound(const void *key, uint32_t key_len)
+{
+    uint32_t left = 0, right = device->snapshot_version_count;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        if (kvs_snapshot_version_cmp(&device->snapshot_versions[mid], key, key_len, 0) < 0) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+    return left;
+}
+
+uint32_t kvs_snapshot_find_version(const void *key, uint32_t key_len, uint64_t seq)
+{
+    if (!device || device->snapshot_version_count == 0) {
+        return UINT32_MAX;
+    }
+    // Версии одного ключа не пересекаются по времени жизни, снимок видит не больше одной из них
+    for (uint32_t pos = kvs_snapshot_version_lower_bound(key, key_len); pos < device->snapshot_version_count; pos++) {
+        const kvs_snapshot_version *version = &device->snapshot_versions[pos];
+        if (kvs_key_compare(version->key, version->metadata.key_len, key, key_len) != 0) {
+            break;
+        }
+        if (kvs_snapshot_version_visible(version, seq)) {
+            return pos;
+        }
+    }
+    return UINT32_MAX;
+}
+
+int kvs_snapshot_version_crc_valid(const kvs_snapshot_version *version, const void *value, uint32_t aligned_value_len)
+{
+    if (!version) {
+        return 0;
+    }
+    // CRC считался по метаданным в их исходном виде, поэтому перенос данных на него не влияет
+    uint32_t calculated_crc = crc32_update(0xFFFFFFFF, &version->metadata, sizeof(kvs_metadata));
+    if (value && aligned_value_len > 0) {
+        calculated_crc = crc32_update(calculated_crc, value, aligned_value_len);
+    }
+    return ~calculated_crc == version->entry_crc ? 1 : 0;
+}
+
+int kvs_snapshot_read_version(const kvs_snapshot_version *version, void *value)
+{
+    // Шаг 1: Проверяем базовые параметры
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    if (!version || !value) {
+        return KVS_INTERNAL_ERR_NULL_PARAM;
+    }
+
+    // Шаг 2: Значение, хранившееся в слоте, сохранено вместе с метаданными версии
+    if (kvs_value_is_inline(&version->metadata)) {
+        if (!kvs_snapshot_version_crc_valid(version, NULL, 0)) {
+            return 0;
+        }
+        memcpy(value, kvs_inline_value(&version->metadata), version->metadata.value_size);
+        return 1;
+    }
+
+    // Шаг 3: Иначе читаем данные с текущего места и сверяем их с CRC версии
+    uint32_t aligned_value_len = kvs_record_data_size(&version->metadata);
+    uint8_t *buffer = kvs_scratch_acquire(aligned_value_len);
+    if (!buffer) {
+        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    }
+    if (kvs_read_region(device->sim, version->value_offset, buffer, aligned_value_len) < 0) {
+        kvs_scratch_release(buffer);
+        return KVS_INTERNAL_ERR_READ_FAILED;
+    }
+    int valid = kvs_snapshot_version_crc_valid(version, buffer, aligned_value_len);
+    if (valid) {
+        memcpy(value, buffer, version->metadata.value_size);
+    }
+    kvs_scratch_release(buffer);
+    return valid;
+}
+
+kvs_internal_status kvs_snapshot_mark_extents(void)
+{
+    if (!device) {
+        return KVS_INTERNAL_ERR_NULL_DEVICE;
+    }
+    for (uint32_t i = 0; i < device->snapshot_version_count; i++) {
+        const kvs_snapshot_version *version = &device->snapshot_versions[i];
+        if (kvs_value_is_inline(&version->metadata)) {
+            continue;
+        }
+        if (bitmap_set_region(version->value_offset, kvs_record_data_size(&version->metadata)) < 0) {
+            return KVS_INTERNAL_ERR_WRITE_FAILED;
+        }
+    }
+    return KVS_INTERNAL_OK;
+}
+
+void kvs_snapshot_destroy(void)
+{
+    if (!device) {
+        return;
+    }
+    struct kvs_snapshot *s = device->snapshots;
+    while (s) {
+        struct kvs_snapshot *next = s->next;
+        free(s);
+        s = next;
+    }
+    device->snapshots = NULL;
+    free(device->snapshot_versions);
+    device->snapshot_versions         = NULL;
+    device->snapshot_version_count    = 0;
+    device->snapshot_version_capacity = 0;
+}
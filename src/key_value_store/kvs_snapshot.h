@@ -0,0 +1,52 @@
+#ifndef SSDMMCSTORE_KVS_SNAPSHOT_H
+#define SSDMMCSTORE_KVS_SNAPSHOT_H
+
+#include "kvs_types.h"
+#include "kvs_internal.h"
+
+
+// Проверяет, видит ли снимок с номером изменения seq сохраненную версию.
+bool kvs_snapshot_version_visible(const kvs_snapshot_version *version, uint64_t seq);
+
+// Проверяет, видит ли снимок с номером изменения seq текущую запись слота slot_index.
+bool kvs_snapshot_slot_visible(uint32_t slot_index, uint64_t seq);
+
+// Сохраняет версию ключа перед ее удалением с устройства, если ее видит хотя бы один открытый снимок.
+// Вызывается до того, как слот будет очищен и device->mutation_count увеличен.
+// metadata   - метаданные слота, прочитанные с устройства (ключ уже проверен по CRC).
+// slot_index - слот метаданных версии.
+// Возвращает 1, если версия сохранена (ее область данных нельзя стирать и освобождать в биткарте),
+// 0, если снимков, которым она нужна, нет, или отрицательный код ошибки.
+int kvs_snapshot_retain(const kvs_metadata *metadata, uint32_t slot_index);
+
+// Удаляет сохраненные версии, которые не видит ни один открытый снимок, стирает и освобождает их области данных.
+// Вызывается после освобождения снимка.
+// Возвращает KVS_INTERNAL_OK при успехе или код ошибки.
+kvs_internal_status kvs_snapshot_prune(void);
+
+// Возвращает позицию первой сохраненной версии с ключом не меньше key (device->snapshot_version_count, если таких нет).
+uint32_t kvs_snapshot_version_lower_bound(const void *key, uint32_t key_len);
+
+// Ищет среди сохраненных версию ключа, которую видит снимок с номером изменения seq.
+// Возвращает позицию версии в device->snapshot_versions или UINT32_MAX, если такой версии нет.
+uint32_t kvs_snapshot_find_version(const void *key, uint32_t key_len, uint64_t seq);
+
+// Сверяет CRC сохраненной версии с ее данными.
+// value             - выровненные данные версии (NULL, если значение хранится в слоте).
+// aligned_value_len - длина value в байтах (0, если значение хранится в слоте).
+// Возвращает 1, если CRC совпадает, и 0 в противном случае.
+int kvs_snapshot_version_crc_valid(const kvs_snapshot_version *version, const void *value, uint32_t aligned_value_len);
+
+// Читает значение сохраненной версии и проверяет его CRC.
+// value - буфер не меньше version->metadata.value_size байт.
+// Возвращает 1 при успехе, 0 если CRC не совпал, или отрицательный код ошибки.
+int kvs_snapshot_read_version(const kvs_snapshot_version *version, void *value);
+
+// Помечает в битовой карте данных области, занятые сохраненными версиями.
+// Вызывается при пересборке биткарты по key_index, в котором этих версий уже нет.
+kvs_internal_status kvs_snapshot_mark_extents(void);
+
+// Освобождает все снимки и сохраненные версии в ОЗУ, не трогая устройство.
+void kvs_snapshot_destroy(void);
+
+#endif //SSDMMCSTORE_KVS_SNAPSHOT_H
@@ -0,0 +1,298 @@
+#include "kvs_stats.h"
+#include "kvs_metadata.h"
+#include <time.h>
+
+// Следующая свободная полоса счетчиков и полоса вызывающего потока (UINT32_MAX - еще не выбрана).
+// Полоса закрепляется за потоком один раз и одинакова для всех хранилищ, с которыми он работает.
+static _Atomic uint32_t kvs_stats_next_stripe;
+static _Thread_local uint32_t kvs_stats_stripe = UINT32_MAX;
+
+// Переводит код состояния в результат операции для счетчиков.
+static kvs_op_result kvs_stats_result(kvs_status status)
+{
+    switch (status) {
+        case KVS_SUCCESS:
+            return KVS_OP_RESULT_OK;
+        case KVS_ERROR_KEY_NOT_FOUND:
+            return KVS_OP_RESULT_NOT_FOUND;
+        case KVS_ERROR_KEY_ALREADY_EXISTS:
+            return KVS_OP_RESULT_ALREADY_EXISTS;
+        case KVS_ERROR_NO_SPACE:
+            return KVS_OP_RESULT_NO_SPACE;
+        default:
+            return KVS_OP_RESULT_ERROR;
+    }
+}
+
+void kvs_stats_count_op(kvs_op_type op, kvs_status status)
+{
+    if (!device || op >= KVS_OP_COUNT) {
+        return;
+    }
+    if (kvs_stats_stripe == UINT32_MAX) {
+        kvs_stats_stripe = atomic_fetch_add_explicit(&kvs_stats_next_stripe, 1, memory_order_relaxed) % KVS_STATS_STRIPES;
+    }
+    atomic_fetch_add_explicit(&device->op_counters[kvs_stats_stripe].ops[op][kvs_stats_result(status)], 1, memory_order_relaxed);
+}
+
+// Имена операций в выгрузке метрик.
+static const char *const kvs_latency_op_names[KVS_LATENCY_OP_COUNT] = {"get", "put", "delete", "update", "gc", "persist"};
+
+uint64_t kvs_stats_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Возвращает корзину гистограммы для значения value. Значение со старшим битом m (m >= KVS_LATENCY_SUB_BITS)
+// попадает в строку m - KVS_LATENCY_SUB_BITS + 1, корзину в строке выбирают следующие KVS_LATENCY_SUB_BITS бит.
+static uint32_t kvs_latency_bucket(uint64_t value)
+{
+    const uint32_t sub_count = 1u << KVS_LATENCY_SUB_BITS;
+    if (value < sub_count) {
+        return (uint32_t)value;
+    }
+    uint32_t msb = 63 - (uint32_t)__builtin_clzll(value);
+    if (msb > KVS_LATENCY_MAX_BITS) {
+        return KVS_LATENCY_BUCKETS - 1;
+    }
+    uint32_t shift = msb - KVS_LATENCY_SUB_BITS;
+    uint32_t sub = (uint32_t)(value >> shift) & (sub_count - 1);
+    return ((shift + 1) << KVS_LATENCY_SUB_BITS) + sub;
+}
+
+// Возвращает наибольшее значение, попадающее в корзину bucket.
+static uint64_t kvs_latency_bucket_upper(uint32_t bucket)
+{
+    const uint32_t sub_count = 1u << KVS_LATENCY_SUB_BITS;
+    if (bucket < sub_count) {
+        return bucket;
+    }
+    uint32_t shift = (bucket >> KVS_LATENCY_SUB_BITS) - 1;
+    uint64_t lower = (uint64_t)(sub_count + (bucket & (sub_count - 1))) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+void kvs_latency_record(kvs_latency_op op, uint64_t start_ns)
+{
+    if (!device || op >= KVS_LATENCY_OP_COUNT) {
+        return;
+    }
+    uint64_t now = kvs_stats_now_ns();
+    uint64_t elapsed = now > start_ns ? now - start_ns : 0;
+    kvs_latency_histogram *histogram = &device->latency[op];
+    atomic_fetch_add_explicit(&histogram->buckets[kvs_latency_bucket(elapsed)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total_ns, elapsed, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+    while (elapsed > max && !atomic_compare_exchange_weak_explicit(&histogram->max_ns, &max, elapsed,
+                                                                   memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void kvs_latency_take(kvs_latency_counts *counts)
+{
+    for (uint32_t op = 0; op < KVS_LATENCY_OP_COUNT; op++) {
+        kvs_latency_histogram *histogram = &device->latency[op];
+        for (uint32_t b = 0; b < KVS_LATENCY_BUCKETS; b++) {
+            counts[op].buckets[b] = atomic_load_explicit(&histogram->buckets[b], memory_order_relaxed);
+        }
+        counts[op].total_ns = atomic_load_explicit(&histogram->total_ns, memory_order_relaxed);
+        counts[op].max_ns   = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+    }
+}
+
+void kvs_latency_release(const kvs_latency_counts *counts)
+{
+    for (uint32_t op = 0; op < KVS_LATENCY_OP_COUNT; op++) {
+        kvs_latency_histogram *histogram = &device->latency[op];
+        for (uint32_t b = 0; b < KVS_LATENCY_BUCKETS; b++) {
+            if (counts[op].buckets[b] > 0) {
+                atomic_fetch_sub_explicit(&histogram->buckets[b], counts[op].buckets[b], memory_order_relaxed);
+            }
+        }
+        atomic_fetch_sub_explicit(&histogram->total_ns, counts[op].total_ns, memory_order_relaxed);
+        atomic_store_explicit(&histogram->max_ns, 0, memory_order_relaxed);
+    }
+}
+
+// Возвращает значение, не больше которого доля quantile замеров: верхнюю границу корзины замера с этим рангом,
+// но не больше наибольшего замера.
+static uint64_t kvs_latency_quantile(const kvs_latency_counts *counts, uint64_t count, double quantile)
+{
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(quantile * (double)count + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < KVS_LATENCY_BUCKETS; b++) {
+        seen += counts->buckets[b];
+        if (seen >= rank) {
+            uint64_t upper = kvs_latency_bucket_upper(b);
+            return upper < counts->max_ns ? upper : counts->max_ns;
+        }
+    }
+    return counts->max_ns;
+}
+
+void kvs_latency_summarize(const kvs_latency_counts *counts, kvs_latency_summary *summary)
+{
+    summary->count = 0;
+    for (uint32_t b = 0; b < KVS_LATENCY_BUCKETS; b++) {
+        summary->count += counts->buckets[b];
+    }
+    summary->total_ns = counts->total_ns;
+    summary->p50_ns   = kvs_latency_quantile(counts, summary->count, 0.5);
+    summary->p99_ns   = kvs_latency_quantile(counts, summary->count, 0.99);
+    summary->p999_ns  = kvs_latency_quantile(counts, summary->count, 0.999);
+    summary->max_ns   = counts->max_ns;
+}
+
+// Дописывает форматированный текст в buffer после used символов. Возвращает новую длину текста
+// (она растет, даже если текст уже не помещается, чтобы вызывающий узнал нужный размер).
+static size_t kvs_latency_append(char *buffer, size_t size, size_t used, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(used < size ? buffer + used : NULL, used < size ? size - used : 0, format, args);
+    va_end(args);
+    return n > 0 ? used + (size_t)n : used;
+}
+
+size_t kvs_latency_format(kvs_metrics_format format, const kvs_latency_summary *summaries, char *buffer, size_t size)
+{
+    size_t used = 0;
+    if (format == KVS_METRICS_PROMETHEUS) {
+        used = kvs_latency_append(buffer, size, used, "# HELP kvs_latency_seconds Время выполнения операций хранилища.\n"
+                                                      "# TYPE kvs_latency_seconds summary\n");
+        for (uint32_t op = 0; op < KVS_LATENCY_OP_COUNT; op++) {
+            const kvs_latency_summary *s = &summaries[op];
+            const char *name = kvs_latency_op_names[op];
+            used = kvs_latency_append(buffer, size, used,
+                                      "kvs_latency_seconds{op=\"%s\",quantile=\"0.5\"} %.9f\n"
+                                      "kvs_latency_seconds{op=\"%s\",quantile=\"0.99\"} %.9f\n"
+                                      "kvs_latency_seconds{op=\"%s\",quantile=\"0.999\"} %.9f\n"
+                                      "kvs_latency_seconds_sum{op=\"%s\"} %.9f\n"
+                                      "kvs_latency_seconds_count{op=\"%s\"} %llu\n",
+                                      name, s->p50_ns / 1e9, name, s->p99_ns / 1e9, name, s->p999_ns / 1e9,
+                                      name, s->total_ns / 1e9, name, (unsigned long long)s->count);
+        }
+        used = kvs_latency_append(buffer, size, used, "# HELP kvs_latency_max_seconds Наибольшее время выполнения операции.\n"
+                                                      "# TYPE kvs_latency_max_seconds gauge\n");
+        for (uint32_t op = 0; op < KVS_LATENCY_OP_COUNT; op++) {
+            used = kvs_latency_append(buffer, size, used, "kvs_latency_max_seconds{op=\"%s\"} %.9f\n",
+                                      kvs_latency_op_names[op], summaries[op].max_ns / 1e9);
+        }
+        return used;
+    }
+
+    used = kvs_latency_append(buffer, size, used, "{\"latency_ns\": {");
+    for (uint32_t op = 0; op < KVS_LATENCY_OP_COUNT; op++) {
+        const kvs_latency_summary *s = &summaries[op];
+        used = kvs_latency_append(buffer, size, used,
+                                  "%s\"%s\": {\"count\": %llu, \"total\": %llu, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}",
+                                  op == 0 ? "" : ", ", kvs_latency_op_names[op], (unsigned long long)s->count,
+                                  (unsigned long long)s->total_ns, (unsigned long long)s->p50_ns, (unsigned long long)s->p99_ns,
+                                  (unsigned long long)s->p999_ns, (unsigned long long)s->max_ns);
+    }
+    return kvs_latency_append(buffer, size, used, "}}\n");
+}
+
+// Считает свободные слова области данных и наибольший непрерывный свободный участок.
+static void kvs_stats_free_space(uint64_t *free_words, uint64_t *largest_run)
+{
+    uint32_t total_words = device->superblock.userdata_size_bytes / device->superblock.word_size_bytes;
+    uint64_t run = 0;
+    *free_words  = 0;
+    *largest_run = 0;
+    for (uint32_t i = 0; i < total_words; i++) {
+        if (get_bit(device->bitmap, i) != 0) {
+            run = 0;
+            continue;
+        }
+        (*free_words)++;
+        run++;
+        if (run > *largest_run) {
+            *largest_run = run;
+        }
+    }
+}
+
+void kvs_stats_collect(kvs_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    // Шаг 1: Складываем полосы счетчиков операций
+    for (uint32_t s = 0; s < KVS_STATS_STRIPES; s++) {
+        for (uint32_t op = 0; op < KVS_OP_COUNT; op++) {
+            for (uint32_t r = 0; r < KVS_OP_RESULT_COUNT; r++) {
+                stats->ops[op][r] += atomic_load_explicit(&device->op_counters[s].ops[op][r], memory_order_relaxed);
+            }
+        }
+    }
+
+    // Шаг 2: Счетчики эмулятора, сборки мусора и сохранения служебных данных
+    ssdmmc_sim_io_counters io;
+    if (ssdmmc_sim_get_io_counters(device->sim, &io) == SSDMMC_OK) {
+        stats->device_words_read    = io.words_read;
+        stats->device_words_written = io.words_written;
+        stats->device_pages_erased  = io.pages_erased;
+    }
+    stats->gc_cycles      = device->gc_cycles;
+    stats->gc_bytes_moved = device->gc_bytes_moved;
+    stats->persist_count  = device->persist_count;
+    stats->persist_bytes  = device->write_counters[KVS_WRITE_PATH_PERSIST].programmed_bytes;
+
+    // Шаг 3: Кеш и ключи
+    stats->cache_hits   = device->cache_hits;
+    stats->cache_misses = device->cache_misses;
+    if (stats->cache_hits + stats->cache_misses > 0) {
+        stats->cache_hit_rate = (double)stats->cache_hits / (double)(stats->cache_hits + stats->cache_misses);
+    }
+    stats->key_count     = device->key_count;
+    stats->max_key_count = device->superblock.max_key_count;
+
+    // Шаг 4: Свободное место и фрагментация области данных
+    uint64_t free_words, largest_run;
+    uint32_t word_size = device->superblock.word_size_bytes;
+    kvs_stats_free_space(&free_words, &largest_run);
+    stats->data_bytes         = device->superblock.userdata_size_bytes;
+    stats->free_bytes         = free_words * word_size;
+    stats->largest_free_bytes = largest_run * word_size;
+    if (free_words > 0) {
+        stats->fragmentation = 1.0 - (double)largest_run / (double)free_words;
+    }
+
+    // Шаг 5: Износ страниц данных
+    stats->wear_spread = kvs_wear_spread(&stats->wear_min, &stats->wear_max);
+
+    // Шаг 6: Сводки гистограмм задержек (без сброса)
+    kvs_latency_counts *counts = malloc(KVS_LATENCY_OP_COUNT * sizeof(kvs_latency_counts));
+    if (counts) {
+        kvs_latency_take(counts);
+        for (uint32_t op = 0; op < KVS_LATENCY_OP_COUNT; op++) {
+            kvs_latency_summarize(&counts[op], &stats->latency[op]);
+        }
+        free(counts);
+    }
+}
+
+void kvs_trace_begin(kvs_op_type op, const void *key, size_t key_len)
+{
+    if (!device || !atomic_load_explicit(&device->tracing, memory_order_relaxed)) {
+        return;
+    }
+    uint32_t length = (key && key_len <= KVS_KEY_SIZE) ? (uint32_t)key_len : 0;
+    ssdmmc_sim_trace_set_op((uint8_t)op, length > 0 ? kvs_key_hash(key, length) : 0);
+}
+
+void kvs_trace_end(size_t value_len, kvs_status status)
+{
+    if (device && atomic_load_explicit(&device->tracing, memory_order_relaxed)) {
+        ssdmmc_sim_trace_event(device->sim, (uint32_t)value_len, (int8_t)status);
+    }
+    ssdmmc_sim_trace_set_op(KVS_TRACE_NONE, 0);
+}
@@ -0,0 +1,46 @@
+#ifndef SSDMMCSTORE_KVS_STATS_H
+#define SSDMMCSTORE_KVS_STATS_H
+
+#include "kvs_types.h"
+#include "kvs_internal.h"
+
+
+// Учитывает операцию API op с результатом status в счетчиках текущего устройства.
+// Поток пишет только в свою полосу device->op_counters, счетчики увеличиваются без барьеров (memory_order_relaxed),
+// поэтому функцию можно вызывать без блокировки хранилища. Без текущего устройства ничего не делает.
+void kvs_stats_count_op(kvs_op_type op, kvs_status status);
+
+// Заполняет stats по текущему устройству: складывает полосы счетчиков операций, читает счетчики эмулятора
+// и считает свободное место области данных по битовой карте. Вызывается под исключительной блокировкой.
+void kvs_stats_collect(kvs_stats *stats);
+
+// Возвращает показания монотонных часов в наносекундах: от них отсчитываются задержки операций.
+uint64_t kvs_stats_now_ns(void);
+
+// Записывает в гистограмму операции op текущего устройства время от start_ns (kvs_stats_now_ns) до текущего момента.
+// Как и kvs_stats_count_op, работает без блокировки хранилища. Без текущего устройства ничего не делает.
+void kvs_latency_record(kvs_latency_op op, uint64_t start_ns);
+
+// Копирует гистограммы задержек текущего устройства в counts (по одной на операцию).
+void kvs_latency_take(kvs_latency_counts *counts);
+
+// Удаляет из гистограмм текущего устройства замеры, скопированные kvs_latency_take в counts.
+// Замеры, записанные после копирования, остаются; наибольший замер обнуляется.
+void kvs_latency_release(const kvs_latency_counts *counts);
+
+// Считает сводку (количество, процентили, наибольшее время) по копии гистограммы.
+void kvs_latency_summarize(const kvs_latency_counts *counts, kvs_latency_summary *summary);
+
+// Печатает сводки всех операций в buffer размером size в формате format, как snprintf.
+// Возвращает длину текста без нулевого байта (текст мог не поместиться, если она не меньше size).
+size_t kvs_latency_format(kvs_metrics_format format, const kvs_latency_summary *summaries, char *buffer, size_t size);
+
+// Если у текущего устройства идет трасса, делает операцию op над ключом key (длиной не больше key_len)
+// контекстом записей трассы операций устройства вызывающего потока.
+void kvs_trace_begin(kvs_op_type op, const void *key, size_t key_len);
+
+// Завершает операцию, начатую kvs_trace_begin: добавляет в трассу событие с длиной значения value_len
+// и результатом status и сбрасывает контекст потока.
+void kvs_trace_end(size_t value_len, kvs_status status);
+
+#endif //SSDMMCSTORE_KVS_STATS_H
@@ -29,7 +29,7 @@
  * | (device->superblock.userdata_size_bytes)                | Её размер задается пользователем при инициализации.     |
  * +---------------------------------------------------------+---------------------------------------------------------+
  * | Metadata Area                                           | Область для хранения метаданных (ключ,                  |
- * | (размер вычисляется)                                    | смещение, размер значения).                             |
+ * | (размер вычисляется)                                    | смещение, размер значения, малое значение целиком).     |
  * +---------------------------------------------------------+---------------------------------------------------------+
  * | Superblock (Резервный)                                  | Резервная копия основного суперблока. Хранится          |
  * | (размер вычисляется динамически)                        | в самом конце файла для отказоустойчивости.             |
@@ -39,14 +39,69 @@
 
 #include "kvs.h"
 #include "../ssdmmc_sim/ssdmmc_sim.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Значения размером до KVS_INLINE_VALUE_SIZE байт хранятся прямо в слоте метаданных.
+// Размер задается при сборке и увеличивает каждый слот на столько же байт, поэтому в ту же
+// область метаданных помещается меньше ключей. По умолчанию 0: значения всегда в области данных.
+#ifndef KVS_INLINE_VALUE_SIZE
+#define KVS_INLINE_VALUE_SIZE 0
+#endif
+#if KVS_INLINE_VALUE_SIZE < 0 || KVS_INLINE_VALUE_SIZE > 255
+#error "KVS_INLINE_VALUE_SIZE must be in range 0..255"
+#endif
+
+// Сколько первых байт ключа хранится в слоте метаданных. Ключ длиннее хранит остальные байты
+// (хвост) в области данных записи, сразу за выровненным значением. Типичный ключ целиком помещается
+// в слот, а слот не растет вместе с KVS_KEY_SIZE. По умолчанию 23: вместе с длиной ключа это 24 байта.
+#ifndef KVS_SLOT_KEY_SIZE
+#define KVS_SLOT_KEY_SIZE 23
+#endif
+#if KVS_SLOT_KEY_SIZE < 1 || KVS_SLOT_KEY_SIZE > 255
+#error "KVS_SLOT_KEY_SIZE must be in range 1..255"
+#endif
+#define KVS_SLOT_KEY_BYTES (KVS_KEY_SIZE < KVS_SLOT_KEY_SIZE ? KVS_KEY_SIZE : KVS_SLOT_KEY_SIZE)
+
+// value_offset слота, значение которого хранится в самом слоте (область данных всегда начинается после суперблока)
+#define KVS_INLINE_VALUE_OFFSET 0
 
 #define CLEAN_DATA     1
 #define CLEAN_METADATA 2
 
+#define KVS_DATA_COLD  0
+#define KVS_DATA_HOT   1
+
+#define KVS_MEMTABLE_PUT     1
+#define KVS_MEMTABLE_UPDATE  2
+#define KVS_MEMTABLE_DELETE  3
+
 #define KVS_MIN_NUM_METADATA      16
-#define KVS_KEY_SIZE              128
-#define KVS_SUPERBLOCK_MAGIC      122221
+#define KVS_GC_MAX_VICTIM_PAGES   16
+#define KVS_HOT_UPDATE_THRESHOLD  2
+#define KVS_WEAR_LEVEL_THRESHOLD  32
+#define KVS_WEAR_LEVEL_INTERVAL   64
+#define KVS_SCRATCH_BUFFER_COUNT  8
+#define KVS_SCRATCH_BUFFER_PAGES  4
+#define KVS_CACHE_BUDGET_BYTES    (64 * 1024)
+#define KVS_CACHE_MAX_ENTRIES     1024
+#define KVS_CACHE_CHUNK_BYTES     32
+#define KVS_MEMTABLE_MAX_ENTRIES  256
+#define KVS_ITER_BATCH_KEYS       32
+#define KVS_ITER_BATCH_BYTES      (64 * 1024)
+#define KVS_MAX_SHARDS            64
+#define KVS_ASYNC_BATCH_MAX       64
+#define KVS_STATS_STRIPES         8
+#define KVS_LATENCY_SUB_BITS      5
+#define KVS_LATENCY_MAX_BITS      40
+#define KVS_LATENCY_BUCKETS       ((KVS_LATENCY_MAX_BITS - KVS_LATENCY_SUB_BITS + 2) << KVS_LATENCY_SUB_BITS)
+#define KVS_SUPERBLOCK_MAGIC      122222
+#define KVS_SUPERBLOCK_MAGIC_V1   122221 // Хранилища, записанные до появления версии формата
+#define KVS_FORMAT_VERSION        3
 #define KVS_LOG_FILENAME          "../kvs_log.txt"
+#define KVS_LOG_RING_SIZE         1024
+#define KVS_LOG_MESSAGE_SIZE      256
+#define KVS_LOG_BATCH_MAX         64
 
 typedef struct {
     uint32_t superblock_crc;         // CRC для суперблока
@@ -56,6 +111,8 @@ typedef struct {
     uint32_t metadata_bitmap_crc;    // CRC для биткарты метаданных
 
     uint32_t* entry_crc;             // Единый CRC массив с кодами для связки данные + метаданные
+    uint32_t  entry_crc_dirty_first; // Первый слот entry_crc, измененный после последнего сохранения
+    uint32_t  entry_crc_dirty_end;   // Слот за последним измененным (пустой диапазон, если first >= end)
 
 } kvs_crc_info;
 
@@ -63,12 +120,14 @@ typedef struct {
     uint8_t  key[KVS_KEY_SIZE];      // Ключ
     uint32_t metadata_offset;        // Смещение метаданных для этого ключа
     uint8_t  flags;                  // Флаги (валидность, удаленность и т.д.)
+    uint8_t  key_len;                // Длина ключа в байтах
 } kvs_key_index_entry;
 
 
 typedef struct {
 
     uint32_t magic;                  // Магическое число
+    uint32_t format_version;         // Версия формата (KVS_FORMAT_VERSION): меняется при любом изменении раскладки на диске
 
     // Параметры устройства
     uint32_t storage_size_bytes;     // Физический размер устройства (байты)
@@ -96,14 +155,185 @@ typedef struct {
 
     uint32_t max_key_count;          // Максимально возможное количество ключей
 
-    uint32_t last_data_word_checked; // Последнее проверенное слово в userdata при поиске места
+    uint32_t last_data_word_checked; // Последнее проверенное слово в userdata при поиске места (холодная область)
+    uint32_t last_hot_data_word_checked; // Последнее проверенное слово в userdata при поиске места (горячая область)
     uint32_t last_metadata_slot_checked; // Последний проверенный слот в metadata при поиске места
 
+    // Раскладка слотов метаданных
+    uint16_t max_key_size;           // Наибольшая длина ключа (KVS_KEY_SIZE сборки, создавшей хранилище)
+    uint8_t  metadata_layout;        // KVS_LAYOUT_LINEAR или KVS_LAYOUT_HASH
+    uint8_t  inline_value_size;      // Размер области значения в слоте (KVS_INLINE_VALUE_SIZE сборки, создавшей хранилище)
+    uint16_t hash_bucket_slots;      // Количество слотов в одной корзине (помещается в страницу)
+    uint32_t hash_bucket_count;      // Количество корзин в области метаданных
+    uint32_t hash_max_probe;         // Наибольшее расстояние от домашней корзины, на котором когда-либо размещался ключ
+    uint8_t  slot_key_size;          // Сколько байт ключа хранится в слоте (KVS_SLOT_KEY_BYTES сборки, создавшей хранилище)
+
+    // Карта шардов: место хранилища в разделенном хранилище (kvs_sharded_open)
+    uint32_t shard_set_id;           // Идентификатор набора шардов, общий для всех его файлов
+    uint16_t shard_index;            // Номер шарда в наборе
+    uint16_t shard_count;            // Количество шардов в наборе (0 - хранилище не является шардом)
+
 } kvs_superblock;
 
 typedef struct {
 
-    FILE *fp;                        // Указатель на файл-эмулятор
+    uint8_t  key_len;                // Длина ключа в байтах (1..KVS_KEY_SIZE)
+    uint8_t  key[KVS_SLOT_KEY_BYTES]; // Первые байты ключа; байты после key_len заполнены нулями.
+                                     // Хвост длинного ключа лежит в области данных за значением (kvs_key_tail_size)
+    uint32_t value_offset;           // Смещение значения в файле
+    uint32_t value_size;             // Размер значения в байтах
+    uint32_t update_count;           // Сколько раз значение ключа обновлялось (для разделения горячих и холодных данных)
+#if KVS_INLINE_VALUE_SIZE > 0
+    uint8_t  inline_value[KVS_INLINE_VALUE_SIZE]; // Значение, если value_offset равен KVS_INLINE_VALUE_OFFSET; иначе нули
+#endif
+
+} kvs_metadata;
+
+// Запись кеша чтения: проверенные метаданные и копия значения одного слота метаданных.
+// Копия значения хранится в области кеша цепочкой блоков по KVS_CACHE_CHUNK_BYTES байт.
+typedef struct {
+    uint32_t slot;                   // Слот метаданных, которому принадлежит запись (UINT32_MAX - запись свободна)
+    uint32_t value_size;             // Размер значения в байтах
+    uint32_t first_chunk;            // Первый блок копии значения (UINT32_MAX - значение пустое)
+    uint8_t  referenced;             // Бит обращения для вытеснения по алгоритму CLOCK
+} kvs_cache_entry;
+
+// Запись буфера записи (memtable): отложенная операция над одним ключом.
+typedef struct {
+    uint8_t  key[KVS_KEY_SIZE];      // Ключ
+    uint8_t  key_len;                // Длина ключа в байтах
+    uint8_t  op;                     // Отложенная операция: KVS_MEMTABLE_PUT, KVS_MEMTABLE_UPDATE или KVS_MEMTABLE_DELETE
+    uint32_t value_size;             // Размер значения в байтах (0 для удаления)
+    uint32_t replaced_data_bytes;    // Для обновления: сколько байт области данных освободит при сбросе прежняя запись ключа
+    uint8_t  *value;                 // Копия значения (NULL для удаления)
+} kvs_memtable_entry;
+
+// Элемент пакета итератора: ключ и заранее прочитанное значение.
+typedef struct {
+    uint8_t  key[KVS_KEY_SIZE];      // Ключ
+    uint8_t  key_len;                // Длина ключа в байтах
+    bool     valid;                  // Запись прошла проверку CRC и ее значение прочитано
+    uint32_t metadata_offset;        // Смещение метаданных ключа
+    uint32_t version_pos;            // Позиция версии в device->snapshot_versions (UINT32_MAX - текущая запись ключа)
+    uint32_t value_size;             // Размер значения в байтах
+    uint8_t  *value;                 // Копия значения в области значений итератора (NULL, если запись невалидна)
+} kvs_iter_item;
+
+// Курсор упорядоченного обхода ключей (объявлен в kvs.h как kvs_iterator).
+// Границы хранятся как есть; нулевая длина означает отсутствие границы.
+struct kvs_iterator {
+    struct kvs_handle *owner;        // Хранилище, по которому идет обход
+    uint8_t  start[KVS_KEY_SIZE];    // Нижняя граница диапазона (включительно)
+    uint8_t  start_len;
+    uint8_t  end[KVS_KEY_SIZE];      // Верхняя граница диапазона (не включительно)
+    uint8_t  end_len;
+    uint8_t  last[KVS_KEY_SIZE];     // Последний пройденный ключ: обход продолжается со следующего за ним
+    uint8_t  last_len;
+    kvs_iter_item items[KVS_ITER_BATCH_KEYS]; // Пакет ключей, значения которых уже прочитаны
+    uint32_t item_count;             // Количество записей в пакете
+    uint32_t item_next;              // Следующая запись пакета, которую вернет kvs_iter_next
+    uint64_t mutation_count;         // device->mutation_count на момент чтения пакета
+    bool     exhausted;              // Ключей в диапазоне больше нет
+    bool     snapshot;               // Обход идет по снимку, а не по текущему состоянию
+    uint64_t snapshot_seq;           // Номер изменения снимка (если snapshot равен true)
+    uint8_t  *values;                // Область значений пакета, переиспользуется от пакета к пакету
+    uint32_t values_capacity;        // Размер области значений в байтах
+};
+
+// Снимок хранилища (объявлен в kvs.h как kvs_snapshot).
+// Видит каждую запись, записанную изменением с номером не больше seq и удаленную позже seq.
+struct kvs_snapshot {
+    struct kvs_handle *owner;        // Хранилище, состояние которого зафиксировано
+    uint64_t seq;                    // device->mutation_count на момент создания снимка
+    struct kvs_snapshot *next;       // Следующий открытый снимок
+};
+
+// Версия ключа, удаленная или перезаписанная после создания снимка, который ее видит.
+// Слот метаданных уже освобожден, а область данных остается занятой, пока версия нужна хотя бы одному снимку.
+typedef struct {
+    kvs_metadata metadata;           // Метаданные версии в том виде, в котором они были на устройстве
+    uint8_t  key[KVS_KEY_SIZE];      // Полный ключ версии (в слоте хранятся только его первые KVS_SLOT_KEY_BYTES байт)
+    uint32_t entry_crc;              // Единый CRC метаданных и данных версии
+    uint32_t value_offset;           // Текущее смещение данных (сборщик мусора может их перенести)
+    uint64_t created_seq;            // Номер изменения, которым версия была записана
+    uint64_t dead_seq;               // Номер изменения, которым версия была удалена
+} kvs_snapshot_version;
+
+// Хранилище, разделенное на шарды (объявлено в kvs.h как kvs_sharded).
+// Ключ всегда попадает в шард kvs_shard_index(ключ, shard_count).
+struct kvs_sharded {
+    uint32_t shard_count;            // Количество шардов
+    uint32_t shard_set_id;           // Идентификатор набора шардов (совпадает с суперблоком каждого шарда)
+    struct kvs_handle *shards[KVS_MAX_SHARDS]; // Шарды: независимые хранилища в отдельных файлах-эмуляторах
+};
+
+// Полоса счетчиков операций API. Каждый поток увеличивает счетчики своей полосы, поэтому
+// потоки на разных полосах не делят строку кеша; дополнение отделяет полосу от соседней.
+typedef struct {
+    _Atomic uint64_t ops[KVS_OP_COUNT][KVS_OP_RESULT_COUNT]; // Операции по типу и результату
+    char padding[64];
+} kvs_op_counters;
+
+// Гистограмма задержек одной операции. Значения меньше 2^KVS_LATENCY_SUB_BITS нс попадают каждое в свою
+// корзину, остальные - в одну из 2^KVS_LATENCY_SUB_BITS корзин своей степени двойки (см. kvs_latency_bucket).
+// Значения от 2^(KVS_LATENCY_MAX_BITS + 1) нс попадают в последнюю корзину.
+typedef struct {
+    _Atomic uint64_t buckets[KVS_LATENCY_BUCKETS]; // Количество замеров по корзинам
+    _Atomic uint64_t total_ns;       // Суммарное время замеров
+    _Atomic uint64_t max_ns;         // Наибольший замер
+} kvs_latency_histogram;
+
+// Копия гистограммы задержек, снятая для сводки или выгрузки.
+typedef struct {
+    uint64_t buckets[KVS_LATENCY_BUCKETS];
+    uint64_t total_ns;
+    uint64_t max_ns;
+} kvs_latency_counts;
+
+// Ячейка кольца: номер позиции, для которой она готова, и сам элемент.
+typedef struct {
+    _Atomic uint64_t seq;            // Позиция записи, которую ждет ячейка (pos), или pos + 1, если элемент записан
+    void *value;                     // Элемент
+} kvs_ring_cell;
+
+// Ограниченное кольцо указателей без блокировок (очередь Вьюкова): писать и читать
+// могут несколько потоков одновременно, каждая операция - один CAS позиции.
+typedef struct {
+    kvs_ring_cell *cells;            // Ячейки; их количество - степень двойки
+    uint32_t mask;                   // Количество ячеек минус один
+    _Atomic uint64_t enqueue_pos;    // Следующая позиция записи
+    _Atomic uint64_t dequeue_pos;    // Следующая позиция чтения
+} kvs_ring;
+
+// Запись кольца лога: сообщение, отформатированное потоком, который его записал.
+typedef struct {
+    kvs_log_level level;             // Уровень сообщения
+    struct timespec time;            // Время записи (CLOCK_REALTIME); дату по нему печатает фоновый поток
+    char text[KVS_LOG_MESSAGE_SIZE]; // Текст сообщения (длинный текст обрезается)
+} kvs_log_record;
+
+// Очередь асинхронных запросов к одному хранилищу (объявлена в kvs.h как kvs_async).
+struct kvs_async {
+    struct kvs_handle *handle;       // Хранилище, к которому обращается рабочий поток
+    uint32_t depth;                  // Наибольшее количество запросов в работе (отправленных и еще не забранных)
+    kvs_ring submissions;            // Отправленные запросы
+    kvs_ring completions;            // Выполненные запросы без функции обратного вызова
+    _Atomic uint32_t inflight;       // Запросы в работе: отправленные, но еще не забранные через kvs_async_poll
+    _Atomic uint64_t submitted;      // Сколько запросов отправлено
+    _Atomic uint64_t executed;       // Сколько запросов выполнено
+    _Atomic bool stopping;           // Очередь закрывается: рабочий поток выполняет оставшиеся запросы и завершается
+    _Atomic bool worker_sleeping;    // Рабочий поток ждет новых запросов на wake
+    uint64_t batches;                // Количество выполненных пакетов (меняет только рабочий поток)
+    pthread_t worker;                // Рабочий поток
+    pthread_mutex_t mutex;           // Нужен только для засыпания и пробуждения потоков, кольца его не используют
+    pthread_cond_t wake;             // Рабочему потоку: появились запросы или очередь закрывается
+    pthread_cond_t done;             // Ожидающим в kvs_async_drain: выполнен очередной пакет
+};
+
+// Экземпляр хранилища (объявлен в kvs.h как kvs_handle).
+typedef struct kvs_handle {
+
+    ssdmmc_sim_device *sim;          // Эмулируемое устройство (файл-эмулятор и состояние симулятора)
 
     kvs_superblock superblock;       // Суперблок нашего файла-эмулятора
     kvs_crc_info   page_crc;         // Структура для хранения crc-кодов, различных частей хранилища
@@ -112,21 +342,88 @@ typedef struct {
     uint8_t  *bitmap;                // Битовая карта занятости слов в области данных
     uint8_t  *metadata_bitmap;       // Битовая карта занятости слотов в области метаданных
     uint32_t *page_rewrite_count;    // Счетчики перезаписей страниц
-    kvs_key_index_entry *key_index;  // Массив записей ключей: для каждого ключа хранится его имя и смещение метаданных.
+    kvs_key_index_entry *key_index;  // Массив записей ключей: для каждого ключа хранится его имя и смещение метаданных (NULL в хеш-раскладке)
+    uint32_t *slot_to_index;         // Обратное отображение: номер слота метаданных -> позиция в key_index (UINT32_MAX, если слот не в индексе; NULL в хеш-раскладке)
 
     uint32_t key_count;              // Текущее количество ключей
+    uint64_t mutation_count;         // Счетчик изменений содержимого (put, delete, операции буфера записи); по нему итераторы замечают устаревший пакет,
+                                     // а снимки определяют, какие записи они видят
+    uint64_t *slot_write_seq;        // Слот метаданных -> номер изменения, которым записан его ключ (0 - ключ записан до загрузки хранилища)
 
-} kvs_device;
+    struct kvs_snapshot *snapshots;  // Открытые снимки (односвязный список)
+    kvs_snapshot_version *snapshot_versions; // Версии, сохраненные для открытых снимков, по возрастанию ключа и номера записи
+    uint32_t snapshot_version_count; // Количество сохраненных версий
+    uint32_t snapshot_version_capacity; // Размер массива snapshot_versions
 
+    uint32_t hot_update_threshold;   // Количество обновлений, начиная с которого данные ключа считаются горячими
+    uint64_t gc_bytes_moved;         // Байт живых данных, перенесенных сборщиком мусора
+    uint64_t erase_copy_bytes;       // Байт живых пользовательских данных, переписанных заново при стирании страниц
 
-typedef struct {
+    uint32_t wear_level_threshold;   // Разброс стираний страниц, начиная с которого включается статическое выравнивание износа
+    uint32_t wear_level_ops;         // Количество изменяющих операций с последнего шага выравнивания износа
+    uint32_t wear_level_migrations;  // Сколько страниц с холодными данными было перенесено выравниванием износа
+    uint64_t wear_level_bytes_moved; // Байт живых данных, перенесенных выравниванием износа
 
-    uint8_t  key[KVS_KEY_SIZE];      // Ключ (строка или бинарные данные)
-    uint32_t value_offset;           // Смещение значения в файле
-    uint32_t value_size;             // Размер значения в байтах
+    uint8_t  *scratch_arena;         // Выровненная по страницам область под временные буферы ввода-вывода
+    uint32_t scratch_buffer_size;    // Размер одного временного буфера (кратен размеру страницы)
+    _Atomic uint32_t scratch_in_use; // Битовая маска занятых временных буферов
+    _Atomic uint64_t heap_alloc_count; // Сколько временных буферов пришлось выделить в куче мимо пула
 
-} kvs_metadata;
+    kvs_cache_entry *cache_entries;  // Записи кеша чтения
+    uint32_t *cache_slot_map;        // Слот метаданных -> номер записи кеша (UINT32_MAX, если слот не закеширован)
+    uint32_t cache_capacity;         // Количество записей кеша
+    uint32_t cache_hand;             // Стрелка CLOCK: с какой записи продолжать поиск кандидата на вытеснение
+    uint64_t cache_budget_bytes;     // Максимальный суммарный размер закешированных значений (0 - кеш выключен)
+    uint64_t cache_used_bytes;       // Текущий суммарный размер закешированных значений
+    uint8_t  *cache_arena;           // Область копий значений: блоки по KVS_CACHE_CHUNK_BYTES, выделяется под бюджет кеша
+    uint32_t *cache_chunk_next;      // Следующий блок цепочки значения или списка свободных блоков (UINT32_MAX - конец)
+    uint32_t cache_chunk_count;      // Количество блоков в области
+    uint32_t cache_free_chunk;       // Первый свободный блок (UINT32_MAX - свободных нет)
+    uint32_t cache_free_chunks;      // Количество свободных блоков
+    uint64_t cache_hits;             // Количество чтений, обслуженных из кеша
+    uint64_t cache_misses;           // Количество чтений, потребовавших обращения к устройству
+
+    kvs_memtable_entry *memtable;    // Буфер записи, отсортированный по ключу (NULL - буфер выключен)
+    uint32_t memtable_count;         // Количество отложенных операций в буфере
+    uint64_t memtable_bytes;         // Суммарный размер ключей и значений в буфере
+    uint64_t memtable_budget_bytes;  // Размер буфера, при достижении которого он сбрасывается на устройство
+    uint32_t memtable_pending_inserts;    // Сколько новых ключей (KVS_MEMTABLE_PUT) ждут сброса в буфере
+    uint64_t memtable_pending_data_bytes; // Сколько байт области данных займут значения этих ключей и выросшие при обновлении значения
+    uint64_t memtable_free_data_bytes;    // Свободное место области данных на момент последнего сброса буфера
+    uint64_t memtable_absorbed;      // Сколько отложенных записей было перекрыто или отменено до сброса и не дошло до устройства
+    uint64_t memtable_flushed;       // Сколько отложенных операций было применено к устройству
+    bool     persist_deferred;       // Пока true, put и delete не сохраняют служебные данные (пакетный сброс буфера)
+
+    _Atomic uint64_t hash_lookups;   // Количество поисков ключа по хешу на устройстве
+    _Atomic uint64_t hash_bucket_reads; // Количество прочитанных при этом корзин
+
+    bool     stripe_allocations;     // Политика чередования: соседние выделения в области данных размещаются на разных кристаллах
+    uint32_t inline_value_limit;     // Значения не больше этого размера записываются в слот метаданных (0 - всегда в область данных)
+    _Atomic uint64_t io_read_ops;    // Количество чтений регионов устройства
+    _Atomic uint64_t io_read_bytes;  // Прочитано байт
+    uint64_t io_write_ops;           // Количество записей регионов устройства
+    uint64_t io_write_bytes;         // Записано байт
+    kvs_write_path write_path;       // Путь, которому засчитываются текущие записи на устройство: задается в начале put и delete,
+                                     // сборка мусора, выравнивание износа и сохранение служебных данных восстанавливают прежний
+    kvs_write_counters write_counters[KVS_WRITE_PATH_COUNT]; // Счетчики записи по путям
+    kvs_op_counters op_counters[KVS_STATS_STRIPES]; // Счетчики операций API по полосам (см. kvs_stats_count_op)
+    uint64_t gc_cycles;              // Запусков сборщика мусора
+    uint64_t persist_count;          // Сохранений служебных данных
+    kvs_latency_histogram latency[KVS_LATENCY_OP_COUNT]; // Гистограммы задержек операций
+    atomic_bool tracing;             // Идет трасса ввода-вывода (см. kvs_trace_begin)
+
+    bool     concurrent;             // Режим параллельного чтения: get и exists выполняются под разделяемой блокировкой,
+                                     // изменения - под исключительной. Поля, которые меняет чтение, для этого атомарные
+    pthread_rwlock_t lock;           // Блокировка хранилища (используется, если concurrent равен true)
+    pthread_mutex_t  cache_lock;     // Защищает кеш чтения от параллельных читателей (если concurrent равен true)
+
+} kvs_device;
+
+// Текущее устройство вызывающего потока: над ним работают все внутренние функции.
+// Устанавливается на время вызова API через kvs_bind_device, поэтому разные потоки могут работать с разными хранилищами.
+extern _Thread_local kvs_device * device;
 
-extern kvs_device * device;
+// Хранилище, открытое kvs_init (NULL, если оно не открыто). Функции API без дескриптора работают с ним.
+extern kvs_device *kvs_default_device;
 
 #endif //SSDMMCSTORE_KVS_TYPES_H
\ No newline at end of file
@@ -36,12 +36,25 @@ int is_metadata_entry_valid(const kvs_metadata *metadata)
     if (!metadata) {
         return KVS_INTERNAL_ERR_NULL_PARAM;
     }
+    // Проверяем длину ключа: у стертого слота она равна 0xFF
+    if (metadata->key_len == 0 || metadata->key_len > KVS_KEY_SIZE) {
+        return 0;
+    }
+    // Значение, хранящееся в слоте, не занимает область данных: проверяем только его размер.
+    // Хвосту длинного ключа нужна область данных, такой ключ значение в слоте не хранит
+    if (kvs_value_is_inline(metadata)) {
+        return metadata->value_size > 0 && metadata->value_size <= KVS_INLINE_VALUE_SIZE && kvs_key_tail_size(metadata->key_len) == 0;
+    }
     // Проверяем, что размеры и смещения находятся в допустимых границах
     if (metadata->value_size > device->superblock.userdata_size_bytes || metadata->value_offset >= device->superblock.metadata_offset   || metadata->value_offset < device->superblock.data_offset) {
         return 0;
     }
+    // Область данных (значение и хвост длинного ключа) должна целиком лежать в пользовательской области
+    uint32_t aligned_size = kvs_record_data_size(metadata);
+    if (aligned_size > device->superblock.metadata_offset - metadata->value_offset) {
+        return 0;
+    }
     // Проверяем, не является ли область данных просто стертой (состоит из 0xFF)
-    uint32_t aligned_size = align_up(metadata->value_size, device->superblock.word_size_bytes);
     int empty_check = is_data_region_empty(metadata->value_offset, aligned_size);
     if (empty_check < 0) {
         return empty_check;
@@ -65,53 +78,80 @@ int is_metadata_bitmap_valid()
 }
 
 int is_key_valid(uint32_t key_index)
+{
+    return is_key_valid_read(key_index, NULL);
+}
+
+int is_key_valid_read(uint32_t key_index, kvs_metadata *metadata_out)
 {
     // Шаг 1: Проверяем базовые параметры
-    if (!device || key_index >= device->key_count) {
+    if (!device || key_index >= kvs_key_pos_end()) {
         return KVS_INTERNAL_ERR_INVALID_PARAM;
     }
-    // Шаг 2: Проверяем флаг в key_index. Если ключ в процессе записи, он невалиден.
-    if (device->key_index[key_index].flags == 2) {
+    // Шаг 2: Ключ в процессе записи невалиден. В key_index у него флаг 2,
+    // в хеш-раскладке бит его слота в биткарте метаданных еще не установлен
+    bool hash_layout = device->superblock.metadata_layout == KVS_LAYOUT_HASH;
+    if (!kvs_key_pos_live(key_index) || (!hash_layout && device->key_index[key_index].flags == 2)) {
         return 0;
     }
     // Шаг 3: Читаем с диска метаданные для этого ключа
-    uint32_t metadata_offset = device->key_index[key_index].metadata_offset;
+    uint32_t metadata_offset = kvs_key_metadata_offset(key_index);
     kvs_metadata metadata;
-    if (kvs_read_region(device->fp, metadata_offset, &metadata, sizeof(kvs_metadata)) < 0) {
+    if (kvs_read_region(device->sim, metadata_offset, &metadata, sizeof(kvs_metadata)) < 0) {
         return KVS_INTERNAL_ERR_READ_FAILED;
     }
-    // Шаг 4: Проверяем, что ключ в метаданных на диске совпадает с ключом в key_index
-    if (memcmp(metadata.key, device->key_index[key_index].key, KVS_KEY_SIZE) != 0) {
+    // Шаг 4: Проверяем, что ключ в метаданных на диске совпадает с ключом в key_index.
+    // Хвост длинного ключа сверяется на шаге 5 по уже прочитанной области данных.
+    // В хеш-раскладке слот найден по самому ключу в корзине, сверять не с чем
+    const kvs_key_index_entry *entry = hash_layout ? NULL : &device->key_index[key_index];
+    uint32_t tail = entry ? kvs_key_tail_size(entry->key_len) : 0;
+    if (entry && (metadata.key_len != entry->key_len || memcmp(metadata.key, entry->key, entry->key_len - tail) != 0)) {
         return 0;
     }
-    // Шаг 5: Выделяем буфер под данные и читаем их с диска
-    uint32_t aligned_value_len = align_up(metadata.value_size, device->superblock.word_size_bytes);
-    uint8_t *value_buffer = calloc(1, aligned_value_len);
-    if (!value_buffer) {
-        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    // Шаг 5: Значение, хранящееся в слоте, уже покрыто CRC метаданных,
+    // иначе берем временный буфер и дочитываем данные с диска
+    uint32_t slot_index = (metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
+    int crc_valid;
+    if (kvs_value_is_inline(&metadata)) {
+        crc_valid = is_entry_crc_valid(slot_index, &metadata, NULL, 0);
+    } else {
+        uint32_t aligned_value_len = kvs_record_data_size(&metadata);
+        uint8_t *value_buffer = kvs_scratch_acquire(aligned_value_len);
+        if (!value_buffer) {
+            return KVS_INTERNAL_ERR_MALLOC_FAILED;
+        }
+        if (kvs_read_region(device->sim, metadata.value_offset, value_buffer, aligned_value_len) < 0) {
+            kvs_scratch_release(value_buffer);
+            return KVS_INTERNAL_ERR_READ_FAILED;
+        }
+        uint32_t tail_offset = align_up(metadata.value_size, device->superblock.word_size_bytes);
+        if (tail > 0 && memcmp(value_buffer + tail_offset, entry->key + KVS_SLOT_KEY_BYTES, tail) != 0) {
+            kvs_scratch_release(value_buffer);
+            return 0;
+        }
+        crc_valid = is_entry_crc_valid(slot_index, &metadata, value_buffer, aligned_value_len);
+        kvs_scratch_release(value_buffer);
     }
-    if (kvs_read_region(device->fp, metadata.value_offset, value_buffer, aligned_value_len) < 0) {
-        free(value_buffer);
-        return KVS_INTERNAL_ERR_READ_FAILED;
+
+    // Шаг 6: Возвращаем метаданные только для ключа с совпавшим CRC
+    if (!crc_valid) {
+        return 0;
     }
-    // Шаг 6: Создаем единый буфер для проверки целостности.
-    size_t total_size = sizeof(kvs_metadata) + aligned_value_len;
-    uint8_t *check_buffer = calloc(1,total_size);
-    if (!check_buffer) {
-        free(value_buffer);
-        return KVS_INTERNAL_ERR_MALLOC_FAILED;
+    if (metadata_out) {
+        *metadata_out = metadata;
     }
-    memcpy(check_buffer, &metadata, sizeof(kvs_metadata));
-    memcpy(check_buffer + sizeof(kvs_metadata), value_buffer, aligned_value_len);
-
-    // Шаг 7: Считаем CRC для этого единого буфера
-    uint32_t calculated_crc = crc32_calc(check_buffer, total_size);
-    // Шаг 8: Сравниваем вычисленный CRC с тем, что хранится в массиве entry_crc
-    uint32_t slot_index = (metadata_offset - device->superblock.metadata_offset) / sizeof(kvs_metadata);
-    bool is_valid = (calculated_crc == device->page_crc.entry_crc[slot_index]);
+    return 1;
+}
 
-    // Шаг 9: Освобождаем всю выделенную память
-    free(value_buffer);
-    free(check_buffer);
-    return is_valid ? 1 : 0;
-}
\ No newline at end of file
+int is_entry_crc_valid(uint32_t slot_index, const kvs_metadata *metadata, const void *value, uint32_t aligned_value_len)
+{
+    if (!device || !metadata || slot_index >= device->superblock.max_key_count) {
+        return 0;
+    }
+    // Считаем единый CRC для метаданных и данных без их склейки в общий буфер
+    uint32_t calculated_crc = crc32_update(0xFFFFFFFF, metadata, sizeof(kvs_metadata));
+    if (value && aligned_value_len > 0) {
+        calculated_crc = crc32_update(calculated_crc, value, aligned_value_len);
+    }
+    return ~calculated_crc == device->page_crc.entry_crc[slot_index] ? 1 : 0;
+}
@@ -30,4 +30,16 @@ int is_metadata_bitmap_valid(void);
 // Возвращает 1 если ключ валиден, 0 если нет, или отрицательный код ошибки.
 int is_key_valid(uint32_t key_index);
 
+// То же, что is_key_valid, но дополнительно возвращает прочитанные при проверке метаданные,
+// чтобы вызывающему не приходилось читать слот повторно.
+// metadata_out - куда скопировать метаданные ключа (может быть NULL); заполняется только для валидного ключа.
+// Возвращает 1 если ключ валиден, 0 если нет, или отрицательный код ошибки.
+int is_key_valid_read(uint32_t key_index, kvs_metadata *metadata_out);
+
+// Сверяет единый CRC слота slot_index с уже прочитанными метаданными и данными записи.
+// value             - выровненные данные записи (NULL, если значение хранится в слоте).
+// aligned_value_len - длина value в байтах (0, если значение хранится в слоте).
+// Возвращает 1, если CRC совпадает, и 0 в противном случае.
+int is_entry_crc_valid(uint32_t slot_index, const kvs_metadata *metadata, const void *value, uint32_t aligned_value_len);
+
 #endif //SSDMMCSTORE_KVS_VALID_H
\ No newline at end of file
@@ -2,7 +2,104 @@
 
 int g_write_countdown = -1;
 
-int ssdmmc_sim_read_word(FILE *fp, uint32_t page_num, uint32_t word_offset, void *word)
+// Учитывает операцию op над словом word_offset страницы page_num в модели времени, счетчиках операций и трассе.
+// Чтение обращается к массиву, только если страницы нет в регистре кристалла; слова одной страницы,
+// записанные подряд, набираются в регистре и программируются одной операцией; после стирания регистр
+// не содержит страницы. Переданные слова занимают шину канала. Если задано реальное ожидание,
+// вызывающий поток ждет накопленное время, как только оно превысит SSDMMC_SIM_SLEEP_QUANTUM_NS.
+static void ssdmmc_sim_account(ssdmmc_sim_device *dev, uint32_t page_num, uint32_t word_offset, ssdmmc_sim_op op, uint32_t bytes)
+{
+    uint32_t die_num = ssdmmc_sim_get_page_die(page_num);
+    ssdmmc_sim_die *die = &dev->dies[die_num];
+    uint64_t array_ns = 0;
+    uint64_t sleep_ns = 0;
+
+    pthread_mutex_lock(&dev->timing_lock);
+    if (dev->trace) {
+        ssdmmc_sim_trace_device_op(dev, op, page_num, word_offset, op == SSDMMC_SIM_OP_ERASE ? SSDMMC_SIM_WORDS_PER_PAGE : 1);
+    }
+    switch (op) {
+    case SSDMMC_SIM_OP_READ:
+        dev->io.words_read++;
+        if (die->register_page != page_num || die->register_dirty) {
+            die->register_page  = page_num;
+            die->register_dirty = false;
+            array_ns = dev->timing.read_ns;
+            die->reads++;
+        }
+        break;
+    case SSDMMC_SIM_OP_WRITE:
+        dev->io.words_written++;
+        if (die->register_page != page_num || !die->register_dirty) {
+            die->register_page  = page_num;
+            die->register_dirty = true;
+            array_ns = dev->timing.program_ns;
+            die->programs++;
+        }
+        break;
+    case SSDMMC_SIM_OP_ERASE:
+        dev->io.pages_erased++;
+        die->register_page  = UINT32_MAX;
+        die->register_dirty = false;
+        array_ns = dev->timing.erase_ns;
+        die->erases++;
+        break;
+    }
+    uint64_t bus_ns = (uint64_t)bytes * dev->timing.bus_ps_per_byte / 1000;
+    die->busy_ns += array_ns;
+    dev->channel_busy_ns[die_num % SSDMMC_SIM_CHANNEL_COUNT] += bus_ns;
+    dev->clock_ns += array_ns + bus_ns;
+    if (dev->timing.sleep) {
+        dev->sleep_debt_ns += array_ns + bus_ns;
+        if (dev->sleep_debt_ns >= SSDMMC_SIM_SLEEP_QUANTUM_NS) {
+            sleep_ns = dev->sleep_debt_ns;
+            dev->sleep_debt_ns = 0;
+        }
+    }
+    pthread_mutex_unlock(&dev->timing_lock);
+
+    // Ждем вне блокировки: операции других потоков в это время учитываются
+    if (sleep_ns > 0) {
+        struct timespec ts = {(time_t)(sleep_ns / 1000000000ull), (long)(sleep_ns % 1000000000ull)};
+        nanosleep(&ts, NULL);
+    }
+}
+
+ssdmmc_sim_device *ssdmmc_sim_open(const char *path, bool create)
+{
+    if (path == NULL)
+        return NULL;
+
+    ssdmmc_sim_device *dev = calloc(1, sizeof(ssdmmc_sim_device));
+    if (dev == NULL)
+        return NULL;
+
+    // Новое устройство создается с нуля, существующее открывается без усечения
+    dev->fp = fopen(path, create ? "wb+" : "rb+");
+    if (dev->fp == NULL) {
+        free(dev);
+        return NULL;
+    }
+    dev->write_countdown = -1;
+    memset(dev->erase_buf, 0xFF, sizeof(dev->erase_buf));
+    pthread_mutex_init(&dev->timing_lock, NULL);
+    ssdmmc_sim_get_default_timing(&dev->timing);
+    ssdmmc_sim_reset_timing_stats(dev);
+    return dev;
+}
+
+void ssdmmc_sim_close(ssdmmc_sim_device *dev)
+{
+    if (dev == NULL)
+        return;
+    ssdmmc_sim_trace_stop(dev);
+    if (dev->fp)
+        fclose(dev->fp);
+    pthread_mutex_destroy(&dev->timing_lock);
+    free(dev);
+}
+
+int ssdmmc_sim_read_word(ssdmmc_sim_device *dev, uint32_t page_num, uint32_t word_offset, void *word)
 {
     // Проверяем не выходят ли запрашиваемые данные за размер хранилища
     if (page_num >= SSDMMC_SIM_PAGE_COUNT)
@@ -10,31 +107,32 @@ int ssdmmc_sim_read_word(FILE *fp, uint32_t page_num, uint32_t word_offset, void
     if (word_offset >= SSDMMC_SIM_WORDS_PER_PAGE)
         return SSDMMC_ERR_INVALID_OFFSET;
 
-    // Проверяем указатель на файл
-    if (fp == NULL)
+    // Проверяем указатель на устройство
+    if (dev == NULL || dev->fp == NULL)
         return SSDMMC_ERR_NULL_POINTER;
 
     // Вычисляем позицию необходимого слова
-    uint32_t pos = (page_num * SSDMMC_SIM_WORDS_PER_PAGE + word_offset) * SSDMMC_SIM_WORD_SIZE;
+    off_t pos = (off_t)(page_num * SSDMMC_SIM_WORDS_PER_PAGE + word_offset) * SSDMMC_SIM_WORD_SIZE;
 
-    // Переходим в вычисленную позицию
-    if (fseeko(fp, pos, SEEK_SET) != 0) {
-        return SSDMMC_ERR_SEEK_FAILED;
-    }
-
-    // Считываем слово
-    size_t read = fread(word, 1, SSDMMC_SIM_WORD_SIZE, fp);
+    // Считываем слово позиционным чтением: оно не трогает позицию файла, поэтому параллельные
+    // чтения не мешают друг другу. Запись сбрасывает буфер файла сразу, так что чтение видит ее
+    ssize_t read = pread(fileno(dev->fp), word, SSDMMC_SIM_WORD_SIZE, pos);
 
     // Проверяем считались ли запрашиваемые данные
     if (read != SSDMMC_SIM_WORD_SIZE)
         return SSDMMC_ERR_IO_FAILED;
 
+    ssdmmc_sim_account(dev, page_num, word_offset, SSDMMC_SIM_OP_READ, SSDMMC_SIM_WORD_SIZE);
     return SSDMMC_OK;
 }
 
-int ssdmmc_sim_write_word(FILE *fp, uint32_t page_num, uint32_t word_offset, const void *word)
+int ssdmmc_sim_write_word(ssdmmc_sim_device *dev, uint32_t page_num, uint32_t word_offset, const void *word)
 {
+    // Проверяем указатель на устройство
+    if (dev == NULL)
+        return SSDMMC_ERR_NULL_POINTER;
 
+    // Общий таймер считает записи всех устройств процесса, таймер устройства - только его собственные
     if (g_write_countdown > 0) {
         g_write_countdown--;
         if (g_write_countdown == 0) {
@@ -42,6 +140,13 @@ int ssdmmc_sim_write_word(FILE *fp, uint32_t page_num, uint32_t word_offset, con
             exit(1); // Аварийно завершаем программу
         }
     }
+    if (dev->write_countdown > 0) {
+        dev->write_countdown--;
+        if (dev->write_countdown == 0) {
+            printf("\n!!! СБОЙ ПИТАНИЯ УСТРОЙСТВА (СИМУЛЯЦИЯ) !!!\n");
+            exit(1);
+        }
+    }
 
     // Проверяем не выходят ли запрашиваемые данные за размер хранилища
     if (page_num >= SSDMMC_SIM_PAGE_COUNT)
@@ -49,13 +154,32 @@ int ssdmmc_sim_write_word(FILE *fp, uint32_t page_num, uint32_t word_offset, con
     if (word_offset >= SSDMMC_SIM_WORDS_PER_PAGE)
         return SSDMMC_ERR_INVALID_OFFSET;
 
-    // Проверяем указатель на файл
-    if (fp == NULL)
+    // Проверяем указатель на файл устройства
+    if (dev->fp == NULL)
         return SSDMMC_ERR_NULL_POINTER;
+    FILE *fp = dev->fp;
 
     // Вычисляем позицию необходимого слова
     uint32_t pos = (page_num * SSDMMC_SIM_WORDS_PER_PAGE + word_offset) * SSDMMC_SIM_WORD_SIZE;
 
+    // Программирование может только сбросить биты: бит, который должен стать 1, уже должен быть 1
+    if (dev->nand_mode != SSDMMC_SIM_NAND_LENIENT) {
+        uint8_t old[SSDMMC_SIM_WORD_SIZE];
+        const uint8_t *new_word = word;
+        if (pread(fileno(fp), old, SSDMMC_SIM_WORD_SIZE, pos) != SSDMMC_SIM_WORD_SIZE)
+            return SSDMMC_ERR_IO_FAILED;
+        for (uint32_t b = 0; b < SSDMMC_SIM_WORD_SIZE; b++) {
+            if ((old[b] & new_word[b]) != new_word[b]) {
+                dev->nand_report.violations++;
+                dev->nand_report.last_page = page_num;
+                dev->nand_report.last_word = word_offset;
+                if (dev->nand_mode == SSDMMC_SIM_NAND_STRICT)
+                    return SSDMMC_ERR_NOT_ERASED;
+                break;
+            }
+        }
+    }
+
     // Переходим в вычисленную позицию
     if (fseeko(fp, pos, SEEK_SET) != 0) {
         return SSDMMC_ERR_SEEK_FAILED;
@@ -69,18 +193,20 @@ int ssdmmc_sim_write_word(FILE *fp, uint32_t page_num, uint32_t word_offset, con
         return SSDMMC_ERR_IO_FAILED;
 
     fflush(fp);
+    ssdmmc_sim_account(dev, page_num, word_offset, SSDMMC_SIM_OP_WRITE, SSDMMC_SIM_WORD_SIZE);
     return SSDMMC_OK;
 }
 
-int ssdmmc_sim_erase_page(FILE *fp, uint32_t page_num)
+int ssdmmc_sim_erase_page(ssdmmc_sim_device *dev, uint32_t page_num)
 {
     // Проверяем не выходит ли страница за количество страниц
     if (page_num >= SSDMMC_SIM_PAGE_COUNT)
         return SSDMMC_ERR_INVALID_PAGE;
 
-    // Проверяем указатель на файл
-    if (fp == NULL)
+    // Проверяем указатель на устройство
+    if (dev == NULL || dev->fp == NULL)
         return SSDMMC_ERR_NULL_POINTER;
+    FILE *fp = dev->fp;
 
     // Вычисляем позицию необходимой страницы
     size_t page_size = SSDMMC_SIM_WORDS_PER_PAGE * SSDMMC_SIM_WORD_SIZE;
@@ -91,29 +217,34 @@ int ssdmmc_sim_erase_page(FILE *fp, uint32_t page_num)
         return SSDMMC_ERR_SEEK_FAILED;
     }
 
-    // Выделяем буфер очистки и заполняем его
-    uint8_t *erase_buf = calloc(1,page_size);
-    if (erase_buf == NULL) {
-        return SSDMMC_ERR_MALLOC_FAILED;
-    }
-    memset(erase_buf, 0xFF, page_size);
-
-    // Очищаем страницу
-    size_t written = fwrite(erase_buf, 1, page_size, fp);
-    free(erase_buf);
+    // Очищаем страницу готовым буфером устройства: он заполнен 0xFF при открытии
+    size_t written = fwrite(dev->erase_buf, 1, page_size, fp);
 
     // Проверяем записались ли данные
     if (written != page_size)
         return SSDMMC_ERR_IO_FAILED;
 
     fflush(fp);
+    ssdmmc_sim_account(dev, page_num, 0, SSDMMC_SIM_OP_ERASE, 0);
     return SSDMMC_OK;
 }
 
-int ssdmmc_sim_format(FILE *fp){
-    // Проверяем указатель на файл
-    if(fp == NULL)
+int ssdmmc_sim_sync(ssdmmc_sim_device *dev)
+{
+    // Проверяем указатель на устройство
+    if (dev == NULL || dev->fp == NULL)
+        return SSDMMC_ERR_NULL_POINTER;
+
+    if (fflush(dev->fp) != 0)
+        return SSDMMC_ERR_IO_FAILED;
+    return SSDMMC_OK;
+}
+
+int ssdmmc_sim_format(ssdmmc_sim_device *dev){
+    // Проверяем указатель на устройство
+    if(dev == NULL || dev->fp == NULL)
         return SSDMMC_ERR_NULL_POINTER;
+    FILE *fp = dev->fp;
 
     // Убедимся, что запись будет с самого начала
     rewind(fp);
@@ -157,4 +288,116 @@ const char* ssdmmc_sim_get_storage_filename(void) {
 
 void ssdmmc_sim_set_write_failure_countdown(int count) {
     g_write_countdown = count;
-}
\ No newline at end of file
+}
+
+void ssdmmc_sim_device_set_write_failure_countdown(ssdmmc_sim_device *dev, int count) {
+    if (dev != NULL)
+        dev->write_countdown = count;
+}
+
+void ssdmmc_sim_set_nand_mode(ssdmmc_sim_device *dev, ssdmmc_sim_nand_mode mode)
+{
+    if (dev != NULL)
+        dev->nand_mode = mode;
+}
+
+ssdmmc_sim_nand_mode ssdmmc_sim_get_nand_mode(ssdmmc_sim_device *dev)
+{
+    return dev != NULL ? dev->nand_mode : SSDMMC_SIM_NAND_LENIENT;
+}
+
+int ssdmmc_sim_get_nand_report(ssdmmc_sim_device *dev, ssdmmc_sim_nand_report *report)
+{
+    if (dev == NULL || report == NULL)
+        return SSDMMC_ERR_NULL_POINTER;
+    *report = dev->nand_report;
+    return SSDMMC_OK;
+}
+
+void ssdmmc_sim_get_default_timing(ssdmmc_sim_timing *timing)
+{
+    if (timing == NULL)
+        return;
+    timing->read_ns         = SSDMMC_SIM_READ_NS;
+    timing->program_ns      = SSDMMC_SIM_PROGRAM_NS;
+    timing->erase_ns        = SSDMMC_SIM_ERASE_NS;
+    timing->bus_ps_per_byte = SSDMMC_SIM_BUS_PS_PER_BYTE;
+    timing->sleep           = false;
+}
+
+int ssdmmc_sim_set_timing(ssdmmc_sim_device *dev, const ssdmmc_sim_timing *timing)
+{
+    if (dev == NULL || timing == NULL)
+        return SSDMMC_ERR_NULL_POINTER;
+
+    pthread_mutex_lock(&dev->timing_lock);
+    dev->timing = *timing;
+    dev->sleep_debt_ns = 0;
+    pthread_mutex_unlock(&dev->timing_lock);
+    return SSDMMC_OK;
+}
+
+uint64_t ssdmmc_sim_get_clock_ns(ssdmmc_sim_device *dev)
+{
+    if (dev == NULL)
+        return 0;
+
+    pthread_mutex_lock(&dev->timing_lock);
+    uint64_t clock_ns = dev->clock_ns;
+    pthread_mutex_unlock(&dev->timing_lock);
+    return clock_ns;
+}
+
+int ssdmmc_sim_get_io_counters(ssdmmc_sim_device *dev, ssdmmc_sim_io_counters *counters)
+{
+    if (dev == NULL || counters == NULL)
+        return SSDMMC_ERR_NULL_POINTER;
+
+    pthread_mutex_lock(&dev->timing_lock);
+    *counters = dev->io;
+    pthread_mutex_unlock(&dev->timing_lock);
+    return SSDMMC_OK;
+}
+
+int ssdmmc_sim_get_timing_stats(ssdmmc_sim_device *dev, ssdmmc_sim_timing_stats *stats)
+{
+    if (dev == NULL || stats == NULL)
+        return SSDMMC_ERR_NULL_POINTER;
+
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&dev->timing_lock);
+    stats->die_count = SSDMMC_SIM_DIE_COUNT;
+    for (uint32_t d = 0; d < SSDMMC_SIM_DIE_COUNT; d++) {
+        const ssdmmc_sim_die *die = &dev->dies[d];
+        stats->reads    += die->reads;
+        stats->programs += die->programs;
+        stats->erases   += die->erases;
+        stats->serial_ns += die->busy_ns;
+        stats->die_busy_ns[d] = die->busy_ns;
+        if (die->busy_ns > stats->parallel_ns)
+            stats->parallel_ns = die->busy_ns;
+    }
+    stats->channel_count = SSDMMC_SIM_CHANNEL_COUNT;
+    for (uint32_t c = 0; c < SSDMMC_SIM_CHANNEL_COUNT; c++) {
+        stats->bus_ns += dev->channel_busy_ns[c];
+        stats->channel_busy_ns[c] = dev->channel_busy_ns[c];
+        if (dev->channel_busy_ns[c] > stats->parallel_ns)
+            stats->parallel_ns = dev->channel_busy_ns[c];
+    }
+    stats->serial_ns += stats->bus_ns;
+    pthread_mutex_unlock(&dev->timing_lock);
+    return SSDMMC_OK;
+}
+
+void ssdmmc_sim_reset_timing_stats(ssdmmc_sim_device *dev)
+{
+    if (dev == NULL)
+        return;
+    pthread_mutex_lock(&dev->timing_lock);
+    for (uint32_t d = 0; d < SSDMMC_SIM_DIE_COUNT; d++) {
+        memset(&dev->dies[d], 0, sizeof(ssdmmc_sim_die));
+        dev->dies[d].register_page = UINT32_MAX;
+    }
+    memset(dev->channel_busy_ns, 0, sizeof(dev->channel_busy_ns));
+    pthread_mutex_unlock(&dev->timing_lock);
+}
@@ -11,40 +11,71 @@ typedef enum {
     SSDMMC_ERR_SEEK_FAILED = -4,     // Ошибка позиционирования в файле
     SSDMMC_ERR_IO_FAILED = -5,       // Ошибка чтения/записи
     SSDMMC_ERR_MALLOC_FAILED = -6,   // Ошибка выделения памяти
-    SSDMMC_ERR_MKDIR_FAILED = -7     // Ошибка создания директории
+    SSDMMC_ERR_MKDIR_FAILED = -7,    // Ошибка создания директории
+    SSDMMC_ERR_NOT_ERASED = -8       // Запись требует перевода битов 0 -> 1 без стирания страницы (строгий режим NAND)
 } ssdmmc_status_t;
 
+// Режим проверки записи. Программирование флеш-памяти может только сбрасывать биты (1 -> 0),
+// вернуть бит в 1 можно лишь стиранием страницы.
+typedef enum {
+    SSDMMC_SIM_NAND_LENIENT = 0,     // Любое слово можно перезаписать любым значением (по умолчанию)
+    SSDMMC_SIM_NAND_REPORT,          // Нарушения учитываются, но запись выполняется
+    SSDMMC_SIM_NAND_STRICT           // Нарушения учитываются, а запись отклоняется с SSDMMC_ERR_NOT_ERASED
+} ssdmmc_sim_nand_mode;
+
+// Сведения о нарушениях порядка "стирание перед записью".
+typedef struct {
+    uint64_t violations;             // Сколько записей требовали перевода битов 0 -> 1
+    uint32_t last_page;              // Страница последнего нарушения
+    uint32_t last_word;              // Слово последнего нарушения
+} ssdmmc_sim_nand_report;
+
+// Эмулируемое устройство: открытый файл-эмулятор и собственное состояние симулятора.
+// Каждое хранилище работает со своим устройством, поэтому в одном процессе их может быть несколько.
+typedef struct ssdmmc_sim_device ssdmmc_sim_device;
+
+// Открывает файл-эмулятор устройства.
+// path   - путь к файлу.
+// create - true создает файл заново (существующий усекается), false открывает существующий.
+// Возвращает устройство или NULL при ошибке.
+ssdmmc_sim_device *ssdmmc_sim_open(const char *path, bool create);
+
+// Закрывает файл-эмулятор и освобождает устройство. dev может быть NULL.
+void ssdmmc_sim_close(ssdmmc_sim_device *dev);
 
 // Читает одно слово из указанной страницы по смещению.
 //
-// fp         - указатель на открытый файл-эмулятор устройства.
+// dev        - открытое устройство.
 // page_num   - номер страницы (от 0 до количества страниц - 1).
 // word_offset- смещение слова внутри страницы (от 0 до слов на страницу - 1).
 // word       - указатель на буфер, куда будет записано слово.
 //
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-int ssdmmc_sim_read_word(FILE *fp, uint32_t page_num, uint32_t word_offset, void *word);
+int ssdmmc_sim_read_word(ssdmmc_sim_device *dev, uint32_t page_num, uint32_t word_offset, void *word);
 
 // Записывает одно слово в указанную страницу по смещению.
 //
-// fp         - указатель на открытый файл-эмулятор устройства.
+// dev        - открытое устройство.
 // page_num   - номер страницы (от 0 до количества страниц - 1).
 // word_offset- смещение слова внутри страницы (от 0 до слов на страницу - 1).
 // word       - указатель на данные слова для записи.
 //
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-int ssdmmc_sim_write_word(FILE *fp, uint32_t page_num, uint32_t word_offset, const void *word);
+int ssdmmc_sim_write_word(ssdmmc_sim_device *dev, uint32_t page_num, uint32_t word_offset, const void *word);
 
 // Очищает (стирает) одну страницу в хранилище.
 //
-// fp         - указатель на открытый файл-эмулятор устройства.
+// dev        - открытое устройство.
 // page_num   - номер страницы (от 0 до количества страниц - 1).
 //
 // Возвращает 0 при успехе, отрицательное значение при ошибке.
-int ssdmmc_sim_erase_page(FILE *fp, uint32_t page_num);
+int ssdmmc_sim_erase_page(ssdmmc_sim_device *dev, uint32_t page_num);
+
+// Принудительно сбрасывает буферы файла-эмулятора на диск.
+int ssdmmc_sim_sync(ssdmmc_sim_device *dev);
 
 // Полностью очищает (форматирует) все устройство.
-int ssdmmc_sim_format(FILE *fp);
+int ssdmmc_sim_format(ssdmmc_sim_device *dev);
 
 // Возвращает общее количество страниц в памяти.
 uint32_t ssdmmc_sim_get_page_count(void);
@@ -55,6 +86,177 @@ uint32_t ssdmmc_sim_get_words_per_page(void);
 // Возвращает размер одного слова в байтах.
 uint32_t ssdmmc_sim_get_word_size(void);
 
+// Возвращает количество каналов устройства.
+uint32_t ssdmmc_sim_get_channel_count(void);
+
+// Возвращает количество кристаллов (die) на одном канале.
+uint32_t ssdmmc_sim_get_dies_per_channel(void);
+
+// Возвращает количество плоскостей (plane) в одном кристалле.
+uint32_t ssdmmc_sim_get_planes_per_die(void);
+
+// Возвращает общее количество кристаллов устройства.
+uint32_t ssdmmc_sim_get_die_count(void);
+
+// Возвращает номер кристалла (0..ssdmmc_sim_get_die_count() - 1), в котором лежит страница page_num.
+uint32_t ssdmmc_sim_get_page_die(uint32_t page_num);
+
+// Возвращает номер канала, к которому подключен кристалл страницы page_num.
+uint32_t ssdmmc_sim_get_page_channel(uint32_t page_num);
+
+// Возвращает номер плоскости страницы page_num внутри ее кристалла.
+uint32_t ssdmmc_sim_get_page_plane(uint32_t page_num);
+
+// Наибольшее количество кристаллов и каналов, для которого ssdmmc_sim_timing_stats хранит время занятости.
+#define SSDMMC_SIM_MAX_DIES     64
+#define SSDMMC_SIM_MAX_CHANNELS 16
+
+// Время операций устройства.
+typedef struct {
+    uint32_t read_ns;                // tR: чтение страницы из массива в регистр кристалла
+    uint32_t program_ns;             // tPROG: программирование страницы из регистра
+    uint32_t erase_ns;               // tBERS: стирание страницы
+    uint32_t bus_ps_per_byte;        // Передача одного байта по шине канала, в пикосекундах
+    bool     sleep;                  // Вызывающий поток действительно ждет смоделированное время
+} ssdmmc_sim_timing;
+
+// Статистика модели времени устройства.
+// Каждая операция занимает кристалл своей страницы: чтение страницы - на время чтения (слова той же
+// страницы, уже лежащей в регистре кристалла, читаются без обращения к массиву), запись слов одной
+// страницы подряд - на одно программирование страницы, стирание - на время стирания. Кроме того,
+// каждое прочитанное или записанное слово занимает шину канала кристалла на время передачи.
+// Операции разных кристаллов и каналов могут выполняться одновременно, поэтому наименьшее время
+// выполнения всей нагрузки - время самого загруженного кристалла или канала (parallel_ns),
+// а при одной очереди - сумма (serial_ns).
+typedef struct {
+    uint64_t reads;                  // Чтений страниц из массива памяти
+    uint64_t programs;               // Программирований страниц
+    uint64_t erases;                 // Стираний страниц
+    uint64_t bus_ns;                 // Суммарное время передачи по шинам каналов
+    uint64_t serial_ns;              // Суммарное время всех операций вместе с передачей
+    uint64_t parallel_ns;            // Время занятости самого загруженного кристалла или канала
+    uint32_t die_count;              // Количество кристаллов
+    uint32_t channel_count;          // Количество каналов
+    uint64_t die_busy_ns[SSDMMC_SIM_MAX_DIES];         // Время занятости каждого кристалла
+    uint64_t channel_busy_ns[SSDMMC_SIM_MAX_CHANNELS]; // Время занятости шины каждого канала
+} ssdmmc_sim_timing_stats;
+
+// Счетчики операций устройства с его открытия (форматирование не учитывается).
+typedef struct {
+    uint64_t words_read;             // Прочитано слов
+    uint64_t words_written;          // Записано слов
+    uint64_t pages_erased;           // Стерто страниц
+} ssdmmc_sim_io_counters;
+
+// Заполняет counters счетчиками операций устройства dev.
+// Возвращает SSDMMC_OK или SSDMMC_ERR_NULL_POINTER.
+int ssdmmc_sim_get_io_counters(ssdmmc_sim_device *dev, ssdmmc_sim_io_counters *counters);
+
+// Заполняет timing временем операций по умолчанию (без реального ожидания).
+void ssdmmc_sim_get_default_timing(ssdmmc_sim_timing *timing);
+
+// Задает время операций устройства dev. Действует на последующие операции, накопленное время не меняется.
+// Возвращает SSDMMC_OK или SSDMMC_ERR_NULL_POINTER.
+int ssdmmc_sim_set_timing(ssdmmc_sim_device *dev, const ssdmmc_sim_timing *timing);
+
+// Возвращает показания виртуальных часов устройства dev: смоделированное время всех его операций с открытия
+// при выполнении по одной (как их выполняет вызывающий поток). Сброс статистики часы не сбрасывает.
+uint64_t ssdmmc_sim_get_clock_ns(ssdmmc_sim_device *dev);
+
+// Заполняет stats статистикой модели времени устройства dev.
+// Возвращает SSDMMC_OK или SSDMMC_ERR_NULL_POINTER.
+int ssdmmc_sim_get_timing_stats(ssdmmc_sim_device *dev, ssdmmc_sim_timing_stats *stats);
+
+// Обнуляет статистику модели времени устройства dev.
+void ssdmmc_sim_reset_timing_stats(ssdmmc_sim_device *dev);
+
+// Задает режим проверки записи устройства dev. Новое устройство открывается в режиме SSDMMC_SIM_NAND_LENIENT.
+void ssdmmc_sim_set_nand_mode(ssdmmc_sim_device *dev, ssdmmc_sim_nand_mode mode);
+
+// Возвращает режим проверки записи устройства dev.
+ssdmmc_sim_nand_mode ssdmmc_sim_get_nand_mode(ssdmmc_sim_device *dev);
+
+// Заполняет report сведениями о нарушениях, найденных с открытия устройства (в режимах REPORT и STRICT).
+// Возвращает SSDMMC_OK или SSDMMC_ERR_NULL_POINTER.
+int ssdmmc_sim_get_nand_report(ssdmmc_sim_device *dev, ssdmmc_sim_nand_report *report);
+
+// Вид записи трассы ввода-вывода.
+typedef enum {
+    SSDMMC_SIM_TRACE_READ = 0,       // Чтение слов first_word..first_word + word_count - 1 страницы page
+    SSDMMC_SIM_TRACE_WRITE,          // Запись слов страницы
+    SSDMMC_SIM_TRACE_ERASE,          // Стирание страницы
+    SSDMMC_SIM_TRACE_EVENT           // Событие верхнего уровня (ssdmmc_sim_trace_event), устройство не трогает
+} ssdmmc_sim_trace_op;
+
+// Значение api_op и path вне операции верхнего уровня.
+#define SSDMMC_SIM_TRACE_NONE 0xFF
+
+// Запись трассы ввода-вывода, 32 байта. Подряд идущие слова одной страницы, прочитанные или записанные
+// в одном контексте (ssdmmc_sim_trace_set_op, ssdmmc_sim_trace_set_path), образуют одну запись.
+// api_op, path и status - значения верхнего уровня, симулятор их только переносит.
+typedef struct {
+    uint64_t time_ns;                // Монотонное время от начала трассы
+    uint64_t device_ns;              // Виртуальные часы устройства перед операцией (ssdmmc_sim_get_clock_ns)
+    uint32_t key_hash;               // Хеш ключа операции верхнего уровня (0 - без ключа)
+    uint32_t page;                   // Страница; у события - длина значения
+    uint16_t first_word;             // Первое слово диапазона
+    uint16_t word_count;             // Количество слов (у стирания - все слова страницы, у события - 0)
+    uint8_t  op;                     // ssdmmc_sim_trace_op
+    uint8_t  api_op;                 // Операция верхнего уровня или SSDMMC_SIM_TRACE_NONE
+    uint8_t  path;                   // Путь записи верхнего уровня или SSDMMC_SIM_TRACE_NONE
+    int8_t   status;                 // У события - результат операции верхнего уровня, у операций устройства - 0
+} ssdmmc_sim_trace_record;
+
+// Заголовок файла трассы; за ним записи ssdmmc_sim_trace_record подряд.
+#define SSDMMC_SIM_TRACE_MAGIC   "SSDTRACE"
+#define SSDMMC_SIM_TRACE_VERSION 1
+typedef struct {
+    char     magic[8];               // SSDMMC_SIM_TRACE_MAGIC без нулевого байта
+    uint32_t version;                // SSDMMC_SIM_TRACE_VERSION
+    uint32_t record_size;            // sizeof(ssdmmc_sim_trace_record)
+    uint32_t page_count;             // Геометрия устройства, на котором снята трасса
+    uint32_t words_per_page;
+    uint32_t word_size;
+    uint32_t reserved;
+} ssdmmc_sim_trace_header;
+
+// Начинает трассу устройства dev. Если трасса уже идет, она сначала останавливается.
+// path         - файл трассы (создается заново); NULL - трасса пишется в кольцо в памяти.
+// ring_records - емкость кольца в записях (при path == NULL, больше 0); заполненное кольцо
+//                перезаписывает самые старые записи.
+// Пока трасса выключена, операции устройства ее не касаются.
+// Возвращает SSDMMC_OK, SSDMMC_ERR_NULL_POINTER, SSDMMC_ERR_MALLOC_FAILED или SSDMMC_ERR_IO_FAILED.
+int ssdmmc_sim_trace_start(ssdmmc_sim_device *dev, const char *path, uint32_t ring_records);
+
+// Останавливает трассу устройства dev: дописывает незавершенную запись и закрывает файл или освобождает кольцо.
+// Вызывается и из ssdmmc_sim_close.
+void ssdmmc_sim_trace_stop(ssdmmc_sim_device *dev);
+
+// Забирает из кольца трассы устройства dev до max самых старых записей в records.
+// Возвращает количество записей (0, если трасса не идет или пишется в файл).
+size_t ssdmmc_sim_trace_read(ssdmmc_sim_device *dev, ssdmmc_sim_trace_record *records, size_t max);
+
+// Возвращает счетчики трассы устройства dev с ее начала.
+// records     - записей сформировано.
+// overwritten - записей кольца, перезаписанных до чтения.
+int ssdmmc_sim_trace_get_counts(ssdmmc_sim_device *dev, uint64_t *records, uint64_t *overwritten);
+
+// Задает операцию верхнего уровня и хеш ключа, которые переносятся в записи операций вызывающего потока.
+void ssdmmc_sim_trace_set_op(uint8_t api_op, uint32_t key_hash);
+
+// Задает путь записи верхнего уровня для записей операций вызывающего потока.
+void ssdmmc_sim_trace_set_path(uint8_t path);
+
+// Добавляет в трассу устройства dev событие верхнего уровня (op = SSDMMC_SIM_TRACE_EVENT)
+// с операцией и хешем ключа, заданными ssdmmc_sim_trace_set_op.
+// length - длина значения, status - результат операции. Без трассы ничего не делает.
+void ssdmmc_sim_trace_event(ssdmmc_sim_device *dev, uint32_t length, int8_t status);
+
+// Повторяет операцию устройства из записи трассы на устройстве dev: читает слова диапазона,
+// записывает в них нули или стирает страницу. События пропускаются.
+// Возвращает SSDMMC_OK или код ошибки операции.
+int ssdmmc_sim_trace_replay(ssdmmc_sim_device *dev, const ssdmmc_sim_trace_record *record);
+
 // Проверяет существование директории для данных и создает ее, если она отсутствует.
 // Возвращает SSDMMC_OK при успехе или SSDMMC_ERR_MKDIR_FAILED при ошибке.
 int ssdmmc_sim_ensure_data_dir_exists(void);
@@ -66,7 +268,11 @@ const char* ssdmmc_sim_get_storage_filename(void);
 // аварийно завершит работу, имитируя внезапное отключение питания.
 // count - количество операций ssdmmc_sim_write_word, которые должны успешно
 //         выполниться перед сбоем. Если count < 0, таймер отключается.
+// Таймер общий для всех устройств процесса.
 void ssdmmc_sim_set_write_failure_countdown(int count);
 
+// То же, что ssdmmc_sim_set_write_failure_countdown, но считаются только записи устройства dev.
+void ssdmmc_sim_device_set_write_failure_countdown(ssdmmc_sim_device *dev, int count);
+
 
 #endif
\ No newline at end of file
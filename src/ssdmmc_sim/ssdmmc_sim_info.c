@@ -10,4 +10,32 @@ uint32_t ssdmmc_sim_get_words_per_page(void){
 
 uint32_t ssdmmc_sim_get_word_size(void){
     return SSDMMC_SIM_WORD_SIZE;
-}
\ No newline at end of file
+}
+
+uint32_t ssdmmc_sim_get_channel_count(void){
+    return SSDMMC_SIM_CHANNEL_COUNT;
+}
+
+uint32_t ssdmmc_sim_get_dies_per_channel(void){
+    return SSDMMC_SIM_DIES_PER_CHANNEL;
+}
+
+uint32_t ssdmmc_sim_get_planes_per_die(void){
+    return SSDMMC_SIM_PLANES_PER_DIE;
+}
+
+uint32_t ssdmmc_sim_get_die_count(void){
+    return SSDMMC_SIM_DIE_COUNT;
+}
+
+uint32_t ssdmmc_sim_get_page_die(uint32_t page_num){
+    return page_num % SSDMMC_SIM_DIE_COUNT;
+}
+
+uint32_t ssdmmc_sim_get_page_channel(uint32_t page_num){
+    return ssdmmc_sim_get_page_die(page_num) % SSDMMC_SIM_CHANNEL_COUNT;
+}
+
+uint32_t ssdmmc_sim_get_page_plane(uint32_t page_num){
+    return (page_num / SSDMMC_SIM_DIE_COUNT) % SSDMMC_SIM_PLANES_PER_DIE;
+}
@@ -2,12 +2,100 @@
 #define SSDMMCSTORE_SSDMMC_SIM_INTERNAL_H
 
 #include "ssdmmc_sim.h"
+#include <unistd.h>
+#include <pthread.h>
 
 #define SSDMMC_SIM_PAGE_COUNT      2048
 #define SSDMMC_SIM_WORD_SIZE       4
 #define SSDMMC_SIM_WORDS_PER_PAGE  256
 
+// Геометрия параллельности: каналы, кристаллы (die) на канале и плоскости (plane) в кристалле.
+// Страницы чередуются по кристаллам: страница p лежит в кристалле p % SSDMMC_SIM_DIE_COUNT,
+// поэтому соседние страницы принадлежат разным кристаллам и могут обрабатываться одновременно.
+// Геометрию можно задать при сборке (например, -DSSDMMC_SIM_CHANNEL_COUNT=4)
+#ifndef SSDMMC_SIM_CHANNEL_COUNT
+#define SSDMMC_SIM_CHANNEL_COUNT      2
+#endif
+#ifndef SSDMMC_SIM_DIES_PER_CHANNEL
+#define SSDMMC_SIM_DIES_PER_CHANNEL   2
+#endif
+#ifndef SSDMMC_SIM_PLANES_PER_DIE
+#define SSDMMC_SIM_PLANES_PER_DIE     2
+#endif
+#if SSDMMC_SIM_CHANNEL_COUNT < 1 || SSDMMC_SIM_DIES_PER_CHANNEL < 1 || SSDMMC_SIM_PLANES_PER_DIE < 1
+#error "SSDMMC_SIM_CHANNEL_COUNT, SSDMMC_SIM_DIES_PER_CHANNEL and SSDMMC_SIM_PLANES_PER_DIE must be at least 1"
+#endif
+#define SSDMMC_SIM_DIE_COUNT          (SSDMMC_SIM_CHANNEL_COUNT * SSDMMC_SIM_DIES_PER_CHANNEL)
+#if SSDMMC_SIM_DIE_COUNT > SSDMMC_SIM_MAX_DIES
+#error "SSDMMC_SIM_DIE_COUNT must not exceed SSDMMC_SIM_MAX_DIES"
+#endif
+#if SSDMMC_SIM_CHANNEL_COUNT > SSDMMC_SIM_MAX_CHANNELS
+#error "SSDMMC_SIM_CHANNEL_COUNT must not exceed SSDMMC_SIM_MAX_CHANNELS"
+#endif
+
+// Время операций по умолчанию: чтение страницы в регистр (tR), программирование (tPROG) и стирание (tBERS)
+// в наносекундах, передача по шине канала в пикосекундах на байт (2500 пс - 400 МБ/с)
+#define SSDMMC_SIM_READ_NS          50000
+#define SSDMMC_SIM_PROGRAM_NS       600000
+#define SSDMMC_SIM_ERASE_NS         3000000
+#define SSDMMC_SIM_BUS_PS_PER_BYTE  2500
+
+// Реальное ожидание копится, пока не наберется хотя бы столько наносекунд: спать на каждое слово
+// по несколько наносекунд бессмысленно, точность sleep на порядки хуже
+#define SSDMMC_SIM_SLEEP_QUANTUM_NS 100000
+
+// Вид операции для модели времени.
+typedef enum {
+    SSDMMC_SIM_OP_READ,
+    SSDMMC_SIM_OP_WRITE,
+    SSDMMC_SIM_OP_ERASE
+} ssdmmc_sim_op;
+
 #define SSDMMC_DATA_DIR       "../data"
 #define SSDMMC_STORAGE_FILENAME (SSDMMC_DATA_DIR "/kvs_storage.bin")
 
+// Состояние одного кристалла для модели времени.
+typedef struct {
+    uint32_t register_page;          // Страница в регистре кристалла (UINT32_MAX - регистр не заполнен)
+    bool     register_dirty;         // Регистр набирает данные программирования, а не хранит прочитанную страницу
+    uint64_t busy_ns;                // Суммарное время занятости кристалла
+    uint64_t reads;                  // Чтений страниц из массива
+    uint64_t programs;               // Программирований страниц
+    uint64_t erases;                 // Стираний страниц
+} ssdmmc_sim_die;
+
+// Трасса ввода-вывода устройства. Все поля защищены timing_lock устройства.
+typedef struct {
+    FILE    *file;                   // Файл трассы (NULL - трасса пишется в кольцо)
+    ssdmmc_sim_trace_record *ring;   // Кольцо записей
+    uint32_t capacity;               // Емкость кольца
+    uint64_t head;                   // Записей, помещенных в кольцо
+    uint64_t tail;                   // Номер самой старой непрочитанной записи
+    ssdmmc_sim_trace_record pending; // Незавершенная запись: к ней добавляются следующие слова той же страницы
+    bool     has_pending;
+    struct timespec start;           // Начало трассы
+    uint64_t records;                // Записей сформировано
+    uint64_t overwritten;            // Записей кольца, перезаписанных до чтения
+} ssdmmc_sim_trace;
+
+struct ssdmmc_sim_device {
+    FILE    *fp;                     // Файл-эмулятор устройства
+    int      write_countdown;        // Записей до имитации сбоя питания (< 0 - таймер выключен)
+    ssdmmc_sim_nand_mode nand_mode;  // Режим проверки записи
+    ssdmmc_sim_nand_report nand_report; // Найденные нарушения порядка "стирание перед записью"
+    ssdmmc_sim_die dies[SSDMMC_SIM_DIE_COUNT]; // Кристаллы устройства
+    uint64_t channel_busy_ns[SSDMMC_SIM_CHANNEL_COUNT]; // Время занятости шины каждого канала
+    ssdmmc_sim_timing timing;        // Время операций устройства
+    uint64_t clock_ns;               // Виртуальные часы: время устройства с открытия
+    ssdmmc_sim_io_counters io;       // Счетчики операций с открытия
+    uint64_t sleep_debt_ns;          // Накопленное, но еще не выполненное реальное ожидание
+    ssdmmc_sim_trace *trace;         // Трасса ввода-вывода (NULL - выключена)
+    pthread_mutex_t timing_lock;     // Защищает модель времени и счетчики io: чтения хранилища в режиме параллельного чтения идут из нескольких потоков
+    uint8_t  erase_buf[SSDMMC_SIM_WORDS_PER_PAGE * SSDMMC_SIM_WORD_SIZE]; // Стертая страница (0xFF) для ssdmmc_sim_erase_page
+};
+
+// Добавляет операцию op над словами word_offset..word_offset + word_count - 1 страницы page_num в трассу устройства.
+// Вызывается под timing_lock перед учетом операции в модели времени, только когда трасса включена.
+void ssdmmc_sim_trace_device_op(ssdmmc_sim_device *dev, ssdmmc_sim_op op, uint32_t page_num, uint32_t word_offset, uint32_t word_count);
+
 #endif
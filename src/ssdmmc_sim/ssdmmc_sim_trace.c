@@ -0,0 +1,222 @@
+#include "ssdmmc_sim_internal.h"
+
+// Контекст верхнего уровня вызывающего потока: переносится в записи его операций
+static _Thread_local uint8_t  trace_api_op   = SSDMMC_SIM_TRACE_NONE;
+static _Thread_local uint8_t  trace_path     = SSDMMC_SIM_TRACE_NONE;
+static _Thread_local uint32_t trace_key_hash = 0;
+
+// Возвращает время от начала трассы в наносекундах.
+static uint64_t ssdmmc_sim_trace_elapsed_ns(const ssdmmc_sim_trace *trace)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - trace->start.tv_sec) * 1000000000ull + (uint64_t)now.tv_nsec - (uint64_t)trace->start.tv_nsec;
+}
+
+// Помещает завершенную запись в файл или в кольцо (самая старая запись заполненного кольца перезаписывается).
+static void ssdmmc_sim_trace_put(ssdmmc_sim_trace *trace, const ssdmmc_sim_trace_record *record)
+{
+    trace->records++;
+    if (trace->file) {
+        fwrite(record, sizeof(*record), 1, trace->file);
+        return;
+    }
+    trace->ring[trace->head % trace->capacity] = *record;
+    trace->head++;
+    if (trace->head - trace->tail > trace->capacity) {
+        trace->tail = trace->head - trace->capacity;
+        trace->overwritten++;
+    }
+}
+
+// Завершает незавершенную запись.
+static void ssdmmc_sim_trace_flush_pending(ssdmmc_sim_trace *trace)
+{
+    if (trace->has_pending) {
+        ssdmmc_sim_trace_put(trace, &trace->pending);
+        trace->has_pending = false;
+    }
+}
+
+// Заполняет общие поля записи: время, часы устройства и контекст вызывающего потока.
+static void ssdmmc_sim_trace_fill(ssdmmc_sim_device *dev, ssdmmc_sim_trace_record *record, uint8_t op)
+{
+    memset(record, 0, sizeof(*record));
+    record->time_ns   = ssdmmc_sim_trace_elapsed_ns(dev->trace);
+    record->device_ns = dev->clock_ns;
+    record->key_hash  = trace_key_hash;
+    record->op        = op;
+    record->api_op    = trace_api_op;
+    record->path      = trace_path;
+}
+
+void ssdmmc_sim_trace_device_op(ssdmmc_sim_device *dev, ssdmmc_sim_op op, uint32_t page_num, uint32_t word_offset, uint32_t word_count)
+{
+    ssdmmc_sim_trace *trace = dev->trace;
+    uint8_t trace_op = op == SSDMMC_SIM_OP_READ ? SSDMMC_SIM_TRACE_READ : op == SSDMMC_SIM_OP_WRITE ? SSDMMC_SIM_TRACE_WRITE : SSDMMC_SIM_TRACE_ERASE;
+
+    // Шаг 1: Слово сразу за диапазоном незавершенной записи в том же контексте продлевает ее
+    ssdmmc_sim_trace_record *pending = &trace->pending;
+    if (trace->has_pending && trace_op != SSDMMC_SIM_TRACE_ERASE && pending->op == trace_op && pending->page == page_num
+        && pending->first_word + pending->word_count == word_offset && pending->api_op == trace_api_op
+        && pending->path == trace_path && pending->key_hash == trace_key_hash) {
+        pending->word_count += word_count;
+        return;
+    }
+
+    // Шаг 2: Иначе завершаем прежнюю запись и начинаем новую
+    ssdmmc_sim_trace_flush_pending(trace);
+    ssdmmc_sim_trace_fill(dev, pending, trace_op);
+    pending->page       = page_num;
+    pending->first_word = (uint16_t)word_offset;
+    pending->word_count = (uint16_t)word_count;
+    trace->has_pending  = true;
+}
+
+int ssdmmc_sim_trace_start(ssdmmc_sim_device *dev, const char *path, uint32_t ring_records)
+{
+    if (dev == NULL || (path == NULL && ring_records == 0))
+        return SSDMMC_ERR_NULL_POINTER;
+    ssdmmc_sim_trace_stop(dev);
+
+    // Шаг 1: Готовим трассу вне блокировки: файл с заголовком или кольцо
+    ssdmmc_sim_trace *trace = calloc(1, sizeof(ssdmmc_sim_trace));
+    if (trace == NULL)
+        return SSDMMC_ERR_MALLOC_FAILED;
+    if (path != NULL) {
+        ssdmmc_sim_trace_header header = {0};
+        memcpy(header.magic, SSDMMC_SIM_TRACE_MAGIC, sizeof(header.magic));
+        header.version        = SSDMMC_SIM_TRACE_VERSION;
+        header.record_size    = sizeof(ssdmmc_sim_trace_record);
+        header.page_count     = SSDMMC_SIM_PAGE_COUNT;
+        header.words_per_page = SSDMMC_SIM_WORDS_PER_PAGE;
+        header.word_size      = SSDMMC_SIM_WORD_SIZE;
+        trace->file = fopen(path, "wb");
+        if (trace->file == NULL || fwrite(&header, sizeof(header), 1, trace->file) != 1) {
+            if (trace->file)
+                fclose(trace->file);
+            free(trace);
+            return SSDMMC_ERR_IO_FAILED;
+        }
+    } else {
+        trace->ring = malloc((size_t)ring_records * sizeof(ssdmmc_sim_trace_record));
+        if (trace->ring == NULL) {
+            free(trace);
+            return SSDMMC_ERR_MALLOC_FAILED;
+        }
+        trace->capacity = ring_records;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &trace->start);
+
+    // Шаг 2: Включаем трассу: операции проверяют указатель под той же блокировкой
+    pthread_mutex_lock(&dev->timing_lock);
+    dev->trace = trace;
+    pthread_mutex_unlock(&dev->timing_lock);
+    return SSDMMC_OK;
+}
+
+void ssdmmc_sim_trace_stop(ssdmmc_sim_device *dev)
+{
+    if (dev == NULL)
+        return;
+
+    pthread_mutex_lock(&dev->timing_lock);
+    ssdmmc_sim_trace *trace = dev->trace;
+    dev->trace = NULL;
+    if (trace)
+        ssdmmc_sim_trace_flush_pending(trace);
+    pthread_mutex_unlock(&dev->timing_lock);
+
+    if (trace == NULL)
+        return;
+    if (trace->file)
+        fclose(trace->file);
+    free(trace->ring);
+    free(trace);
+}
+
+size_t ssdmmc_sim_trace_read(ssdmmc_sim_device *dev, ssdmmc_sim_trace_record *records, size_t max)
+{
+    if (dev == NULL || records == NULL)
+        return 0;
+
+    size_t count = 0;
+    pthread_mutex_lock(&dev->timing_lock);
+    ssdmmc_sim_trace *trace = dev->trace;
+    if (trace && trace->ring) {
+        ssdmmc_sim_trace_flush_pending(trace);
+        while (count < max && trace->tail < trace->head) {
+            records[count++] = trace->ring[trace->tail % trace->capacity];
+            trace->tail++;
+        }
+    }
+    pthread_mutex_unlock(&dev->timing_lock);
+    return count;
+}
+
+int ssdmmc_sim_trace_get_counts(ssdmmc_sim_device *dev, uint64_t *records, uint64_t *overwritten)
+{
+    if (dev == NULL || records == NULL || overwritten == NULL)
+        return SSDMMC_ERR_NULL_POINTER;
+
+    pthread_mutex_lock(&dev->timing_lock);
+    *records     = dev->trace ? dev->trace->records + dev->trace->has_pending : 0;
+    *overwritten = dev->trace ? dev->trace->overwritten : 0;
+    pthread_mutex_unlock(&dev->timing_lock);
+    return SSDMMC_OK;
+}
+
+void ssdmmc_sim_trace_set_op(uint8_t api_op, uint32_t key_hash)
+{
+    trace_api_op   = api_op;
+    trace_key_hash = key_hash;
+}
+
+void ssdmmc_sim_trace_set_path(uint8_t path)
+{
+    trace_path = path;
+}
+
+void ssdmmc_sim_trace_event(ssdmmc_sim_device *dev, uint32_t length, int8_t status)
+{
+    if (dev == NULL)
+        return;
+
+    pthread_mutex_lock(&dev->timing_lock);
+    if (dev->trace) {
+        ssdmmc_sim_trace_record record;
+        ssdmmc_sim_trace_flush_pending(dev->trace);
+        ssdmmc_sim_trace_fill(dev, &record, SSDMMC_SIM_TRACE_EVENT);
+        record.page   = length;
+        record.status = status;
+        ssdmmc_sim_trace_put(dev->trace, &record);
+    }
+    pthread_mutex_unlock(&dev->timing_lock);
+}
+
+int ssdmmc_sim_trace_replay(ssdmmc_sim_device *dev, const ssdmmc_sim_trace_record *record)
+{
+    if (dev == NULL || record == NULL)
+        return SSDMMC_ERR_NULL_POINTER;
+
+    // Данные записей в трассу не попадают: записываются нули, их можно запрограммировать поверх любых данных
+    uint8_t word[SSDMMC_SIM_WORD_SIZE];
+    memset(word, 0, sizeof(word));
+    int status = SSDMMC_OK;
+    switch (record->op) {
+    case SSDMMC_SIM_TRACE_READ:
+        for (uint32_t w = 0; w < record->word_count && status == SSDMMC_OK; w++)
+            status = ssdmmc_sim_read_word(dev, record->page, record->first_word + w, word);
+        break;
+    case SSDMMC_SIM_TRACE_WRITE:
+        for (uint32_t w = 0; w < record->word_count && status == SSDMMC_OK; w++)
+            status = ssdmmc_sim_write_word(dev, record->page, record->first_word + w, word);
+        break;
+    case SSDMMC_SIM_TRACE_ERASE:
+        status = ssdmmc_sim_erase_page(dev, record->page);
+        break;
+    default:
+        break;
+    }
+    return status;
+}
@@ -50,38 +50,38 @@ void Kvs_put(const void *key, size_t key_len, const void *value, size_t value_le
     }
 }
 
-void Kvs_get(const void *key, void *value, size_t *value_len) {
+void Kvs_get(const void *key, size_t key_len, void *value, size_t *value_len) {
     size_t initial_size = *value_len;
-    kvs_status status = kvs_get(key, value, value_len);
+    kvs_status status = kvs_get(key, key_len, value, value_len);
     if (status == KVS_SUCCESS) {
-        printf("KVS_GET: Ключ '%.*s' успешно прочитан (размер: %zu).\n", (int)strnlen(key, KVS_KEY_SIZE), (const char*)key, *value_len);
+        printf("KVS_GET: Ключ '%.*s' успешно прочитан (размер: %zu).\n", (int)strnlen(key, key_len), (const char*)key, *value_len);
     } else if (status == KVS_ERROR_BUFFER_TOO_SMALL) {
-        printf("KVS_GET: Ошибка чтения ключа '%.*s'. Причина: Буфер слишком мал (требуется %zu, предоставлено %zu).\n", (int)strnlen(key, KVS_KEY_SIZE), (const char*)key, *value_len, initial_size);
+        printf("KVS_GET: Ошибка чтения ключа '%.*s'. Причина: Буфер слишком мал (требуется %zu, предоставлено %zu).\n", (int)strnlen(key, key_len), (const char*)key, *value_len, initial_size);
     } else {
-        printf("KVS_GET: Ошибка чтения ключа '%.*s'. Причина: %s.\n", (int)strnlen(key, KVS_KEY_SIZE), (const char*)key, get_kvs_error_string(status));
+        printf("KVS_GET: Ошибка чтения ключа '%.*s'. Причина: %s.\n", (int)strnlen(key, key_len), (const char*)key, get_kvs_error_string(status));
     }
 }
 
-void Kvs_delete(const void *key) {
-    kvs_status status = kvs_delete(key);
+void Kvs_delete(const void *key, size_t key_len) {
+    kvs_status status = kvs_delete(key, key_len);
     if (status == KVS_SUCCESS) {
-        printf("KVS_DELETE: Ключ '%.*s' успешно удален.\n", (int)strnlen(key, KVS_KEY_SIZE), (const char*)key);
+        printf("KVS_DELETE: Ключ '%.*s' успешно удален.\n", (int)strnlen(key, key_len), (const char*)key);
     } else {
-        printf("KVS_DELETE: Ошибка удаления ключа '%.*s'. Причина: %s.\n", (int)strnlen(key, KVS_KEY_SIZE), (const char*)key, get_kvs_error_string(status));
+        printf("KVS_DELETE: Ошибка удаления ключа '%.*s'. Причина: %s.\n", (int)strnlen(key, key_len), (const char*)key, get_kvs_error_string(status));
     }
 }
 
-void Kvs_exists(const void *key) {
-    int result = kvs_exists(key);
+void Kvs_exists(const void *key, size_t key_len) {
+    int result = kvs_exists(key, key_len);
     if (result == 1) {
-        printf("KVS_EXISTS: Ключ '%.*s' найден в хранилище.\n", (int)strnlen(key, KVS_KEY_SIZE), (const char*)key);
+        printf("KVS_EXISTS: Ключ '%.*s' найден в хранилище.\n", (int)strnlen(key, key_len), (const char*)key);
     } else if (result == 0) {
-        printf("KVS_EXISTS: Ключ '%.*s' не найден в хранилище.\n", (int)strnlen(key, KVS_KEY_SIZE), (const char*)key);
+        printf("KVS_EXISTS: Ключ '%.*s' не найден в хранилище.\n", (int)strnlen(key, key_len), (const char*)key);
     } else {
-        printf("KVS_EXISTS: Ошибка проверки ключа '%.*s'. Причина: %s.\n", (int)strnlen(key, KVS_KEY_SIZE), (const char*)key, get_kvs_error_string((kvs_status)result));
+        printf("KVS_EXISTS: Ошибка проверки ключа '%.*s'. Причина: %s.\n", (int)strnlen(key, key_len), (const char*)key, get_kvs_error_string((kvs_status)result));
     }
 }
-void Kvs_update(const void *key, const void *value, size_t value_len) {
-    kvs_status status = kvs_update(key, value, value_len);
-    printf("KVS_UPDATE: ключ '%s', результат: %s\n", (char*)key, status == KVS_SUCCESS ? "Успех" : "Ошибка");
+void Kvs_update(const void *key, size_t key_len, const void *value, size_t value_len) {
+    kvs_status status = kvs_update(key, key_len, value, value_len);
+    printf("KVS_UPDATE: ключ '%.*s', результат: %s\n", (int)strnlen(key, key_len), (const char*)key, status == KVS_SUCCESS ? "Успех" : "Ошибка");
 }
\ No newline at end of file
@@ -18,18 +18,18 @@ void Kvs_put(const void *key, size_t key_len, const void *value, size_t value_le
 
 // Обертка для kvs_get.
 // Получает значение по ключу и выводит результат операции.
-void Kvs_get(const void *key, void *value, size_t *value_len);
+void Kvs_get(const void *key, size_t key_len, void *value, size_t *value_len);
 
 // Обертка для kvs_delete.
 // Удаляет ключ и выводит результат операции.
-void Kvs_delete(const void *key);
+void Kvs_delete(const void *key, size_t key_len);
 
 // Обертка для kvs_exists.
 // Проверяет существование ключа и выводит результат.
-void Kvs_exists(const void *key);
+void Kvs_exists(const void *key, size_t key_len);
 
 // Обертка для kvs_update
-void Kvs_update(const void *key, const void *value, size_t value_len);
+void Kvs_update(const void *key, size_t key_len, const void *value, size_t value_len);
 
 
 #endif
\ No newline at end of file
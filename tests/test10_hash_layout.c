@@ -0,0 +1,150 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 128)
+#define NUM_KEYS            300
+#define VALUE_SIZE          64
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "hash_key_%d", i);
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    memset(value, (uint8_t)((i * 5 + version) % 0xFF), VALUE_SIZE);
+}
+
+// Ключ удален, если его номер делится на 3; ключи с четным номером обновлены до версии 1.
+static bool key_is_deleted(int i) {
+    return i % 3 == 0;
+}
+
+static int key_version(int i) {
+    return i % 2 == 0 ? 1 : 0;
+}
+
+// Проверяет содержимое хранилища и возвращает количество ошибок.
+static int check_contents(void) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    uint8_t expected[VALUE_SIZE];
+    int errors = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        size_t value_len = VALUE_SIZE;
+        make_key(key, i);
+        kvs_status status = kvs_get(key, strlen(key), value, &value_len);
+        if (key_is_deleted(i)) {
+            if (status != KVS_ERROR_KEY_NOT_FOUND || kvs_exists(key, strlen(key)) != 0) {
+                errors++;
+            }
+            continue;
+        }
+        make_value(expected, i, key_version(i));
+        if (status != KVS_SUCCESS || value_len != VALUE_SIZE || memcmp(value, expected, VALUE_SIZE) != 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// Количество ключей, оставшихся после удаления части из них.
+static int expected_live_keys(void) {
+    int live = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        live += key_is_deleted(i) ? 0 : 1;
+    }
+    return live;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("         ЗАПУСК ТЕСТА ХЕШ-РАСКЛАДКИ МЕТАДАННЫХ           \n");
+    printf("=========================================================\n");
+
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    int errors = 0;
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init_with_layout(TEST_USER_DATA_SIZE, KVS_LAYOUT_HASH) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return 1;
+    }
+    printf("  Корзин: %u по %u слотов\n", device->superblock.hash_bucket_count, device->superblock.hash_bucket_slots);
+
+    // Записываем ключи, часть удаляем, часть обновляем
+    printf("\n--- Запись %d ключей, удаление и обновление части из них ---\n", NUM_KEYS);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        if (kvs_put(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+            errors++;
+        }
+    }
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        if (key_is_deleted(i)) {
+            if (kvs_delete(key, strlen(key)) != KVS_SUCCESS) {
+                errors++;
+            }
+        } else if (key_version(i) == 1) {
+            make_value(value, i, 1);
+            if (kvs_update(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+                errors++;
+            }
+        }
+    }
+
+    // Поиск каждого ключа должен читать с устройства в среднем около одной корзины
+    device->hash_lookups = 0;
+    device->hash_bucket_reads = 0;
+    errors += check_contents();
+    double reads_per_lookup = device->hash_lookups ? (double)device->hash_bucket_reads / device->hash_lookups : 0.0;
+    printf("  Поисков по хешу: %llu, прочитано корзин: %llu (%.2f на поиск), наибольшее удаление: %u\n",
+           (unsigned long long)device->hash_lookups, (unsigned long long)device->hash_bucket_reads,
+           reads_per_lookup, device->superblock.hash_max_probe);
+    kvs_deinit();
+
+    // Раскладка хранится в суперблоке: обычный kvs_init должен загрузить хеш-раскладку
+    printf("\n--- Перезапуск хранилища ---\n");
+    bool layout_ok = false;
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS) {
+        errors++;
+    } else {
+        layout_ok = device->superblock.metadata_layout == KVS_LAYOUT_HASH;
+        // В хеш-раскладке ключи ищутся прямо в корзинах, индекс ключей в памяти не строится
+        if (device->key_index != NULL || device->key_count != (uint32_t)expected_live_keys()) {
+            printf("  ОШИБКА: индекс ключей построен или счетчик ключей неверен (%u).\n", device->key_count);
+            errors++;
+        }
+        errors += check_contents();
+        kvs_deinit();
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0 && layout_ok) {
+        printf("  ПРОВЕРКА: Все значения корректны, хеш-раскладка сохранилась после перезапуска.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d, раскладка %s.\n", errors, layout_ok ? "сохранилась" : "потеряна");
+    }
+    if (reads_per_lookup > 0.0 && reads_per_lookup <= 1.5) {
+        printf("  ПРОВЕРКА: Поиск ключа читает в среднем %.2f корзины.\n", reads_per_lookup);
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Поиск ключа читает в среднем %.2f корзины.\n", reads_per_lookup);
+    }
+
+    printf("\n=========================================================\n");
+    printf("        ТЕСТИРОВАНИЕ ХЕШ-РАСКЛАДКИ ЗАВЕРШЕНО              \n");
+    printf("=========================================================\n");
+    return 0;
+}
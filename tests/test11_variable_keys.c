@@ -0,0 +1,368 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 128)
+#define VALUE_SIZE          48
+#define MAX_TEST_KEYS       16
+#define CHURN_ROUNDS        120
+#define CHURN_VALUE_SIZE    2000
+#define SMALL_VALUE_SIZE    8
+// Данные занимают почти все устройство, чтобы область метаданных вмещала немного слотов
+#define CAPACITY_USER_DATA_SIZE (1930 * 1024)
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+// Ключ теста: байты и их точное количество (нулевые байты в конце входят в ключ)
+typedef struct {
+    uint8_t bytes[KVS_KEY_SIZE];
+    uint32_t len;
+} test_key;
+
+static test_key keys[MAX_TEST_KEYS];
+static int key_total = 0;
+
+// Слот метаданных, хранящий ключ целиком: так он был устроен до переноса хвоста длинного ключа в область данных
+typedef struct {
+    uint8_t  key_len;
+    uint8_t  key[KVS_KEY_SIZE];
+    uint32_t value_offset;
+    uint32_t value_size;
+    uint32_t update_count;
+#if KVS_INLINE_VALUE_SIZE > 0
+    uint8_t  inline_value[KVS_INLINE_VALUE_SIZE];
+#endif
+} full_key_metadata;
+
+static void add_text_key(uint32_t len) {
+    test_key *k = &keys[key_total++];
+    memset(k->bytes, 0, KVS_KEY_SIZE);
+    for (uint32_t j = 0; j < len; j++) {
+        k->bytes[j] = (uint8_t)('a' + (j * 7 + len) % 26);
+    }
+    k->len = len;
+}
+
+static void add_raw_key(const uint8_t *bytes, uint32_t len) {
+    test_key *k = &keys[key_total++];
+    memset(k->bytes, 0, KVS_KEY_SIZE);
+    memcpy(k->bytes, bytes, len);
+    k->len = len;
+}
+
+// Добавляет ключ той же длины, что и ключ number, отличающийся от него только последним байтом.
+static void add_sibling_key(int number) {
+    test_key *k = &keys[key_total++];
+    *k = keys[number];
+    k->bytes[k->len - 1] ^= 0x01;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i) {
+    for (int j = 0; j < VALUE_SIZE; j++) {
+        value[j] = (uint8_t)((i * 31 + j) % 0xFF);
+    }
+}
+
+// Находит ключ теста по байтам и длине. Возвращает его номер или -1.
+static int find_key(const uint8_t *bytes, size_t len) {
+    for (int i = 0; i < key_total; i++) {
+        if (keys[i].len == len && memcmp(keys[i].bytes, bytes, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Возвращает копию ключа в буфере ровно key_len байт (освобождает вызывающий) или NULL:
+// библиотека не должна читать за его пределами.
+static uint8_t *exact_copy(const test_key *k) {
+    uint8_t *exact = malloc(k->len);
+    if (exact) {
+        memcpy(exact, k->bytes, k->len);
+    }
+    return exact;
+}
+
+static bool update_exact(const test_key *k, int i) {
+    uint8_t value[VALUE_SIZE];
+    uint8_t *exact = exact_copy(k);
+    if (!exact) {
+        return false;
+    }
+    make_value(value, i);
+    bool ok = kvs_update(exact, k->len, value, VALUE_SIZE) == KVS_SUCCESS;
+    free(exact);
+    return ok;
+}
+
+static bool put_exact(const test_key *k, int i) {
+    uint8_t value[VALUE_SIZE];
+    uint8_t *exact = exact_copy(k);
+    if (!exact) {
+        return false;
+    }
+    make_value(value, i);
+    bool ok = kvs_put(exact, k->len, value, VALUE_SIZE) == KVS_SUCCESS;
+    free(exact);
+    return ok;
+}
+
+// Проверяет все ключи, передавая каждый в буфере ровно его длины.
+// deleted - номер удаленного ключа или -1. Возвращает количество ошибок.
+static int check_contents(int deleted) {
+    int errors = 0;
+    for (int i = 0; i < key_total; i++) {
+        uint8_t value[VALUE_SIZE];
+        uint8_t expected[VALUE_SIZE];
+        size_t value_len = VALUE_SIZE;
+        uint8_t *exact = exact_copy(&keys[i]);
+        if (!exact) {
+            return errors + 1;
+        }
+        kvs_status status = kvs_get(exact, keys[i].len, value, &value_len);
+        int exists = kvs_exists(exact, keys[i].len);
+        free(exact);
+        if (i == deleted) {
+            if (status != KVS_ERROR_KEY_NOT_FOUND || exists != 0) {
+                printf("  ОШИБКА: удаленный ключ длиной %u найден.\n", keys[i].len);
+                errors++;
+            }
+            continue;
+        }
+        make_value(expected, i);
+        if (status != KVS_SUCCESS || exists != 1 || value_len != VALUE_SIZE || memcmp(value, expected, VALUE_SIZE) != 0) {
+            printf("  ОШИБКА: ключ длиной %u прочитан неверно (статус %d).\n", keys[i].len, status);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// Обходит хранилище итератором: ключи должны идти по возрастанию, каждый ровно один раз и со своим значением.
+// deleted - номер удаленного ключа или -1. Возвращает количество ошибок.
+static int check_iteration(int deleted) {
+    kvs_iterator *iter = NULL;
+    if (kvs_iter_open(NULL, 0, NULL, 0, &iter) != KVS_SUCCESS) {
+        printf("  ОШИБКА: не удалось открыть итератор.\n");
+        return 1;
+    }
+    int errors = 0;
+    int seen = 0;
+    int previous = -1;
+    uint8_t key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    uint8_t expected[VALUE_SIZE];
+    size_t key_len = 0;
+    size_t value_len = VALUE_SIZE;
+    while (kvs_iter_next(iter, key, &key_len, value, &value_len) == KVS_SUCCESS) {
+        int i = find_key(key, key_len);
+        make_value(expected, i);
+        if (i < 0 || i == deleted || value_len != VALUE_SIZE || memcmp(value, expected, VALUE_SIZE) != 0) {
+            printf("  ОШИБКА: итератор вернул неверную пару (ключ длиной %zu).\n", key_len);
+            errors++;
+        } else if (previous >= 0 && kvs_key_compare(keys[previous].bytes, keys[previous].len, key, key_len) >= 0) {
+            printf("  ОШИБКА: итератор нарушил порядок ключей на ключе длиной %zu.\n", key_len);
+            errors++;
+        }
+        previous = i;
+        seen++;
+        value_len = VALUE_SIZE;
+    }
+    kvs_iter_close(iter);
+    if (seen != key_total - (deleted >= 0)) {
+        printf("  ОШИБКА: итератор вернул %d ключей вместо %d.\n", seen, key_total - (deleted >= 0));
+        errors++;
+    }
+    return errors;
+}
+
+// Многократно перезаписывает самый длинный ключ, чтобы сборщик мусора переносил хвосты длинных ключей,
+// а снимок, открытый до перезаписи, продолжал видеть прежнее значение. Возвращает количество ошибок.
+static int churn_long_key(void) {
+    int errors = 0;
+    int last = key_total - 1;
+    kvs_snapshot *snapshot = NULL;
+    if (kvs_snapshot_create(&snapshot) != KVS_SUCCESS) {
+        return 1;
+    }
+    // Крупные значения за CHURN_ROUNDS перезаписей несколько раз заполняют область данных
+    static uint8_t churn_value[CHURN_VALUE_SIZE];
+    for (int round = 0; round < CHURN_ROUNDS && errors == 0; round++) {
+        memset(churn_value, round % 0xFF, CHURN_VALUE_SIZE);
+        errors += kvs_update(keys[last].bytes, keys[last].len, churn_value, CHURN_VALUE_SIZE) != KVS_SUCCESS;
+    }
+    errors += !update_exact(&keys[last], last);
+
+    uint8_t value[VALUE_SIZE];
+    uint8_t expected[VALUE_SIZE];
+    size_t value_len = VALUE_SIZE;
+    make_value(expected, last);
+    if (kvs_snapshot_get(snapshot, keys[last].bytes, keys[last].len, value, &value_len) != KVS_SUCCESS
+        || value_len != VALUE_SIZE || memcmp(value, expected, VALUE_SIZE) != 0) {
+        printf("  ОШИБКА: снимок не видит прежнее значение ключа длиной %u.\n", keys[last].len);
+        errors++;
+    }
+    kvs_snapshot_release(snapshot);
+    if (errors > 0) {
+        printf("  ОШИБКА: перезапись ключа длиной %u не удалась.\n", keys[last].len);
+    }
+    return errors;
+}
+
+// Проверяет, что в ту же область метаданных помещается в несколько раз больше 20-байтовых ключей,
+// чем при слоте с ключом целиком, и все они записываются и читаются. Возвращает количество ошибок.
+static int run_capacity(kvs_metadata_layout layout) {
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init_with_layout(CAPACITY_USER_DATA_SIZE, layout) != KVS_SUCCESS || !device) {
+        return 1;
+    }
+    // Объем области метаданных считаем по количеству слотов: metadata_size_bytes в суперблоке 16-битный
+    int errors = 0;
+    uint32_t max_key_count = device->superblock.max_key_count;
+    uint32_t full_key_count = (uint32_t)((uint64_t)max_key_count * sizeof(kvs_metadata) / sizeof(full_key_metadata));
+    printf("  Емкость: слот %zu байт вместо %zu, ключей до %u вместо %u\n",
+           sizeof(kvs_metadata), sizeof(full_key_metadata), max_key_count, full_key_count);
+    if (sizeof(full_key_metadata) >= 3 * sizeof(kvs_metadata) && max_key_count < 3 * full_key_count) {
+        printf("  ОШИБКА: емкость выросла меньше чем втрое.\n");
+        errors++;
+    }
+
+    // Записываем больше ключей, чем поместилось бы при слоте с ключом целиком
+    uint32_t count = full_key_count * 3 < max_key_count ? full_key_count * 3 : max_key_count;
+    char key[KVS_KEY_SIZE + 1];
+    uint8_t value[SMALL_VALUE_SIZE];
+    for (uint32_t i = 0; i < count && errors == 0; i++) {
+        snprintf(key, sizeof(key), "capacity_key_%07u", i);
+        memset(value, (int)(i % 0xFF), SMALL_VALUE_SIZE);
+        if (kvs_put(key, 20, value, SMALL_VALUE_SIZE) != KVS_SUCCESS) {
+            printf("  ОШИБКА: ключ %u из %u не записан.\n", i, count);
+            errors++;
+        }
+    }
+    kvs_deinit();
+
+    if (kvs_init(CAPACITY_USER_DATA_SIZE) != KVS_SUCCESS) {
+        return errors + 1;
+    }
+    for (uint32_t i = 0; i < count && errors == 0; i++) {
+        uint8_t read_back[SMALL_VALUE_SIZE];
+        size_t read_len = SMALL_VALUE_SIZE;
+        snprintf(key, sizeof(key), "capacity_key_%07u", i);
+        memset(value, (int)(i % 0xFF), SMALL_VALUE_SIZE);
+        if (kvs_get(key, 20, read_back, &read_len) != KVS_SUCCESS || read_len != SMALL_VALUE_SIZE
+            || memcmp(read_back, value, SMALL_VALUE_SIZE) != 0) {
+            printf("  ОШИБКА: ключ %u из %u не прочитан после перезапуска.\n", i, count);
+            errors++;
+        }
+    }
+    kvs_deinit();
+    printf("  Записано и прочитано 20-байтовых ключей: %u\n", count);
+    return errors;
+}
+
+// Прогоняет сценарий для одной раскладки метаданных. Возвращает количество ошибок.
+static int run_layout(kvs_metadata_layout layout, const char *name) {
+    int errors = 0;
+    printf("\n--- Раскладка %s ---\n", name);
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init_with_layout(TEST_USER_DATA_SIZE, layout) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return 1;
+    }
+    printf("  Слот метаданных: %zu байт, ключей в хранилище: до %u\n",
+           sizeof(kvs_metadata), device->superblock.max_key_count);
+
+    for (int i = 0; i < key_total; i++) {
+        if (!put_exact(&keys[i], i)) {
+            printf("  ОШИБКА: не удалось записать ключ длиной %u.\n", keys[i].len);
+            errors++;
+        }
+    }
+
+    // Повторная запись того же ключа должна дать дубликат, а тот же ключ с нулевым байтом
+    // в конце - это другой ключ
+    uint8_t value[VALUE_SIZE];
+    make_value(value, 0);
+    if (kvs_put(keys[1].bytes, keys[1].len, value, VALUE_SIZE) != KVS_ERROR_KEY_ALREADY_EXISTS) {
+        printf("  ОШИБКА: существующий ключ записан повторно.\n");
+        errors++;
+    }
+    if (kvs_update(keys[1].bytes, keys[1].len + 1, value, VALUE_SIZE) != KVS_ERROR_KEY_NOT_FOUND) {
+        printf("  ОШИБКА: ключ с нулевым байтом в конце совпал с ключом без него.\n");
+        errors++;
+    }
+
+    errors += churn_long_key();
+
+    // Ключ "abc" удаляем: "abcd", начинающийся с тех же байт, должен остаться
+    int deleted = 2;
+    if (kvs_delete(keys[deleted].bytes, keys[deleted].len) != KVS_SUCCESS) {
+        errors++;
+    }
+    errors += check_contents(deleted);
+    errors += check_iteration(deleted);
+    kvs_deinit();
+
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS) {
+        return errors + 1;
+    }
+    errors += check_contents(deleted);
+    errors += check_iteration(deleted);
+    kvs_deinit();
+
+    errors += run_capacity(layout);
+    printf("  Ошибок: %d\n", errors);
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("         ЗАПУСК ТЕСТА КЛЮЧЕЙ ПЕРЕМЕННОЙ ДЛИНЫ            \n");
+    printf("=========================================================\n");
+
+    // Ключи разной длины, ключ-префикс другого ключа и двоичные ключи с нулями внутри и в конце
+    const uint8_t binary_a[] = {0x01, 0x00, 0x02};
+    const uint8_t binary_b[] = {0x01, 0x00, 0x00, 0x03};
+    const uint8_t binary_c[] = {0x01, 0x00, 0x02, 0x00};
+    add_text_key(1);
+    add_text_key(20);
+    add_raw_key((const uint8_t *)"abc", 3);
+    add_raw_key((const uint8_t *)"abcd", 4);
+    add_raw_key(binary_a, sizeof(binary_a));
+    add_raw_key(binary_b, sizeof(binary_b));
+    add_raw_key(binary_c, sizeof(binary_c));
+    // Ключи на границе слота и длинные ключи, различающиеся только байтами хвоста в области данных
+    if (KVS_KEY_SIZE > KVS_SLOT_KEY_BYTES + 1) {
+        add_text_key(KVS_SLOT_KEY_BYTES);
+        add_text_key(KVS_SLOT_KEY_BYTES + 1);
+        add_sibling_key(key_total - 1);
+    }
+    if (KVS_KEY_SIZE > 127) {
+        add_text_key(127);
+        add_sibling_key(key_total - 1);
+    }
+    add_text_key(KVS_KEY_SIZE);
+
+    int errors = run_layout(KVS_LAYOUT_LINEAR, "линейная");
+    errors += run_layout(KVS_LAYOUT_HASH, "хеш");
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Ключи длиной от 1 до %d байт корректны в обеих раскладках, в том числе после перезапуска, сборки мусора и в снимке; емкость слотов выросла.\n", KVS_KEY_SIZE);
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("       ТЕСТИРОВАНИЕ КЛЮЧЕЙ ПЕРЕМЕННОЙ ДЛИНЫ ЗАВЕРШЕНО     \n");
+    printf("=========================================================\n");
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 128)
+#define NUM_KEYS            50
+#define NUM_SIZES           7
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+static const uint32_t value_sizes[NUM_SIZES] = {1, 4, 8, 16, 32, 48, 64};
+
+// Счетчики обращений к устройству за одну фазу нагрузки
+typedef struct {
+    uint64_t read_ops;
+    uint64_t read_bytes;
+    uint64_t write_ops;
+    uint64_t data_page_rewrites;
+} io_sample;
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "inline_%d", i);
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, uint32_t size) {
+    for (uint32_t j = 0; j < size; j++) {
+        value[j] = (uint8_t)((i * 13 + j) % 0xFF);
+    }
+}
+
+// Суммарный счетчик перезаписи страниц области данных (без страниц метаданных).
+static uint64_t data_page_rewrites(void) {
+    uint32_t page_size = device->superblock.page_size_bytes;
+    uint32_t count = device->superblock.metadata_offset / page_size - device->superblock.data_offset / page_size;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        total += device->page_rewrite_count[i];
+    }
+    return total;
+}
+
+static io_sample io_now(void) {
+    io_sample s = {device->io_read_ops, device->io_read_bytes, device->io_write_ops, data_page_rewrites()};
+    return s;
+}
+
+static io_sample io_since(io_sample start) {
+    io_sample now = io_now();
+    io_sample d = {now.read_ops - start.read_ops, now.read_bytes - start.read_bytes,
+                   now.write_ops - start.write_ops, now.data_page_rewrites - start.data_page_rewrites};
+    return d;
+}
+
+// Проверяет все ключи и возвращает количество ошибок.
+static int check_contents(uint32_t size) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[64];
+    uint8_t expected[64];
+    int errors = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        size_t value_len = sizeof(value);
+        make_key(key, i);
+        make_value(expected, i, size);
+        if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || value_len != size || memcmp(value, expected, size) != 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// Записывает и читает NUM_KEYS значений размера size на чистом хранилище.
+// inline_limit - наибольший размер значения, которое записывается в слот метаданных (0 - хранение в области данных).
+// Возвращает количество ошибок, put_out и get_out - обращения к устройству при записи и чтении.
+static int run_workload(uint32_t size, uint32_t inline_limit, io_sample *put_out, io_sample *get_out) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[64];
+    int errors = 0;
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS || !device) {
+        return -1;
+    }
+    device->inline_value_limit = inline_limit;
+    kvs_set_cache_budget(0);
+
+    io_sample start = io_now();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, size);
+        if (kvs_put(key, strlen(key), value, size) != KVS_SUCCESS) {
+            errors++;
+        }
+    }
+    *put_out = io_since(start);
+
+    start = io_now();
+    errors += check_contents(size);
+    *get_out = io_since(start);
+
+    // Значения в слотах метаданных должны пережить перезапуск
+    kvs_deinit();
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS) {
+        return errors + 1;
+    }
+    errors += check_contents(size);
+    kvs_deinit();
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("        ЗАПУСК ТЕСТА ЗНАЧЕНИЙ В СЛОТЕ МЕТАДАННЫХ         \n");
+    printf("=========================================================\n");
+
+    // Значения в слоте включаются при сборке (например, -DKVS_INLINE_VALUE_SIZE=64)
+    if (KVS_INLINE_VALUE_SIZE == 0) {
+        printf("  Библиотека собрана без значений в слоте метаданных (KVS_INLINE_VALUE_SIZE=0), тест пропущен.\n");
+        return 0;
+    }
+    printf("  Размер слота: %zu байт, значения до %d байт хранятся в слоте\n", sizeof(kvs_metadata), KVS_INLINE_VALUE_SIZE);
+    printf("\n  Обращения к устройству на одну операцию (область данных -> слот метаданных).\n");
+    printf("  Записи на put включают сохранение служебных областей, общее для обоих режимов:\n");
+    printf("  %6s | %-21s | %-21s | %-21s | %-21s\n", "Размер", "чтений на get", "байт чтения на get", "записей на put", "страниц данных на put");
+
+    int errors = 0;
+    bool reduced = true;
+    for (int s = 0; s < NUM_SIZES; s++) {
+        io_sample put_extent, get_extent, put_inline, get_inline;
+        int e1 = run_workload(value_sizes[s], 0, &put_extent, &get_extent);
+        int e2 = run_workload(value_sizes[s], KVS_INLINE_VALUE_SIZE, &put_inline, &get_inline);
+        if (e1 < 0 || e2 < 0) {
+            printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+            return 1;
+        }
+        errors += e1 + e2;
+        printf("  %6u | %6.1f -> %-6.1f | %7.1f -> %-7.1f | %6.1f -> %-6.1f | %7.1f -> %-7.1f\n", value_sizes[s],
+               (double)get_extent.read_ops / NUM_KEYS, (double)get_inline.read_ops / NUM_KEYS,
+               (double)get_extent.read_bytes / NUM_KEYS, (double)get_inline.read_bytes / NUM_KEYS,
+               (double)put_extent.write_ops / NUM_KEYS, (double)put_inline.write_ops / NUM_KEYS,
+               (double)put_extent.data_page_rewrites / NUM_KEYS, (double)put_inline.data_page_rewrites / NUM_KEYS);
+        if (value_sizes[s] <= KVS_INLINE_VALUE_SIZE &&
+            (get_inline.read_ops >= get_extent.read_ops || put_inline.write_ops >= put_extent.write_ops)) {
+            reduced = false;
+        }
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Все значения корректны в обоих режимах, в том числе после перезапуска.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+    if (reduced) {
+        printf("  ПРОВЕРКА: Значения в слоте метаданных требуют меньше обращений к устройству.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Значения в слоте метаданных не сократили обращения к устройству.\n");
+    }
+
+    printf("\n=========================================================\n");
+    printf("      ТЕСТИРОВАНИЕ ЗНАЧЕНИЙ В СЛОТЕ МЕТАДАННЫХ ЗАВЕРШЕНО  \n");
+    printf("=========================================================\n");
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 256)
+#define NUM_USER_KEYS       100
+#define NUM_ITEM_KEYS       50
+#define MAX_VALUE_SIZE      400
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+static void make_key(char *key, const char *prefix, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "%s:%03d", prefix, i);
+}
+
+// Малые значения хранятся в слоте метаданных, большие - в области данных.
+static uint32_t value_size(int i) {
+    return i % 3 == 0 ? 300 + i : 8 + i % 40;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((i * 11 + j + version) % 0xFF);
+    }
+}
+
+static bool value_matches(const uint8_t *value, size_t len, int i, int version) {
+    uint8_t expected[MAX_VALUE_SIZE];
+    make_value(expected, i, version);
+    return len == value_size(i) && memcmp(value, expected, len) == 0;
+}
+
+// Номер ключа вида "prefix:NNN".
+static int key_number(const char *key) {
+    const char *colon = strchr(key, ':');
+    return colon ? atoi(colon + 1) : -1;
+}
+
+// Проходит итератор до конца. Проверяет строгий порядок ключей и значения (версия 0).
+// Возвращает количество пройденных ключей или -1 при ошибке.
+static int drain(kvs_iterator *iter, int *errors) {
+    char key[KVS_KEY_SIZE];
+    char prev[KVS_KEY_SIZE];
+    size_t prev_len = 0;
+    uint8_t value[MAX_VALUE_SIZE];
+    int count = 0;
+    while (true) {
+        size_t key_len = 0;
+        size_t value_len = sizeof(value);
+        kvs_status status = kvs_iter_next(iter, key, &key_len, value, &value_len);
+        if (status == KVS_ERROR_KEY_NOT_FOUND) {
+            return count;
+        }
+        if (status != KVS_SUCCESS) {
+            return -1;
+        }
+        if (prev_len > 0) {
+            size_t common = prev_len < key_len ? prev_len : key_len;
+            int n = memcmp(prev, key, common);
+            if (n > 0 || (n == 0 && prev_len >= key_len)) {
+                printf("  ОШИБКА: нарушен порядок ключей: '%s' после '%s'.\n", key, prev);
+                (*errors)++;
+            }
+        }
+        if (key_len != strlen(key) || !value_matches(value, value_len, key_number(key), 0)) {
+            printf("  ОШИБКА: неверные данные ключа '%s'.\n", key);
+            (*errors)++;
+        }
+        memcpy(prev, key, KVS_KEY_SIZE);
+        prev_len = key_len;
+        count++;
+    }
+}
+
+// Открывает итератор по диапазону и возвращает количество ключей в нем (или -1).
+static int count_range(const char *start, const char *end, int *errors) {
+    kvs_iterator *iter = NULL;
+    if (kvs_iter_open(start, start ? strlen(start) : 0, end, end ? strlen(end) : 0, &iter) != KVS_SUCCESS) {
+        return -1;
+    }
+    int count = drain(iter, errors);
+    kvs_iter_close(iter);
+    return count;
+}
+
+static int count_prefix(const char *prefix, int *errors) {
+    kvs_iterator *iter = NULL;
+    if (kvs_iter_open_prefix(prefix, strlen(prefix), &iter) != KVS_SUCCESS) {
+        return -1;
+    }
+    int count = drain(iter, errors);
+    kvs_iter_close(iter);
+    return count;
+}
+
+static void expect_count(const char *what, int actual, int expected, int *errors) {
+    if (actual != expected) {
+        printf("  ОШИБКА: %s: %d ключей вместо %d.\n", what, actual, expected);
+        (*errors)++;
+    } else {
+        printf("  %s: %d ключей\n", what, actual);
+    }
+}
+
+// Прогоняет сценарий для одной раскладки метаданных. Возвращает количество ошибок.
+static int run_layout(kvs_metadata_layout layout, const char *name) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    int errors = 0;
+    printf("\n--- Раскладка %s ---\n", name);
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init_with_layout(TEST_USER_DATA_SIZE, layout) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return 1;
+    }
+
+    // Ключи записываем вперемешку, чтобы порядок на устройстве не совпадал с порядком ключей
+    for (int i = NUM_USER_KEYS - 1; i >= 0; i--) {
+        make_key(key, "user", i);
+        make_value(value, i, 0);
+        if (kvs_put(key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+            errors++;
+        }
+        if (i < NUM_ITEM_KEYS) {
+            make_key(key, "item", i);
+            make_value(value, i, 0);
+            if (kvs_put(key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+                errors++;
+            }
+        }
+    }
+
+    // Полный обход, диапазоны и префиксы
+    uint64_t reads_before = device->io_read_ops;
+    expect_count("Полный обход", count_range(NULL, NULL, &errors), NUM_USER_KEYS + NUM_ITEM_KEYS, &errors);
+    printf("  Чтений устройства на ключ при полном обходе: %.2f\n",
+           (double)(device->io_read_ops - reads_before) / (NUM_USER_KEYS + NUM_ITEM_KEYS));
+    expect_count("Диапазон [user:020, user:050)", count_range("user:020", "user:050", &errors), 30, &errors);
+    expect_count("Диапазон [user:095, конец)", count_range("user:095", NULL, &errors), 5, &errors);
+    expect_count("Префикс 'item:'", count_prefix("item:", &errors), NUM_ITEM_KEYS, &errors);
+    expect_count("Префикс 'user:09'", count_prefix("user:09", &errors), 10, &errors);
+    expect_count("Префикс 'zzz'", count_prefix("zzz", &errors), 0, &errors);
+
+    // Маленький буфер не сдвигает итератор
+    kvs_iterator *iter = NULL;
+    size_t small_len = 1;
+    size_t key_len = 0;
+    kvs_iter_open_prefix("user:000", 8, &iter);
+    if (kvs_iter_next(iter, key, &key_len, value, &small_len) != KVS_ERROR_BUFFER_TOO_SMALL || small_len != value_size(0)) {
+        printf("  ОШИБКА: не сообщено о нехватке буфера.\n");
+        errors++;
+    }
+    size_t value_len = sizeof(value);
+    if (kvs_iter_next(iter, key, &key_len, value, &value_len) != KVS_SUCCESS || strcmp(key, "user:000") != 0) {
+        printf("  ОШИБКА: итератор сдвинулся после нехватки буфера.\n");
+        errors++;
+    }
+    kvs_iter_close(iter);
+
+    // Изменения во время обхода видны для еще не пройденных ключей
+    kvs_set_write_buffer(16 * 1024);
+    kvs_iter_open_prefix("user:", 5, &iter);
+    int seen = 0;
+    bool saw_deleted = false, saw_added = false, saw_updated = false;
+    while (true) {
+        value_len = sizeof(value);
+        if (kvs_iter_next(iter, key, &key_len, value, &value_len) != KVS_SUCCESS) {
+            break;
+        }
+        int n = key_number(key);
+        if (n == 70) {
+            saw_deleted = true;
+        }
+        if (n == 200) {
+            saw_added = true;
+        }
+        if (n == 80 && value_matches(value, value_len, 80, 1)) {
+            saw_updated = true;
+        }
+        if (++seen == 10) {
+            char other[KVS_KEY_SIZE];
+            make_key(other, "user", 70);
+            kvs_delete(other, strlen(other));
+            make_key(other, "user", 80);
+            make_value(value, 80, 1);
+            kvs_update(other, strlen(other), value, value_size(80));
+            make_key(other, "user", 200);
+            make_value(value, 200, 0);
+            kvs_put(other, strlen(other), value, value_size(200));
+        }
+    }
+    kvs_iter_close(iter);
+    if (saw_deleted || !saw_added || !saw_updated || seen != NUM_USER_KEYS) {
+        printf("  ОШИБКА: изменения во время обхода учтены неверно (пройдено %d).\n", seen);
+        errors++;
+    } else {
+        printf("  Изменения во время обхода учтены: удаленный ключ пропущен, новый и обновленный видны\n");
+    }
+
+    kvs_deinit();
+    printf("  Ошибок: %d\n", errors);
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("          ЗАПУСК ТЕСТА УПОРЯДОЧЕННОГО ОБХОДА             \n");
+    printf("=========================================================\n");
+
+    int errors = run_layout(KVS_LAYOUT_LINEAR, "линейная");
+    errors += run_layout(KVS_LAYOUT_HASH, "хеш");
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Обход возвращает все ключи диапазона по порядку и с корректными значениями.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("        ТЕСТИРОВАНИЕ УПОРЯДОЧЕННОГО ОБХОДА ЗАВЕРШЕНО      \n");
+    printf("=========================================================\n");
+    return 0;
+}
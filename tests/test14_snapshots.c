@@ -0,0 +1,317 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "../src/key_value_store/kvs_metadata.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 32)
+#define NUM_KEYS            60
+#define NUM_NEW_KEYS        10
+#define TOTAL_KEYS          (NUM_KEYS + NUM_NEW_KEYS)
+#define MAX_VALUE_SIZE      320
+#define CHURN_ROUNDS        3
+#define GC_BYTES_NEEDED     (1024 * 4)
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "snap:%03d", i);
+}
+
+// Размер зависит от версии, поэтому при обновлении значение переходит между слотом метаданных и областью данных.
+static uint32_t value_size(int i, int version) {
+    return (i + version) % 3 == 0 ? 40 : 200 + (i * 7 + version) % 100;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i, version); j++) {
+        value[j] = (uint8_t)((i * 17 + j + version * 5) % 0xFF);
+    }
+}
+
+static bool value_matches(const uint8_t *value, size_t len, int i, int version) {
+    uint8_t expected[MAX_VALUE_SIZE];
+    make_value(expected, i, version);
+    return len == value_size(i, version) && memcmp(value, expected, len) == 0;
+}
+
+// Проверяет состояние (снимок или текущее, если snapshot равен NULL) чтением каждого ключа и полным обходом.
+// versions - ожидаемая версия каждого ключа, -1 если ключа нет. Возвращает количество ошибок.
+static int check_view(const kvs_snapshot *snapshot, const int *versions, const char *what) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    int errors = 0;
+    int expected_count = 0;
+
+    for (int i = 0; i < TOTAL_KEYS; i++) {
+        size_t value_len = sizeof(value);
+        make_key(key, i);
+        kvs_status status = snapshot ? kvs_snapshot_get(snapshot, key, strlen(key), value, &value_len) : kvs_get(key, strlen(key), value, &value_len);
+        if (versions[i] < 0) {
+            if (status != KVS_ERROR_KEY_NOT_FOUND) {
+                printf("  ОШИБКА: %s: ключ '%s' виден, хотя его нет (статус %d).\n", what, key, status);
+                errors++;
+            }
+            continue;
+        }
+        expected_count++;
+        if (status != KVS_SUCCESS || !value_matches(value, value_len, i, versions[i])) {
+            printf("  ОШИБКА: %s: ключ '%s' прочитан неверно (статус %d).\n", what, key, status);
+            errors++;
+        }
+    }
+
+    kvs_iterator *iter = NULL;
+    if (kvs_snapshot_iter_open_prefix(snapshot, "snap:", 5, &iter) != KVS_SUCCESS) {
+        return errors + 1;
+    }
+    int seen = 0;
+    while (true) {
+        size_t value_len = sizeof(value);
+        if (kvs_iter_next(iter, key, NULL, value, &value_len) != KVS_SUCCESS) {
+            break;
+        }
+        int i = atoi(key + 5);
+        if (i < 0 || i >= TOTAL_KEYS || versions[i] < 0 || !value_matches(value, value_len, i, versions[i])) {
+            printf("  ОШИБКА: %s: обход вернул неверный ключ или значение '%s'.\n", what, key);
+            errors++;
+        }
+        seen++;
+    }
+    kvs_iter_close(iter);
+    if (seen != expected_count) {
+        printf("  ОШИБКА: %s: обход вернул %d ключей вместо %d.\n", what, seen, expected_count);
+        errors++;
+    }
+    return errors;
+}
+
+// Количество занятых слов в биткарте данных.
+static uint32_t used_words(void) {
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < device->superblock.bitmap_size_bytes; i++) {
+        used += __builtin_popcount(device->bitmap[i]);
+    }
+    return used;
+}
+
+// Количество слов, которые должны занимать живые ключи (значения в слоте метаданных места не занимают).
+static uint32_t live_words(const int *versions) {
+    uint32_t words = 0;
+    uint32_t word_size = device->superblock.word_size_bytes;
+    for (int i = 0; i < TOTAL_KEYS; i++) {
+        if (versions[i] >= 0 && value_size(i, versions[i]) > device->inline_value_limit) {
+            words += (value_size(i, versions[i]) + word_size - 1) / word_size;
+        }
+    }
+    return words;
+}
+
+// Помечает занятыми свободные слова на страницах, где лежат данные сохраненных версий.
+// Возвращает количество помеченных слов.
+static uint32_t mark_garbage_near_versions(void) {
+    uint32_t word_size = device->superblock.word_size_bytes;
+    uint32_t words_per_page = device->superblock.words_per_page;
+    uint32_t total_words = device->superblock.userdata_size_bytes / word_size;
+    uint32_t marked = 0;
+    for (uint32_t v = 0; v < device->snapshot_version_count; v++) {
+        const kvs_snapshot_version *version = &device->snapshot_versions[v];
+        if (version->value_offset == KVS_INLINE_VALUE_OFFSET) {
+            continue;
+        }
+        uint32_t first_word = (version->value_offset - device->superblock.data_offset) / word_size / words_per_page * words_per_page;
+        for (uint32_t w = first_word; w < first_word + words_per_page && w < total_words; w++) {
+            if (!(device->bitmap[w / 8] & (1 << (w % 8)))) {
+                device->bitmap[w / 8] |= (uint8_t)(1 << (w % 8));
+                marked++;
+            }
+        }
+    }
+    return marked;
+}
+
+static int update_key(int *versions, int i, int version) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    make_key(key, i);
+    make_value(value, i, version);
+    if (kvs_update(key, strlen(key), value, value_size(i, version)) != KVS_SUCCESS) {
+        return 1;
+    }
+    versions[i] = version;
+    return 0;
+}
+
+// Прогоняет сценарий для одной раскладки метаданных. Возвращает количество ошибок.
+static int run_layout(kvs_metadata_layout layout, const char *name) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    int live[TOTAL_KEYS], first[TOTAL_KEYS], second[TOTAL_KEYS];
+    int errors = 0;
+    printf("\n--- Раскладка %s ---\n", name);
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init_with_layout(TEST_USER_DATA_SIZE, layout) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return 1;
+    }
+
+    // Шаг 1: Исходное состояние и первый снимок
+    for (int i = 0; i < TOTAL_KEYS; i++) {
+        live[i] = -1;
+    }
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        if (kvs_put(key, strlen(key), value, value_size(i, 0)) != KVS_SUCCESS) {
+            errors++;
+        }
+        live[i] = 0;
+    }
+    kvs_snapshot *snap1 = NULL;
+    if (kvs_snapshot_create(&snap1) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось создать снимок.\n");
+        return errors + 1;
+    }
+    memcpy(first, live, sizeof(live));
+
+    // Шаг 2: Обновления, удаления и новые ключи после снимка (часть - через буфер записи)
+    kvs_set_write_buffer(4 * 1024);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        if (i % 4 == 1) {
+            errors += update_key(live, i, 1);
+        } else if (i % 5 == 2) {
+            make_key(key, i);
+            errors += kvs_delete(key, strlen(key)) != KVS_SUCCESS;
+            live[i] = -1;
+        }
+    }
+    for (int i = NUM_KEYS; i < TOTAL_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        errors += kvs_put(key, strlen(key), value, value_size(i, 0)) != KVS_SUCCESS;
+        live[i] = 0;
+    }
+    kvs_set_write_buffer(0);
+    kvs_snapshot *snap2 = NULL;
+    if (kvs_snapshot_create(&snap2) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось создать снимок.\n");
+        return errors + 1;
+    }
+    memcpy(second, live, sizeof(live));
+    errors += check_view(snap1, first, "Первый снимок");
+    errors += check_view(snap2, second, "Второй снимок");
+    errors += check_view(NULL, live, "Текущее состояние");
+
+    // Шаг 3: Выгрузка первого снимка, во время которой ключи многократно обновляются до сборки мусора
+    kvs_iterator *iter = NULL;
+    kvs_snapshot_iter_open(snap1, NULL, 0, NULL, 0, &iter);
+    int exported = 0;
+    while (exported < NUM_KEYS / 3) {
+        size_t value_len = sizeof(value);
+        if (kvs_iter_next(iter, key, NULL, value, &value_len) != KVS_SUCCESS || !value_matches(value, value_len, atoi(key + 5), first[atoi(key + 5)])) {
+            errors++;
+            break;
+        }
+        exported++;
+    }
+    for (int round = 1; round <= CHURN_ROUNDS; round++) {
+        for (int i = 0; i < TOTAL_KEYS; i++) {
+            if (live[i] >= 0) {
+                errors += update_key(live, i, round + 1);
+            }
+        }
+    }
+
+    // Свободные слова на страницах с данными сохраненных версий помечаем занятыми, как мусор после сбоя.
+    // Сборщик выбирает именно эти страницы и должен перенести версии вместе с живыми ключами
+    uint32_t moved_before[256];
+    uint32_t version_count = device->snapshot_version_count < 256 ? device->snapshot_version_count : 256;
+    for (uint32_t v = 0; v < version_count; v++) {
+        moved_before[v] = device->snapshot_versions[v].value_offset;
+    }
+    uint32_t garbage_words = mark_garbage_near_versions();
+    uint64_t gc_before = device->gc_bytes_moved;
+    kvs_gc(CLEAN_DATA, GC_BYTES_NEEDED);
+    uint32_t versions_moved = 0;
+    for (uint32_t v = 0; v < version_count; v++) {
+        if (device->snapshot_versions[v].value_offset != moved_before[v]) {
+            versions_moved++;
+        }
+    }
+    while (true) {
+        size_t value_len = sizeof(value);
+        if (kvs_iter_next(iter, key, NULL, value, &value_len) != KVS_SUCCESS) {
+            break;
+        }
+        int i = atoi(key + 5);
+        if (!value_matches(value, value_len, i, first[i])) {
+            printf("  ОШИБКА: выгрузка снимка вернула неверное значение '%s'.\n", key);
+            errors++;
+        }
+        exported++;
+    }
+    kvs_iter_close(iter);
+    if (device->gc_bytes_moved == gc_before || versions_moved == 0 || exported != NUM_KEYS) {
+        printf("  ОШИБКА: выгрузка во время сборки мусора: выгружено %d ключей из %d, перенесено версий %u.\n",
+               exported, NUM_KEYS, versions_moved);
+        errors++;
+    } else {
+        printf("  Выгрузка снимка во время обновлений и сборки мусора: %d ключей\n", exported);
+        printf("  Рядом с версиями помечено %u слов мусора, сборщик перенес %u из %u сохраненных версий\n",
+               garbage_words, versions_moved, device->snapshot_version_count);
+    }
+    errors += check_view(snap1, first, "Первый снимок после сборки мусора");
+    errors += check_view(snap2, second, "Второй снимок после сборки мусора");
+    errors += check_view(NULL, live, "Текущее состояние после сборки мусора");
+
+    // Шаг 4: Освобождение снимков возвращает место, которое занимали только их версии
+    kvs_snapshot_release(snap1);
+    errors += check_view(snap2, second, "Второй снимок после освобождения первого");
+    kvs_snapshot_release(snap2);
+    if (device->snapshot_version_count != 0 || used_words() != live_words(live)) {
+        printf("  ОШИБКА: после освобождения снимков осталось %u версий, занято %u слов вместо %u.\n",
+               device->snapshot_version_count, used_words(), live_words(live));
+        errors++;
+    } else {
+        printf("  После освобождения снимков занято %u слов - только живые ключи\n", used_words());
+    }
+
+    // Шаг 5: Текущее состояние переживает перезапуск
+    kvs_deinit();
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS) {
+        return errors + 1;
+    }
+    errors += check_view(NULL, live, "Текущее состояние после перезапуска");
+    kvs_deinit();
+    printf("  Ошибок: %d\n", errors);
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("              ЗАПУСК ТЕСТА СНИМКОВ ХРАНИЛИЩА             \n");
+    printf("=========================================================\n");
+
+    int errors = run_layout(KVS_LAYOUT_LINEAR, "линейная");
+    errors += run_layout(KVS_LAYOUT_HASH, "хеш");
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Снимки неизменны при обновлениях, удалениях и сборке мусора, место освобождается вместе с ними.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("            ТЕСТИРОВАНИЕ СНИМКОВ ХРАНИЛИЩА ЗАВЕРШЕНО      \n");
+    printf("=========================================================\n");
+    return 0;
+}
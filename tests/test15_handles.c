@@ -0,0 +1,216 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "../src/ssdmmc_sim/ssdmmc_sim_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 64)
+#define NUM_SHARDS          4
+#define NUM_KEYS            80
+#define MAX_VALUE_SIZE      200
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+typedef struct {
+    int         shard;
+    kvs_handle *handle;
+    int         errors;
+} shard_job;
+
+static void shard_path(char *path, int shard) {
+    sprintf(path, "../data/kvs_shard_%d.bin", shard);
+}
+
+static void make_key(char *key, int shard, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "s%d:key:%03d", shard, i);
+}
+
+static uint32_t value_size(int i) {
+    return i % 4 == 0 ? 120 + i : 16 + i % 30;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int shard, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((shard * 37 + i * 7 + j + version) % 0xFF);
+    }
+}
+
+// Проверяет ключ i шарда: удаленные ключи (i % 5 == 0) должны отсутствовать, обновленные (i % 3 == 0) - иметь версию 1.
+static int check_shard(kvs_handle *handle, int shard) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    uint8_t expected[MAX_VALUE_SIZE];
+    int errors = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, shard, i);
+        size_t len = sizeof(value);
+        kvs_status status = kvs_get_h(handle, key, strlen(key), value, &len);
+        if (i % 5 == 0) {
+            if (status != KVS_ERROR_KEY_NOT_FOUND) {
+                printf("  ОШИБКА: удаленный ключ '%s' найден.\n", key);
+                errors++;
+            }
+            continue;
+        }
+        make_value(expected, shard, i, i % 3 == 0 ? 1 : 0);
+        if (status != KVS_SUCCESS || len != value_size(i) || memcmp(value, expected, len) != 0) {
+            printf("  ОШИБКА: неверное значение ключа '%s'.\n", key);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// Работа одного потока: свое хранилище, свои ключи.
+static void *shard_worker(void *arg) {
+    shard_job *job = arg;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, job->shard, i);
+        make_value(value, job->shard, i, 0);
+        if (kvs_put_h(job->handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+            job->errors++;
+        }
+    }
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, job->shard, i);
+        if (i % 3 == 0) {
+            make_value(value, job->shard, i, 1);
+            if (kvs_update_h(job->handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+                job->errors++;
+            }
+        }
+        if (i % 5 == 0 && kvs_delete_h(job->handle, key, strlen(key)) != KVS_SUCCESS) {
+            job->errors++;
+        }
+    }
+    job->errors += check_shard(job->handle, job->shard);
+    return NULL;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("         ЗАПУСК ТЕСТА НЕЗАВИСИМЫХ ХРАНИЛИЩ               \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char path[64];
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    kvs_handle *handles[NUM_SHARDS] = {NULL};
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+
+    // Шаг 1: Хранилище по умолчанию и шарды в отдельных файлах
+    remove(KVS_STORAGE_FILE_PATH);
+    ssdmmc_sim_ensure_data_dir_exists();
+    Kvs_init(TEST_USER_DATA_SIZE);
+    Kvs_put("default:key", strlen("default:key"), "default-value", 14);
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        shard_path(path, s);
+        remove(path);
+        options.layout = s % 2 == 0 ? KVS_LAYOUT_LINEAR : KVS_LAYOUT_HASH;
+        if (kvs_open(path, &options, &handles[s]) != KVS_SUCCESS) {
+            printf("Критическая ошибка: не удалось открыть шард %d.\n", s);
+            return 1;
+        }
+    }
+    if (kvs_get_default_handle() != device || kvs_open(NULL, NULL, &handles[0]) != KVS_ERROR_INVALID_PARAM) {
+        printf("  ОШИБКА: неверный дескриптор по умолчанию или проверка параметров.\n");
+        errors++;
+    }
+
+    // Шаг 2: Каждый поток работает со своим хранилищем
+    pthread_t threads[NUM_SHARDS];
+    shard_job jobs[NUM_SHARDS];
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        jobs[s].shard  = s;
+        jobs[s].handle = handles[s];
+        jobs[s].errors = 0;
+        pthread_create(&threads[s], NULL, shard_worker, &jobs[s]);
+    }
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        pthread_join(threads[s], NULL);
+        errors += jobs[s].errors;
+    }
+    printf("  Потоки завершены, ошибок в потоках: %d\n", errors);
+
+    // Шаг 3: Хранилища не видят ключей друг друга, хранилище по умолчанию не затронуто
+    make_key(key, 1, 1);
+    if (kvs_exists_h(handles[0], key, strlen(key)) != 0 || kvs_exists_h(handles[1], key, strlen(key)) != 1 || kvs_exists(key, strlen(key)) != 0) {
+        printf("  ОШИБКА: ключ одного шарда виден в другом хранилище.\n");
+        errors++;
+    }
+    size_t len = sizeof(value);
+    if (kvs_get("default:key", strlen("default:key"), value, &len) != KVS_SUCCESS || len != 14 || kvs_exists_h(handles[2], "default:key", strlen("default:key")) != 0) {
+        printf("  ОШИБКА: хранилище по умолчанию повреждено работой шардов.\n");
+        errors++;
+    }
+    uint32_t expected_keys = NUM_KEYS - NUM_KEYS / 5;
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        if (handles[s]->key_count != expected_keys) {
+            printf("  ОШИБКА: в шарде %d %u ключей вместо %u.\n", s, handles[s]->key_count, expected_keys);
+            errors++;
+        }
+    }
+
+    // Шаг 4: Таймер сбоя питания у каждого устройства свой
+    ssdmmc_sim_device_set_write_failure_countdown(handles[0]->sim, 1000000);
+    make_key(key, 1, 500);
+    make_value(value, 1, 1, 0);
+    kvs_put_h(handles[1], key, strlen(key), value, value_size(1));
+    int untouched = handles[0]->sim->write_countdown;
+    make_key(key, 0, 500);
+    kvs_put_h(handles[0], key, strlen(key), value, value_size(1));
+    if (untouched != 1000000 || handles[0]->sim->write_countdown >= 1000000) {
+        printf("  ОШИБКА: записи одного устройства учтены в таймере другого.\n");
+        errors++;
+    }
+    ssdmmc_sim_device_set_write_failure_countdown(handles[0]->sim, -1);
+    kvs_delete_h(handles[0], key, strlen(key));
+    make_key(key, 1, 500);
+    kvs_delete_h(handles[1], key, strlen(key));
+
+    // Шаг 5: После закрытия и повторного открытия данные каждого шарда на месте
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        kvs_close(handles[s]);
+    }
+    if (device != kvs_get_default_handle()) {
+        printf("  ОШИБКА: закрытие шардов изменило текущее хранилище потока.\n");
+        errors++;
+    }
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        shard_path(path, s);
+        if (kvs_open(path, &options, &handles[s]) != KVS_SUCCESS) {
+            printf("  ОШИБКА: не удалось повторно открыть шард %d.\n", s);
+            errors++;
+            continue;
+        }
+        errors += check_shard(handles[s], s);
+        kvs_close(handles[s]);
+    }
+    Kvs_deinit();
+    if (device != NULL || kvs_get_default_handle() != NULL) {
+        printf("  ОШИБКА: хранилище по умолчанию не закрыто.\n");
+        errors++;
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: %d хранилища работают независимо в параллельных потоках и корректно переоткрываются.\n", NUM_SHARDS);
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("      ТЕСТИРОВАНИЕ НЕЗАВИСИМЫХ ХРАНИЛИЩ ЗАВЕРШЕНО        \n");
+    printf("=========================================================\n");
+    return 0;
+}
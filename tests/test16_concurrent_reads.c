@@ -0,0 +1,207 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdatomic.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 256)
+#define NUM_KEYS            300
+#define MAX_VALUE_SIZE      200
+#define TOTAL_READS         12000
+#define MAX_THREADS         32
+#define WRITER_UPDATES      150
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_concurrent.bin";
+
+typedef struct {
+    kvs_handle *handle;
+    uint32_t    seed;
+    int         reads;
+    int         errors;
+} reader_job;
+
+static atomic_bool writer_running = false;
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "conc:%04d", i);
+}
+
+static uint32_t value_size(int i) {
+    return i % 3 == 0 ? 100 + i % 90 : 20 + i % 40;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((i * 13 + j + version * 101) % 0xFF);
+    }
+}
+
+// Читатель может застать ключ до или после обновления, но не смесь двух версий.
+static bool value_is_consistent(const uint8_t *value, size_t len, int i) {
+    uint8_t expected[MAX_VALUE_SIZE];
+    if (len != value_size(i)) {
+        return false;
+    }
+    for (int version = 0; version < 2; version++) {
+        make_value(expected, i, version);
+        if (memcmp(value, expected, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t next_random(uint32_t *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return (*seed >> 8) & 0xFFFFFF;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *reader(void *arg) {
+    reader_job *job = arg;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    for (int r = 0; r < job->reads; r++) {
+        int i = (int)(next_random(&job->seed) % NUM_KEYS);
+        make_key(key, i);
+        size_t len = sizeof(value);
+        if (kvs_get_h(job->handle, key, strlen(key), value, &len) != KVS_SUCCESS || !value_is_consistent(value, len, i)
+            || kvs_exists_h(job->handle, key, strlen(key)) != 1) {
+            job->errors++;
+        }
+    }
+    return NULL;
+}
+
+// Обновляет ключи, пока читатели работают: изменения выполняются по одному под исключительной блокировкой.
+static void *writer(void *arg) {
+    reader_job *job = arg;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    for (int u = 0; u < WRITER_UPDATES && writer_running; u++) {
+        int i = (int)(next_random(&job->seed) % NUM_KEYS);
+        make_key(key, i);
+        make_value(value, i, u % 2);
+        if (kvs_update_h(job->handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+            job->errors++;
+        }
+    }
+    return NULL;
+}
+
+// Прогоняет TOTAL_READS чтений в threads потоках (и, если нужно, параллельного писателя).
+// Возвращает количество ошибок, пропускную способность пишет в *ops_per_sec.
+static int run_readers(kvs_handle *handle, int threads, bool with_writer, double *ops_per_sec) {
+    pthread_t ids[MAX_THREADS];
+    reader_job jobs[MAX_THREADS];
+    pthread_t writer_id;
+    reader_job writer_job = {handle, 777, 0, 0};
+    int errors = 0;
+
+    if (with_writer) {
+        writer_running = true;
+        pthread_create(&writer_id, NULL, writer, &writer_job);
+    }
+    double start = now_seconds();
+    for (int t = 0; t < threads; t++) {
+        jobs[t].handle = handle;
+        jobs[t].seed   = 17u + (uint32_t)t * 7919u;
+        jobs[t].reads  = TOTAL_READS / threads;
+        jobs[t].errors = 0;
+        pthread_create(&ids[t], NULL, reader, &jobs[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        errors += jobs[t].errors;
+    }
+    double elapsed = now_seconds() - start;
+    if (with_writer) {
+        writer_running = false;
+        pthread_join(writer_id, NULL);
+        errors += writer_job.errors;
+    }
+    *ops_per_sec = (double)(TOTAL_READS / threads * threads) / (elapsed > 0 ? elapsed : 1e-9);
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("       ЗАПУСК ТЕСТА ПАРАЛЛЕЛЬНОГО ЧТЕНИЯ                 \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    kvs_handle *handle = NULL;
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, true, false};
+
+    remove(KVS_STORAGE_FILE_PATH);
+    ssdmmc_sim_ensure_data_dir_exists();
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return 1;
+    }
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        if (kvs_put_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+            errors++;
+        }
+    }
+
+    // Шаг 1: Масштабирование чтения с устройства (кеш выключен) и из кеша
+    int counts[] = {1, 2, 4, 8, 16, 32};
+    for (int pass = 0; pass < 2; pass++) {
+        kvs_set_cache_budget_h(handle, pass == 0 ? 0 : 64 * 1024);
+        printf("\n  Чтение %s:\n", pass == 0 ? "с устройства (кеш выключен)" : "с кешем 64 КБ");
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            double ops = 0;
+            errors += run_readers(handle, counts[c], false, &ops);
+            printf("    потоков: %2d, чтений в секунду: %.0f\n", counts[c], ops);
+        }
+    }
+
+    // Шаг 2: Читатели вместе с писателем: каждое чтение видит одну из целых версий значения
+    double ops = 0;
+    int mixed_errors = run_readers(handle, 8, true, &ops);
+    printf("\n  8 читателей и писатель: чтений в секунду: %.0f, ошибок: %d\n", ops, mixed_errors);
+    errors += mixed_errors;
+
+    // Шаг 3: Счетчики, которые меняют читатели, не теряют приращений
+    uint64_t hits = 0, misses = 0;
+    kvs_get_cache_stats_h(handle, &hits, &misses);
+    uint64_t reads_before = handle->io_read_ops;
+    kvs_set_cache_budget_h(handle, 0);
+    double ignored = 0;
+    errors += run_readers(handle, 4, false, &ignored);
+    if (handle->io_read_ops == reads_before || atomic_load(&handle->scratch_in_use) != 0) {
+        printf("  ОШИБКА: счетчики чтения или пул буферов в неверном состоянии.\n");
+        errors++;
+    }
+    kvs_close(handle);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Параллельные чтения возвращают корректные значения при любом числе потоков.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("     ТЕСТИРОВАНИЕ ПАРАЛЛЕЛЬНОГО ЧТЕНИЯ ЗАВЕРШЕНО         \n");
+    printf("=========================================================\n");
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 256)
+#define NUM_SHARDS          4
+#define NUM_WRITERS         8
+#define KEYS_PER_WRITER     60
+#define MAX_VALUE_SIZE      200
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_sharded.bin";
+
+typedef struct {
+    kvs_sharded *store;
+    int          writer;
+    int          errors;
+} writer_job;
+
+static void make_key(char *key, int writer, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "w%d:item:%03d", writer, i);
+}
+
+static uint32_t value_size(int i) {
+    return i % 4 == 0 ? 90 + i : 12 + i % 40;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int writer, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((writer * 31 + i * 7 + j + version * 53) % 0xFF);
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Писатель: свои ключи, каждый третий обновляется, каждый пятый удаляется.
+static void *writer(void *arg) {
+    writer_job *job = arg;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    for (int i = 0; i < KEYS_PER_WRITER; i++) {
+        make_key(key, job->writer, i);
+        make_value(value, job->writer, i, 0);
+        if (kvs_sharded_put(job->store, key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+            job->errors++;
+        }
+        if (i % 3 == 0) {
+            make_value(value, job->writer, i, 1);
+            if (kvs_sharded_update(job->store, key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+                job->errors++;
+            }
+        }
+        if (i % 5 == 0 && kvs_sharded_delete(job->store, key, strlen(key)) != KVS_SUCCESS) {
+            job->errors++;
+        }
+    }
+    return NULL;
+}
+
+// Запускает NUM_WRITERS писателей и возвращает количество ошибок; пропускную способность пишет в *ops_per_sec.
+static int run_writers(kvs_sharded *store, double *ops_per_sec) {
+    pthread_t ids[NUM_WRITERS];
+    writer_job jobs[NUM_WRITERS];
+    int errors = 0;
+    double start = now_seconds();
+    for (int w = 0; w < NUM_WRITERS; w++) {
+        jobs[w].store  = store;
+        jobs[w].writer = w;
+        jobs[w].errors = 0;
+        pthread_create(&ids[w], NULL, writer, &jobs[w]);
+    }
+    for (int w = 0; w < NUM_WRITERS; w++) {
+        pthread_join(ids[w], NULL);
+        errors += jobs[w].errors;
+    }
+    double elapsed = now_seconds() - start;
+    int ops = NUM_WRITERS * (KEYS_PER_WRITER + (KEYS_PER_WRITER + 2) / 3 + (KEYS_PER_WRITER + 4) / 5);
+    *ops_per_sec = ops / (elapsed > 0 ? elapsed : 1e-9);
+    return errors;
+}
+
+// Проверяет все ключи: значение, версию и то, что ключ хранится только в своем шарде.
+static int check_store(kvs_sharded *store) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    uint8_t expected[MAX_VALUE_SIZE];
+    int errors = 0;
+    for (int w = 0; w < NUM_WRITERS; w++) {
+        for (int i = 0; i < KEYS_PER_WRITER; i++) {
+            make_key(key, w, i);
+            size_t len = sizeof(value);
+            kvs_status status = kvs_sharded_get(store, key, strlen(key), value, &len);
+            if (i % 5 == 0) {
+                if (status != KVS_ERROR_KEY_NOT_FOUND) {
+                    printf("  ОШИБКА: удаленный ключ '%s' найден.\n", key);
+                    errors++;
+                }
+                continue;
+            }
+            make_value(expected, w, i, i % 3 == 0 ? 1 : 0);
+            if (status != KVS_SUCCESS || len != value_size(i) || memcmp(value, expected, len) != 0) {
+                printf("  ОШИБКА: неверное значение ключа '%s'.\n", key);
+                errors++;
+            }
+            kvs_handle *home = kvs_sharded_shard_for_key(store, key, strlen(key));
+            for (uint32_t s = 0; s < kvs_sharded_shard_count(store); s++) {
+                kvs_handle *shard = kvs_sharded_shard(store, s);
+                if (kvs_exists_h(shard, key, strlen(key)) != (shard == home ? 1 : 0)) {
+                    printf("  ОШИБКА: ключ '%s' найден не в своем шарде.\n", key);
+                    errors++;
+                }
+            }
+        }
+    }
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("          ЗАПУСК ТЕСТА РАЗДЕЛЕНИЯ НА ШАРДЫ               \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char path[64];
+    kvs_sharded *store = NULL;
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_HASH, false, false};
+    ssdmmc_sim_ensure_data_dir_exists();
+
+    // Шаг 1: Параллельные писатели на одном шарде и на NUM_SHARDS шардах
+    double ops_single = 0, ops_sharded = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t shard_count = pass == 0 ? 1 : NUM_SHARDS;
+        for (uint32_t s = 0; s < NUM_SHARDS; s++) {
+            sprintf(path, "%s.%u", KVS_STORAGE_FILE_PATH, s);
+            remove(path);
+        }
+        if (kvs_sharded_open(KVS_STORAGE_FILE_PATH, &options, shard_count, &store) != KVS_SUCCESS) {
+            printf("Критическая ошибка: не удалось открыть хранилище из %u шардов.\n", shard_count);
+            return 1;
+        }
+        int pass_errors = run_writers(store, pass == 0 ? &ops_single : &ops_sharded);
+        printf("  Шардов: %u, операций записи в секунду: %.0f, ошибок: %d\n", shard_count,
+               pass == 0 ? ops_single : ops_sharded, pass_errors);
+        errors += pass_errors + check_store(store);
+        if (pass == 0) {
+            kvs_sharded_close(store);
+        }
+    }
+
+    // Шаг 2: Ключи распределены по всем шардам, и каждый шард помнит свое место в наборе
+    uint32_t total_keys = 0;
+    for (uint32_t s = 0; s < NUM_SHARDS; s++) {
+        kvs_handle *shard = kvs_sharded_shard(store, s);
+        printf("  Шард %u: ключей %u\n", s, shard->key_count);
+        total_keys += shard->key_count;
+        if (shard->key_count == 0 || shard->superblock.shard_count != NUM_SHARDS || shard->superblock.shard_index != s
+            || shard->superblock.shard_set_id != kvs_sharded_shard(store, 0)->superblock.shard_set_id) {
+            printf("  ОШИБКА: неверная карта шарда %u.\n", s);
+            errors++;
+        }
+    }
+    if (total_keys != NUM_WRITERS * (KEYS_PER_WRITER - KEYS_PER_WRITER / 5)) {
+        printf("  ОШИБКА: в шардах %u ключей.\n", total_keys);
+        errors++;
+    }
+    kvs_sharded_close(store);
+
+    // Шаг 3: Набор открывается заново только с тем же числом шардов
+    store = NULL;
+    if (kvs_sharded_open(KVS_STORAGE_FILE_PATH, &options, 2, &store) != KVS_ERROR_INVALID_PARAM || store != NULL) {
+        printf("  ОШИБКА: набор открыт с неверным числом шардов.\n");
+        errors++;
+    }
+    if (kvs_sharded_open(KVS_STORAGE_FILE_PATH, &options, NUM_SHARDS, &store) != KVS_SUCCESS) {
+        printf("  ОШИБКА: не удалось повторно открыть набор шардов.\n");
+        return 1;
+    }
+    errors += check_store(store);
+    kvs_sharded_close(store);
+
+    // Шаг 4: Файл чужого набора в качестве шарда не принимается
+    sprintf(path, "%s.%u", KVS_STORAGE_FILE_PATH, 1);
+    remove(path);
+    kvs_handle *stranger = NULL;
+    if (kvs_open(path, &options, &stranger) != KVS_SUCCESS) {
+        printf("  ОШИБКА: не удалось создать постороннее хранилище.\n");
+        return 1;
+    }
+    kvs_put_h(stranger, "stranger", strlen("stranger"), "value", 5);
+    kvs_close(stranger);
+    if (kvs_sharded_open(KVS_STORAGE_FILE_PATH, &options, NUM_SHARDS, &store) != KVS_ERROR_INVALID_PARAM) {
+        printf("  ОШИБКА: непустое хранилище не из набора принято как шард.\n");
+        errors++;
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Ключи распределены по шардам, параллельная запись и повторное открытие набора корректны.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("       ТЕСТИРОВАНИЕ РАЗДЕЛЕНИЯ НА ШАРДЫ ЗАВЕРШЕНО        \n");
+    printf("=========================================================\n");
+    return 0;
+}
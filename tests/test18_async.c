@@ -0,0 +1,197 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 256)
+#define NUM_KEYS            200
+#define MAX_VALUE_SIZE      160
+#define QUEUE_DEPTH         32
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_async.bin";
+const char* KVS_SYNC_FILE_PATH    = "../data/kvs_async_sync.bin";
+
+static char     keys[NUM_KEYS][KVS_KEY_SIZE];
+static uint8_t  values[NUM_KEYS][MAX_VALUE_SIZE];
+static uint8_t  buffers[NUM_KEYS][MAX_VALUE_SIZE];
+static kvs_async_request requests[NUM_KEYS];
+static atomic_int callback_errors;
+static atomic_int callback_count;
+
+static uint32_t value_size(int i) {
+    return i % 4 == 0 ? 100 + i % 50 : 10 + i % 40;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((i * 11 + j + version * 77) % 0xFF);
+    }
+}
+
+static void prepare(void) {
+    for (int i = 0; i < NUM_KEYS; i++) {
+        memset(keys[i], 0, KVS_KEY_SIZE);
+        sprintf(keys[i], "async:%04d", (i * 37) % NUM_KEYS);
+        make_value(values[i], i, 0);
+    }
+}
+
+// Отправляет запрос, забирая выполненные, пока в очереди нет места. Возвращает количество ошибок среди забранных.
+static int submit(kvs_async *queue, kvs_async_request *request) {
+    int errors = 0;
+    kvs_async_request *done[QUEUE_DEPTH];
+    while (kvs_async_submit(queue, request) == KVS_ERROR_NO_SPACE) {
+        size_t n = kvs_async_poll(queue, done, QUEUE_DEPTH);
+        for (size_t k = 0; k < n; k++) {
+            if (done[k]->status != KVS_SUCCESS) {
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+// Забирает оставшиеся результаты после kvs_async_drain.
+static int reap(kvs_async *queue) {
+    int errors = 0;
+    kvs_async_request *done[QUEUE_DEPTH];
+    size_t n;
+    while ((n = kvs_async_poll(queue, done, QUEUE_DEPTH)) > 0) {
+        for (size_t k = 0; k < n; k++) {
+            if (done[k]->status != KVS_SUCCESS) {
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+// Проверяет прочитанное значение (выполняется в рабочем потоке очереди).
+static void check_get(kvs_async_request *request) {
+    int i = (int)(intptr_t)request->user_data;
+    if (request->status != KVS_SUCCESS || request->value_len != value_size(i) || memcmp(request->value, values[i], request->value_len) != 0) {
+        atomic_fetch_add(&callback_errors, 1);
+    }
+    atomic_fetch_add(&callback_count, 1);
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("        ЗАПУСК ТЕСТА АСИНХРОННЫХ ЗАПРОСОВ                \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    prepare();
+    ssdmmc_sim_ensure_data_dir_exists();
+
+    for (int pass = 0; pass < 2; pass++) {
+        kvs_options options = {TEST_USER_DATA_SIZE, pass == 0 ? KVS_LAYOUT_LINEAR : KVS_LAYOUT_HASH, false, false};
+        kvs_handle *handle = NULL;
+        kvs_async *queue = NULL;
+        printf("\n  Раскладка: %s\n", pass == 0 ? "линейная" : "хеш");
+
+        // Шаг 1: Эталон - те же записи синхронно
+        remove(KVS_SYNC_FILE_PATH);
+        if (kvs_open(KVS_SYNC_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+            printf("Критическая ошибка: не удалось открыть хранилище.\n");
+            return 1;
+        }
+        uint64_t sync_writes = handle->io_write_ops;
+        for (int i = 0; i < NUM_KEYS; i++) {
+            kvs_put_h(handle, keys[i], strlen(keys[i]), values[i], value_size(i));
+        }
+        sync_writes = handle->io_write_ops - sync_writes;
+        kvs_close(handle);
+
+        // Шаг 2: Асинхронные записи через очередь
+        remove(KVS_STORAGE_FILE_PATH);
+        if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS || kvs_async_open(handle, QUEUE_DEPTH, &queue) != KVS_SUCCESS) {
+            printf("Критическая ошибка: не удалось открыть хранилище или очередь.\n");
+            return 1;
+        }
+        uint64_t async_writes = handle->io_write_ops;
+        for (int i = 0; i < NUM_KEYS; i++) {
+            requests[i] = (kvs_async_request){KVS_ASYNC_PUT, keys[i], strlen(keys[i]), values[i], value_size(i), NULL, NULL, KVS_ERROR_UNKNOWN};
+            errors += submit(queue, &requests[i]);
+        }
+        kvs_async_drain(queue);
+        errors += reap(queue);
+        async_writes = handle->io_write_ops - async_writes;
+        printf("  Записей на устройство: синхронно %lu, асинхронно %lu, пакетов: %lu\n",
+               (unsigned long)sync_writes, (unsigned long)async_writes, (unsigned long)queue->batches);
+        if (async_writes >= sync_writes) {
+            printf("  ОШИБКА: пакетная запись не сократила число записей на устройство.\n");
+            errors++;
+        }
+
+        // Шаг 3: Чтения с функцией обратного вызова
+        atomic_store(&callback_errors, 0);
+        atomic_store(&callback_count, 0);
+        for (int i = 0; i < NUM_KEYS; i++) {
+            requests[i] = (kvs_async_request){KVS_ASYNC_GET, keys[i], strlen(keys[i]), buffers[i], MAX_VALUE_SIZE, check_get, (void *)(intptr_t)i, KVS_ERROR_UNKNOWN};
+            errors += submit(queue, &requests[i]);
+        }
+        kvs_async_drain(queue);
+        if (atomic_load(&callback_count) != NUM_KEYS || atomic_load(&callback_errors) != 0) {
+            printf("  ОШИБКА: чтений выполнено %d, с ошибкой %d.\n", atomic_load(&callback_count), atomic_load(&callback_errors));
+            errors++;
+        }
+
+        // Шаг 4: Запросы к одному ключу выполняются в порядке отправки
+        kvs_async_request chain[4];
+        uint8_t updated[MAX_VALUE_SIZE];
+        uint8_t read_back[MAX_VALUE_SIZE];
+        make_value(updated, 5, 1);
+        chain[0] = (kvs_async_request){KVS_ASYNC_UPDATE, keys[5], strlen(keys[5]), updated, value_size(5), NULL, NULL, KVS_ERROR_UNKNOWN};
+        chain[1] = (kvs_async_request){KVS_ASYNC_GET, keys[5], strlen(keys[5]), read_back, MAX_VALUE_SIZE, NULL, NULL, KVS_ERROR_UNKNOWN};
+        chain[2] = (kvs_async_request){KVS_ASYNC_DELETE, keys[6], strlen(keys[6]), NULL, 0, NULL, NULL, KVS_ERROR_UNKNOWN};
+        chain[3] = (kvs_async_request){KVS_ASYNC_GET, keys[6], strlen(keys[6]), buffers[6], MAX_VALUE_SIZE, NULL, NULL, KVS_ERROR_UNKNOWN};
+        for (int c = 0; c < 4; c++) {
+            errors += submit(queue, &chain[c]);
+        }
+        kvs_async_drain(queue);
+        kvs_async_request *done[QUEUE_DEPTH];
+        size_t reaped = kvs_async_poll(queue, done, QUEUE_DEPTH);
+        if (reaped != 4 || chain[0].status != KVS_SUCCESS || chain[1].status != KVS_SUCCESS
+            || memcmp(read_back, updated, value_size(5)) != 0 || chain[2].status != KVS_SUCCESS || chain[3].status != KVS_ERROR_KEY_NOT_FOUND) {
+            printf("  ОШИБКА: нарушен порядок запросов к одному ключу.\n");
+            errors++;
+        }
+        kvs_async_close(queue);
+        kvs_close(handle);
+
+        // Шаг 5: Выполненные записи сохранены на устройстве
+        if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+            printf("  ОШИБКА: не удалось повторно открыть хранилище.\n");
+            return 1;
+        }
+        for (int i = 0; i < NUM_KEYS; i++) {
+            size_t len = MAX_VALUE_SIZE;
+            kvs_status status = kvs_get_h(handle, keys[i], strlen(keys[i]), buffers[i], &len);
+            const uint8_t *expected = i == 5 ? updated : values[i];
+            if (i == 6 ? status != KVS_ERROR_KEY_NOT_FOUND : status != KVS_SUCCESS || len != value_size(i) || memcmp(buffers[i], expected, len) != 0) {
+                printf("  ОШИБКА: после перезапуска неверен ключ '%s'.\n", keys[i]);
+                errors++;
+            }
+        }
+        kvs_close(handle);
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Асинхронные запросы выполнены корректно и сохранены на устройстве.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("       ТЕСТИРОВАНИЕ АСИНХРОННЫХ ЗАПРОСОВ ЗАВЕРШЕНО       \n");
+    printf("=========================================================\n");
+    return 0;
+}
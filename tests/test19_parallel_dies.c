@@ -0,0 +1,163 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "../src/ssdmmc_sim/ssdmmc_sim_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 64)
+#define NUM_KEYS            120
+#define UPDATE_ROUNDS       6
+#define MAX_VALUE_SIZE      200
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_dies.bin";
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "die:%04d", i);
+}
+
+static uint32_t value_size(int i) {
+    return 96 + (i * 17) % 100;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((i * 3 + j + version * 29) % 0xFF);
+    }
+}
+
+// Проверяет все ключи: после round раундов обновлений у ключа версия round.
+static int check_all(kvs_handle *handle, int round) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    uint8_t expected[MAX_VALUE_SIZE];
+    int errors = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(expected, i, round);
+        size_t len = sizeof(value);
+        if (kvs_get_h(handle, key, strlen(key), value, &len) != KVS_SUCCESS || len != value_size(i) || memcmp(value, expected, len) != 0) {
+            printf("  ОШИБКА: неверное значение ключа '%s'.\n", key);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// Печатает статистику модели времени и возвращает отношение последовательного времени к параллельному.
+static double print_timing(const char *title, kvs_handle *handle) {
+    ssdmmc_sim_timing_stats stats;
+    ssdmmc_sim_get_timing_stats(handle->sim, &stats);
+    double speedup = stats.parallel_ns > 0 ? (double)stats.serial_ns / stats.parallel_ns : 0;
+    printf("    %s: чтений %lu, программирований %lu, стираний %lu, одна очередь %.1f мс, параллельно %.1f мс, ускорение %.2f\n",
+           title, (unsigned long)stats.reads, (unsigned long)stats.programs, (unsigned long)stats.erases,
+           stats.serial_ns / 1e6, stats.parallel_ns / 1e6, speedup);
+    printf("      занятость кристаллов, мс:");
+    for (uint32_t d = 0; d < stats.die_count; d++) {
+        printf(" %.1f", stats.die_busy_ns[d] / 1e6);
+    }
+    printf("\n");
+    return speedup;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("       ЗАПУСК ТЕСТА ПАРАЛЛЕЛЬНОСТИ КРИСТАЛЛОВ            \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    double read_speedup[2] = {0, 0};
+
+    // Шаг 1: Геометрия: соседние страницы лежат в разных кристаллах, кристаллы чередуются по каналам
+    uint32_t dies = ssdmmc_sim_get_die_count();
+    printf("  Каналов: %u, кристаллов на канал: %u, плоскостей: %u\n",
+           ssdmmc_sim_get_channel_count(), ssdmmc_sim_get_dies_per_channel(), ssdmmc_sim_get_planes_per_die());
+    // Геометрия задается при сборке: соседние страницы попадают на разные каналы и плоскости, только если их больше одного
+    bool channels = ssdmmc_sim_get_channel_count() > 1;
+    bool planes   = ssdmmc_sim_get_planes_per_die() > 1;
+    if (dies != ssdmmc_sim_get_channel_count() * ssdmmc_sim_get_dies_per_channel() || dies < 2
+        || ssdmmc_sim_get_page_die(0) == ssdmmc_sim_get_page_die(1) || ssdmmc_sim_get_page_die(dies) != ssdmmc_sim_get_page_die(0)
+        || (channels && ssdmmc_sim_get_page_channel(0) == ssdmmc_sim_get_page_channel(1))
+        || (planes && ssdmmc_sim_get_page_plane(dies) == ssdmmc_sim_get_page_plane(0))) {
+        printf("  ОШИБКА: неверное отображение страниц на кристаллы.\n");
+        errors++;
+    }
+
+    // Шаг 2: Одна и та же нагрузка без чередования и с чередованием выделений
+    ssdmmc_sim_ensure_data_dir_exists();
+    for (int pass = 0; pass < 2; pass++) {
+        kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, pass == 1};
+        kvs_handle *handle = NULL;
+        remove(KVS_STORAGE_FILE_PATH);
+        if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+            printf("Критическая ошибка: не удалось открыть хранилище.\n");
+            return 1;
+        }
+        printf("\n  Чередование по кристаллам: %s\n", pass == 1 ? "включено" : "выключено");
+
+        // Служебные данные сохраняются после каждой записи на одни и те же страницы, поэтому
+        // распределение записи значений по кристаллам смотрим через буфер записи: он сохраняет их раз на пакет
+        kvs_set_write_buffer_h(handle, 16 * 1024);
+        ssdmmc_sim_reset_timing_stats(handle->sim);
+        for (int i = 0; i < NUM_KEYS; i++) {
+            make_key(key, i);
+            make_value(value, i, 0);
+            if (kvs_put_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+                errors++;
+            }
+        }
+        kvs_flush_h(handle);
+        print_timing("запись", handle);
+
+        ssdmmc_sim_reset_timing_stats(handle->sim);
+        errors += check_all(handle, 0);
+        read_speedup[pass] = print_timing("чтение", handle);
+
+        // Шаг 3: Раунды обновлений заставляют карусель пройти область данных по кругу и запускают сборку мусора
+        for (int round = 1; round <= UPDATE_ROUNDS; round++) {
+            for (int i = 0; i < NUM_KEYS; i++) {
+                make_key(key, i);
+                make_value(value, i, round);
+                if (kvs_update_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS) {
+                    errors++;
+                }
+            }
+        }
+        kvs_flush_h(handle);
+        errors += check_all(handle, UPDATE_ROUNDS);
+        kvs_close(handle);
+
+        // Шаг 4: После перезапуска данные на месте
+        if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+            printf("  ОШИБКА: не удалось повторно открыть хранилище.\n");
+            return 1;
+        }
+        errors += check_all(handle, UPDATE_ROUNDS);
+        kvs_close(handle);
+    }
+
+    // Значения с чередованием не делят страницу с соседями, поэтому их чтения расходятся по всем кристаллам
+    if (read_speedup[1] <= read_speedup[0]) {
+        printf("  ОШИБКА: чередование не увеличило параллельность чтения.\n");
+        errors++;
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Чтения с чередованием распределяются по кристаллам, данные корректны.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("     ТЕСТИРОВАНИЕ ПАРАЛЛЕЛЬНОСТИ КРИСТАЛЛОВ ЗАВЕРШЕНО    \n");
+    printf("=========================================================\n");
+    return 0;
+}
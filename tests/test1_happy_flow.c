@@ -32,7 +32,7 @@ void verify_data(const TestData* test_entry) {
     void *read_buffer = calloc(1, buffer_size);
     if(!read_buffer) exit(2);
 
-    Kvs_get(test_entry->key, read_buffer, &buffer_size);
+    Kvs_get(test_entry->key, strlen(test_entry->key), read_buffer, &buffer_size);
 
     if (buffer_size == test_entry->size && memcmp(read_buffer, test_entry->data, buffer_size) == 0) {
         printf("  ПРОВЕРКА: Данные для ключа '%s' корректны.\n", test_entry->key);
@@ -72,7 +72,7 @@ int main() {
         all_tests[current_key_index].size = SMALL_DATA_MIN + rand() % (SMALL_DATA_MAX - SMALL_DATA_MIN + 1);
         all_tests[current_key_index].data = calloc(1, all_tests[current_key_index].size);
         memset(all_tests[current_key_index].data, 'A' + (i % 26), all_tests[current_key_index].size);
-        Kvs_put(all_tests[current_key_index].key, KVS_KEY_SIZE, all_tests[current_key_index].data, all_tests[current_key_index].size);
+        Kvs_put(all_tests[current_key_index].key, strlen(all_tests[current_key_index].key), all_tests[current_key_index].data, all_tests[current_key_index].size);
         current_key_index++;
     }
 
@@ -82,7 +82,7 @@ int main() {
         all_tests[current_key_index].size = MEDIUM_DATA_MIN + rand() % (MEDIUM_DATA_MAX - MEDIUM_DATA_MIN + 1);
         all_tests[current_key_index].data = calloc(1, all_tests[current_key_index].size);
         memset(all_tests[current_key_index].data, 'a' + (i % 26), all_tests[current_key_index].size);
-        Kvs_put(all_tests[current_key_index].key, KVS_KEY_SIZE, all_tests[current_key_index].data, all_tests[current_key_index].size);
+        Kvs_put(all_tests[current_key_index].key, strlen(all_tests[current_key_index].key), all_tests[current_key_index].data, all_tests[current_key_index].size);
         current_key_index++;
     }
 
@@ -92,14 +92,14 @@ int main() {
         all_tests[current_key_index].size = LARGE_DATA_MIN + rand() % (LARGE_DATA_MAX - LARGE_DATA_MIN + 1);
         all_tests[current_key_index].data = calloc(1, all_tests[current_key_index].size);
         memset(all_tests[current_key_index].data, '0' + (i % 10), all_tests[current_key_index].size);
-        Kvs_put(all_tests[current_key_index].key, KVS_KEY_SIZE, all_tests[current_key_index].data, all_tests[current_key_index].size);
+        Kvs_put(all_tests[current_key_index].key, strlen(all_tests[current_key_index].key), all_tests[current_key_index].data, all_tests[current_key_index].size);
         current_key_index++;
     }
 
     // --- Фаза 2: Проверка существования всех ключей ---
     printf("\n--- Фаза 2: Проверка существования всех %d ключей ---\n", total_keys);
     for (int i = 0; i < total_keys; i++) {
-        Kvs_exists(all_tests[i].key);
+        Kvs_exists(all_tests[i].key, strlen(all_tests[i].key));
     }
 
     // --- Фаза 3: Перезапуск и проверка целостности данных ---
@@ -127,7 +127,7 @@ int main() {
         memset(all_tests[random_index].data, 'Z', UPDATE_DATA_SIZE);
 
         // Обновляем ключ в KVS
-        Kvs_update(all_tests[random_index].key, all_tests[random_index].data, all_tests[random_index].size);
+        Kvs_update(all_tests[random_index].key, strlen(all_tests[random_index].key), all_tests[random_index].data, all_tests[random_index].size);
 
         // Сразу же проверяем, что данные обновились корректно
         verify_data(&all_tests[random_index]);
@@ -136,8 +136,8 @@ int main() {
     // --- Фаза 5: Удаление всех ключей и финальная проверка ---
     printf("\n--- Фаза 5: Удаление всех %d ключей и финальная проверка ---\n", total_keys);
     for (int i = 0; i < total_keys; i++) {
-        Kvs_delete(all_tests[i].key);
-        Kvs_exists(all_tests[i].key);
+        Kvs_delete(all_tests[i].key, strlen(all_tests[i].key));
+        Kvs_exists(all_tests[i].key, strlen(all_tests[i].key));
     }
 
     Kvs_deinit();
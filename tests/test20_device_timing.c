@@ -0,0 +1,176 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 64)
+#define NUM_KEYS            60
+#define MAX_VALUE_SIZE      160
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_timing.bin";
+
+// Время одной фазы нагрузки: по виртуальным часам устройства и процессорное.
+typedef struct {
+    uint64_t device_ns;
+    double   cpu_ms;
+    uint64_t erases;
+} phase_time;
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "timing:%03d", i);
+}
+
+static uint32_t value_size(int i) {
+    return 40 + (i * 13) % 120;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((i * 5 + j + version * 41) % 0xFF);
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Выполняет фазу op (0 - запись, 1 - чтение, 2 - обновление, 3 - удаление) по всем ключам.
+// Возвращает количество ошибок, время фазы пишет в *time.
+static int run_phase(kvs_handle *handle, int op, phase_time *time) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    uint8_t expected[MAX_VALUE_SIZE];
+    int errors = 0;
+    uint64_t device_start = 0, device_end = 0;
+    ssdmmc_sim_timing_stats stats;
+
+    ssdmmc_sim_reset_timing_stats(handle->sim);
+    kvs_get_device_time_h(handle, &device_start);
+    clock_t cpu_start = clock();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        size_t len = sizeof(value);
+        switch (op) {
+        case 0:
+            make_value(value, i, 0);
+            errors += kvs_put_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS;
+            break;
+        case 1:
+            make_value(expected, i, 0);
+            errors += kvs_get_h(handle, key, strlen(key), value, &len) != KVS_SUCCESS || len != value_size(i) || memcmp(value, expected, len) != 0;
+            break;
+        case 2:
+            make_value(value, i, 1);
+            errors += kvs_update_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS;
+            break;
+        default:
+            errors += kvs_delete_h(handle, key, strlen(key)) != KVS_SUCCESS;
+            break;
+        }
+    }
+    time->cpu_ms = (double)(clock() - cpu_start) * 1000.0 / CLOCKS_PER_SEC;
+    kvs_get_device_time_h(handle, &device_end);
+    time->device_ns = device_end - device_start;
+
+    // Часы идут ровно на время, посчитанное статистикой модели
+    ssdmmc_sim_get_timing_stats(handle->sim, &stats);
+    time->erases = stats.erases;
+    if (stats.serial_ns != time->device_ns) {
+        printf("  ОШИБКА: часы устройства (%lu нс) расходятся со статистикой (%lu нс).\n",
+               (unsigned long)time->device_ns, (unsigned long)stats.serial_ns);
+        errors++;
+    }
+    return errors;
+}
+
+// Создает хранилище заново, задает время операций и выполняет все фазы.
+static int run_workload(const kvs_device_timing *timing, phase_time times[4]) {
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return 1;
+    }
+    int errors = 0;
+    if (timing && kvs_set_device_timing_h(handle, timing) != KVS_SUCCESS) {
+        errors++;
+    }
+    for (int op = 0; op < 4; op++) {
+        errors += run_phase(handle, op, &times[op]);
+    }
+    kvs_close(handle);
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("        ЗАПУСК ТЕСТА МОДЕЛИ ВРЕМЕНИ УСТРОЙСТВА           \n");
+    printf("=========================================================\n");
+
+    static const char *phase_names[4] = {"запись", "чтение", "обновление", "удаление"};
+    int errors = 0;
+    phase_time base[4], doubled[4], slept[4];
+    ssdmmc_sim_ensure_data_dir_exists();
+
+    // Шаг 1: Время устройства по умолчанию рядом с процессорным
+    errors += run_workload(NULL, base);
+    for (int op = 0; op < 4; op++) {
+        printf("  %s: устройство %.2f мс, процессор %.2f мс, стираний %lu\n", phase_names[op], base[op].device_ns / 1e6, base[op].cpu_ms, (unsigned long)base[op].erases);
+        if (base[op].device_ns == 0) {
+            printf("  ОШИБКА: фаза '%s' не заняла времени устройства.\n", phase_names[op]);
+            errors++;
+        }
+    }
+    if (base[1].device_ns >= base[0].device_ns) {
+        printf("  ОШИБКА: чтение оказалось не дешевле записи.\n");
+        errors++;
+    }
+
+    // Шаг 2: Вдвое более медленная память - та же нагрузка занимает ровно вдвое больше времени устройства
+    kvs_device_timing slow = {50000 * 2, 600000 * 2, 3000000 * 2, 2500 * 2, false};
+    errors += run_workload(&slow, doubled);
+    for (int op = 0; op < 4; op++) {
+        if (doubled[op].device_ns != 2 * base[op].device_ns) {
+            printf("  ОШИБКА: фаза '%s' при вдвое медленной памяти: %lu нс вместо %lu нс.\n", phase_names[op],
+                   (unsigned long)doubled[op].device_ns, (unsigned long)(2 * base[op].device_ns));
+            errors++;
+        }
+    }
+
+    // Шаг 3: С реальным ожиданием нагрузка идет не быстрее смоделированного времени
+    kvs_device_timing fast = {500, 6000, 30000, 25, true};
+    double start = now_seconds();
+    errors += run_workload(&fast, slept);
+    double wall_ns = (now_seconds() - start) * 1e9;
+    uint64_t modeled_ns = 0;
+    for (int op = 0; op < 4; op++) {
+        modeled_ns += slept[op].device_ns;
+    }
+    printf("  С ожиданием: смоделировано %.1f мс, прошло %.1f мс\n", modeled_ns / 1e6, wall_ns / 1e6);
+    if (wall_ns < modeled_ns * 0.9) {
+        printf("  ОШИБКА: реальное ожидание короче смоделированного времени.\n");
+        errors++;
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Время устройства учитывается корректно и не зависит от процессорного.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("      ТЕСТИРОВАНИЕ МОДЕЛИ ВРЕМЕНИ УСТРОЙСТВА ЗАВЕРШЕНО   \n");
+    printf("=========================================================\n");
+    return 0;
+}
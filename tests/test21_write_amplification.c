@@ -0,0 +1,192 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 64)
+#define NUM_KEYS            80
+#define UPDATE_ROUNDS       4
+#define MAX_VALUE_SIZE      200
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_write_amp.bin";
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "wa:%04d", i);
+}
+
+static uint32_t value_size(int i) {
+    return 60 + (i * 23) % 140;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((i * 7 + j + version * 19) % 0xFF);
+    }
+}
+
+// Нагрузка: запись всех ключей, раунды обновлений и удаление каждого третьего ключа.
+static int run_workload(kvs_handle *handle) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    int errors = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        errors += kvs_put_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS;
+    }
+    for (int round = 1; round <= UPDATE_ROUNDS; round++) {
+        for (int i = 0; i < NUM_KEYS; i++) {
+            make_key(key, i);
+            make_value(value, i, round);
+            errors += kvs_update_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS;
+        }
+    }
+    for (int i = 0; i < NUM_KEYS; i += 3) {
+        make_key(key, i);
+        errors += kvs_delete_h(handle, key, strlen(key)) != KVS_SUCCESS;
+    }
+    return errors;
+}
+
+// Проверяет содержимое хранилища после run_workload.
+static int check_all(kvs_handle *handle) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    uint8_t expected[MAX_VALUE_SIZE];
+    int errors = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        size_t len = sizeof(value);
+        kvs_status status = kvs_get_h(handle, key, strlen(key), value, &len);
+        if (i % 3 == 0) {
+            errors += status != KVS_ERROR_KEY_NOT_FOUND;
+            continue;
+        }
+        make_value(expected, i, UPDATE_ROUNDS);
+        if (status != KVS_SUCCESS || len != value_size(i) || memcmp(value, expected, len) != 0) {
+            printf("  ОШИБКА: неверное значение ключа '%s'.\n", key);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static kvs_handle *open_fresh(void) {
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return NULL;
+    }
+    return handle;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("          ЗАПУСК ТЕСТА УСИЛЕНИЯ ЗАПИСИ                   \n");
+    printf("=========================================================\n");
+
+    static const char *path_names[KVS_WRITE_PATH_COUNT] = {"запись", "удаление", "сборка мусора", "выравнивание износа", "служебные данные"};
+    int errors = 0;
+    kvs_write_stats stats;
+    ssdmmc_sim_ensure_data_dir_exists();
+
+    // Шаг 1: Эмулятор в строгом режиме отклоняет перевод битов 0 -> 1 без стирания
+    remove(KVS_STORAGE_FILE_PATH);
+    ssdmmc_sim_device *sim = ssdmmc_sim_open(KVS_STORAGE_FILE_PATH, true);
+    if (!sim || ssdmmc_sim_format(sim) != SSDMMC_OK) {
+        printf("Критическая ошибка: не удалось создать устройство.\n");
+        return 1;
+    }
+    uint8_t zeros[4] = {0x00, 0x00, 0x00, 0x00};
+    uint8_t ones[4]  = {0xFF, 0x0F, 0xFF, 0xFF};
+    ssdmmc_sim_nand_report report;
+    ssdmmc_sim_set_nand_mode(sim, SSDMMC_SIM_NAND_STRICT);
+    if (ssdmmc_sim_write_word(sim, 3, 7, ones) != SSDMMC_OK || ssdmmc_sim_write_word(sim, 3, 7, zeros) != SSDMMC_OK
+        || ssdmmc_sim_write_word(sim, 3, 7, ones) != SSDMMC_ERR_NOT_ERASED
+        || ssdmmc_sim_erase_page(sim, 3) != SSDMMC_OK || ssdmmc_sim_write_word(sim, 3, 7, ones) != SSDMMC_OK
+        || ssdmmc_sim_get_nand_report(sim, &report) != SSDMMC_OK || report.violations != 1 || report.last_page != 3 || report.last_word != 7) {
+        printf("  ОШИБКА: строгий режим эмулятора работает неверно.\n");
+        errors++;
+    }
+    ssdmmc_sim_close(sim);
+
+    // Шаг 2: Без стирания перед записью хранилище перезаписывает служебные данные на месте
+    kvs_handle *handle = open_fresh();
+    if (!handle) {
+        return 1;
+    }
+    ssdmmc_sim_set_nand_mode(handle->sim, SSDMMC_SIM_NAND_REPORT);
+    errors += run_workload(handle);
+    kvs_get_write_stats_h(handle, &stats);
+    printf("  Без строгого режима нарушений: %lu\n", (unsigned long)stats.nand_violations);
+    if (stats.nand_violations == 0) {
+        printf("  ОШИБКА: нарушения порядка стирания не обнаружены.\n");
+        errors++;
+    }
+    kvs_close(handle);
+
+    // Шаг 3: В строгом режиме хранилище само стирает страницы перед записью, и нарушений нет
+    handle = open_fresh();
+    if (!handle) {
+        return 1;
+    }
+    kvs_set_strict_nand_h(handle, true);
+    errors += run_workload(handle);
+    errors += check_all(handle);
+    kvs_get_write_stats_h(handle, &stats);
+
+    uint64_t host = 0, programmed = 0, erased = 0;
+    for (int p = 0; p < KVS_WRITE_PATH_COUNT; p++) {
+        const kvs_write_counters *c = &stats.paths[p];
+        printf("  %s: от пользователя %lu Б, запрограммировано %lu Б, стерто страниц %lu\n", path_names[p],
+               (unsigned long)c->host_bytes, (unsigned long)c->programmed_bytes, (unsigned long)c->erased_pages);
+        host += c->host_bytes;
+        programmed += c->programmed_bytes;
+        erased += c->erased_pages;
+    }
+    double amplification = host > 0 ? (double)programmed / host : 0;
+    printf("  Усиление записи: %.2f, стерто страниц всего: %lu, нарушений: %lu\n", amplification, (unsigned long)erased, (unsigned long)stats.nand_violations);
+    if (stats.nand_violations != 0) {
+        printf("  ОШИБКА: в строгом режиме хранилище нарушило порядок стирания.\n");
+        errors++;
+    }
+    if (stats.paths[KVS_WRITE_PATH_PUT].host_bytes == 0 || stats.paths[KVS_WRITE_PATH_PUT].programmed_bytes < stats.paths[KVS_WRITE_PATH_PUT].host_bytes
+        || stats.paths[KVS_WRITE_PATH_DELETE].erased_pages == 0 || stats.paths[KVS_WRITE_PATH_PERSIST].erased_pages == 0 || amplification <= 1.0) {
+        printf("  ОШИБКА: счетчики путей записи неправдоподобны.\n");
+        errors++;
+    }
+    if (handle->gc_bytes_moved > 0 && stats.paths[KVS_WRITE_PATH_GC].programmed_bytes == 0) {
+        printf("  ОШИБКА: записи сборщика мусора не учтены.\n");
+        errors++;
+    }
+    kvs_close(handle);
+
+    // Шаг 4: Данные, записанные в строгом режиме, читаются после перезапуска
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("  ОШИБКА: не удалось повторно открыть хранилище.\n");
+        return 1;
+    }
+    errors += check_all(handle);
+    kvs_close(handle);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Строгий режим NAND и счетчики усиления записи работают корректно.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("         ТЕСТИРОВАНИЕ УСИЛЕНИЯ ЗАПИСИ ЗАВЕРШЕНО          \n");
+    printf("=========================================================\n");
+    return 0;
+}
@@ -0,0 +1,241 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 64)
+#define NUM_KEYS            80
+#define UPDATE_ROUNDS       4
+#define MAX_VALUE_SIZE      200
+#define NUM_READERS         4
+#define READS_PER_READER    500
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_stats.bin";
+
+typedef struct {
+    kvs_handle *handle;
+    int         reader;
+    int         errors;
+} reader_job;
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "stats:%04d", i);
+}
+
+static uint32_t value_size(int i) {
+    return 30 + (i * 19) % 150;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((i * 9 + j + version * 37) % 0xFF);
+    }
+}
+
+// Сравнивает счетчик операций с ожидаемым значением.
+static int expect_ops(const kvs_stats *stats, kvs_op_type op, kvs_op_result result, uint64_t expected, const char *what) {
+    if (stats->ops[op][result] != expected) {
+        printf("  ОШИБКА: %s: %lu вместо %lu.\n", what, (unsigned long)stats->ops[op][result], (unsigned long)expected);
+        return 1;
+    }
+    return 0;
+}
+
+// Читатель: читает свои ключи по кругу.
+static void *reader(void *arg) {
+    reader_job *job = arg;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    for (int r = 0; r < READS_PER_READER; r++) {
+        int i = 1 + (job->reader + r * NUM_READERS) % (NUM_KEYS - 1);
+        if (i % 4 == 0) {
+            i++;
+        }
+        make_key(key, i);
+        size_t len = sizeof(value);
+        if (kvs_get_h(job->handle, key, strlen(key), value, &len) != KVS_SUCCESS) {
+            job->errors++;
+        }
+    }
+    return NULL;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("          ЗАПУСК ТЕСТА СТАТИСТИКИ ХРАНИЛИЩА              \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    kvs_stats stats;
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, true, false};
+    kvs_handle *handle = NULL;
+    ssdmmc_sim_ensure_data_dir_exists();
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return 1;
+    }
+
+    // Шаг 1: Операции с разными результатами
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        kvs_put_h(handle, key, strlen(key), value, value_size(i));
+    }
+    for (int i = 0; i < 10; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        kvs_put_h(handle, key, strlen(key), value, value_size(i));
+    }
+    for (int round = 1; round <= UPDATE_ROUNDS; round++) {
+        for (int i = 0; i < NUM_KEYS; i++) {
+            make_key(key, i);
+            make_value(value, i, round);
+            kvs_update_h(handle, key, strlen(key), value, value_size(i));
+        }
+    }
+    for (int i = 0; i < NUM_KEYS; i += 4) {
+        make_key(key, i);
+        kvs_delete_h(handle, key, strlen(key));
+        kvs_delete_h(handle, key, strlen(key));
+    }
+    make_key(key, NUM_KEYS + 1);
+    kvs_update_h(handle, key, strlen(key), value, 10);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        size_t len = sizeof(value);
+        kvs_get_h(handle, key, strlen(key), value, &len);
+        kvs_exists_h(handle, key, strlen(key));
+    }
+    size_t small = 1;
+    make_key(key, 1);
+    kvs_get_h(handle, key, strlen(key), value, &small);
+    kvs_get_h(handle, NULL, 0, value, &small);
+
+    uint64_t deleted = (NUM_KEYS + 3) / 4;
+    kvs_get_stats_h(handle, &stats);
+    errors += expect_ops(&stats, KVS_OP_PUT, KVS_OP_RESULT_OK, NUM_KEYS, "успешных put");
+    errors += expect_ops(&stats, KVS_OP_PUT, KVS_OP_RESULT_ALREADY_EXISTS, 10, "повторных put");
+    errors += expect_ops(&stats, KVS_OP_UPDATE, KVS_OP_RESULT_OK, NUM_KEYS * UPDATE_ROUNDS, "успешных update");
+    errors += expect_ops(&stats, KVS_OP_UPDATE, KVS_OP_RESULT_NOT_FOUND, 1, "update отсутствующего ключа");
+    errors += expect_ops(&stats, KVS_OP_DELETE, KVS_OP_RESULT_OK, deleted, "успешных delete");
+    errors += expect_ops(&stats, KVS_OP_DELETE, KVS_OP_RESULT_NOT_FOUND, deleted, "повторных delete");
+    errors += expect_ops(&stats, KVS_OP_GET, KVS_OP_RESULT_OK, NUM_KEYS - deleted, "успешных get");
+    errors += expect_ops(&stats, KVS_OP_GET, KVS_OP_RESULT_NOT_FOUND, deleted, "get удаленных ключей");
+    errors += expect_ops(&stats, KVS_OP_GET, KVS_OP_RESULT_ERROR, 2, "get с ошибкой");
+    errors += expect_ops(&stats, KVS_OP_EXISTS, KVS_OP_RESULT_OK, NUM_KEYS - deleted, "exists найденных ключей");
+    errors += expect_ops(&stats, KVS_OP_EXISTS, KVS_OP_RESULT_NOT_FOUND, deleted, "exists удаленных ключей");
+
+    // Шаг 2: Счетчики устройства и показатели хранилища
+    printf("  Слов прочитано: %lu, записано: %lu, стерто страниц: %lu\n", (unsigned long)stats.device_words_read,
+           (unsigned long)stats.device_words_written, (unsigned long)stats.device_pages_erased);
+    printf("  Сборок мусора: %lu, перенесено %lu Б; сохранений служебных данных: %lu, %lu Б\n", (unsigned long)stats.gc_cycles,
+           (unsigned long)stats.gc_bytes_moved, (unsigned long)stats.persist_count, (unsigned long)stats.persist_bytes);
+    printf("  Ключей: %u из %u, кеш: попаданий %lu, промахов %lu, доля %.2f\n", stats.key_count, stats.max_key_count,
+           (unsigned long)stats.cache_hits, (unsigned long)stats.cache_misses, stats.cache_hit_rate);
+    printf("  Свободно %lu Б из %lu Б, наибольший участок %lu Б, фрагментация %.3f, износ %u..%u\n", (unsigned long)stats.free_bytes,
+           (unsigned long)stats.data_bytes, (unsigned long)stats.largest_free_bytes, stats.fragmentation, stats.wear_min, stats.wear_max);
+    if (stats.device_words_read == 0 || stats.device_words_written == 0 || stats.device_pages_erased == 0
+        || stats.persist_count == 0 || stats.persist_bytes == 0 || (stats.gc_bytes_moved > 0 && stats.gc_cycles == 0)) {
+        printf("  ОШИБКА: счетчики устройства неправдоподобны.\n");
+        errors++;
+    }
+    if (stats.key_count != NUM_KEYS - deleted || stats.key_count != handle->key_count || stats.max_key_count < stats.key_count) {
+        printf("  ОШИБКА: неверное количество ключей.\n");
+        errors++;
+    }
+    if (stats.data_bytes != TEST_USER_DATA_SIZE || stats.free_bytes == 0 || stats.free_bytes > stats.data_bytes
+        || stats.largest_free_bytes == 0 || stats.largest_free_bytes > stats.free_bytes
+        || stats.fragmentation < 0 || stats.fragmentation >= 1 || stats.wear_spread != stats.wear_max - stats.wear_min) {
+        printf("  ОШИБКА: показатели свободного места или износа неправдоподобны.\n");
+        errors++;
+    }
+    if (stats.cache_hits + stats.cache_misses == 0 || stats.cache_hit_rate < 0 || stats.cache_hit_rate > 1) {
+        printf("  ОШИБКА: неверная статистика кеша.\n");
+        errors++;
+    }
+
+    // Шаг 3: Параллельные читатели учитываются без потерь
+    uint64_t gets_before = stats.ops[KVS_OP_GET][KVS_OP_RESULT_OK];
+    pthread_t ids[NUM_READERS];
+    reader_job jobs[NUM_READERS];
+    for (int r = 0; r < NUM_READERS; r++) {
+        jobs[r] = (reader_job){handle, r, 0};
+        pthread_create(&ids[r], NULL, reader, &jobs[r]);
+    }
+    for (int r = 0; r < NUM_READERS; r++) {
+        pthread_join(ids[r], NULL);
+        errors += jobs[r].errors;
+    }
+    kvs_get_stats_h(handle, &stats);
+    errors += expect_ops(&stats, KVS_OP_GET, KVS_OP_RESULT_OK, gets_before + NUM_READERS * READS_PER_READER, "get параллельных читателей");
+
+    // Шаг 4: Запросы асинхронной очереди учитываются так же, как синхронные
+    kvs_async *queue = NULL;
+    uint64_t puts_before = stats.ops[KVS_OP_PUT][KVS_OP_RESULT_OK];
+    uint64_t missing_before = stats.ops[KVS_OP_GET][KVS_OP_RESULT_NOT_FOUND];
+    char async_key[KVS_KEY_SIZE];
+    uint8_t buffer[MAX_VALUE_SIZE];
+    make_key(async_key, NUM_KEYS + 2);
+    make_value(value, 0, 9);
+    kvs_async_request async_requests[2] = {
+        {KVS_ASYNC_PUT, async_key, strlen(async_key), value, value_size(0), NULL, NULL, KVS_ERROR_UNKNOWN},
+        {KVS_ASYNC_GET, key, strlen(key), buffer, MAX_VALUE_SIZE, NULL, NULL, KVS_ERROR_UNKNOWN},
+    };
+    make_key(key, 0);
+    if (kvs_async_open(handle, 4, &queue) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть очередь.\n");
+        return 1;
+    }
+    kvs_async_submit(queue, &async_requests[0]);
+    kvs_async_submit(queue, &async_requests[1]);
+    kvs_async_drain(queue);
+    kvs_async_close(queue);
+    kvs_get_stats_h(handle, &stats);
+    errors += expect_ops(&stats, KVS_OP_PUT, KVS_OP_RESULT_OK, puts_before + 1, "асинхронных put");
+    errors += expect_ops(&stats, KVS_OP_GET, KVS_OP_RESULT_NOT_FOUND, missing_before + 1, "асинхронных get удаленного ключа");
+    kvs_close(handle);
+
+    // Шаг 5: После повторного открытия счетчики операций начинаются с нуля, а показатели восстанавливаются
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("  ОШИБКА: не удалось повторно открыть хранилище.\n");
+        return 1;
+    }
+    kvs_get_stats_h(handle, &stats);
+    uint64_t total_ops = 0;
+    for (int op = 0; op < KVS_OP_COUNT; op++) {
+        for (int r = 0; r < KVS_OP_RESULT_COUNT; r++) {
+            total_ops += stats.ops[op][r];
+        }
+    }
+    if (total_ops != 0 || stats.key_count != NUM_KEYS - deleted + 1) {
+        printf("  ОШИБКА: неверная статистика после повторного открытия.\n");
+        errors++;
+    }
+    kvs_close(handle);
+    if (kvs_get_stats(&stats) != KVS_ERROR_NOT_INITIALIZED) {
+        printf("  ОШИБКА: статистика доступна без открытого хранилища.\n");
+        errors++;
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Статистика операций, устройства и свободного места корректна.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("         ТЕСТИРОВАНИЕ СТАТИСТИКИ ХРАНИЛИЩА ЗАВЕРШЕНО      \n");
+    printf("=========================================================\n");
+    return 0;
+}
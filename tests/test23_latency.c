@@ -0,0 +1,207 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "../src/key_value_store/kvs_stats.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 32)
+#define NUM_KEYS            220
+#define UPDATE_ROUNDS       2
+#define LARGE_KEYS          8
+#define LARGE_VALUE_SIZE    1000
+#define MAX_VALUE_SIZE      1024
+#define EXPORT_BUFFER_SIZE  8192
+#define SYNTHETIC_SAMPLES   10000
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_latency.bin";
+
+static const char *op_names[KVS_LATENCY_OP_COUNT] = {"get", "put", "delete", "update", "gc", "persist"};
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "lat:%04d", i);
+}
+
+static uint32_t value_size(int i) {
+    return i >= NUM_KEYS ? LARGE_VALUE_SIZE : 120 + (i * 7) % 20;
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < value_size(i); j++) {
+        value[j] = (uint8_t)((i * 17 + j + version * 61) % 0xFF);
+    }
+}
+
+// Проверяет, что значение отличается от точного не больше чем на долю tolerance.
+static int expect_near(const char *what, uint64_t value, uint64_t exact, double tolerance) {
+    double error = ((double)value - (double)exact) / (double)exact;
+    if (error < -tolerance || error > tolerance) {
+        printf("  ОШИБКА: %s: %lu нс вместо %lu нс.\n", what, (unsigned long)value, (unsigned long)exact);
+        return 1;
+    }
+    return 0;
+}
+
+static kvs_handle *open_fresh(void) {
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return NULL;
+    }
+    return handle;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("          ЗАПУСК ТЕСТА ГИСТОГРАММ ЗАДЕРЖЕК               \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[MAX_VALUE_SIZE];
+    static char text[EXPORT_BUFFER_SIZE];
+    kvs_stats stats;
+    ssdmmc_sim_ensure_data_dir_exists();
+
+    // Шаг 1: Процентили известного распределения: 1..SYNTHETIC_SAMPLES мкс, по одному замеру на значение
+    kvs_handle *handle = open_fresh();
+    if (!handle) {
+        return 1;
+    }
+    size_t len = sizeof(text);
+    kvs_export_latency_h(handle, KVS_METRICS_JSON, true, text, &len);
+    kvs_device *previous = kvs_bind_device(handle);
+    for (uint64_t v = 1; v <= SYNTHETIC_SAMPLES; v++) {
+        kvs_latency_record(KVS_LATENCY_GC, kvs_stats_now_ns() - v * 1000);
+    }
+    kvs_bind_device(previous);
+    kvs_get_stats_h(handle, &stats);
+    const kvs_latency_summary *synthetic = &stats.latency[KVS_LATENCY_GC];
+    printf("  Распределение 1..%d мкс: p50 %.1f мкс, p99 %.1f мкс, p99.9 %.1f мкс, max %.1f мкс\n", SYNTHETIC_SAMPLES,
+           synthetic->p50_ns / 1e3, synthetic->p99_ns / 1e3, synthetic->p999_ns / 1e3, synthetic->max_ns / 1e3);
+    if (synthetic->count != SYNTHETIC_SAMPLES) {
+        printf("  ОШИБКА: в гистограмме %lu замеров.\n", (unsigned long)synthetic->count);
+        errors++;
+    }
+    errors += expect_near("p50", synthetic->p50_ns, SYNTHETIC_SAMPLES / 2 * 1000, 0.04);
+    errors += expect_near("p99", synthetic->p99_ns, SYNTHETIC_SAMPLES * 99 / 100 * 1000, 0.04);
+    errors += expect_near("p99.9", synthetic->p999_ns, SYNTHETIC_SAMPLES * 999 / 1000 * 1000, 0.04);
+    errors += expect_near("max", synthetic->max_ns, SYNTHETIC_SAMPLES * 1000, 0.01);
+    kvs_close(handle);
+
+    // Шаг 2: Нагрузка со сборкой мусора: область данных почти заполняется, удаление каждого второго ключа
+    // оставляет мелкие дыры, и для больших значений запускается сборка мусора (места может и не хватить).
+    // Каждая операция API попадает в свою гистограмму
+    handle = open_fresh();
+    if (!handle) {
+        return 1;
+    }
+    len = sizeof(text);
+    kvs_export_latency_h(handle, KVS_METRICS_JSON, true, text, &len);
+    kvs_get_stats_h(handle, &stats);
+    uint64_t gc_before = stats.gc_cycles, persist_before = stats.persist_count;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        errors += kvs_put_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS;
+    }
+    for (int round = 1; round <= UPDATE_ROUNDS; round++) {
+        for (int i = 1; i < NUM_KEYS; i += 2) {
+            make_key(key, i);
+            make_value(value, i, round);
+            errors += kvs_update_h(handle, key, strlen(key), value, value_size(i)) != KVS_SUCCESS;
+            size_t value_len = sizeof(value);
+            errors += kvs_get_h(handle, key, strlen(key), value, &value_len) != KVS_SUCCESS;
+        }
+    }
+    for (int i = 0; i < NUM_KEYS; i += 2) {
+        make_key(key, i);
+        errors += kvs_delete_h(handle, key, strlen(key)) != KVS_SUCCESS;
+    }
+    for (int i = NUM_KEYS; i < NUM_KEYS + LARGE_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        kvs_status status = kvs_put_h(handle, key, strlen(key), value, value_size(i));
+        errors += status != KVS_SUCCESS && status != KVS_ERROR_NO_SPACE;
+    }
+    kvs_get_stats_h(handle, &stats);
+    for (int op = 0; op < KVS_LATENCY_OP_COUNT; op++) {
+        const kvs_latency_summary *s = &stats.latency[op];
+        printf("  %-8s замеров %6lu, p50 %8.1f мкс, p99 %8.1f мкс, p99.9 %8.1f мкс, max %8.1f мкс\n", op_names[op], (unsigned long)s->count,
+               s->p50_ns / 1e3, s->p99_ns / 1e3, s->p999_ns / 1e3, s->max_ns / 1e3);
+        if (s->count > 0 && (s->p50_ns > s->p99_ns || s->p99_ns > s->p999_ns || s->p999_ns > s->max_ns || s->max_ns == 0 || s->total_ns < s->max_ns)) {
+            printf("  ОШИБКА: процентили операции '%s' не упорядочены.\n", op_names[op]);
+            errors++;
+        }
+    }
+    if (stats.latency[KVS_LATENCY_PUT].count != NUM_KEYS + LARGE_KEYS || stats.latency[KVS_LATENCY_UPDATE].count != NUM_KEYS / 2 * UPDATE_ROUNDS
+        || stats.latency[KVS_LATENCY_GET].count != NUM_KEYS / 2 * UPDATE_ROUNDS || stats.latency[KVS_LATENCY_DELETE].count != NUM_KEYS / 2
+        || stats.latency[KVS_LATENCY_GC].count != stats.gc_cycles - gc_before
+        || stats.latency[KVS_LATENCY_PERSIST].count != stats.persist_count - persist_before) {
+        printf("  ОШИБКА: количество замеров не совпадает с количеством операций.\n");
+        errors++;
+    }
+    if (stats.gc_cycles == gc_before) {
+        printf("  ОШИБКА: нагрузка не запустила сборку мусора.\n");
+        errors++;
+    }
+
+    // Шаг 3: Выгрузка в JSON и в формате Prometheus
+    len = 16;
+    if (kvs_export_latency_h(handle, KVS_METRICS_JSON, true, text, &len) != KVS_ERROR_BUFFER_TOO_SMALL || len <= 16) {
+        printf("  ОШИБКА: выгрузка в маленький буфер не сообщила нужный размер.\n");
+        errors++;
+    }
+    len = sizeof(text);
+    char expected[128];
+    if (kvs_export_latency_h(handle, KVS_METRICS_PROMETHEUS, false, text, &len) != KVS_SUCCESS || len != strlen(text) + 1) {
+        printf("  ОШИБКА: выгрузка в формате Prometheus не удалась.\n");
+        errors++;
+    }
+    sprintf(expected, "kvs_latency_seconds_count{op=\"update\"} %d\n", NUM_KEYS / 2 * UPDATE_ROUNDS);
+    if (!strstr(text, "# TYPE kvs_latency_seconds summary") || !strstr(text, expected) || !strstr(text, "quantile=\"0.999\"")) {
+        printf("  ОШИБКА: неверная выгрузка в формате Prometheus.\n");
+        errors++;
+    }
+    len = sizeof(text);
+    if (kvs_export_latency_h(handle, KVS_METRICS_JSON, true, text, &len) != KVS_SUCCESS) {
+        printf("  ОШИБКА: выгрузка в JSON не удалась.\n");
+        errors++;
+    }
+    printf("  JSON: %.160s...\n", text);
+    sprintf(expected, "\"put\": {\"count\": %d, ", NUM_KEYS + LARGE_KEYS);
+    if (text[0] != '{' || !strstr(text, "{\"latency_ns\": {\"get\": {\"count\": ") || !strstr(text, expected) || !strstr(text, "\"p999\": ")) {
+        printf("  ОШИБКА: неверная выгрузка в JSON.\n");
+        errors++;
+    }
+
+    // Шаг 4: Выгрузка со сбросом удалила выгруженные замеры, новые операции считаются с нуля
+    make_key(key, 1);
+    size_t value_len = sizeof(value);
+    kvs_get_h(handle, key, strlen(key), value, &value_len);
+    kvs_get_stats_h(handle, &stats);
+    if (stats.latency[KVS_LATENCY_GET].count != 1 || stats.latency[KVS_LATENCY_PUT].count != 0 || stats.latency[KVS_LATENCY_UPDATE].max_ns != 0) {
+        printf("  ОШИБКА: выгрузка со сбросом не очистила гистограммы.\n");
+        errors++;
+    }
+    kvs_close(handle);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Гистограммы задержек и выгрузка процентилей корректны.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("         ТЕСТИРОВАНИЕ ГИСТОГРАММ ЗАДЕРЖЕК ЗАВЕРШЕНО       \n");
+    printf("=========================================================\n");
+    return 0;
+}
@@ -0,0 +1,227 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 32)
+#define NUM_THREADS         4
+#define MESSAGES_PER_THREAD 5000
+#define SLOW_SINK_US        50
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_logging.bin";
+const char* LOG_FILE_PATH         = "../data/kvs_logging_log.txt";
+const char* LOG_FD_PATH           = "../data/kvs_logging_fd.txt";
+
+// Сообщения, полученные функцией обратного вызова
+static char captured[64][KVS_LOG_MESSAGE_SIZE];
+static kvs_log_level captured_levels[64];
+static atomic_int captured_count;
+static pthread_t callback_thread;
+static atomic_int slow_count;
+
+static void capture(kvs_log_level level, const char *message, void *user_data) {
+    (void)user_data;
+    int i = atomic_fetch_add(&captured_count, 1);
+    callback_thread = pthread_self();
+    if (i < 64) {
+        snprintf(captured[i], sizeof(captured[i]), "%s", message);
+        captured_levels[i] = level;
+    }
+}
+
+static void slow_sink(kvs_log_level level, const char *message, void *user_data) {
+    (void)level; (void)message; (void)user_data;
+    atomic_fetch_add(&slow_count, 1);
+    usleep(SLOW_SINK_US);
+}
+
+static void set_callback(kvs_log_callback callback) {
+    kvs_log_sink sink = {KVS_LOG_SINK_CALLBACK, NULL, -1, callback, NULL};
+    kvs_set_log_sink(&sink);
+}
+
+// Ищет сообщение среди полученных; возвращает его номер или -1.
+static int find_captured(const char *text) {
+    int count = atomic_load(&captured_count);
+    for (int i = 0; i < count && i < 64; i++) {
+        if (strstr(captured[i], text)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Проверяет, открыт ли процессом файл с именем name (по /proc/self/fd).
+static bool file_is_open(const char *name) {
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return false;
+    }
+    bool found = false;
+    struct dirent *entry;
+    char link[512], target[512];
+    while (!found && (entry = readdir(dir)) != NULL) {
+        snprintf(link, sizeof(link), "/proc/self/fd/%s", entry->d_name);
+        ssize_t len = readlink(link, target, sizeof(target) - 1);
+        if (len > 0) {
+            target[len] = '\0';
+            found = strstr(target, name) != NULL;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+static bool file_contains(const char *path, const char *text) {
+    static char content[65536];
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    size_t len = fread(content, 1, sizeof(content) - 1, file);
+    content[len] = '\0';
+    fclose(file);
+    return strstr(content, text) != NULL;
+}
+
+static void *log_worker(void *arg) {
+    int id = (int)(intptr_t)arg;
+    for (int i = 0; i < MESSAGES_PER_THREAD; i++) {
+        kvs_log_at(KVS_LOG_WARNING, "поток %d: сообщение %d", id, i);
+    }
+    return NULL;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("             ЗАПУСК ТЕСТА АСИНХРОННОГО ЛОГА              \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    uint64_t written = 0, dropped = 0, written_before = 0, dropped_before = 0;
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    ssdmmc_sim_ensure_data_dir_exists();
+    remove(KVS_STORAGE_FILE_PATH);
+    remove(LOG_FILE_PATH);
+    remove(LOG_FD_PATH);
+
+    // Шаг 1: Без открытых хранилищ сообщение сразу передается приемнику в вызывающем потоке
+    set_callback(capture);
+    kvs_log("сообщение без хранилища");
+    if (find_captured("сообщение без хранилища") != 0 || !pthread_equal(callback_thread, pthread_self())) {
+        printf("  ОШИБКА: сообщение без открытого хранилища не записано сразу.\n");
+        errors++;
+    }
+
+    // Шаг 2: С открытым хранилищем сообщения пишет фоновый поток, а kvs_log_flush дожидается записи
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return 1;
+    }
+    kvs_log_at(KVS_LOG_ERROR, "ошибка %d", 42);
+    kvs_log_flush();
+    int error_index = find_captured("ошибка 42");
+    if (find_captured("НОВЫЙ ЗАПУСК") < 0 || error_index < 0 || captured_levels[error_index] != KVS_LOG_ERROR
+        || pthread_equal(callback_thread, pthread_self())) {
+        printf("  ОШИБКА: сообщения не переданы фоновым потоком.\n");
+        errors++;
+    }
+
+    // Шаг 3: Сообщения ниже заданного уровня отбрасываются
+    kvs_set_log_level(KVS_LOG_WARNING);
+    int before = atomic_load(&captured_count);
+    kvs_log("отброшенное сообщение");
+    kvs_log_at(KVS_LOG_DEBUG, "отладочное сообщение");
+    kvs_log_at(KVS_LOG_WARNING, "предупреждение");
+    kvs_log_flush();
+    if (atomic_load(&captured_count) != before + 1 || find_captured("предупреждение") != before) {
+        printf("  ОШИБКА: фильтр уровня не сработал.\n");
+        errors++;
+    }
+    if (kvs_set_log_level((kvs_log_level)(KVS_LOG_OFF + 1)) != KVS_ERROR_INVALID_PARAM) {
+        printf("  ОШИБКА: принят неверный уровень лога.\n");
+        errors++;
+    }
+    kvs_set_log_level(KVS_LOG_INFO);
+
+    // Шаг 4: Приемник - файловый дескриптор
+    int fd = open(LOG_FD_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    kvs_log_sink fd_sink = {KVS_LOG_SINK_FD, NULL, fd, NULL, NULL};
+    if (kvs_set_log_sink(&fd_sink) != KVS_SUCCESS) {
+        printf("  ОШИБКА: не удалось задать дескриптор.\n");
+        errors++;
+    }
+    kvs_log("в дескриптор %s", "fd");
+    kvs_log_flush();
+    close(fd);
+    if (!file_contains(LOG_FD_PATH, "] в дескриптор fd\n") || !file_contains(LOG_FD_PATH, "[20")) {
+        printf("  ОШИБКА: сообщение не записано в дескриптор.\n");
+        errors++;
+    }
+    kvs_log_sink bad_sink = {KVS_LOG_SINK_CALLBACK, NULL, -1, NULL, NULL};
+    if (kvs_set_log_sink(&bad_sink) != KVS_ERROR_INVALID_PARAM) {
+        printf("  ОШИБКА: принят приемник без функции.\n");
+        errors++;
+    }
+
+    // Шаг 5: Файл лога открыт, пока открыто хранилище, и закрывается вместе с ним
+    kvs_log_sink file_sink = {KVS_LOG_SINK_FILE, LOG_FILE_PATH, -1, NULL, NULL};
+    kvs_set_log_sink(&file_sink);
+    kvs_log("в файл");
+    kvs_log_flush();
+    if (!file_contains(LOG_FILE_PATH, "] в файл\n") || !file_is_open("kvs_logging_log.txt")) {
+        printf("  ОШИБКА: файл лога не записан или не остался открытым.\n");
+        errors++;
+    }
+
+    // Шаг 6: Медленный приемник не задерживает пишущие потоки: при заполненном кольце сообщения отбрасываются,
+    // и каждое сообщение либо записано, либо учтено как отброшенное
+    set_callback(slow_sink);
+    kvs_get_log_stats(&written_before, &dropped_before);
+    pthread_t threads[NUM_THREADS];
+    for (int t = 0; t < NUM_THREADS; t++) {
+        pthread_create(&threads[t], NULL, log_worker, (void *)(intptr_t)t);
+    }
+    for (int t = 0; t < NUM_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    kvs_log_flush();
+    kvs_get_log_stats(&written, &dropped);
+    printf("  Сообщений: записано %lu, отброшено %lu\n", (unsigned long)(written - written_before), (unsigned long)(dropped - dropped_before));
+    if (written - written_before + dropped - dropped_before != NUM_THREADS * MESSAGES_PER_THREAD
+        || (uint64_t)atomic_load(&slow_count) != written - written_before || dropped == dropped_before) {
+        printf("  ОШИБКА: счетчики записанных и отброшенных сообщений не сходятся.\n");
+        errors++;
+    }
+
+    // Шаг 7: После закрытия хранилища файл лога закрыт, а закрытие дописало все сообщения
+    kvs_set_log_sink(&file_sink);
+    kvs_close(handle);
+    if (file_is_open("kvs_logging_log.txt") || !file_contains(LOG_FILE_PATH, "] Деинициализация завершена.\n")) {
+        printf("  ОШИБКА: файл лога не закрыт вместе с хранилищем.\n");
+        errors++;
+    }
+    kvs_set_log_sink(NULL);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Асинхронный лог, фильтр уровня и приемники работают корректно.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("            ТЕСТИРОВАНИЕ АСИНХРОННОГО ЛОГА ЗАВЕРШЕНО      \n");
+    printf("=========================================================\n");
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "../src/key_value_store/kvs_metadata.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 64)
+#define NUM_KEYS            40
+#define VALUE_SIZE          100
+#define RING_RECORDS        65536
+#define SMALL_RING          16
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_trace.bin";
+const char* TRACE_FILE_PATH       = "../data/kvs_trace.trc";
+const char* REPLAY_FILE_PATH      = "../data/kvs_trace_replay.bin";
+
+static kvs_trace_record records[RING_RECORDS];
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "trace:%03d", i);
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, int i, int version) {
+    for (uint32_t j = 0; j < VALUE_SIZE; j++) {
+        value[j] = (uint8_t)((i * 13 + j + version * 29) % 0xFF);
+    }
+}
+
+// Нагрузка: все ключи записываются, половина читается, четверть обновляется и четверть удаляется.
+static int run_workload(kvs_handle *handle, int version) {
+    int errors = 0;
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, version);
+        errors += kvs_put_h(handle, key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS;
+    }
+    for (int i = 0; i < NUM_KEYS; i += 2) {
+        make_key(key, i);
+        size_t value_len = sizeof(value);
+        errors += kvs_get_h(handle, key, strlen(key), value, &value_len) != KVS_SUCCESS;
+    }
+    for (int i = 1; i < NUM_KEYS; i += 4) {
+        make_key(key, i);
+        make_value(value, i, version + 1);
+        errors += kvs_update_h(handle, key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS;
+    }
+    for (int i = 3; i < NUM_KEYS; i += 4) {
+        make_key(key, i);
+        errors += kvs_delete_h(handle, key, strlen(key)) != KVS_SUCCESS;
+    }
+    make_key(key, 3);
+    errors += kvs_exists_h(handle, key, strlen(key)) != 0;
+    return errors;
+}
+
+static kvs_handle *open_fresh(void) {
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return NULL;
+    }
+    return handle;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("             ЗАПУСК ТЕСТА ТРАССЫ ВВОДА-ВЫВОДА            \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char key[KVS_KEY_SIZE];
+    kvs_stats before, after;
+    ssdmmc_sim_ensure_data_dir_exists();
+    kvs_handle *handle = open_fresh();
+    if (!handle) {
+        return 1;
+    }
+
+    // Шаг 1: Трасса в кольцо: каждая операция API дает событие, а ее операции устройства
+    // помечены той же операцией и хешем ключа
+    kvs_get_stats_h(handle, &before);
+    errors += kvs_trace_start_h(handle, NULL, RING_RECORDS) != KVS_SUCCESS;
+    errors += run_workload(handle, 0);
+    size_t count = RING_RECORDS;
+    errors += kvs_trace_read_h(handle, records, &count) != KVS_SUCCESS;
+    kvs_get_stats_h(handle, &after);
+
+    uint64_t events[KVS_OP_COUNT] = {0}, words_read = 0, words_written = 0, pages_erased = 0;
+    uint32_t merged = 0, put_index = 0, wrong_context = 0, wrong_path = 0;
+    for (size_t i = 0; i < count; i++) {
+        const kvs_trace_record *record = &records[i];
+        if (record->kind == KVS_TRACE_API) {
+            events[record->api_op]++;
+            if (record->api_op == KVS_OP_PUT) {
+                make_key(key, put_index++);
+                if (record->key_hash != kvs_key_hash(key, strlen(key)) || record->page != VALUE_SIZE || record->status != KVS_SUCCESS) {
+                    wrong_context++;
+                }
+            }
+            continue;
+        }
+        words_read    += record->kind == KVS_TRACE_READ ? record->word_count : 0;
+        words_written += record->kind == KVS_TRACE_WRITE ? record->word_count : 0;
+        pages_erased  += record->kind == KVS_TRACE_ERASE;
+        merged        += record->word_count > 1 && record->kind != KVS_TRACE_ERASE;
+
+        // Следующее событие API завершает операцию, которой принадлежит запись
+        size_t next = i + 1;
+        while (next < count && records[next].kind != KVS_TRACE_API) {
+            next++;
+        }
+        if (next < count && (record->api_op != records[next].api_op || record->key_hash != records[next].key_hash)) {
+            wrong_context++;
+        }
+        if (record->api_op == KVS_OP_PUT && record->kind == KVS_TRACE_WRITE && record->path != KVS_WRITE_PATH_PUT && record->path != KVS_WRITE_PATH_PERSIST) {
+            wrong_path++;
+        }
+    }
+    printf("  Записей трассы: %zu (объединенных диапазонов слов: %u), событий API: put %lu, get %lu, update %lu, delete %lu, exists %lu\n",
+           count, merged, (unsigned long)events[KVS_OP_PUT], (unsigned long)events[KVS_OP_GET], (unsigned long)events[KVS_OP_UPDATE],
+           (unsigned long)events[KVS_OP_DELETE], (unsigned long)events[KVS_OP_EXISTS]);
+    if (events[KVS_OP_PUT] != NUM_KEYS || events[KVS_OP_GET] != NUM_KEYS / 2 || events[KVS_OP_UPDATE] != NUM_KEYS / 4
+        || events[KVS_OP_DELETE] != NUM_KEYS / 4 || events[KVS_OP_EXISTS] != 1) {
+        printf("  ОШИБКА: количество событий API не совпадает с нагрузкой.\n");
+        errors++;
+    }
+    if (wrong_context > 0 || wrong_path > 0 || merged == 0) {
+        printf("  ОШИБКА: записи с чужим контекстом: %u, с неверным путем: %u.\n", wrong_context, wrong_path);
+        errors++;
+    }
+    if (words_read != after.device_words_read - before.device_words_read || words_written != after.device_words_written - before.device_words_written
+        || pages_erased != after.device_pages_erased - before.device_pages_erased) {
+        printf("  ОШИБКА: трасса не совпадает со счетчиками устройства.\n");
+        errors++;
+    }
+
+    // Шаг 2: Заполненное кольцо перезаписывает самые старые записи. Ключи уже есть, поэтому
+    // результаты повторной нагрузки не проверяются
+    errors += kvs_trace_start_h(handle, NULL, SMALL_RING) != KVS_SUCCESS;
+    run_workload(handle, 2);
+    count = RING_RECORDS;
+    kvs_trace_read_h(handle, records, &count);
+    uint64_t total = 0, overwritten = 0;
+    ssdmmc_sim_trace_get_counts(handle->sim, &total, &overwritten);
+    if (count != SMALL_RING || overwritten + SMALL_RING != total || records[count - 1].kind != KVS_TRACE_API
+        || records[count - 1].api_op != KVS_OP_EXISTS) {
+        printf("  ОШИБКА: кольцо трассы перезаписано неверно (%zu записей из %lu).\n", count, (unsigned long)total);
+        errors++;
+    }
+    kvs_trace_stop_h(handle);
+    kvs_close(handle);
+
+    // Шаг 3: Трасса в файл воспроизводится на новом устройстве с теми же операциями
+    handle = open_fresh();
+    if (!handle) {
+        return 1;
+    }
+    kvs_get_stats_h(handle, &before);
+    errors += kvs_trace_start_h(handle, TRACE_FILE_PATH, 0) != KVS_SUCCESS;
+    errors += run_workload(handle, 4);
+    kvs_get_stats_h(handle, &after);
+    kvs_trace_stop_h(handle);
+    kvs_close(handle);
+
+    FILE *trace = fopen(TRACE_FILE_PATH, "rb");
+    ssdmmc_sim_trace_header header;
+    ssdmmc_sim_device *replay = ssdmmc_sim_open(REPLAY_FILE_PATH, true);
+    if (!trace || !replay || ssdmmc_sim_format(replay) != SSDMMC_OK || fread(&header, sizeof(header), 1, trace) != 1
+        || memcmp(header.magic, SSDMMC_SIM_TRACE_MAGIC, sizeof(header.magic)) != 0 || header.record_size != sizeof(ssdmmc_sim_trace_record)) {
+        printf("  ОШИБКА: файл трассы не прочитан.\n");
+        errors++;
+    } else {
+        ssdmmc_sim_trace_record record;
+        uint32_t failures = 0;
+        while (fread(&record, sizeof(record), 1, trace) == 1) {
+            failures += ssdmmc_sim_trace_replay(replay, &record) != SSDMMC_OK;
+        }
+        ssdmmc_sim_io_counters io;
+        ssdmmc_sim_get_io_counters(replay, &io);
+        printf("  Воспроизведение: прочитано слов %lu, записано слов %lu, стерто страниц %lu\n",
+               (unsigned long)io.words_read, (unsigned long)io.words_written, (unsigned long)io.pages_erased);
+        if (failures > 0 || io.words_read != after.device_words_read - before.device_words_read
+            || io.words_written != after.device_words_written - before.device_words_written
+            || io.pages_erased != after.device_pages_erased - before.device_pages_erased) {
+            printf("  ОШИБКА: воспроизведение не повторило операции устройства.\n");
+            errors++;
+        }
+    }
+    if (trace) {
+        fclose(trace);
+    }
+    ssdmmc_sim_close(replay);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Трасса ввода-вывода и ее воспроизведение корректны.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("           ТЕСТИРОВАНИЕ ТРАССЫ ВВОДА-ВЫВОДА ЗАВЕРШЕНО     \n");
+    printf("=========================================================\n");
+    return 0;
+}
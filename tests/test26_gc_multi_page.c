@@ -0,0 +1,193 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "../src/key_value_store/kvs_metadata.h"
+#include "../src/key_value_store/kvs_internal_io.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 32)
+#define MAX_KEYS            256
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_gc_multi_page.bin";
+
+// Сообщение GC о количестве очищенных страниц, полученное через приемник лога
+static int gc_pages_cleared = -1;
+
+static void capture_gc(kvs_log_level level, const char *message, void *user_data) {
+    (void)level; (void)user_data;
+    unsigned pages = 0;
+    const char *text = strstr(message, "GC: Очищено ");
+    if (text && sscanf(text, "GC: Очищено %u страниц данных", &pages) == 1) {
+        gc_pages_cleared = (int)pages;
+    }
+}
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "gc_key_%03d", i);
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, uint32_t size, int i) {
+    for (uint32_t j = 0; j < size; j++) {
+        value[j] = (uint8_t)((i * 31 + j) % 0xFF);
+    }
+}
+
+// Возвращает смещение значения ключа на устройстве или UINT32_MAX.
+static uint32_t value_offset_of(kvs_handle *handle, const char *key) {
+    uint32_t offset = UINT32_MAX;
+    kvs_device *previous = kvs_bind_device(handle);
+    uint32_t pos = 0;
+    kvs_metadata metadata;
+    if (kvs_key_locate(key, strlen(key), &pos)
+        && kvs_read_region(handle->sim, kvs_key_metadata_offset(pos), &metadata, sizeof(metadata)) == KVS_INTERNAL_OK) {
+        offset = metadata.value_offset;
+    }
+    kvs_bind_device(previous);
+    return offset;
+}
+
+static bool corrupt_file(uint32_t offset) {
+    FILE *fp = fopen(KVS_STORAGE_FILE_PATH, "r+b");
+    if (!fp) {
+        return false;
+    }
+    uint8_t garbage[4] = {5, 5, 5, 5};
+    fseek(fp, offset, SEEK_SET);
+    size_t written = fwrite(garbage, 1, sizeof(garbage), fp);
+    fclose(fp);
+    return written == sizeof(garbage);
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("        ЗАПУСК ТЕСТА GC С НЕСКОЛЬКИМИ СТРАНИЦАМИ         \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char key[KVS_KEY_SIZE];
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    ssdmmc_sim_ensure_data_dir_exists();
+    remove(KVS_STORAGE_FILE_PATH);
+
+    // Шаг 1: Заполняем область данных значениями в четверть страницы, оставляя в конце
+    // полторы свободные страницы: туда поместятся живые данные жертв, но не большое значение
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return 1;
+    }
+    uint32_t page_size  = handle->superblock.page_size_bytes;
+    uint32_t page_count = handle->superblock.userdata_page_count;
+    uint32_t small_size = page_size / 4;
+    int key_count = (int)(page_count * 4) - 6;
+    if (key_count > MAX_KEYS) {
+        key_count = MAX_KEYS;
+    }
+    uint8_t *value = malloc(page_size * 3);
+    uint8_t *read_back = malloc(page_size * 3);
+    if (!value || !read_back) {
+        return 1;
+    }
+    for (int i = 0; i < key_count; i++) {
+        make_key(key, i);
+        make_value(value, small_size, i);
+        if (kvs_put_h(handle, key, strlen(key), value, small_size) != KVS_SUCCESS) {
+            printf("  ОШИБКА: не удалось записать ключ %s.\n", key);
+            errors++;
+        }
+    }
+
+    // Шаг 2: Три значения из четырех на каждой странице становятся мусором (повреждаются на диске),
+    // поэтому самый длинный свободный участок внутри заполненной части - три четверти страницы
+    uint32_t corrupt_offsets[MAX_KEYS];
+    for (int i = 0; i < key_count; i++) {
+        make_key(key, i);
+        corrupt_offsets[i] = i % 4 != 0 ? value_offset_of(handle, key) : UINT32_MAX;
+    }
+    kvs_close(handle);
+    for (int i = 0; i < key_count; i++) {
+        if (corrupt_offsets[i] != UINT32_MAX && !corrupt_file(corrupt_offsets[i])) {
+            printf("  ОШИБКА: не удалось повредить значение ключа %d.\n", i);
+            errors++;
+        }
+    }
+
+    // Шаг 3: Значение в две с половиной страницы помещается только после одного прохода GC,
+    // который очищает сразу несколько страниц-жертв
+    kvs_log_sink sink = {KVS_LOG_SINK_CALLBACK, NULL, -1, capture_gc, NULL};
+    kvs_set_log_sink(&sink);
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище повторно.\n");
+        return 1;
+    }
+    kvs_stats before, after;
+    kvs_get_stats_h(handle, &before);
+    uint32_t large_size = page_size * 5 / 2;
+    char large_key[KVS_KEY_SIZE];
+    make_key(large_key, 999);
+    make_value(value, large_size, 999);
+    if (kvs_put_h(handle, large_key, strlen(large_key), value, large_size) != KVS_SUCCESS) {
+        printf("  ОШИБКА: большое значение не записано.\n");
+        errors++;
+    }
+    kvs_get_stats_h(handle, &after);
+    kvs_log_flush();
+    printf("  Проходов GC: %lu, очищено страниц за проход: %d, перенесено байт: %lu\n",
+           (unsigned long)(after.gc_cycles - before.gc_cycles), gc_pages_cleared,
+           (unsigned long)(after.gc_bytes_moved - before.gc_bytes_moved));
+    if (after.gc_cycles - before.gc_cycles != 1 || gc_pages_cleared < 2) {
+        printf("  ОШИБКА: ожидался один проход GC, очищающий больше одной страницы.\n");
+        errors++;
+    }
+
+    // Шаг 4: Все уцелевшие значения читаются без искажений, а поврежденные ключи недоступны
+    size_t read_len = page_size * 3;
+    if (kvs_get_h(handle, large_key, strlen(large_key), read_back, &read_len) != KVS_SUCCESS || read_len != large_size
+        || memcmp(read_back, value, large_size) != 0) {
+        printf("  ОШИБКА: большое значение прочитано неверно.\n");
+        errors++;
+    }
+    int survivors = 0;
+    for (int i = 0; i < key_count; i++) {
+        make_key(key, i);
+        read_len = page_size * 3;
+        kvs_status status = kvs_get_h(handle, key, strlen(key), read_back, &read_len);
+        if (i % 4 != 0) {
+            if (status == KVS_SUCCESS) {
+                printf("  ОШИБКА: поврежденный ключ %s прочитан.\n", key);
+                errors++;
+            }
+            continue;
+        }
+        make_value(value, small_size, i);
+        if (status != KVS_SUCCESS || read_len != small_size || memcmp(read_back, value, small_size) != 0) {
+            printf("  ОШИБКА: значение ключа %s после GC неверно.\n", key);
+            errors++;
+        }
+        survivors++;
+    }
+    printf("  Проверено уцелевших ключей: %d\n", survivors);
+    kvs_close(handle);
+    kvs_set_log_sink(NULL);
+    free(value);
+    free(read_back);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Один проход GC очистил несколько страниц, данные корректны.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("      ТЕСТИРОВАНИЕ GC С НЕСКОЛЬКИМИ СТРАНИЦАМИ ЗАВЕРШЕНО  \n");
+    printf("=========================================================\n");
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 32)
+#define VALUE_SIZE          100
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_format_version.bin";
+
+// Записывает значение поля по смещению field в основной и резервный суперблоки файла.
+static bool patch_superblocks(uint32_t backup_offset, size_t field, uint32_t value) {
+    FILE *fp = fopen(KVS_STORAGE_FILE_PATH, "r+b");
+    if (!fp) {
+        return false;
+    }
+    bool ok = fseek(fp, (long)field, SEEK_SET) == 0 && fwrite(&value, sizeof(value), 1, fp) == 1
+              && fseek(fp, (long)(backup_offset + field), SEEK_SET) == 0 && fwrite(&value, sizeof(value), 1, fp) == 1;
+    fclose(fp);
+    return ok;
+}
+
+// Читает файл хранилища целиком. Возвращает буфер (освобождает вызывающий) или NULL.
+static uint8_t *read_file(size_t *size_out) {
+    FILE *fp = fopen(KVS_STORAGE_FILE_PATH, "rb");
+    if (!fp) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t *content = malloc((size_t)size);
+    if (content && fread(content, 1, (size_t)size, fp) != (size_t)size) {
+        free(content);
+        content = NULL;
+    }
+    fclose(fp);
+    *size_out = (size_t)size;
+    return content;
+}
+
+// Открывает хранилище другого формата: открытие должно завершиться ошибкой, а файл - остаться прежним.
+static int expect_rejected(const char *description) {
+    size_t size_before = 0, size_after = 0;
+    uint8_t *before = read_file(&size_before);
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    kvs_status status = kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle);
+    if (status == KVS_SUCCESS) {
+        kvs_close(handle);
+    }
+    uint8_t *after = read_file(&size_after);
+    int errors = 0;
+    if (status == KVS_SUCCESS || !before || !after || size_before != size_after || memcmp(before, after, size_before) != 0) {
+        printf("  ОШИБКА: хранилище (%s) открыто или перезаписано.\n", description);
+        errors++;
+    } else {
+        printf("  Хранилище (%s) отклонено, файл не изменен.\n", description);
+    }
+    free(before);
+    free(after);
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("             ЗАПУСК ТЕСТА ВЕРСИИ ФОРМАТА                 \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char key[KVS_KEY_SIZE] = "format_key";
+    uint8_t value[VALUE_SIZE], read_back[VALUE_SIZE];
+    for (int i = 0; i < VALUE_SIZE; i++) {
+        value[i] = (uint8_t)(i * 3);
+    }
+    kvs_options options = {TEST_USER_DATA_SIZE, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    ssdmmc_sim_ensure_data_dir_exists();
+    remove(KVS_STORAGE_FILE_PATH);
+
+    // Шаг 1: Хранилище текущего формата открывается повторно
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось открыть хранилище.\n");
+        return 1;
+    }
+    uint32_t backup_offset = handle->superblock.superblock_backup_offset;
+    if (handle->superblock.magic != KVS_SUPERBLOCK_MAGIC || handle->superblock.format_version != KVS_FORMAT_VERSION) {
+        printf("  ОШИБКА: новое хранилище записано без текущей версии формата.\n");
+        errors++;
+    }
+    kvs_put_h(handle, key, strlen(key), value, VALUE_SIZE);
+    kvs_close(handle);
+    size_t value_len = VALUE_SIZE;
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS
+        || kvs_get_h(handle, key, strlen(key), read_back, &value_len) != KVS_SUCCESS || memcmp(read_back, value, VALUE_SIZE) != 0) {
+        printf("  ОШИБКА: хранилище текущего формата не открыто повторно.\n");
+        errors++;
+    }
+    kvs_close(handle);
+
+    // Шаг 2: Хранилище другой версии формата не открывается и не перезаписывается новым
+    if (!patch_superblocks(backup_offset, offsetof(kvs_superblock, format_version), KVS_FORMAT_VERSION + 1)) {
+        printf("Критическая ошибка: не удалось изменить суперблок.\n");
+        return 1;
+    }
+    errors += expect_rejected("следующая версия формата");
+
+    // Шаг 3: Так же отклоняется хранилище, записанное до появления версии формата
+    patch_superblocks(backup_offset, offsetof(kvs_superblock, magic), KVS_SUPERBLOCK_MAGIC_V1);
+    errors += expect_rejected("формат без версии");
+
+    // Шаг 4: После возврата версии хранилище снова открывается с прежними данными
+    patch_superblocks(backup_offset, offsetof(kvs_superblock, magic), KVS_SUPERBLOCK_MAGIC);
+    patch_superblocks(backup_offset, offsetof(kvs_superblock, format_version), KVS_FORMAT_VERSION);
+    value_len = VALUE_SIZE;
+    if (kvs_open(KVS_STORAGE_FILE_PATH, &options, &handle) != KVS_SUCCESS
+        || kvs_get_h(handle, key, strlen(key), read_back, &value_len) != KVS_SUCCESS || memcmp(read_back, value, VALUE_SIZE) != 0) {
+        printf("  ОШИБКА: данные не сохранились после отклоненных открытий.\n");
+        errors++;
+    }
+    kvs_close(handle);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Хранилища другой версии формата корректно отклоняются.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("            ТЕСТИРОВАНИЕ ВЕРСИИ ФОРМАТА ЗАВЕРШЕНО         \n");
+    printf("=========================================================\n");
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "../src/key_value_store/kvs_metadata.h"
+#include "../src/key_value_store/kvs_internal_io.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE  (1024 * 32)
+#define MAX_KEYS             256
+#define HOT_PAGE             5      // Изношенная страница (от начала области данных)
+#define COLD_PAGE            6      // Холодная страница сразу за ней
+#define WEAR_LEVEL_THRESHOLD 8
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "wear_key_%03d", i);
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static void make_value(uint8_t *value, uint32_t size, int i) {
+    for (uint32_t j = 0; j < size; j++) {
+        value[j] = (uint8_t)((i * 13 + j) % 0xFF);
+    }
+}
+
+// Возвращает смещение значения ключа на устройстве или UINT32_MAX.
+static uint32_t value_offset_of(const char *key) {
+    uint32_t pos = 0;
+    kvs_metadata metadata;
+    if (kvs_key_locate(key, strlen(key), &pos)
+        && kvs_read_region(device->sim, kvs_key_metadata_offset(pos), &metadata, sizeof(metadata)) == KVS_INTERNAL_OK) {
+        return metadata.value_offset;
+    }
+    return UINT32_MAX;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("     ЗАПУСК ТЕСТА ОКНА ПОИСКА ВЫРАВНИВАНИЯ ИЗНОСА        \n");
+    printf("=========================================================\n");
+
+    int errors = 0;
+    char key[KVS_KEY_SIZE];
+    ssdmmc_sim_ensure_data_dir_exists();
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return 1;
+    }
+    device->wear_level_threshold = UINT32_MAX;
+
+    // Шаг 1: Выравниваем заполнение по границе страницы и заполняем страницы до холодной включительно
+    // значениями в восьмую часть страницы (страницы считаются от первой целой страницы области данных)
+    uint32_t page_size  = device->superblock.page_size_bytes;
+    uint32_t data_start = device->superblock.data_offset;
+    uint32_t value_size = page_size / 8;
+    uint32_t data_first_page = (data_start + page_size - 1) / page_size;
+    uint32_t data_end_page   = (data_start + device->superblock.userdata_size_bytes) / page_size;
+    int key_count = (COLD_PAGE + 1) * 8;
+    if (key_count > MAX_KEYS) {
+        key_count = MAX_KEYS;
+    }
+    uint8_t *value = malloc(page_size);
+    uint8_t *read_back = malloc(page_size);
+    if (!value || !read_back) {
+        return 1;
+    }
+    char pad_key[KVS_KEY_SIZE];
+    make_key(pad_key, 999);
+    uint32_t pad_size = data_first_page * page_size - data_start;
+    if (pad_size > 0) {
+        make_value(value, pad_size, 999);
+        if (kvs_put(pad_key, strlen(pad_key), value, pad_size) != KVS_SUCCESS) {
+            printf("  ОШИБКА: не удалось записать выравнивающее значение.\n");
+            errors++;
+        }
+    }
+    for (int i = 0; i < key_count; i++) {
+        make_key(key, i);
+        make_value(value, value_size, i);
+        if (kvs_put(key, strlen(key), value, value_size) != KVS_SUCCESS) {
+            printf("  ОШИБКА: не удалось записать ключ %s.\n", key);
+            errors++;
+        }
+    }
+
+    // Шаг 2: Освобождаем последнюю восьмую изношенной страницы и первые три четверти холодной.
+    // Свободный участок, начинающийся перед холодной страницей, продолжается внутри нее.
+    bool deleted[MAX_KEYS] = {false};
+    int cold_live = 0;
+    for (int i = 0; i < key_count; i++) {
+        make_key(key, i);
+        uint32_t offset = value_offset_of(key);
+        if (offset == UINT32_MAX) {
+            printf("  ОШИБКА: ключ %s не найден.\n", key);
+            errors++;
+            continue;
+        }
+        uint32_t page    = offset / page_size - data_first_page;
+        uint32_t in_page = offset % page_size;
+        bool hot_tail  = page == HOT_PAGE && in_page >= page_size - value_size;
+        bool cold_head = page == COLD_PAGE && in_page < page_size * 3 / 4;
+        if (hot_tail || cold_head) {
+            deleted[i] = kvs_delete(key, strlen(key)) == KVS_SUCCESS;
+        } else if (page == COLD_PAGE) {
+            cold_live++;
+        }
+    }
+    if (cold_live == 0) {
+        printf("  ОШИБКА: на холодной странице не осталось живых данных.\n");
+        errors++;
+    }
+
+    // Шаг 3: Задаем износ так, чтобы холодной была COLD_PAGE, а единственным местом назначения - HOT_PAGE
+    uint32_t start_tracked_page = data_start / page_size;
+    for (uint32_t p = data_first_page; p < data_end_page; p++) {
+        device->page_rewrite_count[p - start_tracked_page] = 1;
+    }
+    device->page_rewrite_count[data_first_page + COLD_PAGE - start_tracked_page] = 0;
+    device->page_rewrite_count[data_first_page + HOT_PAGE - start_tracked_page]  = 100;
+    device->wear_level_threshold = WEAR_LEVEL_THRESHOLD;
+
+    uint32_t migrations_before = device->wear_level_migrations;
+    if (kvs_wear_level_step() != KVS_INTERNAL_OK) {
+        printf("  ОШИБКА: шаг выравнивания износа завершился с ошибкой.\n");
+        errors++;
+    }
+    printf("  Живых значений на холодной странице: %d, перенесено страниц: %u\n",
+           cold_live, device->wear_level_migrations - migrations_before);
+
+    // Шаг 4: Целиком вне холодной страницы места на изношенной странице нет, поэтому перенос
+    // либо не выполняется, либо попадает в другое место. В любом случае все ключи читаются,
+    // а после стирания холодной страницы ни одно значение на ней не остается.
+    uint32_t cold_start = (data_first_page + COLD_PAGE) * page_size;
+    for (int i = 0; i < key_count; i++) {
+        make_key(key, i);
+        size_t read_len = page_size;
+        kvs_status status = kvs_get(key, strlen(key), read_back, &read_len);
+        if (deleted[i]) {
+            if (status == KVS_SUCCESS) {
+                printf("  ОШИБКА: удаленный ключ %s прочитан.\n", key);
+                errors++;
+            }
+            continue;
+        }
+        make_value(value, value_size, i);
+        if (status != KVS_SUCCESS || read_len != value_size || memcmp(read_back, value, value_size) != 0) {
+            printf("  ОШИБКА: значение ключа %s после выравнивания износа неверно.\n", key);
+            errors++;
+            continue;
+        }
+        uint32_t offset = value_offset_of(key);
+        if (device->wear_level_migrations != migrations_before && offset >= cold_start && offset < cold_start + page_size) {
+            printf("  ОШИБКА: значение ключа %s осталось на стертой холодной странице.\n", key);
+            errors++;
+        }
+    }
+    size_t read_len = page_size;
+    make_value(value, pad_size, 999);
+    if (pad_size > 0 && (kvs_get(pad_key, strlen(pad_key), read_back, &read_len) != KVS_SUCCESS || memcmp(read_back, value, pad_size) != 0)) {
+        printf("  ОШИБКА: выравнивающее значение после выравнивания износа неверно.\n");
+        errors++;
+    }
+    kvs_deinit();
+    free(value);
+    free(read_back);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0) {
+        printf("  ПРОВЕРКА: Холодные данные не перенесены на стираемую страницу, значения корректны.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d.\n", errors);
+    }
+
+    printf("\n=========================================================\n");
+    printf("   ТЕСТИРОВАНИЕ ОКНА ПОИСКА ВЫРАВНИВАНИЯ ИЗНОСА ЗАВЕРШЕНО \n");
+    printf("=========================================================\n");
+    return errors == 0 ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 #include "kvs.h"
 #include "kvs_test_wrappers.h"
 #include "../src/key_value_store/kvs_internal.h"
+#include <stddef.h>
 
 // --- Конфигурация теста ---
 #define TEST_USER_DATA_SIZE (1024 * 512)
@@ -12,9 +13,14 @@ const char test_keys[NUM_TEST_KEYS][KVS_KEY_SIZE] = {"key_alpha", "key_beta", "k
 const char* test_data[NUM_TEST_KEYS] = {"data_alpha_123", "data_beta_456", "data_gamma_789"};
 
 typedef struct {
-    uint8_t  key[KVS_KEY_SIZE];
+    uint8_t  key_len;
+    uint8_t  key[KVS_SLOT_KEY_BYTES];
     uint32_t value_offset;
     uint32_t value_size;
+    uint32_t update_count;
+#if KVS_INLINE_VALUE_SIZE > 0
+    uint8_t  inline_value[KVS_INLINE_VALUE_SIZE];
+#endif
 } TestMetadata;
 
 // --- Вспомогательные функции ---
@@ -45,7 +51,7 @@ void setup_clean_storage() {
     for (int i = 0; i < NUM_TEST_KEYS; ++i) {
         char key_buffer[KVS_KEY_SIZE] = {0};
         strncpy(key_buffer, test_keys[i], KVS_KEY_SIZE - 1);
-        Kvs_put(key_buffer, KVS_KEY_SIZE, test_data[i], strlen(test_data[i]) + 1);
+        Kvs_put(key_buffer, strlen(key_buffer), test_data[i], strlen(test_data[i]) + 1);
     }
     Kvs_deinit();
 }
@@ -59,11 +65,11 @@ void check_all_keys_exist(bool should_exist) {
         memset(key_buffer, 0, KVS_KEY_SIZE);
         strncpy(key_buffer, test_keys[i], KVS_KEY_SIZE - 1);
 
-        Kvs_exists(key_buffer);
+        Kvs_exists(key_buffer, strlen(key_buffer));
 
         if (should_exist) {
             size_t buffer_size = sizeof(buffer);
-            Kvs_get(key_buffer, buffer, &buffer_size);
+            Kvs_get(key_buffer, strlen(key_buffer), buffer, &buffer_size);
         }
     }
 }
@@ -129,8 +135,14 @@ void test_corrupt_user_data() {
 
     for (uint32_t i = 0; i < sb.max_key_count; i++) {
         if (fread(&temp_meta, sizeof(TestMetadata), 1, fp_reader) != 1) break;
-        if (memcmp(temp_meta.key, key_buffer_for_cmp, KVS_KEY_SIZE) == 0) {
+        if (memcmp(temp_meta.key, key_buffer_for_cmp, sizeof(temp_meta.key)) == 0) {
             data_to_corrupt_offset = temp_meta.value_offset;
+#if KVS_INLINE_VALUE_SIZE > 0
+            // Малое значение хранится прямо в слоте метаданных
+            if (data_to_corrupt_offset == KVS_INLINE_VALUE_OFFSET) {
+                data_to_corrupt_offset = sb.metadata_offset + i * sizeof(TestMetadata) + offsetof(TestMetadata, inline_value);
+            }
+#endif
             break;
         }
     }
@@ -155,17 +167,17 @@ void test_corrupt_user_data() {
     // Этот ключ должен быть найден
     memset(key_buffer, 0, KVS_KEY_SIZE);
     strncpy(key_buffer, test_keys[0], KVS_KEY_SIZE - 1);
-    Kvs_exists(key_buffer);
+    Kvs_exists(key_buffer, strlen(key_buffer));
 
     // Этот ключ (поврежденный) не должен быть найден
     memset(key_buffer, 0, KVS_KEY_SIZE);
     strncpy(key_buffer, test_keys[1], KVS_KEY_SIZE - 1);
-    Kvs_exists(key_buffer);
+    Kvs_exists(key_buffer, strlen(key_buffer));
 
     // Этот ключ должен быть найден
     memset(key_buffer, 0, KVS_KEY_SIZE);
     strncpy(key_buffer, test_keys[2], KVS_KEY_SIZE - 1);
-    Kvs_exists(key_buffer);
+    Kvs_exists(key_buffer, strlen(key_buffer));
 
     Kvs_deinit();
 }
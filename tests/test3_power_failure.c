@@ -17,7 +17,7 @@ int main(int argc, char *argv[]) {
         printf("--- Фаза 1: Подготовка. Создаем хранилище и записываем первый ключ. ---\n");
         remove("../data/kvs_storage.bin");
         Kvs_init(1024 * 128);
-        Kvs_put(key_A, KVS_KEY_SIZE, data_A, strlen(data_A) + 1);
+        Kvs_put(key_A, strlen(key_A), data_A, strlen(data_A) + 1);
         Kvs_deinit();
         printf("--- Подготовка завершена. ---\n");
         return 0;
@@ -32,7 +32,7 @@ int main(int argc, char *argv[]) {
         ssdmmc_sim_set_write_failure_countdown(10);
 
         // Эта операция не завершится
-        Kvs_put(key_B, KVS_KEY_SIZE, data_B, strlen(data_B) + 1);
+        Kvs_put(key_B, strlen(key_B), data_B, strlen(data_B) + 1);
 
         Kvs_deinit(); // До сюда выполнение не дойдет
         return 0;
@@ -44,13 +44,13 @@ int main(int argc, char *argv[]) {
         Kvs_init(1024 * 128);
 
         printf("  Проверка состояния:\n");
-        Kvs_exists(key_A); // Этот ключ ОБЯЗАН существовать и быть валидным
+        Kvs_exists(key_A, strlen(key_A)); // Этот ключ ОБЯЗАН существовать и быть валидным
 
         char buffer[100];
         size_t size = sizeof(buffer);
-        printf("      -> "); Kvs_get(key_A, buffer, &size);
+        printf("      -> "); Kvs_get(key_A, strlen(key_A), buffer, &size);
 
-        Kvs_exists(key_B); // Этот ключ либо не должен существовать, либо быть невалидным
+        Kvs_exists(key_B, strlen(key_B)); // Этот ключ либо не должен существовать, либо быть невалидным
 
         Kvs_deinit();
         printf("--- Проверка завершена. ---\n");
@@ -70,9 +70,9 @@ int main() {
     memset(data3, 'C', page_size);
 
     // Записываем ключи
-    Kvs_put(large_key_name, KVS_KEY_SIZE, data1, large_key_size);
-    Kvs_put(key_to_corrupt, KVS_KEY_SIZE, data2, page_size);
-    Kvs_put(key_on_last_page, KVS_KEY_SIZE, data3, page_size);
+    Kvs_put(large_key_name, strlen(large_key_name), data1, large_key_size);
+    Kvs_put(key_to_corrupt, strlen(key_to_corrupt), data2, page_size);
+    Kvs_put(key_on_last_page, strlen(key_on_last_page), data3, page_size);
 
     Kvs_deinit();
     free(data1); free(data2); free(data3);
@@ -97,7 +97,7 @@ int main() {
 
     for (uint32_t i = 0; i < sb.max_key_count; i++) {
         if (fread(&temp_meta, sizeof(kvs_metadata), 1, fp_reader) != 1) break;
-        if (memcmp(temp_meta.key, key_buffer_for_cmp, KVS_KEY_SIZE) == 0) {
+        if (memcmp(temp_meta.key, key_buffer_for_cmp, sizeof(temp_meta.key)) == 0) {
             data_to_corrupt_offset = temp_meta.value_offset;
             break;
         }
@@ -117,20 +117,20 @@ int main() {
     Kvs_init(TEST_USER_DATA_SIZE);
 
     printf("  Проверка состояния перед запуском GC:\n");
-    Kvs_exists(large_key_name); // Этот ключ должен быть на месте
-    Kvs_exists(key_to_corrupt); // А этот ключ должен быть не найден из-за повреждения
-    Kvs_exists(key_on_last_page); // Этот ключ тоже должен быть на месте
+    Kvs_exists(large_key_name, strlen(large_key_name)); // Этот ключ должен быть на месте
+    Kvs_exists(key_to_corrupt, strlen(key_to_corrupt)); // А этот ключ должен быть не найден из-за повреждения
+    Kvs_exists(key_on_last_page, strlen(key_on_last_page)); // Этот ключ тоже должен быть на месте
 
     printf("\n  Запись нового ключа, которая должна запустить GC...\n");
     char new_data[100];
     memset(new_data, 'N', sizeof(new_data));
-    Kvs_put(new_key_name, KVS_KEY_SIZE, new_data, sizeof(new_data));
+    Kvs_put(new_key_name, strlen(new_key_name), new_data, sizeof(new_data));
 
     printf("\n  Проверка состояния после работы GC:\n");
-    Kvs_exists(large_key_name);
-    Kvs_exists(key_on_last_page);
-    Kvs_exists(new_key_name);
-    Kvs_exists(key_to_corrupt);
+    Kvs_exists(large_key_name, strlen(large_key_name));
+    Kvs_exists(key_on_last_page, strlen(key_on_last_page));
+    Kvs_exists(new_key_name, strlen(new_key_name));
+    Kvs_exists(key_to_corrupt, strlen(key_to_corrupt));
 
     Kvs_deinit();
 
@@ -72,9 +72,9 @@ int main() {
     memset(two_page_data, 'B', two_page_size);
     memset(last_page_data, 'C', page_size);
 
-    Kvs_put(large_key_name, KVS_KEY_SIZE, large_data, large_key_size);
-    Kvs_put(two_page_key_name, KVS_KEY_SIZE, two_page_data, two_page_size);
-    Kvs_put(last_page_key_name, KVS_KEY_SIZE, last_page_data, page_size);
+    Kvs_put(large_key_name, strlen(large_key_name), large_data, large_key_size);
+    Kvs_put(two_page_key_name, strlen(two_page_key_name), two_page_data, two_page_size);
+    Kvs_put(last_page_key_name, strlen(last_page_key_name), last_page_data, page_size);
 
     Kvs_deinit();
     free(large_data); free(two_page_data); free(last_page_data);
@@ -83,7 +83,7 @@ int main() {
     printf("\n--- Фаза 2: Создание и фрагментация 2-страничной дыры ---\n");
     Kvs_init(TEST_USER_DATA_SIZE);
 
-    Kvs_delete(two_page_key_name);
+    Kvs_delete(two_page_key_name, strlen(two_page_key_name));
 
     uint32_t small_key_size = page_size / 4;
     char* small_data_chunk = calloc(1,small_key_size);
@@ -91,7 +91,7 @@ int main() {
         return 2;
     for(int i=0; i<6; i++) {
         memset(small_data_chunk, 'S' + i, small_key_size);
-        Kvs_put(small_keys[i], KVS_KEY_SIZE, small_data_chunk, small_key_size);
+        Kvs_put(small_keys[i], strlen(small_keys[i]), small_data_chunk, small_key_size);
     }
     free(small_data_chunk);
 
@@ -115,7 +115,7 @@ int main() {
 
         for (uint32_t j = 0; j < sb.max_key_count; j++) {
             if (fread(&temp_meta, sizeof(kvs_metadata), 1, fp_reader) != 1) break;
-            if (memcmp(temp_meta.key, key_buffer_for_cmp, KVS_KEY_SIZE) == 0) {
+            if (memcmp(temp_meta.key, key_buffer_for_cmp, sizeof(temp_meta.key)) == 0) {
                 printf("  Повреждаем данные для ключа '%s'\n", small_keys[key_idx_to_corrupt]);
                 corrupt_file(temp_meta.value_offset, 4);
                 break;
@@ -143,7 +143,7 @@ int main() {
 
     char new_data[page_size];
     memset(new_data, 'N', sizeof(new_data));
-    Kvs_put(new_key_after_gc_name, KVS_KEY_SIZE, new_data, sizeof(new_data));
+    Kvs_put(new_key_after_gc_name, strlen(new_key_after_gc_name), new_data, sizeof(new_data));
 
     printf("\n--- Визуализация состояния хранилища ПОСЛЕ работы GC ---\n\n");
     printf("  [ ... Данные 'large_key_main_space' ... ]\n");
@@ -157,21 +157,21 @@ int main() {
     printf("  [ ... Данные 'key_on_last_page' ... ]\n");
 
     printf("\n  Проверка состояния после работы GC:\n");
-    Kvs_exists(large_key_name);
-    Kvs_exists(last_page_key_name);
-    Kvs_exists(new_key_after_gc_name);
+    Kvs_exists(large_key_name, strlen(large_key_name));
+    Kvs_exists(last_page_key_name, strlen(last_page_key_name));
+    Kvs_exists(new_key_after_gc_name, strlen(new_key_after_gc_name));
 
     printf("  Проверка эвакуированных ключей (должны существовать):\n");
-    Kvs_exists(small_keys[0]); // sk1
-    Kvs_exists(small_keys[2]); // sk3
+    Kvs_exists(small_keys[0], strlen(small_keys[0])); // sk1
+    Kvs_exists(small_keys[2], strlen(small_keys[2])); // sk3
     printf("  Проверка ключей которые лежат на странице в которую происходит эвакуация(должны существовать):\n");
-    Kvs_exists(small_keys[4]); // sk5
-    Kvs_exists(small_keys[5]); // sk6
+    Kvs_exists(small_keys[4], strlen(small_keys[4])); // sk5
+    Kvs_exists(small_keys[5], strlen(small_keys[5])); // sk6
 
 
     printf("  Проверка поврежденных ключей (не должны существовать):\n");
-    Kvs_exists(small_keys[1]); // sk2
-    Kvs_exists(small_keys[3]); // sk4
+    Kvs_exists(small_keys[1], strlen(small_keys[1])); // sk2
+    Kvs_exists(small_keys[3], strlen(small_keys[3])); // sk4
     Kvs_deinit();
 
     printf("\n=========================================================\n");
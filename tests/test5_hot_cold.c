@@ -0,0 +1,131 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 256)
+#define NUM_KEYS            400
+#define NUM_HOT_KEYS        40
+#define VALUE_SIZE          300
+#define NUM_UPDATES         2000
+#define HOT_UPDATE_PERCENT  90
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+// Версия данных каждого ключа: по ней восстанавливается ожидаемое содержимое значения
+static uint8_t key_versions[NUM_KEYS];
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "key_%d", i);
+}
+
+static void make_value(uint8_t *value, int i) {
+    memset(value, (uint8_t)(i * 7 + key_versions[i]), VALUE_SIZE);
+}
+
+// Прогоняет перекошенную нагрузку: большая часть обновлений приходится на небольшое число горячих ключей.
+// hot_cold_enabled - включено ли разделение горячих и холодных данных.
+// Возвращает количество байт живых данных, переписанных при стирании страниц и эвакуации GC.
+static uint64_t run_skewed_workload(bool hot_cold_enabled, int *errors_out) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        exit(1);
+    }
+    if (!hot_cold_enabled) {
+        device->hot_update_threshold = UINT32_MAX;
+    }
+
+    // Нагрузка: новые ключи дописываются постепенно, а между вставками обновляются уже записанные.
+    // Фиксированное зерно, чтобы оба прогона получили одинаковую последовательность операций.
+    srand(12345);
+    memset(key_versions, 0, sizeof(key_versions));
+    uint64_t copied_before = device->erase_copy_bytes + device->gc_bytes_moved;
+    int inserted = 0;
+    for (int u = 0; u < NUM_UPDATES; u++) {
+        if (inserted < NUM_KEYS && u % (NUM_UPDATES / NUM_KEYS) == 0) {
+            make_key(key, inserted);
+            make_value(value, inserted);
+            kvs_put(key, strlen(key), value, VALUE_SIZE);
+            inserted++;
+        }
+        if (inserted <= NUM_HOT_KEYS) {
+            continue;
+        }
+        int i;
+        if (rand() % 100 < HOT_UPDATE_PERCENT) {
+            i = rand() % NUM_HOT_KEYS;
+        } else {
+            i = NUM_HOT_KEYS + rand() % (inserted - NUM_HOT_KEYS);
+        }
+        key_versions[i]++;
+        make_key(key, i);
+        make_value(value, i);
+        kvs_update(key, strlen(key), value, VALUE_SIZE);
+    }
+    uint64_t copied = device->erase_copy_bytes + device->gc_bytes_moved - copied_before;
+
+    // Проверяем, что все ключи читаются с последними значениями
+    int errors = 0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        uint8_t expected[VALUE_SIZE];
+        size_t value_len = VALUE_SIZE;
+        make_key(key, i);
+        make_value(expected, i);
+        if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || value_len != VALUE_SIZE || memcmp(value, expected, VALUE_SIZE) != 0) {
+            errors++;
+        }
+    }
+    *errors_out = errors;
+
+    kvs_deinit();
+    return copied;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("     ЗАПУСК ТЕСТА РАЗДЕЛЕНИЯ ГОРЯЧИХ И ХОЛОДНЫХ ДАННЫХ    \n");
+    printf("=========================================================\n");
+
+    printf("\n  Нагрузка: %d ключей по %d байт вставляются вперемешку с %d обновлениями,\n"
+           "  %d%% обновлений приходится на %d горячих ключей.\n",
+           NUM_KEYS, VALUE_SIZE, NUM_UPDATES, HOT_UPDATE_PERCENT, NUM_HOT_KEYS);
+
+    int errors_mixed = 0, errors_separated = 0;
+
+    printf("\n--- Фаза 1: Горячие и холодные данные размещаются вперемешку ---\n");
+    uint64_t copied_mixed = run_skewed_workload(false, &errors_mixed);
+    printf("  Переписано живых данных при стирании и GC: %llu байт\n", (unsigned long long)copied_mixed);
+
+    printf("\n--- Фаза 2: Горячие и холодные данные размещаются в разных областях ---\n");
+    uint64_t copied_separated = run_skewed_workload(true, &errors_separated);
+    printf("  Переписано живых данных при стирании и GC: %llu байт\n", (unsigned long long)copied_separated);
+
+    printf("\n  Проверка данных:\n");
+    if (errors_mixed == 0 && errors_separated == 0) {
+        printf("  ПРОВЕРКА: Все значения корректны в обоих прогонах.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Повреждено значений: %d (вперемешку), %d (раздельно).\n", errors_mixed, errors_separated);
+    }
+    if (copied_separated < copied_mixed) {
+        printf("  ПРОВЕРКА: Разделение сократило объем копирования на %.1f%%.\n",
+               100.0 * (double)(copied_mixed - copied_separated) / (double)copied_mixed);
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Разделение не сократило объем копирования.\n");
+    }
+
+    printf("\n=========================================================\n");
+    printf("      ТЕСТИРОВАНИЕ ГОРЯЧИХ/ХОЛОДНЫХ ДАННЫХ ЗАВЕРШЕНО      \n");
+    printf("=========================================================\n");
+
+    return 0;
+}
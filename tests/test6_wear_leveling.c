@@ -0,0 +1,122 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 128)
+#define NUM_COLD_KEYS       120
+#define NUM_HOT_KEYS        20
+#define VALUE_SIZE          300
+#define NUM_UPDATES         1500
+#define WEAR_LEVEL_THRESHOLD 8
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+// Версия данных каждого ключа: по ней восстанавливается ожидаемое содержимое значения
+static uint8_t key_versions[NUM_COLD_KEYS + NUM_HOT_KEYS];
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "key_%d", i);
+}
+
+static void make_value(uint8_t *value, int i) {
+    memset(value, (uint8_t)(i * 7 + key_versions[i]), VALUE_SIZE);
+}
+
+// Прогоняет нагрузку, при которой холодные ключи записываются один раз, а горячие постоянно обновляются.
+// wear_leveling_enabled - включено ли статическое выравнивание износа.
+// Возвращает итоговый разброс счетчиков перезаписи страниц данных.
+static uint32_t run_wear_workload(bool wear_leveling_enabled, int *errors_out, uint32_t *migrations_out) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    int total_keys = NUM_COLD_KEYS + NUM_HOT_KEYS;
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        exit(1);
+    }
+    device->wear_level_threshold = wear_leveling_enabled ? WEAR_LEVEL_THRESHOLD : UINT32_MAX;
+
+    // Сначала записываем все ключи, затем много раз обновляем только горячие
+    memset(key_versions, 0, sizeof(key_versions));
+    for (int i = 0; i < total_keys; i++) {
+        make_key(key, i);
+        make_value(value, i);
+        kvs_put(key, strlen(key), value, VALUE_SIZE);
+    }
+
+    srand(12345);
+    for (int u = 0; u < NUM_UPDATES; u++) {
+        int i = NUM_COLD_KEYS + rand() % NUM_HOT_KEYS;
+        key_versions[i]++;
+        make_key(key, i);
+        make_value(value, i);
+        kvs_update(key, strlen(key), value, VALUE_SIZE);
+    }
+
+    uint32_t spread = 0, min_rewrites = 0, max_rewrites = 0;
+    kvs_get_wear_spread(&spread, &min_rewrites, &max_rewrites);
+    printf("  Счетчики перезаписи страниц данных: min=%u, max=%u, разброс=%u\n", min_rewrites, max_rewrites, spread);
+    *migrations_out = device->wear_level_migrations;
+
+    // Проверяем, что все ключи читаются с последними значениями
+    int errors = 0;
+    for (int i = 0; i < total_keys; i++) {
+        uint8_t expected[VALUE_SIZE];
+        size_t value_len = VALUE_SIZE;
+        make_key(key, i);
+        make_value(expected, i);
+        if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || value_len != VALUE_SIZE || memcmp(value, expected, VALUE_SIZE) != 0) {
+            errors++;
+        }
+    }
+    *errors_out = errors;
+
+    kvs_deinit();
+    return spread;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("       ЗАПУСК ТЕСТА СТАТИЧЕСКОГО ВЫРАВНИВАНИЯ ИЗНОСА      \n");
+    printf("=========================================================\n");
+
+    printf("\n  Нагрузка: %d холодных ключей записываются один раз,\n"
+           "  %d горячих ключей получают %d обновлений.\n",
+           NUM_COLD_KEYS, NUM_HOT_KEYS, NUM_UPDATES);
+
+    int errors_off = 0, errors_on = 0;
+    uint32_t migrations_off = 0, migrations_on = 0;
+
+    printf("\n--- Фаза 1: Выравнивание износа выключено ---\n");
+    uint32_t spread_off = run_wear_workload(false, &errors_off, &migrations_off);
+
+    printf("\n--- Фаза 2: Выравнивание износа включено ---\n");
+    uint32_t spread_on = run_wear_workload(true, &errors_on, &migrations_on);
+    printf("  Перенесено страниц с холодными данными: %u\n", migrations_on);
+
+    printf("\n  Проверка данных:\n");
+    if (errors_off == 0 && errors_on == 0) {
+        printf("  ПРОВЕРКА: Все значения корректны в обоих прогонах.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Повреждено значений: %d (без выравнивания), %d (с выравниванием).\n", errors_off, errors_on);
+    }
+    if (migrations_off == 0 && migrations_on > 0 && spread_on < spread_off) {
+        printf("  ПРОВЕРКА: Выравнивание сократило разброс износа с %u до %u.\n", spread_off, spread_on);
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Выравнивание не сократило разброс износа.\n");
+    }
+
+    printf("\n=========================================================\n");
+    printf("     ТЕСТИРОВАНИЕ ВЫРАВНИВАНИЯ ИЗНОСА ЗАВЕРШЕНО           \n");
+    printf("=========================================================\n");
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 128)
+#define NUM_KEYS            64
+#define VALUE_SIZE          301
+#define NUM_ROUNDS          5
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "key_%d", i);
+}
+
+static void make_value(uint8_t *value, int i, int round) {
+    memset(value, (uint8_t)(i * 13 + round), VALUE_SIZE);
+}
+
+// Проверяет, что область копий значений кеша чтения не перевыделялась и каждый ее блок
+// принадлежит либо списку свободных, либо ровно одному закешированному значению.
+// Возвращает true, если учет блоков сходится.
+static bool cache_arena_consistent(const uint8_t *arena_before) {
+    uint64_t used_chunks = 0;
+    for (uint32_t i = 0; i < device->cache_capacity; i++) {
+        const kvs_cache_entry *entry = &device->cache_entries[i];
+        if (entry->slot == UINT32_MAX) {
+            continue;
+        }
+        uint32_t chunks = 0;
+        for (uint32_t c = entry->first_chunk; c != UINT32_MAX; c = device->cache_chunk_next[c]) {
+            chunks++;
+        }
+        if (chunks != (entry->value_size + KVS_CACHE_CHUNK_BYTES - 1) / KVS_CACHE_CHUNK_BYTES) {
+            return false;
+        }
+        used_chunks += chunks;
+    }
+    return device->cache_arena == arena_before && used_chunks + device->cache_free_chunks == device->cache_chunk_count;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("        ЗАПУСК ТЕСТА ПУЛА ВРЕМЕННЫХ БУФЕРОВ              \n");
+    printf("=========================================================\n");
+
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    uint8_t expected[VALUE_SIZE];
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return 1;
+    }
+
+    // Прогрев: записываем все ключи
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i, 0);
+        kvs_put(key, strlen(key), value, VALUE_SIZE);
+    }
+
+    // Установившийся режим: чтения, обновления, удаления и повторные записи
+    printf("\n--- Нагрузка: %d раундов get/update/delete/put по %d ключам ---\n", NUM_ROUNDS, NUM_KEYS);
+    uint64_t allocs_before = device->heap_alloc_count;
+    uint64_t misses_before = device->cache_misses;
+    const uint8_t *cache_arena = device->cache_arena;
+    uint32_t operations = 0;
+    int errors = 0;
+    for (int round = 1; round <= NUM_ROUNDS; round++) {
+        for (int i = 0; i < NUM_KEYS; i++) {
+            size_t value_len = VALUE_SIZE;
+            make_key(key, i);
+            make_value(expected, i, round - 1);
+            if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || memcmp(value, expected, VALUE_SIZE) != 0) {
+                errors++;
+            }
+            make_value(value, i, round);
+            if (kvs_update(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+                errors++;
+            }
+            operations += 2;
+        }
+        for (int i = 0; i < NUM_KEYS; i += 4) {
+            make_key(key, i);
+            make_value(value, i, round);
+            if (kvs_delete(key, strlen(key)) != KVS_SUCCESS || kvs_put(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+                errors++;
+            }
+            operations += 2;
+        }
+    }
+    // Последний проход только читает: значения остаются в кеше чтения
+    for (int i = 0; i < NUM_KEYS; i++) {
+        size_t value_len = VALUE_SIZE;
+        make_key(key, i);
+        make_value(expected, i, NUM_ROUNDS);
+        if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || memcmp(value, expected, VALUE_SIZE) != 0) {
+            errors++;
+        }
+        operations++;
+    }
+    uint64_t allocs = device->heap_alloc_count - allocs_before;
+    uint64_t cache_misses = device->cache_misses - misses_before;
+    bool cache_ok = cache_misses > 0 && cache_arena_consistent(cache_arena);
+
+    printf("  Операций: %u, выделений временных буферов в куче: %llu (%.3f на операцию)\n",
+           operations, (unsigned long long)allocs, (double)allocs / operations);
+    printf("  Промахов кеша чтения: %llu, блоков области кеша: %u, свободно: %u\n",
+           (unsigned long long)cache_misses, device->cache_chunk_count, device->cache_free_chunks);
+
+    // Значение больше временного буфера пула обслуживается через кучу и тоже должно читаться корректно
+    uint32_t big_size = device->scratch_buffer_size + 100;
+    uint8_t *big_value = malloc(big_size);
+    uint8_t *big_read = malloc(big_size);
+    size_t big_len = big_size;
+    memset(big_value, 0x5A, big_size);
+    make_key(key, NUM_KEYS);
+    bool big_ok = kvs_put(key, strlen(key), big_value, big_size) == KVS_SUCCESS &&
+                  kvs_get(key, strlen(key), big_read, &big_len) == KVS_SUCCESS &&
+                  big_len == big_size && memcmp(big_value, big_read, big_size) == 0;
+    free(big_value);
+    free(big_read);
+
+    printf("\n  Проверка данных:\n");
+    if (errors == 0 && big_ok) {
+        printf("  ПРОВЕРКА: Все значения корректны.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок операций: %d, большое значение %s.\n", errors, big_ok ? "в порядке" : "повреждено");
+    }
+    if (allocs == 0) {
+        printf("  ПРОВЕРКА: В установившемся режиме временные буферы не выделяются в куче.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! В установившемся режиме было %llu выделений в куче.\n", (unsigned long long)allocs);
+    }
+    if (cache_ok) {
+        printf("  ПРОВЕРКА: Промахи кеша чтения копируют значения в заранее выделенную область.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Копии значений кеша чтения вышли за пределы его области.\n");
+    }
+
+    kvs_deinit();
+
+    printf("\n=========================================================\n");
+    printf("         ТЕСТИРОВАНИЕ ПУЛА БУФЕРОВ ЗАВЕРШЕНО              \n");
+    printf("=========================================================\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE (1024 * 256)
+#define NUM_KEYS            300
+#define VALUE_SIZE          200
+#define NUM_READS           20000
+#define ZIPF_EXPONENT       0.99
+#define CACHE_BUDGET        (16 * 1024)
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+// Накопленное распределение Зипфа по номерам ключей
+static double zipf_cdf[NUM_KEYS];
+
+static void make_key(char *key, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "key_%d", i);
+}
+
+static void make_value(uint8_t *value, int i) {
+    memset(value, (uint8_t)(i * 11 + 3), VALUE_SIZE);
+}
+
+static void zipf_init(void) {
+    double sum = 0.0;
+    for (int i = 0; i < NUM_KEYS; i++) {
+        sum += 1.0 / pow(i + 1, ZIPF_EXPONENT);
+        zipf_cdf[i] = sum;
+    }
+    for (int i = 0; i < NUM_KEYS; i++) {
+        zipf_cdf[i] /= sum;
+    }
+}
+
+// Выбирает номер ключа по распределению Зипфа бинарным поиском по накопленному распределению
+static int zipf_next(void) {
+    double u = (double)rand() / ((double)RAND_MAX + 1.0);
+    int left = 0, right = NUM_KEYS - 1;
+    while (left < right) {
+        int mid = (left + right) / 2;
+        if (zipf_cdf[mid] < u) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+    return left;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Прогоняет чтения по распределению Зипфа.
+// cache_budget - бюджет кеша чтения (0 - кеш выключен).
+// Возвращает среднюю задержку одного чтения в микросекундах.
+static double run_zipf_reads(size_t cache_budget, double *hit_rate_out, int *errors_out) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    uint8_t expected[VALUE_SIZE];
+
+    kvs_set_cache_budget(cache_budget);
+    uint64_t hits_before = 0, misses_before = 0;
+    kvs_get_cache_stats(&hits_before, &misses_before);
+
+    srand(777);
+    int errors = 0;
+    double started = now_us();
+    for (int r = 0; r < NUM_READS; r++) {
+        int i = zipf_next();
+        size_t value_len = VALUE_SIZE;
+        make_key(key, i);
+        if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || value_len != VALUE_SIZE) {
+            errors++;
+            continue;
+        }
+        make_value(expected, i);
+        if (memcmp(value, expected, VALUE_SIZE) != 0) {
+            errors++;
+        }
+    }
+    double elapsed = now_us() - started;
+
+    uint64_t hits = 0, misses = 0;
+    kvs_get_cache_stats(&hits, &misses);
+    hits -= hits_before;
+    misses -= misses_before;
+    *hit_rate_out = (hits + misses) ? 100.0 * (double)hits / (double)(hits + misses) : 0.0;
+    *errors_out = errors;
+    return elapsed / NUM_READS;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("           ЗАПУСК ТЕСТА КЕША ЧТЕНИЯ                      \n");
+    printf("=========================================================\n");
+
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return 1;
+    }
+    for (int i = 0; i < NUM_KEYS; i++) {
+        make_key(key, i);
+        make_value(value, i);
+        kvs_put(key, strlen(key), value, VALUE_SIZE);
+    }
+    zipf_init();
+
+    printf("\n  Нагрузка: %d чтений %d ключей по %d байт, распределение Зипфа (s=%.2f).\n",
+           NUM_READS, NUM_KEYS, VALUE_SIZE, ZIPF_EXPONENT);
+
+    int errors_off = 0, errors_on = 0, errors_update = 0;
+    double hit_rate_off = 0.0, hit_rate_on = 0.0;
+
+    printf("\n--- Фаза 1: Кеш чтения выключен ---\n");
+    double latency_off = run_zipf_reads(0, &hit_rate_off, &errors_off);
+    printf("  Средняя задержка чтения: %.2f мкс\n", latency_off);
+
+    printf("\n--- Фаза 2: Кеш чтения %d байт (%.0f%% объема значений) ---\n",
+           CACHE_BUDGET, 100.0 * CACHE_BUDGET / (NUM_KEYS * VALUE_SIZE));
+    double latency_on = run_zipf_reads(CACHE_BUDGET, &hit_rate_on, &errors_on);
+    printf("  Доля попаданий: %.1f%%\n", hit_rate_on);
+    printf("  Средняя задержка чтения: %.2f мкс\n", latency_on);
+
+    // Фаза 3: обновление и удаление закешированных ключей должны сразу быть видны при чтении
+    printf("\n--- Фаза 3: Обновление и удаление закешированных ключей ---\n");
+    uint8_t new_value[VALUE_SIZE];
+    memset(new_value, 0xEE, VALUE_SIZE);
+    make_key(key, 0);
+    kvs_update(key, strlen(key), new_value, VALUE_SIZE);
+    size_t value_len = VALUE_SIZE;
+    if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || memcmp(value, new_value, VALUE_SIZE) != 0) {
+        errors_update++;
+    }
+    make_key(key, 1);
+    kvs_delete(key, strlen(key));
+    value_len = VALUE_SIZE;
+    if (kvs_get(key, strlen(key), value, &value_len) != KVS_ERROR_KEY_NOT_FOUND) {
+        errors_update++;
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors_off == 0 && errors_on == 0 && errors_update == 0) {
+        printf("  ПРОВЕРКА: Все значения корректны, изменения видны сразу после записи.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок: %d (без кеша), %d (с кешем), %d (после изменений).\n",
+               errors_off, errors_on, errors_update);
+    }
+    if (latency_on < latency_off) {
+        printf("  ПРОВЕРКА: Кеш ускорил чтение в %.1f раз.\n", latency_off / latency_on);
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Кеш не ускорил чтение.\n");
+    }
+
+    kvs_deinit();
+
+    printf("\n=========================================================\n");
+    printf("           ТЕСТИРОВАНИЕ КЕША ЧТЕНИЯ ЗАВЕРШЕНО            \n");
+    printf("=========================================================\n");
+    return 0;
+}
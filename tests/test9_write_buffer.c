@@ -0,0 +1,405 @@
+#include "kvs_test_wrappers.h"
+#include "../src/key_value_store/kvs_internal.h"
+#include "kvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// --- Конфигурация теста ---
+#define TEST_USER_DATA_SIZE  (1024 * 128)
+#define NUM_LONG_KEYS        40
+#define NUM_ROUNDS           10
+#define TEMP_KEYS_PER_ROUND  6
+#define VALUE_SIZE           200
+#define NUM_BULK_KEYS        100
+#define WRITE_BUFFER_BYTES   (16 * 1024)
+#define SMALL_DATA_SIZE      (1024 * 8)
+#define MAX_FILL_KEYS        256
+const char* KVS_STORAGE_FILE_PATH = "../data/kvs_storage.bin";
+
+static void make_key(char *key, const char *prefix, int i) {
+    memset(key, 0, KVS_KEY_SIZE);
+    sprintf(key, "%s_%d", prefix, i);
+}
+
+// Значение из одних 0xFF неотличимо от стертой области, поэтому такой байт-заполнитель не используем.
+static uint8_t value_byte(int i, int round) {
+    return (uint8_t)((i * 7 + round) % 0xFF);
+}
+
+static void make_value(uint8_t *value, int i, int round) {
+    memset(value, value_byte(i, round), VALUE_SIZE);
+}
+
+// Суммарный счетчик перезаписи страниц: сколько раз устройство программировало страницы.
+static uint64_t total_page_rewrites(void) {
+    uint32_t count = (device->superblock.page_crc_offset - device->superblock.page_rewrite_offset) / sizeof(uint32_t);
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        total += device->page_rewrite_count[i];
+    }
+    return total;
+}
+
+// Проверяет, что долгоживущие ключи содержат значения последнего раунда,
+// ключи массовой записи на месте, а временных ключей нет.
+static int check_contents(void) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    uint8_t expected[VALUE_SIZE];
+    int errors = 0;
+    for (int i = 0; i < NUM_LONG_KEYS; i++) {
+        size_t value_len = VALUE_SIZE;
+        make_key(key, "long", i);
+        make_value(expected, i, NUM_ROUNDS);
+        if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || value_len != VALUE_SIZE || memcmp(value, expected, VALUE_SIZE) != 0) {
+            errors++;
+        }
+    }
+    for (int i = 0; i < NUM_BULK_KEYS; i++) {
+        size_t value_len = VALUE_SIZE;
+        make_key(key, "bulk", i);
+        make_value(expected, i, 0);
+        if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || memcmp(value, expected, VALUE_SIZE) != 0) {
+            errors++;
+        }
+    }
+    for (int i = 0; i < NUM_ROUNDS * TEMP_KEYS_PER_ROUND; i++) {
+        make_key(key, "temp", i);
+        if (kvs_exists(key, strlen(key)) != 0) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// Прогоняет нагрузку: долгоживущие ключи многократно обновляются, временные ключи
+// создаются, обновляются и удаляются в пределах одного раунда.
+// Возвращает количество ошибок операций, rewrites_out - прирост счетчика перезаписи страниц.
+static int run_workload(size_t write_buffer_bytes, uint64_t *rewrites_out) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    int errors = 0;
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS || !device) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return -1;
+    }
+    if (kvs_set_write_buffer(write_buffer_bytes) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось настроить буфер записи.\n");
+        return -1;
+    }
+
+    uint64_t rewrites_before = total_page_rewrites();
+    for (int i = 0; i < NUM_LONG_KEYS; i++) {
+        make_key(key, "long", i);
+        make_value(value, i, 0);
+        if (kvs_put(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+            errors++;
+        }
+    }
+    int temp_id = 0;
+    for (int round = 1; round <= NUM_ROUNDS; round++) {
+        for (int i = 0; i < NUM_LONG_KEYS; i++) {
+            make_key(key, "long", i);
+            make_value(value, i, round);
+            if (kvs_update(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+                errors++;
+            }
+        }
+        for (int t = 0; t < TEMP_KEYS_PER_ROUND; t++, temp_id++) {
+            size_t value_len = VALUE_SIZE;
+            make_key(key, "temp", temp_id);
+            make_value(value, temp_id, 0);
+            if (kvs_put(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+                errors++;
+            }
+            make_value(value, temp_id, 1);
+            if (kvs_update(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS ||
+                kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || value[0] != value_byte(temp_id, 1)) {
+                errors++;
+            }
+            if (kvs_delete(key, strlen(key)) != KVS_SUCCESS || kvs_exists(key, strlen(key)) != 0) {
+                errors++;
+            }
+        }
+    }
+
+    // Массовая запись новых ключей переполняет буфер и сбрасывает его пакетами
+    for (int i = 0; i < NUM_BULK_KEYS; i++) {
+        make_key(key, "bulk", i);
+        make_value(value, i, 0);
+        if (kvs_put(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+            errors++;
+        }
+    }
+
+    // Чтения до точки надежности обслуживаются буфером, после нее - устройством
+    errors += check_contents();
+    if (kvs_flush() != KVS_SUCCESS) {
+        errors++;
+    }
+    *rewrites_out = total_page_rewrites() - rewrites_before;
+    errors += check_contents();
+    return errors;
+}
+
+// Заполняет маленькое хранилище через буфер записи, который больше области данных.
+// Нехватка места должна вернуться из самой kvs_put, а сброс буфера - пройти без ошибок,
+// после чего буфер продолжает принимать записи.
+// Возвращает количество ошибок, accepted_out - сколько ключей принято до нехватки места.
+static int run_overflow(int *accepted_out) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    int errors = 0;
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(SMALL_DATA_SIZE) != KVS_SUCCESS || !device || kvs_set_write_buffer(WRITE_BUFFER_BYTES) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return -1;
+    }
+
+    // Шаг 1: Пишем новые ключи, пока put не сообщит о нехватке места
+    int accepted = 0;
+    kvs_status status = KVS_SUCCESS;
+    while (accepted < MAX_FILL_KEYS) {
+        make_key(key, "fill", accepted);
+        make_value(value, accepted, 0);
+        status = kvs_put(key, strlen(key), value, VALUE_SIZE);
+        if (status != KVS_SUCCESS) {
+            break;
+        }
+        accepted++;
+    }
+    if (status != KVS_ERROR_NO_SPACE) {
+        printf("  ОШИБКА: переполнение не обнаружено при записи (код %d).\n", status);
+        errors++;
+    }
+
+    // Шаг 2: Все принятые операции применяются к устройству
+    if (kvs_flush() != KVS_SUCCESS || device->memtable_count != 0) {
+        printf("  ОШИБКА: сброс буфера после переполнения завершился с ошибкой.\n");
+        errors++;
+    }
+
+    // Шаг 3: Буфер не заблокирован: удаление освобождает место под новый ключ
+    make_key(key, "fill", 0);
+    if (kvs_delete(key, strlen(key)) != KVS_SUCCESS) {
+        errors++;
+    }
+    make_key(key, "fill", accepted);
+    make_value(value, accepted, 0);
+    if (kvs_put(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS || kvs_flush() != KVS_SUCCESS) {
+        printf("  ОШИБКА: после удаления новый ключ не записан.\n");
+        errors++;
+    }
+
+    // Шаг 4: Все принятые ключи читаются
+    for (int i = 1; i <= accepted; i++) {
+        uint8_t expected[VALUE_SIZE];
+        size_t value_len = VALUE_SIZE;
+        make_key(key, "fill", i);
+        make_value(expected, i, 0);
+        if (kvs_get(key, strlen(key), value, &value_len) != KVS_SUCCESS || memcmp(value, expected, VALUE_SIZE) != 0) {
+            errors++;
+        }
+    }
+    kvs_deinit();
+    *accepted_out = accepted;
+    return errors;
+}
+
+// Заполняет маленькое хранилище и через буфер записи увеличивает значения обновлениями.
+// Обновление, которому не хватит места при сбросе, должно получить нехватку места сразу:
+// иначе при сбросе старая запись была бы удалена, а новая не записана.
+// Возвращает количество ошибок, grown_out - сколько значений удалось увеличить.
+static int run_update_growth(int *grown_out) {
+    char key[KVS_KEY_SIZE];
+    uint8_t value[2 * VALUE_SIZE];
+    uint8_t expected[2 * VALUE_SIZE];
+    size_t sizes[MAX_FILL_KEYS];
+    int rounds[MAX_FILL_KEYS];
+    int errors = 0;
+
+    remove(KVS_STORAGE_FILE_PATH);
+    if (kvs_init(SMALL_DATA_SIZE) != KVS_SUCCESS || !device || kvs_set_write_buffer(WRITE_BUFFER_BYTES) != KVS_SUCCESS) {
+        printf("Критическая ошибка: не удалось инициализировать хранилище.\n");
+        return -1;
+    }
+
+    // Шаг 1: Заполняем область данных новыми ключами
+    int count = 0;
+    while (count < MAX_FILL_KEYS) {
+        make_key(key, "grow", count);
+        make_value(value, count, 0);
+        if (kvs_put(key, strlen(key), value, VALUE_SIZE) != KVS_SUCCESS) {
+            break;
+        }
+        sizes[count]  = VALUE_SIZE;
+        rounds[count] = 0;
+        count++;
+    }
+
+    if (count < 3 || kvs_flush() != KVS_SUCCESS) {
+        printf("  ОШИБКА: не удалось заполнить хранилище.\n");
+        kvs_deinit();
+        return errors + 1;
+    }
+
+    // Шаг 2: Значение того же размера ложится на место прежнего, такое обновление принимается и в заполненном хранилище
+    make_key(key, "grow", 0);
+    make_value(value, 0, 1);
+    if (kvs_update(key, strlen(key), value, VALUE_SIZE) == KVS_SUCCESS) {
+        rounds[0] = 1;
+    } else {
+        printf("  ОШИБКА: обновление без роста значения отклонено.\n");
+        errors++;
+    }
+
+    // Шаг 3: Увеличиваем значения остальных ключей, пока update не сообщит о нехватке места
+    int grown = 0;
+    kvs_status status = KVS_SUCCESS;
+    for (int i = 1; i < count - 1; i++) {
+        make_key(key, "grow", i);
+        memset(value, value_byte(i, 1), sizeof(value));
+        status = kvs_update(key, strlen(key), value, sizeof(value));
+        if (status != KVS_SUCCESS) {
+            break;
+        }
+        sizes[i]  = sizeof(value);
+        rounds[i] = 1;
+        grown++;
+    }
+    if (status != KVS_ERROR_NO_SPACE) {
+        printf("  ОШИБКА: нехватка места не обнаружена при обновлении (код %d).\n", status);
+        errors++;
+    }
+
+    // Шаг 4: Put поверх отложенного удаления тоже заменяет запись на устройстве и проверяет место.
+    // Если места нет, удаление уже применено сбросом и ключа больше нет
+    int last = count - 1;
+    make_key(key, "grow", last);
+    memset(value, value_byte(last, 2), sizeof(value));
+    if (kvs_delete(key, strlen(key)) != KVS_SUCCESS) {
+        errors++;
+    }
+    status = kvs_put(key, strlen(key), value, sizeof(value));
+    if (status == KVS_SUCCESS) {
+        sizes[last]  = sizeof(value);
+        rounds[last] = 2;
+    } else if (status == KVS_ERROR_NO_SPACE) {
+        sizes[last] = 0;
+    } else {
+        printf("  ОШИБКА: put поверх отложенного удаления вернул код %d.\n", status);
+        errors++;
+    }
+
+    // Шаг 5: Все принятые операции применяются, ни один ключ не потерян
+    if (kvs_flush() != KVS_SUCCESS || device->memtable_count != 0) {
+        printf("  ОШИБКА: сброс буфера после обновлений завершился с ошибкой.\n");
+        errors++;
+    }
+    for (int i = 0; i < count; i++) {
+        size_t value_len = sizeof(value);
+        make_key(key, "grow", i);
+        status = kvs_get(key, strlen(key), value, &value_len);
+        if (sizes[i] == 0) {
+            if (status != KVS_ERROR_KEY_NOT_FOUND) {
+                errors++;
+            }
+            continue;
+        }
+        memset(expected, value_byte(i, rounds[i]), sizes[i]);
+        if (status != KVS_SUCCESS || value_len != sizes[i] || memcmp(value, expected, sizes[i]) != 0) {
+            printf("  ОШИБКА: ключ '%s' потерян или прочитан неверно (код %d).\n", key, status);
+            errors++;
+        }
+    }
+    kvs_deinit();
+    *grown_out = grown;
+    return errors;
+}
+
+// --- Основной тестовый сценарий ---
+
+int main() {
+    printf("=========================================================\n");
+    printf("           ЗАПУСК ТЕСТА БУФЕРА ЗАПИСИ (MEMTABLE)         \n");
+    printf("=========================================================\n");
+
+    uint64_t rewrites_direct = 0, rewrites_buffered = 0;
+
+    printf("\n--- Сценарий 1: запись напрямую на устройство ---\n");
+    int errors_direct = run_workload(0, &rewrites_direct);
+    if (errors_direct < 0) {
+        return 1;
+    }
+    printf("  Перезаписей страниц: %llu, ошибок: %d\n", (unsigned long long)rewrites_direct, errors_direct);
+    kvs_deinit();
+
+    printf("\n--- Сценарий 2: буфер записи %d байт ---\n", WRITE_BUFFER_BYTES);
+    int errors_buffered = run_workload(WRITE_BUFFER_BYTES, &rewrites_buffered);
+    if (errors_buffered < 0) {
+        return 1;
+    }
+    printf("  Перезаписей страниц: %llu, ошибок: %d\n", (unsigned long long)rewrites_buffered, errors_buffered);
+    printf("  Отложенных записей, не дошедших до устройства: %llu, примененных: %llu\n",
+           (unsigned long long)device->memtable_absorbed, (unsigned long long)device->memtable_flushed);
+
+    // Последние изменения, оставленные в буфере, должны пережить перезапуск благодаря сбросу в kvs_deinit
+    char key[KVS_KEY_SIZE];
+    uint8_t value[VALUE_SIZE];
+    make_key(key, "late", 0);
+    make_value(value, 0, 0);
+    bool late_ok = kvs_put(key, strlen(key), value, VALUE_SIZE) == KVS_SUCCESS;
+    kvs_deinit();
+
+    int errors_reload = 0;
+    if (kvs_init(TEST_USER_DATA_SIZE) != KVS_SUCCESS) {
+        errors_reload++;
+    } else {
+        errors_reload += check_contents();
+        late_ok = late_ok && kvs_exists(key, strlen(key)) == 1;
+        kvs_deinit();
+    }
+
+    printf("\n  Проверка данных:\n");
+    if (errors_direct == 0 && errors_buffered == 0 && errors_reload == 0 && late_ok) {
+        printf("  ПРОВЕРКА: Все значения корректны, в том числе после перезапуска.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Ошибок без буфера: %d, с буфером: %d, после перезапуска: %d, последняя запись %s.\n",
+               errors_direct, errors_buffered, errors_reload, late_ok ? "в порядке" : "потеряна");
+    }
+
+    printf("\n--- Сценарий 3: буфер записи больше свободного места ---\n");
+    int accepted = 0;
+    int errors_overflow = run_overflow(&accepted);
+    printf("  Принято ключей до нехватки места: %d, ошибок: %d\n", accepted, errors_overflow);
+    if (errors_overflow == 0) {
+        printf("  ПРОВЕРКА: Нехватка места возвращается из put, сброс буфера не блокируется.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Переполнение буфера записи обработано неверно.\n");
+    }
+
+    printf("\n--- Сценарий 4: обновления увеличивают значения в заполненном хранилище ---\n");
+    int grown = 0;
+    int errors_growth = run_update_growth(&grown);
+    printf("  Увеличено значений до нехватки места: %d, ошибок: %d\n", grown, errors_growth);
+    if (errors_growth == 0) {
+        printf("  ПРОВЕРКА: Нехватка места возвращается из update, обновленные ключи не теряются при сбросе.\n");
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Обновление с ростом значения обработано неверно.\n");
+    }
+    if (rewrites_buffered < rewrites_direct) {
+        printf("  ПРОВЕРКА: Буфер записи сократил перезаписи страниц в %.1f раза.\n", (double)rewrites_direct / rewrites_buffered);
+    } else {
+        printf("  ПРОВЕРКА: ОШИБКА! Буфер записи не сократил перезаписи страниц.\n");
+    }
+
+    printf("\n=========================================================\n");
+    printf("         ТЕСТИРОВАНИЕ БУФЕРА ЗАПИСИ ЗАВЕРШЕНО             \n");
+    printf("=========================================================\n");
+    return 0;
+}
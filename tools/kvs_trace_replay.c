@@ -0,0 +1,240 @@
+#include "kvs.h"
+#include "../src/ssdmmc_sim/ssdmmc_sim.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// Воспроизводит трассу ввода-вывода, снятую kvs_trace_start, на новом устройстве или в новом хранилище.
+//
+//   kvs_trace_replay <трасса> sim <файл устройства>
+//       Повторяет операции устройства (чтения, записи, стирания) на отформатированном устройстве.
+//   kvs_trace_replay <трасса> store <файл хранилища> [размер области данных]
+//       Повторяет операции API в новом хранилище. Ключей в трассе нет, поэтому ключ строится
+//       по его хешу ("trace:<хеш>"), а значение - по длине.
+//
+// В конце печатается сравнение операций устройства в трассе и при воспроизведении.
+
+#define REPLAY_DEFAULT_STORAGE (1024 * 256)
+#define REPLAY_CHUNK           1024
+
+static const char *op_names[KVS_OP_COUNT] = {"get", "put", "update", "delete", "exists"};
+
+// Операции устройства: из трассы или при воспроизведении.
+typedef struct {
+    uint64_t records;
+    uint64_t words_read;
+    uint64_t words_written;
+    uint64_t pages_erased;
+    uint64_t api_ops[KVS_OP_COUNT];
+    uint64_t first_device_ns;
+    uint64_t last_device_ns;
+} replay_totals;
+
+static void count_record(replay_totals *totals, const ssdmmc_sim_trace_record *record)
+{
+    if (totals->records++ == 0) {
+        totals->first_device_ns = record->device_ns;
+    }
+    totals->last_device_ns = record->device_ns;
+    switch (record->op) {
+    case SSDMMC_SIM_TRACE_READ:
+        totals->words_read += record->word_count;
+        break;
+    case SSDMMC_SIM_TRACE_WRITE:
+        totals->words_written += record->word_count;
+        break;
+    case SSDMMC_SIM_TRACE_ERASE:
+        totals->pages_erased++;
+        break;
+    default:
+        if (record->api_op < KVS_OP_COUNT) {
+            totals->api_ops[record->api_op]++;
+        }
+        break;
+    }
+}
+
+// Открывает файл трассы и проверяет заголовок: трасса должна быть снята на устройстве той же геометрии.
+static FILE *open_trace(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("Ошибка: не удалось открыть трассу %s.\n", path);
+        return NULL;
+    }
+    ssdmmc_sim_trace_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, SSDMMC_SIM_TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != SSDMMC_SIM_TRACE_VERSION || header.record_size != sizeof(ssdmmc_sim_trace_record)) {
+        printf("Ошибка: %s не является трассой ввода-вывода этой версии.\n", path);
+        fclose(file);
+        return NULL;
+    }
+    if (header.page_count != ssdmmc_sim_get_page_count() || header.words_per_page != ssdmmc_sim_get_words_per_page()
+        || header.word_size != ssdmmc_sim_get_word_size()) {
+        printf("Ошибка: трасса снята на устройстве другой геометрии (%u страниц по %u слов по %u байт).\n",
+               header.page_count, header.words_per_page, header.word_size);
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+// Повторяет операции устройства. Возвращает количество операций, завершившихся ошибкой, или -1.
+static long replay_sim(FILE *trace, const char *path, replay_totals *original, replay_totals *replayed, uint64_t *replay_ns)
+{
+    ssdmmc_sim_device *dev = ssdmmc_sim_open(path, true);
+    if (!dev || ssdmmc_sim_format(dev) != SSDMMC_OK) {
+        printf("Ошибка: не удалось создать устройство %s.\n", path);
+        ssdmmc_sim_close(dev);
+        return -1;
+    }
+
+    long failures = 0;
+    ssdmmc_sim_trace_record records[REPLAY_CHUNK];
+    size_t count;
+    while ((count = fread(records, sizeof(records[0]), REPLAY_CHUNK, trace)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            count_record(original, &records[i]);
+            failures += ssdmmc_sim_trace_replay(dev, &records[i]) != SSDMMC_OK;
+        }
+    }
+
+    ssdmmc_sim_io_counters io;
+    ssdmmc_sim_get_io_counters(dev, &io);
+    replayed->words_read    = io.words_read;
+    replayed->words_written = io.words_written;
+    replayed->pages_erased  = io.pages_erased;
+    memcpy(replayed->api_ops, original->api_ops, sizeof(replayed->api_ops));
+    *replay_ns = ssdmmc_sim_get_clock_ns(dev);
+    ssdmmc_sim_close(dev);
+    return failures;
+}
+
+// Повторяет операции API. Возвращает количество операций, результат которых отличается от трассы, или -1.
+static long replay_store(FILE *trace, const char *path, size_t storage_size, replay_totals *original, replay_totals *replayed, uint64_t *replay_ns)
+{
+    kvs_options options = {storage_size, KVS_LAYOUT_LINEAR, false, false};
+    kvs_handle *handle = NULL;
+    remove(path);
+    if (kvs_open(path, &options, &handle) != KVS_SUCCESS) {
+        printf("Ошибка: не удалось создать хранилище %s.\n", path);
+        return -1;
+    }
+    kvs_stats before;
+    uint64_t clock_before = 0;
+    kvs_get_stats_h(handle, &before);
+    kvs_get_device_time_h(handle, &clock_before);
+
+    long mismatches = 0;
+    size_t value_capacity = 0;
+    uint8_t *value = NULL;
+    ssdmmc_sim_trace_record records[REPLAY_CHUNK];
+    size_t count;
+    while ((count = fread(records, sizeof(records[0]), REPLAY_CHUNK, trace)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const ssdmmc_sim_trace_record *record = &records[i];
+            count_record(original, record);
+            if (record->op != SSDMMC_SIM_TRACE_EVENT || record->api_op >= KVS_OP_COUNT) {
+                continue;
+            }
+
+            // Шаг 1: Ключ строится по хешу, значение нужной длины - по хешу и длине
+            char key[KVS_KEY_SIZE];
+            memset(key, 0, sizeof(key));
+            snprintf(key, sizeof(key), "trace:%08x", record->key_hash);
+            size_t key_len = strlen(key);
+            size_t length = record->page;
+            if (length > value_capacity) {
+                uint8_t *grown = realloc(value, length);
+                if (!grown) {
+                    printf("Ошибка: не хватает памяти для значения длиной %zu.\n", length);
+                    free(value);
+                    kvs_close(handle);
+                    return -1;
+                }
+                value = grown;
+                value_capacity = length;
+            }
+            for (size_t j = 0; j < length; j++) {
+                value[j] = (uint8_t)((record->key_hash + j) % 0xFF);
+            }
+
+            // Шаг 2: Выполняем операцию и сравниваем результат с записанным
+            kvs_status status;
+            size_t value_len = value_capacity;
+            switch (record->api_op) {
+            case KVS_OP_GET:
+                status = kvs_get_h(handle, key, key_len, value, &value_len);
+                break;
+            case KVS_OP_PUT:
+                status = kvs_put_h(handle, key, key_len, value, length);
+                break;
+            case KVS_OP_UPDATE:
+                status = kvs_update_h(handle, key, key_len, value, length);
+                break;
+            case KVS_OP_DELETE:
+                status = kvs_delete_h(handle, key, key_len);
+                break;
+            default: {
+                int exists = kvs_exists_h(handle, key, key_len);
+                status = exists == 1 ? KVS_SUCCESS : exists == 0 ? KVS_ERROR_KEY_NOT_FOUND : (kvs_status)exists;
+                break;
+            }
+            }
+            replayed->api_ops[record->api_op]++;
+            mismatches += (int8_t)status != record->status;
+        }
+    }
+    free(value);
+
+    kvs_stats after;
+    kvs_get_stats_h(handle, &after);
+    kvs_get_device_time_h(handle, replay_ns);
+    *replay_ns -= clock_before;
+    replayed->words_read    = after.device_words_read - before.device_words_read;
+    replayed->words_written = after.device_words_written - before.device_words_written;
+    replayed->pages_erased  = after.device_pages_erased - before.device_pages_erased;
+    kvs_close(handle);
+    return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4 || (strcmp(argv[2], "sim") != 0 && strcmp(argv[2], "store") != 0)) {
+        printf("Использование: %s <трасса> sim <файл устройства>\n", argv[0]);
+        printf("               %s <трасса> store <файл хранилища> [размер области данных]\n", argv[0]);
+        return 2;
+    }
+    FILE *trace = open_trace(argv[1]);
+    if (!trace) {
+        return 1;
+    }
+
+    replay_totals original = {0}, replayed = {0};
+    uint64_t replay_ns = 0;
+    bool store = strcmp(argv[2], "store") == 0;
+    long problems = store ? replay_store(trace, argv[3], argc > 4 ? strtoull(argv[4], NULL, 0) : REPLAY_DEFAULT_STORAGE, &original, &replayed, &replay_ns)
+                          : replay_sim(trace, argv[3], &original, &replayed, &replay_ns);
+    fclose(trace);
+    if (problems < 0) {
+        return 1;
+    }
+
+    printf("Записей в трассе: %lu\n", (unsigned long)original.records);
+    printf("Операции API:");
+    for (int op = 0; op < KVS_OP_COUNT; op++) {
+        printf(" %s %lu", op_names[op], (unsigned long)replayed.api_ops[op]);
+    }
+    printf("\n");
+    printf("                      %14s %14s\n", "трасса", "повтор");
+    printf("Прочитано слов        %14lu %14lu\n", (unsigned long)original.words_read, (unsigned long)replayed.words_read);
+    printf("Записано слов         %14lu %14lu\n", (unsigned long)original.words_written, (unsigned long)replayed.words_written);
+    printf("Стерто страниц        %14lu %14lu\n", (unsigned long)original.pages_erased, (unsigned long)replayed.pages_erased);
+    printf("Время устройства, мкс %14.1f %14.1f\n", (original.last_device_ns - original.first_device_ns) / 1e3, replay_ns / 1e3);
+    if (store) {
+        printf("Операций с другим результатом: %ld\n", problems);
+    } else {
+        printf("Операций, завершившихся ошибкой: %ld\n", problems);
+    }
+    return 0;
+}